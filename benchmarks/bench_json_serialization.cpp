@@ -0,0 +1,111 @@
+// JSON serialization benchmark
+//
+// Serializes a synthetic snapshot of 10..1000 modules in the getModuleStats()
+// layout, once by building a QJsonArray of QJsonObjects and running it through
+// QJsonDocument (the previous implementation), once with the streaming
+// JsonWriter. Reports time and heap allocations per document; the reused
+// writer should allocate nothing once warmed up.
+//
+// Usage: bench_json_serialization [iterations]
+
+#include "json_writer.h"
+#include "snapshot.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleSample;
+using ProcessStats::Snapshot;
+
+namespace {
+    std::atomic<unsigned long long> s_allocations{0};
+
+    Snapshot makeSnapshot(int modules) {
+        Snapshot snapshot;
+        for (int i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(i);
+            module.stats = {i * 0.37, 100.0 + i * 1.25, 12.5 + i / 3.0};
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    QByteArray serializeWithQJson(const Snapshot& snapshot) {
+        QJsonArray modulesArray;
+        for (const ModuleSample& module : snapshot.modules) {
+            QJsonObject moduleObj;
+            moduleObj["name"] = QString::fromStdString(module.name);
+            moduleObj["cpu_percent"] = module.stats.cpuPercent;
+            moduleObj["cpu_time_seconds"] = module.stats.cpuTimeSeconds;
+            moduleObj["memory_mb"] = module.stats.memoryMB;
+            modulesArray.append(moduleObj);
+        }
+        return QJsonDocument(modulesArray).toJson(QJsonDocument::Compact);
+    }
+
+    template <typename Fn>
+    void measure(const char* label, int modules, int iterations, Fn serialize) {
+        serialize(); // warm up
+        const unsigned long long allocationsBefore = s_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        std::size_t bytes = 0;
+        for (int i = 0; i < iterations; ++i) {
+            bytes += serialize();
+        }
+        const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        const unsigned long long allocations = s_allocations.load() - allocationsBefore;
+
+        std::printf("%8d %10s %12.2f %14.2f %10zu\n", modules, label,
+                    elapsedUs / iterations,
+                    static_cast<double>(allocations) / iterations,
+                    bytes / iterations);
+    }
+}
+
+void* operator new(std::size_t size) {
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    std::printf("iterations=%d (QJson allocations exclude Qt's own malloc use)\n", iterations);
+    std::printf("%8s %10s %12s %14s %10s\n", "modules", "writer", "us_per_doc", "allocs_per_doc", "bytes");
+
+    for (int modules : {10, 100, 1000}) {
+        const Snapshot snapshot = makeSnapshot(modules);
+
+        measure("qjson", modules, iterations, [&]() {
+            return static_cast<std::size_t>(serializeWithQJson(snapshot).size());
+        });
+
+        JsonWriter writer;
+        measure("streaming", modules, iterations, [&]() {
+            writer.clear();
+            writeModuleStatsJson(writer, snapshot);
+            return writer.size();
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Module registry benchmark
+//
+// Times one tick of sampling 10..1000 modules and writing the
+// getModuleStats() JSON, once with modules passed by name on every call and
+// once registered in a ModuleRegistry. Counters come from a synthetic
+// SampleSource, so the difference is the per-tick string work rather than
+// /proc reads.
+//
+// Usage: bench_module_registry [ticks]
+
+#include "json_writer.h"
+#include "module_registry.h"
+#include "stats_engine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleRef;
+using ProcessStats::ModuleRegistry;
+using ProcessStats::RawCounters;
+using ProcessStats::RegistrySample;
+using ProcessStats::SamplerOptions;
+using ProcessStats::SampleSource;
+using ProcessStats::StatsEngine;
+
+namespace {
+    struct SyntheticSource : SampleSource {
+        int64_t tick = 0;
+        int64_t nowNs() override { return tick * 1000000000; }
+        int64_t wallTimeMs() override { return tick * 1000; }
+        RawCounters read(int64_t pid) const override {
+            RawCounters counters;
+            counters.cpuTimeSeconds = (pid % 97) * tick / 100.0;
+            counters.memoryMB = (20480 + pid * 12) / 1024.0;
+            counters.readTimeNs = tick * 1000000000;
+            counters.valid = true;
+            return counters;
+        }
+    };
+
+    template <typename Tick>
+    double timeTicks(SyntheticSource& source, int ticks, Tick tick) {
+        tick(); // warm up buffers and CPU history
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ticks; ++i) {
+            ++source.tick;
+            tick();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ticks;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int ticks = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    std::printf("ticks=%d\n", ticks);
+    std::printf("%8s %14s %14s\n", "modules", "us_by_name", "us_registered");
+
+    for (int count : {10, 100, 1000}) {
+        std::vector<std::string> names;
+        for (int i = 0; i < count; ++i) {
+            names.push_back("org.example.plugin.module_" + std::to_string(i));
+        }
+
+        auto source = std::make_shared<SyntheticSource>();
+        SamplerOptions options;
+        options.source = source;
+        JsonWriter writer;
+
+        // Names handed over on every call, as getModuleStats() callers do
+        StatsEngine byName(options);
+        std::vector<ModuleRef> modules;
+        const double byNameUs = timeTicks(*source, ticks, [&] {
+            modules.clear();
+            for (int i = 0; i < count; ++i) {
+                modules.push_back(ModuleRef{names[i], 1000 + i});
+            }
+            writer.clear();
+            ProcessStats::writeModuleStatsJson(writer, byName.sampleModules(modules));
+        });
+
+        StatsEngine byId(options);
+        ModuleRegistry registry;
+        for (int i = 0; i < count; ++i) {
+            registry.add(names[i], 1000 + i);
+        }
+        RegistrySample sample;
+        const double registeredUs = timeTicks(*source, ticks, [&] {
+            byId.sampleModules(registry, sample);
+            writer.clear();
+            ProcessStats::writeModuleStatsJson(writer, sample.snapshot, registry.jsonNames().data());
+        });
+
+        std::printf("%8d %14.2f %14.2f\n", count, byNameUs, registeredUs);
+    }
+    return 0;
+}
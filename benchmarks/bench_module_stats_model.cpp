@@ -0,0 +1,81 @@
+// Table model benchmark
+//
+// Feeds ModuleStatsModel a tick of 100..5000 modules in which a tenth of
+// the CPU readings move, once through update() and once by clearing the
+// model and filling it again, as a dashboard that rebuilds its table from
+// the JSON array does. Reports the time per tick and the dataChanged()
+// signals a view would receive.
+//
+// Usage: bench_module_stats_model [ticks]
+
+#include "module_stats_model.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::ModuleStatsModel;
+using ProcessStats::Snapshot;
+
+namespace {
+    Snapshot makeSnapshot(int modules) {
+        Snapshot snapshot;
+        for (int i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "org.example.plugin.module_" + std::to_string(i);
+            module.pid = 1000 + i;
+            module.stats = {1.0, 10.0, 20.0 + i};
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    // Move the CPU reading of every tenth module, a different tenth per tick
+    void advance(Snapshot& snapshot, int tick) {
+        for (std::size_t i = static_cast<std::size_t>(tick % 10); i < snapshot.modules.size(); i += 10) {
+            snapshot.modules[i].stats.cpuPercent += 0.5;
+            snapshot.modules[i].stats.cpuTimeSeconds += 0.005;
+        }
+    }
+
+    template <typename Tick>
+    double timeTicks(Snapshot& snapshot, int ticks, Tick tick) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ticks; ++i) {
+            advance(snapshot, i);
+            tick();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ticks;
+    }
+}
+
+int main(int argc, char** argv) {
+    const int ticks = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    std::printf("ticks=%d\n", ticks);
+    std::printf("%8s %14s %16s %14s\n", "modules", "us_rebuild", "us_incremental", "signals/tick");
+
+    for (int count : {100, 1000, 5000}) {
+        Snapshot snapshot = makeSnapshot(count);
+
+        ModuleStatsModel rebuilt;
+        const double rebuildUs = timeTicks(snapshot, ticks, [&] {
+            rebuilt.clear();
+            rebuilt.update(snapshot);
+        });
+
+        ModuleStatsModel incremental;
+        incremental.update(snapshot);
+        long long signals = 0;
+        QObject::connect(&incremental, &QAbstractItemModel::dataChanged, [&signals] { ++signals; });
+        const double incrementalUs = timeTicks(snapshot, ticks, [&] {
+            incremental.update(snapshot);
+        });
+
+        std::printf("%8d %14.2f %16.2f %14.1f\n", count, rebuildUs, incrementalUs,
+                    static_cast<double>(signals) / ticks);
+    }
+    return 0;
+}
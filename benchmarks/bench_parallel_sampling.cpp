@@ -0,0 +1,96 @@
+// Scaling benchmark for parallel sampling
+//
+// Samples a large PID set with 1, 2, 4 and 8 read workers and reports the
+// mean wall time per tick, then compares one serial batch against a
+// sampleProcess() call per PID. Live PIDs from /proc are repeated until the
+// set reaches the requested size, so every read hits a real procfs entry.
+//
+// Usage: bench_parallel_sampling [pid_count] [ticks]
+
+#include "sampler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Sampler;
+using ProcessStats::SamplerOptions;
+
+namespace {
+    std::vector<int64_t> livePids() {
+        std::vector<int64_t> pids;
+        DIR* dir = opendir("/proc");
+        if (!dir) {
+            return pids;
+        }
+        while (dirent* entry = readdir(dir)) {
+            char* end = nullptr;
+            long pid = std::strtol(entry->d_name, &end, 10);
+            if (pid > 0 && end && *end == '\0') {
+                pids.push_back(pid);
+            }
+        }
+        closedir(dir);
+        return pids;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t pidCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const int ticks = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::vector<int64_t> live = livePids();
+    if (live.empty()) {
+        live.push_back(getpid());
+    }
+    std::vector<int64_t> pids(pidCount);
+    for (std::size_t i = 0; i < pidCount; ++i) {
+        pids[i] = live[i % live.size()];
+    }
+    std::vector<ProcessStatsData> out(pidCount);
+
+    std::printf("pids=%zu distinct=%zu ticks=%d hardware_threads=%ld\n",
+                pidCount, live.size(), ticks, sysconf(_SC_NPROCESSORS_ONLN));
+    std::printf("%8s %14s %10s\n", "workers", "ms_per_tick", "speedup");
+
+    double baselineMs = 0.0;
+    for (std::size_t workers : {1u, 2u, 4u, 8u}) {
+        SamplerOptions options;
+        options.workerCount = workers;
+        Sampler sampler(options);
+
+        // Warm up dentry caches and the CPU baselines
+        sampler.sample(pids.data(), pids.size(), out.data());
+
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < ticks; ++tick) {
+            sampler.sample(pids.data(), pids.size(), out.data());
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double msPerTick = std::chrono::duration<double, std::milli>(elapsed).count() / std::max(ticks, 1);
+        if (workers == 1) {
+            baselineMs = msPerTick;
+        }
+        std::printf("%8zu %14.2f %9.2fx\n", workers, msPerTick, baselineMs / msPerTick);
+    }
+
+    // The same serial tick as per-PID calls, each with its own setup
+    Sampler sampler;
+    for (int64_t pid : pids) {
+        sampler.sampleProcess(pid);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; ++tick) {
+        for (int64_t pid : pids) {
+            sampler.sampleProcess(pid);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double msPerTick = std::chrono::duration<double, std::milli>(elapsed).count() / std::max(ticks, 1);
+    std::printf("%8s %14.2f %9.2fx\n", "per-pid", msPerTick, baselineMs / msPerTick);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Prometheus exposition benchmark
+//
+// Renders a synthetic snapshot of 10..1000 modules repeatedly with one
+// PrometheusWriter, so label blocks come from its cache as they would on
+// successive scrapes, and reports the time per scrape.
+//
+// Usage: bench_prometheus [iterations]
+
+#include "prometheus_writer.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::PrometheusWriter;
+using ProcessStats::Snapshot;
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    std::printf("iterations=%d\n", iterations);
+    std::printf("%8s %12s %10s\n", "modules", "us_per_scrape", "bytes");
+
+    for (int modules : {10, 100, 1000}) {
+        Snapshot snapshot;
+        for (int i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(i);
+            module.pid = 1000 + i;
+            // Shaped like real readings: CPU time in clock ticks, RSS in KiB
+            module.stats = {i * 0.37, (10000 + i * 7) / 100.0, (20480 + i * 12) / 1024.0};
+            module.windowMs = 1000;
+            snapshot.modules.push_back(module);
+        }
+
+        PrometheusWriter writer;
+        writer.render(snapshot); // warm up the label cache
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            writer.render(snapshot);
+        }
+        const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8d %12.2f %10zu\n", modules, elapsedUs / iterations, writer.size());
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Time-series store benchmark
+//
+// Records a synthetic week of snapshots of 500 modules into a segmented
+// recording, opens it with TimeSeriesStore and times the queries a
+// dashboard makes: a few minutes of one module, a whole day of one module,
+// and hourly aggregates over the week. Reports recording throughput,
+// bytes per sample, the time to index the store and the latency of each
+// query averaged over modules.
+//
+// Usage: bench_timeseries_store [directory] [modules] [interval_ms] [days]
+
+#include "snapshot_recorder.h"
+#include "timeseries_store.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+using ProcessStats::AggregatedSample;
+using ProcessStats::ModuleSample;
+using ProcessStats::RecordedSample;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotRecorder;
+using ProcessStats::TimeSeriesStore;
+
+namespace {
+    constexpr int64_t kStartMs = 1700006400000;  // a midnight, UTC
+    constexpr int64_t kMinuteMs = 60 * 1000;
+    constexpr int64_t kHourMs = 60 * kMinuteMs;
+    constexpr int64_t kDayMs = 24 * kHourMs;
+
+    double elapsedSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void removeRecording(const std::string& directory) {
+        if (DIR* entries = opendir(directory.c_str())) {
+            while (dirent* entry = readdir(entries)) {
+                if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                    std::remove((directory + "/" + entry->d_name).c_str());
+                }
+            }
+            closedir(entries);
+        }
+        rmdir(directory.c_str());
+    }
+
+    // Times fn over every tenth module and returns the mean in microseconds
+    template<typename Query>
+    double timeQueries(int modules, Query&& fn) {
+        int count = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int m = 0; m < modules; m += 10, ++count) {
+            fn("module_" + std::to_string(m));
+        }
+        return elapsedSince(start) * 1e6 / count;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string directory = argc > 1 ? argv[1] : "/tmp/bench_timeseries_store";
+    const int modules = argc > 2 ? std::atoi(argv[2]) : 500;
+    const int64_t intervalMs = argc > 3 ? std::atoll(argv[3]) : 10000;
+    const int days = argc > 4 ? std::atoi(argv[4]) : 7;
+    const int64_t rows = days * kDayMs / intervalMs;
+
+    std::printf("modules=%d interval_ms=%lld days=%d rows=%lld\n", modules,
+                static_cast<long long>(intervalMs), days, static_cast<long long>(rows));
+    removeRecording(directory);
+
+    // Shaped like real readings: CPU time in clock ticks, RSS drifting in
+    // 4 KiB pages
+    Snapshot snapshot;
+    for (int i = 0; i < modules; ++i) {
+        ModuleSample module;
+        module.name = "module_" + std::to_string(i);
+        module.pid = 1000 + i;
+        module.stats = {0.0, 0.0, (20480 + i * 12) / 1024.0};
+        snapshot.modules.push_back(module);
+    }
+
+    uint64_t recorded = 0;
+    uint64_t encoded = 0;
+    uint64_t dropped = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto recorder = SnapshotRecorder::openDirectory(directory);
+        if (!recorder) {
+            std::perror(directory.c_str());
+            return 1;
+        }
+        uint32_t random = 12345;
+        for (int64_t row = 0; row < rows; ++row) {
+            snapshot.timestampMs = kStartMs + row * intervalMs;
+            for (int i = 0; i < modules; ++i) {
+                random = random * 1664525u + 1013904223u;
+                auto& stats = snapshot.modules[i].stats;
+                const double ticks = (random >> 28) % (1 + i % 8);
+                stats.cpuPercent = ticks * 1000.0 / intervalMs;
+                stats.cpuTimeSeconds += ticks / 100.0;
+                if ((random >> 8) % 16 == 0) {
+                    stats.memoryMB += ((random >> 12) % 3 - 1.0) * 4.0 / 1024.0;
+                }
+            }
+            recorder->record(snapshot);
+        }
+        recorded = recorder->recordedSamples();
+        encoded = recorder->encodedBytes();
+        dropped = recorder->droppedSamples();
+    }
+    const double recordSeconds = elapsedSince(start);
+    std::printf("record: %.2f s, %.1f M samples/s, %.3f bytes/sample, %llu dropped\n", recordSeconds,
+                recorded / recordSeconds / 1e6, static_cast<double>(encoded) / recorded,
+                static_cast<unsigned long long>(dropped));
+
+    start = std::chrono::steady_clock::now();
+    auto store = TimeSeriesStore::open(directory);
+    if (!store) {
+        std::perror(directory.c_str());
+        return 1;
+    }
+    std::printf("open: %.2f ms, %zu segments\n", elapsedSince(start) * 1e3, store->segmentCount());
+
+    // 14:02 to 14:05 on the middle day
+    const int64_t day = kStartMs + (days / 2) * kDayMs;
+    const int64_t from = day + 14 * kHourMs + 2 * kMinuteMs;
+    std::vector<RecordedSample> samples;
+    std::vector<AggregatedSample> buckets;
+
+    uint64_t decodedBefore = store->blocksDecoded();
+    double us = timeQueries(modules, [&](const std::string& module) {
+        samples.clear();
+        store->query(module, from, from + 3 * kMinuteMs, samples);
+    });
+    std::printf("query 3 min:   %10.1f us, %zu samples, %.1f blocks\n", us, samples.size(),
+                (store->blocksDecoded() - decodedBefore) / ((modules + 9) / 10.0));
+
+    decodedBefore = store->blocksDecoded();
+    us = timeQueries(modules, [&](const std::string& module) {
+        samples.clear();
+        store->query(module, day, day + kDayMs, samples);
+    });
+    std::printf("query 1 day:   %10.1f us, %zu samples, %.1f blocks\n", us, samples.size(),
+                (store->blocksDecoded() - decodedBefore) / ((modules + 9) / 10.0));
+
+    decodedBefore = store->blocksDecoded();
+    us = timeQueries(modules, [&](const std::string& module) {
+        buckets.clear();
+        store->aggregate(module, kStartMs, kStartMs + days * kDayMs, kHourMs, buckets);
+    });
+    std::printf("hourly, week:  %10.1f us, %zu buckets, %.1f blocks\n", us, buckets.size(),
+                (store->blocksDecoded() - decodedBefore) / ((modules + 9) / 10.0));
+
+    store.reset();
+    removeRecording(directory);
+    return 0;
+}
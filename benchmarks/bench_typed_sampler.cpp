@@ -0,0 +1,88 @@
+// Compile-time metric selection benchmark
+//
+// Samples the live PIDs from /proc, repeated up to the requested count,
+// with the runtime-configured Sampler (both metrics, one worker) and with
+// TypedSampler for CPU and RSS, CPU only and RSS only. Reports the mean
+// time per PID; the RSS-only sampler reads just /proc/[pid]/statm.
+//
+// Usage: bench_typed_sampler [pid_count] [ticks]
+
+#include "sampler.h"
+#include "typed_sampler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Sampler;
+using ProcessStats::TypedSampler;
+namespace Metrics = ProcessStats::Metrics;
+
+namespace {
+    std::vector<int64_t> livePids() {
+        std::vector<int64_t> pids;
+        DIR* dir = opendir("/proc");
+        if (!dir) {
+            return pids;
+        }
+        while (dirent* entry = readdir(dir)) {
+            char* end = nullptr;
+            long pid = std::strtol(entry->d_name, &end, 10);
+            if (pid > 0 && end && *end == '\0') {
+                pids.push_back(pid);
+            }
+        }
+        closedir(dir);
+        return pids;
+    }
+
+    template <typename Tick>
+    double nsPerPid(std::size_t pidCount, int ticks, Tick tick) {
+        tick(); // warm up history and the dentry cache
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ticks; ++i) {
+            tick();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+            / (static_cast<double>(ticks) * pidCount);
+    }
+
+    template <ProcessStats::MetricSet M>
+    double timeTyped(const std::vector<int64_t>& pids, int ticks) {
+        TypedSampler<M> sampler;
+        std::vector<typename TypedSampler<M>::Reading> out(pids.size());
+        return nsPerPid(pids.size(), ticks, [&] { sampler.sample(pids.data(), pids.size(), out.data()); });
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t pidCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    const int ticks = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::vector<int64_t> live = livePids();
+    if (live.empty()) {
+        live.push_back(getpid());
+    }
+    std::vector<int64_t> pids(pidCount);
+    for (std::size_t i = 0; i < pidCount; ++i) {
+        pids[i] = live[i % live.size()];
+    }
+
+    std::printf("pids=%zu distinct=%zu ticks=%d\n", pidCount, live.size(), ticks);
+    std::printf("%-28s %12s %14s\n", "sampler", "ns_per_pid", "reading_bytes");
+
+    Sampler runtime;
+    std::vector<ProcessStatsData> stats(pidCount);
+    const double runtimeNs = nsPerPid(pidCount, ticks, [&] { runtime.sample(pids.data(), pids.size(), stats.data()); });
+    std::printf("%-28s %12.0f %14zu\n", "Sampler", runtimeNs, sizeof(ProcessStatsData));
+    std::printf("%-28s %12.0f %14zu\n", "TypedSampler<Cpu | Rss>", timeTyped<Metrics::All>(pids, ticks),
+                sizeof(TypedSampler<Metrics::All>::Reading));
+    std::printf("%-28s %12.0f %14zu\n", "TypedSampler<Cpu>", timeTyped<Metrics::Cpu>(pids, ticks),
+                sizeof(TypedSampler<Metrics::Cpu>::Reading));
+    std::printf("%-28s %12.0f %14zu\n", "TypedSampler<Rss>", timeTyped<Metrics::Rss>(pids, ticks),
+                sizeof(TypedSampler<Metrics::Rss>::Reading));
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "adaptive_scheduler.h"
+#include "sampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ProcessStats {
+
+    AdaptiveScheduler::AdaptiveScheduler(Sampler& sampler, AdaptiveIntervalOptions options)
+        : m_sampler(sampler),
+          m_options(options) {
+        if (m_options.maxInterval < m_options.minInterval) {
+            m_options.maxInterval = m_options.minInterval;
+        }
+        m_options.initialInterval = std::clamp(m_options.initialInterval, m_options.minInterval, m_options.maxInterval);
+    }
+
+    void AdaptiveScheduler::addModule(const std::string& name, int64_t pid, Clock::time_point now) {
+        auto existing = m_index.find(name);
+        if (existing != m_index.end()) {
+            Module& module = m_modules[existing->second];
+            if (module.pid != pid) {
+                // Restarted under a new PID: start over from a fresh baseline
+                m_sampler.forget(module.pid);
+                module.pid = pid;
+                module.hasReading = false;
+                module.interval = m_options.initialInterval;
+                schedule(existing->second, now);
+            }
+            return;
+        }
+
+        uint32_t index;
+        if (!m_freeModules.empty()) {
+            index = m_freeModules.back();
+            m_freeModules.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_modules.size());
+            m_modules.emplace_back();
+        }
+
+        Module& module = m_modules[index];
+        module.name = name;
+        module.pid = pid;
+        module.interval = m_options.initialInterval;
+        module.hasReading = false;
+        module.active = true;
+        m_index.emplace(name, index);
+        schedule(index, now);
+    }
+
+    bool AdaptiveScheduler::removeModule(const std::string& name) {
+        auto it = m_index.find(name);
+        if (it == m_index.end()) {
+            return false;
+        }
+        Module& module = m_modules[it->second];
+        m_sampler.forget(module.pid);
+        module.active = false;
+        ++module.generation;
+        m_freeModules.push_back(it->second);
+        m_index.erase(it);
+        return true;
+    }
+
+    std::size_t AdaptiveScheduler::sampleDue(Clock::time_point now, std::vector<ModuleSample>& out) {
+        m_due.clear();
+        m_pids.clear();
+        while (!m_deadlines.empty() && m_deadlines.top().due <= now) {
+            Deadline deadline = m_deadlines.top();
+            m_deadlines.pop();
+            const Module& module = m_modules[deadline.module];
+            if (!module.active || module.generation != deadline.generation) {
+                continue;
+            }
+            m_due.push_back(deadline.module);
+            m_pids.push_back(module.pid);
+        }
+        if (m_due.empty()) {
+            return 0;
+        }
+
+        m_stats.resize(m_pids.size());
+        m_windows.resize(m_pids.size());
+        m_readTimes.resize(m_pids.size());
+        m_status.resize(m_pids.size());
+        m_sampler.sample(m_pids.data(), m_pids.size(), m_stats.data(), m_windows.data(), m_readTimes.data(),
+                         m_status.data());
+
+        for (std::size_t i = 0; i < m_due.size(); ++i) {
+            Module& module = m_modules[m_due[i]];
+            const ProcessStatsData& stats = m_stats[i];
+
+            if (m_status[i] != ModuleStatus::Ok) {
+                // Zeroed stats of a process that cannot be read are not a
+                // change: poll it as rarely as allowed, and start from a
+                // fresh baseline if it comes back
+                module.interval = m_options.maxInterval;
+                module.hasReading = false;
+            } else {
+                // CPU percentages need two readings before they mean anything
+                if (module.hasReading && m_windows[i] > 0) {
+                    module.interval = nextInterval(module.last, stats, module.interval, m_options);
+                }
+                module.last = stats;
+                module.hasReading = true;
+            }
+            schedule(m_due[i], now + module.interval);
+
+            ModuleSample sample;
+            sample.name = module.name;
+            sample.pid = module.pid;
+            sample.stats = stats;
+            sample.windowMs = m_windows[i];
+            sample.readTimeNs = m_readTimes[i];
+            sample.status = m_status[i];
+            out.push_back(std::move(sample));
+        }
+        return m_due.size();
+    }
+
+    AdaptiveScheduler::Clock::time_point AdaptiveScheduler::nextDeadline() {
+        dropStaleDeadlines();
+        return m_deadlines.empty() ? Clock::time_point::max() : m_deadlines.top().due;
+    }
+
+    std::chrono::milliseconds AdaptiveScheduler::interval(const std::string& name) const {
+        auto it = m_index.find(name);
+        return it == m_index.end() ? std::chrono::milliseconds(0) : m_modules[it->second].interval;
+    }
+
+    std::chrono::milliseconds AdaptiveScheduler::nextInterval(const ProcessStatsData& previous,
+                                                              const ProcessStatsData& current,
+                                                              std::chrono::milliseconds interval,
+                                                              const AdaptiveIntervalOptions& options) {
+        const double cpuChange = std::fabs(current.cpuPercent - previous.cpuPercent);
+        const double memoryBase = std::max(previous.memoryMB, 1.0);
+        const double memoryChange = std::fabs(current.memoryMB - previous.memoryMB) / memoryBase;
+        const bool changing = cpuChange > options.cpuChangePercent || memoryChange > options.memoryChangeRatio;
+
+        const double factor = changing ? options.speedUpFactor : options.slowDownFactor;
+        auto next = std::chrono::milliseconds(static_cast<int64_t>(std::llround(interval.count() * factor)));
+        return std::clamp(next, options.minInterval, options.maxInterval);
+    }
+
+    void AdaptiveScheduler::schedule(uint32_t module, Clock::time_point due) {
+        Module& entry = m_modules[module];
+        ++entry.generation;
+        m_deadlines.push(Deadline{due, module, entry.generation});
+    }
+
+    void AdaptiveScheduler::dropStaleDeadlines() {
+        while (!m_deadlines.empty()) {
+            const Deadline& top = m_deadlines.top();
+            const Module& module = m_modules[top.module];
+            if (module.active && module.generation == top.generation) {
+                return;
+            }
+            m_deadlines.pop();
+        }
+    }
+
+}
@@ -0,0 +1,116 @@
+#ifndef PROCESS_STATS_ADAPTIVE_SCHEDULER_H
+#define PROCESS_STATS_ADAPTIVE_SCHEDULER_H
+
+#include "snapshot.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    class Sampler;
+
+    struct AdaptiveIntervalOptions {
+        // Bounds for each module's sampling interval
+        std::chrono::milliseconds minInterval{250};
+        std::chrono::milliseconds maxInterval{10000};
+
+        // Interval used for a module until it has two readings
+        std::chrono::milliseconds initialInterval{1000};
+
+        // A module counts as changing fast if its CPU percentage moved by more
+        // than cpuChangePercent points, or its memory by more than
+        // memoryChangeRatio of the previous value, since its last sample
+        double cpuChangePercent = 5.0;
+        double memoryChangeRatio = 0.05;
+
+        // Interval multipliers applied to changing and stable modules
+        double speedUpFactor = 0.5;
+        double slowDownFactor = 1.5;
+    };
+
+    // Samples each module on its own cadence
+    //
+    // Modules sit in a min-heap keyed by their next deadline. sampleDue()
+    // reads every module whose deadline has passed in one batch, then halves
+    // the interval of modules whose CPU or memory is changing fast and
+    // stretches it for stable ones, within the configured bounds. CPU
+    // percentages always cover the real time between a module's two most
+    // recent reads, reported as ModuleSample::windowMs. A module that cannot
+    // be read reports why in ModuleSample::status and drops to maxInterval.
+    class AdaptiveScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit AdaptiveScheduler(Sampler& sampler, AdaptiveIntervalOptions options = AdaptiveIntervalOptions());
+
+        AdaptiveScheduler(const AdaptiveScheduler&) = delete;
+        AdaptiveScheduler& operator=(const AdaptiveScheduler&) = delete;
+
+        // Add a module, or update its PID if it already exists; it is due at now
+        void addModule(const std::string& name, int64_t pid, Clock::time_point now);
+
+        // Stop sampling a module; returns false if it was not registered
+        bool removeModule(const std::string& name);
+
+        // Sample every module due at now and append the results to out
+        // Returns the number of modules sampled
+        std::size_t sampleDue(Clock::time_point now, std::vector<ModuleSample>& out);
+
+        // Earliest deadline over all modules; Clock::time_point::max() if none
+        Clock::time_point nextDeadline();
+
+        // Current interval of a module; 0 if it is not registered
+        std::chrono::milliseconds interval(const std::string& name) const;
+
+        std::size_t moduleCount() const { return m_index.size(); }
+
+        // Interval to use after a sample, given the module's previous and
+        // current readings
+        static std::chrono::milliseconds nextInterval(const ProcessStatsData& previous,
+                                                      const ProcessStatsData& current,
+                                                      std::chrono::milliseconds interval,
+                                                      const AdaptiveIntervalOptions& options);
+
+    private:
+        struct Module {
+            std::string name;
+            int64_t pid = 0;
+            std::chrono::milliseconds interval{0};
+            ProcessStatsData last = {0.0, 0.0, 0.0};
+            bool hasReading = false;
+            bool active = false;
+            uint32_t generation = 0;  // bumped to invalidate queued deadlines
+        };
+
+        struct Deadline {
+            Clock::time_point due;
+            uint32_t module;
+            uint32_t generation;
+            bool operator>(const Deadline& other) const { return due > other.due; }
+        };
+
+        void schedule(uint32_t module, Clock::time_point due);
+        void dropStaleDeadlines();
+
+        Sampler& m_sampler;
+        AdaptiveIntervalOptions m_options;
+        std::vector<Module> m_modules;
+        std::vector<uint32_t> m_freeModules;
+        std::unordered_map<std::string, uint32_t> m_index;
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_deadlines;
+
+        // Scratch buffers reused between calls
+        std::vector<uint32_t> m_due;
+        std::vector<int64_t> m_pids;
+        std::vector<ProcessStatsData> m_stats;
+        std::vector<int64_t> m_windows;
+        std::vector<int64_t> m_readTimes;
+        std::vector<ModuleStatus> m_status;
+    };
+}
+
+#endif // PROCESS_STATS_ADAPTIVE_SCHEDULER_H
@@ -0,0 +1,116 @@
+#include "async_sampler.h"
+#include "stats_engine.h"
+#include <utility>
+
+namespace ProcessStats {
+
+    AsyncSampler::AsyncSampler(StatsEngine& engine)
+        : m_engine(engine) {}
+
+    AsyncSampler::~AsyncSampler() {
+        std::deque<Request> abandoned;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            abandoned.swap(m_queue);
+        }
+        m_wake.notify_all();
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+        for (Request& request : abandoned) {
+            request.done(nullptr);
+        }
+    }
+
+    void AsyncSampler::submit(const ModuleRef* modules, std::size_t count, Completion done, CancelCheck cancelled) {
+        Request request;
+        request.names.reserve(count);
+        request.pids.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            request.names.emplace_back(modules[i].name);
+            request.pids.push_back(modules[i].pid);
+        }
+        request.done = std::move(done);
+        request.cancelled = std::move(cancelled);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_stopping) {
+                m_queue.push_back(std::move(request));
+                if (!m_worker.joinable()) {
+                    m_worker = std::thread(&AsyncSampler::run, this);
+                }
+                m_wake.notify_one();
+                return;
+            }
+        }
+        request.done(nullptr);
+    }
+
+    std::size_t AsyncSampler::pending() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size() + m_running;
+    }
+
+    uint64_t AsyncSampler::sampleCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sampleCount;
+    }
+
+    void AsyncSampler::run() {
+        std::vector<Request> batch;
+        std::vector<ModuleRef> modules;
+        std::vector<bool> skipped;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+
+            // Take the oldest request and every queued one for the same
+            // modules; all were submitted before this sample starts
+            batch.clear();
+            batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+            for (auto it = m_queue.begin(); it != m_queue.end();) {
+                if (it->pids == batch.front().pids && it->names == batch.front().names) {
+                    batch.push_back(std::move(*it));
+                    it = m_queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            m_running = batch.size();
+            lock.unlock();
+
+            // Cancelled requests are skipped; the sample runs if any is left
+            skipped.clear();
+            bool wanted = false;
+            for (const Request& request : batch) {
+                skipped.push_back(request.cancelled && request.cancelled());
+                wanted = wanted || !skipped.back();
+            }
+            Snapshot snapshot;
+            if (wanted) {
+                const Request& first = batch.front();
+                modules.clear();
+                for (std::size_t i = 0; i < first.pids.size(); ++i) {
+                    modules.push_back(ModuleRef{first.names[i], first.pids[i]});
+                }
+                snapshot = m_engine.sampleModules(modules.data(), modules.size());
+            }
+
+            lock.lock();
+            m_running = 0;
+            m_sampleCount += wanted ? 1 : 0;
+            lock.unlock();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                batch[i].done(skipped[i] ? nullptr : &snapshot);
+            }
+            lock.lock();
+        }
+    }
+
+}
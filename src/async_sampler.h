@@ -0,0 +1,77 @@
+#ifndef PROCESS_STATS_ASYNC_SAMPLER_H
+#define PROCESS_STATS_ASYNC_SAMPLER_H
+
+#include "snapshot.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ProcessStats {
+    class StatsEngine;
+
+    // Runs StatsEngine::sampleModules() on a thread of its own
+    //
+    // submit() copies the request into a queue and returns at once, so the
+    // caller never waits for /proc; the worker, started on the first
+    // submit(), samples and calls the completion. Requests for the same
+    // modules that are queued together are served by one sample, so a
+    // caller that keeps asking while reads are slow does not pile up work.
+    //
+    // Other threads may keep sampling the same engine meanwhile; the engine
+    // serializes them with the worker.
+    class AsyncSampler {
+    public:
+        // Called on the worker with the snapshot, or with nullptr if the
+        // request was cancelled or the sampler shut down first
+        using Completion = std::function<void(const Snapshot* snapshot)>;
+
+        // Asked on the worker just before sampling; true skips the request
+        using CancelCheck = std::function<bool()>;
+
+        explicit AsyncSampler(StatsEngine& engine);
+
+        // Completes queued requests with nullptr, then joins the worker
+        ~AsyncSampler();
+
+        AsyncSampler(const AsyncSampler&) = delete;
+        AsyncSampler& operator=(const AsyncSampler&) = delete;
+
+        // Queue a sample of count modules (copied); never blocks on sampling
+        void submit(const ModuleRef* modules, std::size_t count, Completion done,
+                    CancelCheck cancelled = CancelCheck());
+
+        // Requests queued or being sampled
+        std::size_t pending() const;
+
+        // Samples taken; lower than the number of requests when some were
+        // served together or cancelled
+        uint64_t sampleCount() const;
+
+    private:
+        struct Request {
+            std::vector<std::string> names;
+            std::vector<int64_t> pids;
+            Completion done;
+            CancelCheck cancelled;
+        };
+
+        void run();
+
+        StatsEngine& m_engine;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<Request> m_queue;
+        std::size_t m_running = 0;
+        uint64_t m_sampleCount = 0;
+        bool m_stopping = false;
+        std::thread m_worker;
+    };
+}
+
+#endif // PROCESS_STATS_ASYNC_SAMPLER_H
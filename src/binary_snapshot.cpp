@@ -0,0 +1,153 @@
+#include "binary_snapshot.h"
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+
+// Scratch space for interning names, reused across encodes on each thread
+namespace {
+    struct NameTable {
+        std::unordered_map<std::string_view, uint32_t> offsets;
+        std::vector<std::string_view> unique;
+        std::vector<uint32_t> moduleOffsets;  // per module, into the table
+        uint32_t size = 0;                    // bytes including NULs and padding
+    };
+
+    constexpr std::size_t kAlignment = 8;
+
+    constexpr std::size_t alignUp(std::size_t value) {
+        return (value + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    static_assert(sizeof(ps_snapshot_header) == 64, "binary snapshot header layout changed");
+    static_assert(sizeof(ps_module_record) == 64, "binary snapshot record layout changed");
+    static_assert(offsetof(ps_module_record, status) == PS_MODULE_RECORD_MIN_SIZE,
+                  "fields must be appended to records");
+    static_assert(static_cast<uint32_t>(ModuleStatus::Zombie) == PS_MODULE_ZOMBIE,
+                  "PS_MODULE_* must match ModuleStatus");
+    static_assert(sizeof(ps_module_record) % kAlignment == 0, "records must keep 8-byte alignment");
+    static_assert(sizeof(ps_self_stats) % kAlignment == 0, "the self entry must keep 8-byte alignment");
+
+    NameTable& internNames(const Snapshot& snapshot) {
+        thread_local NameTable table;
+        table.offsets.clear();
+        table.unique.clear();
+        table.moduleOffsets.clear();
+
+        std::size_t size = 0;
+        for (const ModuleSample& module : snapshot.modules) {
+            auto inserted = table.offsets.emplace(module.name, static_cast<uint32_t>(size));
+            if (inserted.second) {
+                table.unique.push_back(module.name);
+                size += module.name.size() + 1;
+            }
+            table.moduleOffsets.push_back(inserted.first->second);
+        }
+        table.size = static_cast<uint32_t>(alignUp(size));
+        return table;
+    }
+}
+
+    std::size_t encodeBinarySnapshot(const Snapshot& snapshot, void* buffer, std::size_t bufferSize) {
+        const NameTable& names = internNames(snapshot);
+        const std::size_t recordsSize = sizeof(ps_module_record) * snapshot.modules.size();
+        const std::size_t namesOffset = sizeof(ps_snapshot_header) + recordsSize;
+        const std::size_t selfOffset = namesOffset + names.size;
+        const std::size_t totalSize = selfOffset + (snapshot.hasSelfStats ? sizeof(ps_self_stats) : 0);
+        if (!buffer || bufferSize < totalSize) {
+            return totalSize;
+        }
+
+        char* out = static_cast<char*>(buffer);
+
+        ps_snapshot_header header = {};
+        header.magic = PS_SNAPSHOT_MAGIC;
+        header.version = PS_SNAPSHOT_VERSION;
+        header.header_size = sizeof(ps_snapshot_header);
+        header.record_size = sizeof(ps_module_record);
+        header.module_count = static_cast<uint32_t>(snapshot.modules.size());
+        header.sequence = snapshot.sequence;
+        header.timestamp_ms = snapshot.timestampMs;
+        header.batch_start_ns = snapshot.batchStartNs;
+        header.batch_end_ns = snapshot.batchEndNs;
+        header.names_offset = static_cast<uint32_t>(namesOffset);
+        header.names_size = names.size;
+        header.total_size = static_cast<uint32_t>(totalSize);
+        header.self_offset = snapshot.hasSelfStats ? static_cast<uint32_t>(selfOffset) : 0;
+        memcpy(out, &header, sizeof(header));
+
+        char* recordOut = out + sizeof(ps_snapshot_header);
+        for (std::size_t i = 0; i < snapshot.modules.size(); ++i) {
+            const ModuleSample& module = snapshot.modules[i];
+            ps_module_record record = {};
+            record.cpu_percent = module.stats.cpuPercent;
+            record.cpu_time_seconds = module.stats.cpuTimeSeconds;
+            record.memory_mb = module.stats.memoryMB;
+            record.pid = module.pid;
+            record.window_ms = module.windowMs;
+            record.read_time_ns = module.readTimeNs;
+            record.name_offset = names.moduleOffsets[i];
+            record.name_length = static_cast<uint32_t>(module.name.size());
+            record.status = static_cast<uint32_t>(module.status);
+            memcpy(recordOut, &record, sizeof(record));
+            recordOut += sizeof(record);
+        }
+
+        // Unique names in first-use order, so their offsets line up with the interning pass
+        char* nameOut = out + namesOffset;
+        for (std::string_view name : names.unique) {
+            memcpy(nameOut, name.data(), name.size());
+            nameOut += name.size();
+            *nameOut++ = '\0';
+        }
+        memset(nameOut, 0, out + selfOffset - nameOut);
+
+        if (snapshot.hasSelfStats) {
+            const SelfStats& stats = snapshot.selfStats;
+            const ps_self_stats self = {stats.ticks, stats.pidsSampled, stats.syscalls, stats.bytesRead,
+                                        stats.readNs, stats.computeNs, stats.serializeNs, stats.allocations,
+                                        stats.maxTickNs};
+            memcpy(out + selfOffset, &self, sizeof(self));
+        }
+        return totalSize;
+    }
+
+    void encodeBinarySnapshot(const Snapshot& snapshot, std::string& out) {
+        const std::size_t size = encodeBinarySnapshot(snapshot, nullptr, 0);
+        out.resize(size);
+        encodeBinarySnapshot(snapshot, &out[0], out.size());
+    }
+
+    bool decodeBinarySnapshot(const void* data, std::size_t size, Snapshot& out) {
+        BinarySnapshotView view(data, size);
+        if (!view.isValid()) {
+            return false;
+        }
+
+        const ps_snapshot_header& header = view.header();
+        out.sequence = header.sequence;
+        out.timestampMs = header.timestamp_ms;
+        out.batchStartNs = header.batch_start_ns;
+        out.batchEndNs = header.batch_end_ns;
+        out.modules.resize(header.module_count);
+        for (uint32_t i = 0; i < header.module_count; ++i) {
+            const ps_module_record& record = view.record(i);
+            ModuleSample& module = out.modules[i];
+            module.name.assign(view.name(i));
+            module.pid = record.pid;
+            module.stats = {record.cpu_percent, record.cpu_time_seconds, record.memory_mb};
+            module.windowMs = record.window_ms;
+            module.readTimeNs = record.read_time_ns;
+            module.status = view.status(i);
+        }
+        const ps_self_stats* self = ps_snapshot_self(&header);
+        out.hasSelfStats = self != nullptr;
+        out.selfStats = self ? SelfStats{self->ticks, self->pids_sampled, self->syscalls, self->bytes_read,
+                                         self->read_ns, self->compute_ns, self->serialize_ns, self->allocations,
+                                         self->max_tick_ns}
+                             : SelfStats();
+        return true;
+    }
+
+}
@@ -0,0 +1,63 @@
+#ifndef PROCESS_STATS_BINARY_SNAPSHOT_H
+#define PROCESS_STATS_BINARY_SNAPSHOT_H
+
+#include "binary_snapshot_format.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ProcessStats {
+    // Encode snapshot in the binary layout described in binary_snapshot_format.h
+    // Returns the encoded size. The snapshot is written only if it fits in
+    // bufferSize bytes; pass nullptr/0 to query the size. buffer must be
+    // 8-byte aligned for readers to use it in place.
+    std::size_t encodeBinarySnapshot(const Snapshot& snapshot, void* buffer, std::size_t bufferSize);
+
+    // Encode into out, replacing its contents and reusing its capacity
+    void encodeBinarySnapshot(const Snapshot& snapshot, std::string& out);
+
+    // Decode a binary snapshot into its structured form
+    // Returns false, leaving out untouched, if the data is not a valid snapshot
+    bool decodeBinarySnapshot(const void* data, std::size_t size, Snapshot& out);
+
+    // In-place, read-only view of an encoded snapshot
+    // Validates once on construction; accessors then read the buffer directly
+    // and must only be used while isValid(). The buffer must outlive the view.
+    class BinarySnapshotView {
+    public:
+        BinarySnapshotView(const void* data, std::size_t size)
+            : m_header(ps_snapshot_validate(data, size)) {}
+
+        bool isValid() const { return m_header != nullptr; }
+
+        const ps_snapshot_header& header() const { return *m_header; }
+        uint64_t sequence() const { return m_header->sequence; }
+        uint32_t moduleCount() const { return m_header->module_count; }
+
+        const ps_module_record& record(uint32_t index) const { return *ps_snapshot_record(m_header, index); }
+
+        // Status of a module; Ok for snapshots written without one, and
+        // Exited for values this reader does not know
+        ModuleStatus status(uint32_t index) const {
+            const uint32_t status = ps_module_status(m_header, &record(index));
+            return status <= PS_MODULE_ZOMBIE ? static_cast<ModuleStatus>(status) : ModuleStatus::Exited;
+        }
+
+        // The __process_stats__ entry, or nullptr
+        const ps_self_stats* self() const { return ps_snapshot_self(m_header); }
+
+        // Module name, empty if the record's name reference is out of range
+        std::string_view name(uint32_t index) const {
+            const ps_module_record& entry = record(index);
+            const char* text = ps_snapshot_name(m_header, &entry);
+            return text ? std::string_view(text, entry.name_length) : std::string_view();
+        }
+
+    private:
+        const ps_snapshot_header* m_header;
+    };
+}
+
+#endif // PROCESS_STATS_BINARY_SNAPSHOT_H
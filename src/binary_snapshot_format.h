@@ -0,0 +1,134 @@
+/*
+ * Binary snapshot layout, shared with C consumers
+ *
+ * A snapshot is one contiguous, 8-byte aligned buffer:
+ *
+ *     ps_snapshot_header                 (64 bytes)
+ *     ps_module_record[module_count]     (record_size bytes each)
+ *     name table                         (NUL-terminated UTF-8 names, padded to 8)
+ *     ps_self_stats                      (optional, at self_offset)
+ *
+ * All integers and doubles are in the writer's native byte order; the format
+ * is meant for processes on the same host. Readers check magic, version and
+ * sizes once, then read records in place. Fields are only ever appended to
+ * the header and records within a major version, so readers must use
+ * header_size/record_size to step over them rather than sizeof().
+ */
+#ifndef PROCESS_STATS_BINARY_SNAPSHOT_FORMAT_H
+#define PROCESS_STATS_BINARY_SNAPSHOT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PS_SNAPSHOT_MAGIC 0x53505350u /* "PSPS" */
+#define PS_SNAPSHOT_VERSION 1u
+
+/* Records of writers that predate ps_module_record.status */
+#define PS_MODULE_RECORD_MIN_SIZE 56u
+
+/* ps_module_record.status, as ProcessStats::ModuleStatus */
+#define PS_MODULE_OK 0u
+#define PS_MODULE_EXITED 1u                 /* no such process */
+#define PS_MODULE_PERMISSION_DENIED 2u      /* the process exists but may not be read */
+#define PS_MODULE_ZOMBIE 3u                 /* the process has exited and awaits its parent */
+
+typedef struct ps_snapshot_header {
+    uint32_t magic;           /* PS_SNAPSHOT_MAGIC; byte-swapped means foreign endianness */
+    uint16_t version;         /* PS_SNAPSHOT_VERSION */
+    uint16_t header_size;     /* bytes from the start of the header to the records */
+    uint32_t record_size;     /* stride of the record array */
+    uint32_t module_count;
+    uint64_t sequence;
+    int64_t timestamp_ms;     /* wall clock, ms since the epoch */
+    int64_t batch_start_ns;   /* monotonic bounds of the read phase */
+    int64_t batch_end_ns;
+    uint32_t names_offset;    /* from the start of the buffer */
+    uint32_t names_size;      /* including padding */
+    uint32_t total_size;      /* whole snapshot, a multiple of 8 */
+    uint32_t self_offset;     /* the __process_stats__ entry (ps_self_stats), 0 if absent */
+} ps_snapshot_header;
+
+typedef struct ps_module_record {
+    double cpu_percent;
+    double cpu_time_seconds;
+    double memory_mb;
+    int64_t pid;
+    int64_t window_ms;        /* time cpu_percent was measured over, 0 on a first reading */
+    int64_t read_time_ns;     /* monotonic time this module was read */
+    uint32_t name_offset;     /* into the name table; names are shared between records */
+    uint32_t name_length;     /* bytes, excluding the NUL terminator */
+    uint32_t status;          /* PS_MODULE_*; read it with ps_module_status() */
+    uint32_t reserved;        /* 0 */
+} ps_module_record;
+
+/* The sampler's own cost (SelfStats), cumulative; times are in nanoseconds */
+typedef struct ps_self_stats {
+    uint64_t ticks;
+    uint64_t pids_sampled;
+    uint64_t syscalls;
+    uint64_t bytes_read;
+    uint64_t read_ns;
+    uint64_t compute_ns;
+    uint64_t serialize_ns;
+    uint64_t allocations;
+    uint64_t max_tick_ns;
+} ps_self_stats;
+
+/* Returns the header if data holds a complete snapshot this reader understands */
+static inline const ps_snapshot_header* ps_snapshot_validate(const void* data, size_t size)
+{
+    const ps_snapshot_header* header = (const ps_snapshot_header*)data;
+    if (!data || ((uintptr_t)data & 7u) != 0 || size < sizeof(ps_snapshot_header))
+        return NULL;
+    if (header->magic != PS_SNAPSHOT_MAGIC || header->version != PS_SNAPSHOT_VERSION)
+        return NULL;
+    if (header->header_size < sizeof(ps_snapshot_header) || header->record_size < PS_MODULE_RECORD_MIN_SIZE
+        || (header->header_size & 7u) != 0 || (header->record_size & 7u) != 0)
+        return NULL;
+    if (header->total_size > size
+        || (uint64_t)header->header_size + (uint64_t)header->record_size * header->module_count > header->names_offset
+        || (uint64_t)header->names_offset + header->names_size > header->total_size)
+        return NULL;
+    return header;
+}
+
+static inline const ps_module_record* ps_snapshot_record(const ps_snapshot_header* header, uint32_t index)
+{
+    return (const ps_module_record*)((const char*)header + header->header_size
+                                     + (size_t)header->record_size * index);
+}
+
+/* NUL-terminated module name, or NULL if the record points outside the name table */
+static inline const char* ps_snapshot_name(const ps_snapshot_header* header, const ps_module_record* record)
+{
+    if ((uint64_t)record->name_offset + record->name_length >= header->names_size)
+        return NULL;
+    return (const char*)header + header->names_offset + record->name_offset;
+}
+
+/* PS_MODULE_* status of a record; PS_MODULE_OK from writers without the field */
+static inline uint32_t ps_module_status(const ps_snapshot_header* header, const ps_module_record* record)
+{
+    if (header->record_size < offsetof(ps_module_record, status) + sizeof(record->status))
+        return PS_MODULE_OK;
+    return record->status;
+}
+
+/* The __process_stats__ entry, or NULL if the snapshot has none */
+static inline const ps_self_stats* ps_snapshot_self(const ps_snapshot_header* header)
+{
+    if (header->self_offset == 0 || (header->self_offset & 7u) != 0
+        || (uint64_t)header->self_offset + sizeof(ps_self_stats) > header->total_size)
+        return NULL;
+    return (const ps_self_stats*)((const char*)header + header->self_offset);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROCESS_STATS_BINARY_SNAPSHOT_FORMAT_H */
@@ -0,0 +1,189 @@
+#include "coalescing_sampler.h"
+#include "sampler.h"
+#include <algorithm>
+
+namespace ProcessStats {
+
+    CoalescingSampler::CoalescingSampler(Sampler& sampler,
+                                         std::chrono::milliseconds window,
+                                         std::chrono::milliseconds retention,
+                                         std::mutex* samplerMutex)
+        : m_sampler(sampler),
+          m_samplerMutex(samplerMutex),
+          m_window(window),
+          m_retention(retention) {
+    }
+
+    void CoalescingSampler::setWindow(std::chrono::milliseconds window) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_window = window;
+    }
+
+    std::chrono::milliseconds CoalescingSampler::window() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_window;
+    }
+
+    uint64_t CoalescingSampler::tickCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_tickCount;
+    }
+
+    void CoalescingSampler::clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.clear();
+    }
+
+    void CoalescingSampler::sample(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                                   int64_t* windowMs, int64_t* readTimeNs, ModuleStatus* status) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Clock::time_point notBefore = Clock::now() - m_window;
+
+        for (;;) {
+            if (servedFromCache(pids, count, out, windowMs, readTimeNs, status, notBefore)) {
+                return;
+            }
+
+            if (m_tickRunning) {
+                // Join the running tick if it reads everything we need,
+                // otherwise queue our PIDs for the next one
+                if (coveredBy(m_inFlight, pids, count)) {
+                    notBefore = std::min(notBefore, m_tickStart);
+                } else {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (pids[i] > 0) {
+                            m_pending.insert(pids[i]);
+                        }
+                    }
+                }
+                const uint64_t tick = m_tickCount;
+                m_tickDone.wait(lock, [&]() { return m_tickCount != tick; });
+                continue;
+            }
+
+            runTick(lock, pids, count);
+            notBefore = std::min(notBefore, m_tickStart);
+        }
+    }
+
+    bool CoalescingSampler::servedFromCache(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                                            int64_t* windowMs, int64_t* readTimeNs, ModuleStatus* status,
+                                            Clock::time_point notBefore) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (pids[i] <= 0) {
+                continue;
+            }
+            auto it = m_cache.find(pids[i]);
+            if (it == m_cache.end() || it->second.sampledAt < notBefore) {
+                return false;
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (pids[i] <= 0) {
+                out[i] = ProcessStatsData{0.0, 0.0, 0.0};
+                if (windowMs) {
+                    windowMs[i] = 0;
+                }
+                if (readTimeNs) {
+                    readTimeNs[i] = 0;
+                }
+                if (status) {
+                    status[i] = ModuleStatus::Exited;
+                }
+                continue;
+            }
+            CachedStats& cached = m_cache[pids[i]];
+            cached.requestedAt = now;
+            out[i] = cached.stats;
+            if (windowMs) {
+                windowMs[i] = cached.windowMs;
+            }
+            if (readTimeNs) {
+                readTimeNs[i] = cached.readTimeNs;
+            }
+            if (status) {
+                status[i] = cached.status;
+            }
+        }
+        return true;
+    }
+
+    bool CoalescingSampler::coveredBy(const std::unordered_set<int64_t>& set,
+                                      const int64_t* pids, std::size_t count) const {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (pids[i] > 0 && set.count(pids[i]) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void CoalescingSampler::runTick(std::unique_lock<std::mutex>& lock, const int64_t* pids, std::size_t count) {
+        const Clock::time_point tickStart = Clock::now();
+        m_tickStart = tickStart;
+
+        // This tick reads our PIDs plus everything queued by other callers
+        m_inFlight.swap(m_pending);
+        m_pending.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (pids[i] > 0) {
+                m_inFlight.insert(pids[i]);
+            }
+        }
+        m_tickPids.assign(m_inFlight.begin(), m_inFlight.end());
+
+        // Keep baselines for PIDs any caller asked for recently; forget the rest
+        std::vector<int64_t> retained(m_tickPids);
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            if (tickStart - it->second.requestedAt > m_retention && m_inFlight.count(it->first) == 0) {
+                it = m_cache.erase(it);
+            } else {
+                retained.push_back(it->first);
+                ++it;
+            }
+        }
+        m_tickRunning = true;
+
+        lock.unlock();
+        try {
+            std::unique_lock<std::mutex> samplerLock;
+            if (m_samplerMutex) {
+                samplerLock = std::unique_lock<std::mutex>(*m_samplerMutex);
+            }
+            m_sampler.retainOnly(retained.data(), retained.size());
+            m_tickStats.resize(m_tickPids.size());
+            m_tickWindows.resize(m_tickPids.size());
+            m_tickReadTimes.resize(m_tickPids.size());
+            m_tickStatus.resize(m_tickPids.size());
+            m_sampler.sample(m_tickPids.data(), m_tickPids.size(), m_tickStats.data(),
+                             m_tickWindows.data(), m_tickReadTimes.data(), m_tickStatus.data());
+        } catch (...) {
+            lock.lock();
+            m_inFlight.clear();
+            m_tickRunning = false;
+            ++m_tickCount;
+            m_tickDone.notify_all();
+            throw;
+        }
+        lock.lock();
+
+        for (std::size_t i = 0; i < m_tickPids.size(); ++i) {
+            CachedStats& cached = m_cache[m_tickPids[i]];
+            cached.stats = m_tickStats[i];
+            cached.windowMs = m_tickWindows[i];
+            cached.readTimeNs = m_tickReadTimes[i];
+            cached.status = m_tickStatus[i];
+            cached.sampledAt = tickStart;
+            if (cached.requestedAt < tickStart) {
+                cached.requestedAt = tickStart;
+            }
+        }
+        m_inFlight.clear();
+        m_tickRunning = false;
+        ++m_tickCount;
+        m_tickDone.notify_all();
+    }
+
+}
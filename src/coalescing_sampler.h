@@ -0,0 +1,95 @@
+#ifndef PROCESS_STATS_COALESCING_SAMPLER_H
+#define PROCESS_STATS_COALESCING_SAMPLER_H
+
+#include "snapshot.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ProcessStats {
+    class Sampler;
+
+    // Thread-safe single-flight front for a Sampler
+    //
+    // Callers that ask for PIDs read less than `window` ago are answered from
+    // the last tick. Callers that arrive while a tick is running wait for it
+    // if it covers their PIDs, or queue their PIDs for the next tick, which
+    // one of them then runs for everybody. Each caller only gets the PIDs it
+    // asked for, and CPU baselines are kept for every PID requested within
+    // `retention`, so callers with different PID sets no longer reset each
+    // other's baselines.
+    class CoalescingSampler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Ticks lock samplerMutex, if given, around their use of sampler, so
+        // an owner that also calls sampler directly can share it safely
+        CoalescingSampler(Sampler& sampler,
+                          std::chrono::milliseconds window,
+                          std::chrono::milliseconds retention = std::chrono::seconds(60),
+                          std::mutex* samplerMutex = nullptr);
+
+        CoalescingSampler(const CoalescingSampler&) = delete;
+        CoalescingSampler& operator=(const CoalescingSampler&) = delete;
+
+        // Fill out[i] with the stats for pids[i]; invalid PIDs yield zeroed stats
+        // windowMs, readTimeNs and status are optional, as for Sampler::sample()
+        // Safe to call from any number of threads
+        void sample(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                    int64_t* windowMs = nullptr, int64_t* readTimeNs = nullptr,
+                    ModuleStatus* status = nullptr);
+
+        void setWindow(std::chrono::milliseconds window);
+        std::chrono::milliseconds window() const;
+
+        // Number of ticks run on the underlying sampler
+        uint64_t tickCount() const;
+
+        // Drop cached results; the next call starts a new tick
+        void clear();
+
+    private:
+        struct CachedStats {
+            ProcessStatsData stats;
+            int64_t windowMs;
+            int64_t readTimeNs;
+            ModuleStatus status;
+            Clock::time_point sampledAt;
+            Clock::time_point requestedAt;
+        };
+
+        bool servedFromCache(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                             int64_t* windowMs, int64_t* readTimeNs, ModuleStatus* status,
+                             Clock::time_point notBefore);
+        bool coveredBy(const std::unordered_set<int64_t>& set, const int64_t* pids, std::size_t count) const;
+        void runTick(std::unique_lock<std::mutex>& lock, const int64_t* pids, std::size_t count);
+
+        Sampler& m_sampler;
+        std::mutex* m_samplerMutex;
+        std::chrono::milliseconds m_window;
+        std::chrono::milliseconds m_retention;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_tickDone;
+        std::unordered_map<int64_t, CachedStats> m_cache;
+        std::unordered_set<int64_t> m_inFlight;  // PIDs of the running tick
+        std::unordered_set<int64_t> m_pending;   // PIDs queued for the next tick
+        bool m_tickRunning = false;
+        Clock::time_point m_tickStart;
+        uint64_t m_tickCount = 0;
+
+        // Leader-only scratch buffers, reused between ticks
+        std::vector<int64_t> m_tickPids;
+        std::vector<ProcessStatsData> m_tickStats;
+        std::vector<int64_t> m_tickWindows;
+        std::vector<int64_t> m_tickReadTimes;
+        std::vector<ModuleStatus> m_tickStatus;
+    };
+}
+
+#endif // PROCESS_STATS_COALESCING_SAMPLER_H
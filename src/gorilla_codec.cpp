@@ -0,0 +1,198 @@
+#include "gorilla_codec.h"
+#include <cstring>
+
+namespace ProcessStats {
+
+namespace {
+    constexpr int kMaxLeadingZeros = 31;  // fits the 5-bit field
+
+    uint64_t toBits(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    double fromBits(uint64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    int countLeadingZeros(uint64_t value) {
+        return __builtin_clzll(value);
+    }
+
+    int countTrailingZeros(uint64_t value) {
+        return __builtin_ctzll(value);
+    }
+
+    int64_t signExtend(uint64_t value, int bits) {
+        const uint64_t sign = uint64_t(1) << (bits - 1);
+        return static_cast<int64_t>((value ^ sign) - sign);
+    }
+
+    uint64_t lowBits(int64_t value, int bits) {
+        return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+    }
+}
+
+    void BitWriter::write(uint64_t value, int bits) {
+        while (bits > 0) {
+            const std::size_t byte = m_bits / 8;
+            if (byte == m_bytes.size()) {
+                m_bytes.push_back(0);
+            }
+            const int free = 8 - static_cast<int>(m_bits % 8);
+            const int chunk = bits < free ? bits : free;
+            const uint64_t part = (value >> (bits - chunk)) & ((uint64_t(1) << chunk) - 1);
+            m_bytes[byte] |= static_cast<uint8_t>(part << (free - chunk));
+            m_bits += static_cast<std::size_t>(chunk);
+            bits -= chunk;
+        }
+    }
+
+    void BitWriter::truncate(std::size_t bits) {
+        if (bits >= m_bits) {
+            return;
+        }
+        m_bits = bits;
+        m_bytes.resize(byteCount());
+        if (m_bits % 8) {
+            // write() ORs into the last byte, so clear the dropped bits
+            m_bytes.back() &= static_cast<uint8_t>(0xff << (8 - m_bits % 8));
+        }
+    }
+
+    uint64_t BitReader::read(int bits) {
+        if (m_position + static_cast<std::size_t>(bits) > m_bits) {
+            m_overrun = true;
+            m_position = m_bits;
+            return 0;
+        }
+        uint64_t value = 0;
+        while (bits > 0) {
+            const int available = 8 - static_cast<int>(m_position % 8);
+            const int chunk = bits < available ? bits : available;
+            const uint8_t byte = m_data[m_position / 8];
+            const uint64_t part = (byte >> (available - chunk)) & ((1u << chunk) - 1);
+            value = (value << chunk) | part;
+            m_position += static_cast<std::size_t>(chunk);
+            bits -= chunk;
+        }
+        return value;
+    }
+
+    void TimestampEncoder::append(BitWriter& out, int64_t timestamp) {
+        if (!started) {
+            out.write(static_cast<uint64_t>(timestamp), 64);
+            previous = timestamp;
+            started = true;
+            return;
+        }
+        // Wrapping arithmetic: any pair of timestamps round-trips
+        const int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(timestamp) - static_cast<uint64_t>(previous));
+        const int64_t change = static_cast<int64_t>(static_cast<uint64_t>(delta) - static_cast<uint64_t>(interval));
+        previous = timestamp;
+        interval = delta;
+
+        if (change == 0) {
+            out.writeBit(false);
+        } else if (change >= -64 && change <= 63) {
+            out.write(0b10, 2);
+            out.write(lowBits(change, 7), 7);
+        } else if (change >= -256 && change <= 255) {
+            out.write(0b110, 3);
+            out.write(lowBits(change, 9), 9);
+        } else if (change >= -2048 && change <= 2047) {
+            out.write(0b1110, 4);
+            out.write(lowBits(change, 12), 12);
+        } else {
+            out.write(0b1111, 4);
+            out.write(static_cast<uint64_t>(change), 64);
+        }
+    }
+
+    int64_t TimestampDecoder::next(BitReader& in) {
+        if (!started) {
+            previous = static_cast<int64_t>(in.read(64));
+            started = true;
+            return previous;
+        }
+        int64_t change = 0;
+        if (in.readBit()) {
+            if (!in.readBit()) {
+                change = signExtend(in.read(7), 7);
+            } else if (!in.readBit()) {
+                change = signExtend(in.read(9), 9);
+            } else if (!in.readBit()) {
+                change = signExtend(in.read(12), 12);
+            } else {
+                change = static_cast<int64_t>(in.read(64));
+            }
+        }
+        interval = static_cast<int64_t>(static_cast<uint64_t>(interval) + static_cast<uint64_t>(change));
+        previous = static_cast<int64_t>(static_cast<uint64_t>(previous) + static_cast<uint64_t>(interval));
+        return previous;
+    }
+
+    void XorEncoder::append(BitWriter& out, double value) {
+        const uint64_t bits = toBits(value);
+        if (!started) {
+            out.write(bits, 64);
+            previous = bits;
+            started = true;
+            return;
+        }
+        const uint64_t x = bits ^ previous;
+        previous = bits;
+        if (x == 0) {
+            out.writeBit(false);
+            return;
+        }
+
+        int lead = countLeadingZeros(x);
+        const int trail = countTrailingZeros(x);
+        if (lead > kMaxLeadingZeros) {
+            lead = kMaxLeadingZeros;
+        }
+        if (leading >= 0 && lead >= leading && trail >= trailing) {
+            out.write(0b10, 2);
+            out.write(x >> trailing, 64 - leading - trailing);
+            return;
+        }
+
+        // The length field holds 1..64 with 64 stored as 0
+        const int significant = 64 - lead - trail;
+        out.write(0b11, 2);
+        out.write(static_cast<uint64_t>(lead), 5);
+        out.write(static_cast<uint64_t>(significant & 63), 6);
+        out.write(x >> trail, significant);
+        leading = lead;
+        trailing = trail;
+    }
+
+    double XorDecoder::next(BitReader& in) {
+        if (!started) {
+            previous = in.read(64);
+            started = true;
+            return fromBits(previous);
+        }
+        if (in.readBit()) {
+            if (in.readBit()) {
+                leading = static_cast<int>(in.read(5));
+                int significant = static_cast<int>(in.read(6));
+                if (significant == 0) {
+                    significant = 64;
+                }
+                // Clamped so a corrupt window cannot shift out of range
+                trailing = significant > 64 - leading ? 0 : 64 - leading - significant;
+            }
+            const int significant = 64 - leading - trailing;
+            if (significant > 0) {
+                previous ^= in.read(significant) << trailing;
+            }
+        }
+        return fromBits(previous);
+    }
+
+}
@@ -0,0 +1,97 @@
+#ifndef PROCESS_STATS_GORILLA_CODEC_H
+#define PROCESS_STATS_GORILLA_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ProcessStats {
+    // Bit-level streams and the time series encodings from Facebook's Gorilla
+    // paper (Pelkonen et al., VLDB 2015): delta-of-delta timestamps and
+    // XOR-compressed doubles. Bits are written most significant first.
+
+    class BitWriter {
+    public:
+        void write(uint64_t value, int bits);
+        void writeBit(bool bit) { write(bit ? 1u : 0u, 1); }
+
+        std::size_t bitCount() const { return m_bits; }
+        std::size_t byteCount() const { return (m_bits + 7) / 8; }
+        const uint8_t* data() const { return m_bytes.data(); }
+
+        // Drop everything after the first bits; used to undo a partial append
+        void truncate(std::size_t bits);
+        void clear() { truncate(0); }
+
+    private:
+        std::vector<uint8_t> m_bytes;
+        std::size_t m_bits = 0;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, std::size_t bits) : m_data(data), m_bits(bits) {}
+
+        // Reads past the end return zeros and set overrun()
+        uint64_t read(int bits);
+        bool readBit() { return read(1) != 0; }
+
+        bool overrun() const { return m_overrun; }
+        std::size_t position() const { return m_position; }
+
+    private:
+        const uint8_t* m_data;
+        std::size_t m_bits;
+        std::size_t m_position = 0;
+        bool m_overrun = false;
+    };
+
+    // Timestamps: the first is stored whole, later ones as the change in
+    // interval, so a steady cadence costs one bit per timestamp:
+    //   '0'            same interval
+    //   '10'   +  7    interval changed by [-64, 63]
+    //   '110'  +  9    [-256, 255]
+    //   '1110' + 12    [-2048, 2047]
+    //   '1111' + 64    anything else
+    struct TimestampEncoder {
+        int64_t previous = 0;
+        int64_t interval = 0;
+        bool started = false;
+
+        void append(BitWriter& out, int64_t timestamp);
+    };
+
+    struct TimestampDecoder {
+        int64_t previous = 0;
+        int64_t interval = 0;
+        bool started = false;
+
+        int64_t next(BitReader& in);
+    };
+
+    // Doubles: the first is stored whole, later ones as the XOR with the
+    // previous value, which is zero for a repeated value and has few
+    // significant bits for nearby integral values:
+    //   '0'                         same value
+    //   '10' + bits                 significant bits fit the previous window
+    //   '11' + 5 + 6 + bits         new window: leading zeros, length, bits
+    struct XorEncoder {
+        uint64_t previous = 0;
+        int leading = -1;     // current window, -1 before the first '11'
+        int trailing = 0;
+        bool started = false;
+
+        void append(BitWriter& out, double value);
+    };
+
+    struct XorDecoder {
+        uint64_t previous = 0;
+        int leading = 0;
+        int trailing = 0;
+        bool started = false;
+
+        double next(BitReader& in);
+    };
+}
+
+#endif // PROCESS_STATS_GORILLA_CODEC_H
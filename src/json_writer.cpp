@@ -0,0 +1,336 @@
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace ProcessStats {
+
+namespace {
+    // Qt pads exponents to two digits ("1e+05"), so the decimal form wins
+    // whenever it is at most this many characters longer than the digits
+    constexpr int kExponentBias = 4;
+
+    inline char hexDigit(unsigned value) {
+        return static_cast<char>(value < 10 ? '0' + value : 'a' + value - 10);
+    }
+
+    inline bool needsEscape(unsigned char c) {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    // Document keys, escaped once here instead of on every module
+    constexpr std::string_view kBatchEndNsKey = "\"batch_end_ns\"";
+    constexpr std::string_view kBatchStartNsKey = "\"batch_start_ns\"";
+    constexpr std::string_view kCpuPercentKey = "\"cpu_percent\"";
+    constexpr std::string_view kCpuTimeSecondsKey = "\"cpu_time_seconds\"";
+    constexpr std::string_view kMemoryMBKey = "\"memory_mb\"";
+    constexpr std::string_view kModulesKey = "\"modules\"";
+    constexpr std::string_view kNameKey = "\"name\"";
+    constexpr std::string_view kReadOffsetNsKey = "\"read_offset_ns\"";
+    constexpr std::string_view kSequenceKey = "\"sequence\"";
+    constexpr std::string_view kSkewMsKey = "\"skew_ms\"";
+    constexpr std::string_view kStatusKey = "\"status\"";
+    constexpr std::string_view kTimestampMsKey = "\"timestamp_ms\"";
+    constexpr std::string_view kWindowMsKey = "\"window_ms\"";
+
+    // Status values, indexed by ModuleStatus
+    constexpr std::string_view kStatusValues[] = {
+        "\"ok\"", "\"exited\"", "\"permission_denied\"", "\"zombie\"",
+    };
+
+    void writeStatus(JsonWriter& writer, ModuleStatus status) {
+        writer.rawKey(kStatusKey);
+        writer.rawValue(kStatusValues[static_cast<std::size_t>(status)]);
+    }
+
+    // The fields every module entry starts with, up to and including "name"
+    void writeModuleFields(JsonWriter& writer, const ModuleSample& module, const std::string_view* jsonName) {
+        writer.rawKey(kCpuPercentKey);
+        writer.value(module.stats.cpuPercent);
+        writer.rawKey(kCpuTimeSecondsKey);
+        writer.value(module.stats.cpuTimeSeconds);
+        writer.rawKey(kMemoryMBKey);
+        writer.value(module.stats.memoryMB);
+        writer.rawKey(kNameKey);
+        if (jsonName) {
+            writer.rawValue(*jsonName);
+        } else {
+            writer.value(std::string_view(module.name));
+        }
+    }
+}
+
+    void JsonWriter::clear() {
+        m_buffer.clear();
+        m_hasElements.clear();
+        m_afterKey = false;
+    }
+
+    void JsonWriter::separate() {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (!m_hasElements.empty()) {
+            if (m_hasElements.back()) {
+                m_buffer += ',';
+            }
+            m_hasElements.back() = true;
+        }
+    }
+
+    void JsonWriter::beginArray() {
+        separate();
+        m_buffer += '[';
+        m_hasElements.push_back(false);
+    }
+
+    void JsonWriter::endArray() {
+        m_buffer += ']';
+        m_hasElements.pop_back();
+    }
+
+    void JsonWriter::beginObject() {
+        separate();
+        m_buffer += '{';
+        m_hasElements.push_back(false);
+    }
+
+    void JsonWriter::endObject() {
+        m_buffer += '}';
+        m_hasElements.pop_back();
+    }
+
+    void JsonWriter::key(std::string_view name) {
+        separate();
+        appendEscaped(m_buffer, name);
+        m_buffer += ':';
+        m_afterKey = true;
+    }
+
+    void JsonWriter::rawKey(std::string_view json) {
+        separate();
+        m_buffer += json;
+        m_buffer += ':';
+        m_afterKey = true;
+    }
+
+    void JsonWriter::rawValue(std::string_view json) {
+        separate();
+        m_buffer += json;
+    }
+
+    void JsonWriter::value(double number) {
+        separate();
+        appendDouble(m_buffer, number, m_precision);
+    }
+
+    void JsonWriter::value(int64_t number) {
+        separate();
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        m_buffer.append(digits, result.ptr);
+    }
+
+    void JsonWriter::value(std::string_view text) {
+        separate();
+        appendEscaped(m_buffer, text);
+    }
+
+    void JsonWriter::value(bool flag) {
+        separate();
+        m_buffer += flag ? "true" : "false";
+    }
+
+    void JsonWriter::appendDouble(std::string& out, double number, int precision) {
+        // JSON has no representation for these; QJsonDocument writes null
+        if (!std::isfinite(number)) {
+            out += "null";
+            return;
+        }
+
+        char text[64];
+        if (precision >= 0) {
+            auto result = std::to_chars(text, text + sizeof(text), number,
+                                        std::chars_format::general, precision > 0 ? precision : 1);
+            out.append(text, result.ptr);
+            return;
+        }
+
+        // Shortest round-trip digits, laid out the way Qt's 'g' format with
+        // FloatingPointShortest does it: decimal unless that is clearly longer
+        auto result = std::to_chars(text, text + sizeof(text), number, std::chars_format::scientific);
+        const char* cursor = text;
+        const char* end = result.ptr;
+        if (*cursor == '-') {
+            out += '-';
+            ++cursor;
+        }
+
+        char digits[32];
+        int digitCount = 0;
+        while (cursor != end && *cursor != 'e') {
+            if (*cursor != '.') {
+                digits[digitCount++] = *cursor;
+            }
+            ++cursor;
+        }
+        int exponent = 0;
+        if (cursor != end) {
+            ++cursor; // 'e'
+            bool negativeExponent = *cursor == '-';
+            ++cursor; // sign
+            std::from_chars(cursor, end, exponent);
+            if (negativeExponent) {
+                exponent = -exponent;
+            }
+        }
+
+        const int decimalPoint = exponent + 1;
+        const bool useDecimal = decimalPoint <= 0
+            ? 1 - decimalPoint <= kExponentBias
+            : decimalPoint <= digitCount + kExponentBias;
+
+        if (useDecimal) {
+            if (decimalPoint <= 0) {
+                out += "0.";
+                out.append(static_cast<std::size_t>(-decimalPoint), '0');
+                out.append(digits, digitCount);
+            } else if (decimalPoint >= digitCount) {
+                out.append(digits, digitCount);
+                out.append(static_cast<std::size_t>(decimalPoint - digitCount), '0');
+            } else {
+                out.append(digits, decimalPoint);
+                out += '.';
+                out.append(digits + decimalPoint, digitCount - decimalPoint);
+            }
+            return;
+        }
+
+        out += digits[0];
+        if (digitCount > 1) {
+            out += '.';
+            out.append(digits + 1, digitCount - 1);
+        }
+        out += 'e';
+        out += exponent < 0 ? '-' : '+';
+        const int magnitude = std::abs(exponent);
+        if (magnitude < 10) {
+            out += '0';
+        }
+        char exponentDigits[8];
+        auto exponentEnd = std::to_chars(exponentDigits, exponentDigits + sizeof(exponentDigits), magnitude);
+        out.append(exponentDigits, exponentEnd.ptr);
+    }
+
+    void JsonWriter::appendEscaped(std::string& out, std::string_view text) {
+        out += '"';
+
+        // Fast path: plain names need no escaping and are copied in one go
+        std::size_t runStart = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (!needsEscape(c)) {
+                continue;
+            }
+            out.append(text.data() + runStart, i - runStart);
+            runStart = i + 1;
+
+            out += '\\';
+            switch (c) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '\b': out += 'b'; break;
+            case '\f': out += 'f'; break;
+            case '\n': out += 'n'; break;
+            case '\r': out += 'r'; break;
+            case '\t': out += 't'; break;
+            default:
+                out += "u00";
+                out += hexDigit(c >> 4);
+                out += hexDigit(c & 0xf);
+                break;
+            }
+        }
+        out.append(text.data() + runStart, text.size() - runStart);
+
+        out += '"';
+    }
+
+    void writeModuleStatsJson(JsonWriter& writer, const Snapshot& snapshot, const std::string_view* jsonNames) {
+        // Keys in QJsonObject order (sorted)
+        writer.beginArray();
+        for (std::size_t i = 0; i < snapshot.modules.size(); ++i) {
+            const ModuleSample& module = snapshot.modules[i];
+            writer.beginObject();
+            writeModuleFields(writer, module, jsonNames ? &jsonNames[i] : nullptr);
+            writeStatus(writer, module.status);
+            writer.endObject();
+        }
+        if (snapshot.hasSelfStats) {
+            writeSelfStatsJson(writer, snapshot.selfStats);
+        }
+        writer.endArray();
+    }
+
+    void writeModuleStatsBatchJson(JsonWriter& writer, const Snapshot& snapshot, const std::string_view* jsonNames) {
+        // Keys in QJsonObject order (sorted)
+        writer.beginObject();
+        writer.rawKey(kBatchEndNsKey);
+        writer.value(static_cast<int64_t>(snapshot.batchEndNs));
+        writer.rawKey(kBatchStartNsKey);
+        writer.value(static_cast<int64_t>(snapshot.batchStartNs));
+        writer.rawKey(kModulesKey);
+        writer.beginArray();
+        for (std::size_t i = 0; i < snapshot.modules.size(); ++i) {
+            const ModuleSample& module = snapshot.modules[i];
+            writer.beginObject();
+            writeModuleFields(writer, module, jsonNames ? &jsonNames[i] : nullptr);
+            writer.rawKey(kReadOffsetNsKey);
+            writer.value(static_cast<int64_t>(module.readTimeNs - snapshot.batchStartNs));
+            writeStatus(writer, module.status);
+            writer.rawKey(kWindowMsKey);
+            writer.value(static_cast<int64_t>(module.windowMs));
+            writer.endObject();
+        }
+        if (snapshot.hasSelfStats) {
+            writeSelfStatsJson(writer, snapshot.selfStats);
+        }
+        writer.endArray();
+        writer.rawKey(kSequenceKey);
+        writer.value(static_cast<int64_t>(snapshot.sequence));
+        writer.rawKey(kSkewMsKey);
+        writer.value(snapshot.skewNs() / 1e6);
+        writer.rawKey(kTimestampMsKey);
+        writer.value(static_cast<int64_t>(snapshot.timestampMs));
+        writer.endObject();
+    }
+
+    void writeSelfStatsJson(JsonWriter& writer, const SelfStats& stats) {
+        // Keys in QJsonObject order (sorted)
+        writer.beginObject();
+        writer.key("allocations");
+        writer.value(static_cast<int64_t>(stats.allocations));
+        writer.key("bytes_read");
+        writer.value(static_cast<int64_t>(stats.bytesRead));
+        writer.key("compute_ns");
+        writer.value(static_cast<int64_t>(stats.computeNs));
+        writer.key("max_tick_ns");
+        writer.value(static_cast<int64_t>(stats.maxTickNs));
+        writer.key("name");
+        writer.value(kSelfStatsName);
+        writer.key("pids_sampled");
+        writer.value(static_cast<int64_t>(stats.pidsSampled));
+        writer.key("read_ns");
+        writer.value(static_cast<int64_t>(stats.readNs));
+        writer.key("serialize_ns");
+        writer.value(static_cast<int64_t>(stats.serializeNs));
+        writer.key("syscalls");
+        writer.value(static_cast<int64_t>(stats.syscalls));
+        writer.key("ticks");
+        writer.value(static_cast<int64_t>(stats.ticks));
+        writer.endObject();
+    }
+
+}
@@ -0,0 +1,89 @@
+#ifndef PROCESS_STATS_JSON_WRITER_H
+#define PROCESS_STATS_JSON_WRITER_H
+
+#include "snapshot.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ProcessStats {
+    // Compact JSON writer that appends straight into a reusable byte buffer
+    //
+    // With the default shortest precision the output is byte-identical to
+    // QJsonDocument::toJson(QJsonDocument::Compact) (Qt 6) for the same
+    // values, provided object keys are written in sorted order as QJsonObject
+    // stores them. clear() keeps the buffer's capacity, so a long-lived
+    // writer stops allocating once it has seen its largest document.
+    class JsonWriter {
+    public:
+        // Shortest representation that round-trips, as Qt writes doubles
+        static constexpr int kShortestPrecision = -1;
+
+        explicit JsonWriter(int precision = kShortestPrecision) : m_precision(precision) {}
+
+        // Reset for a new document; keeps the allocated buffer
+        void clear();
+
+        void beginArray();
+        void endArray();
+        void beginObject();
+        void endObject();
+
+        // Write an object key; must be followed by exactly one value
+        void key(std::string_view name);
+
+        void value(double number);
+        void value(int64_t number);
+        void value(std::string_view text);
+        void value(bool flag);
+
+        // Keeps string literals from converting to bool
+        void value(const char* text) { value(std::string_view(text)); }
+
+        // Key or value already in JSON form, e.g. a name escaped once up
+        // front; written as is
+        void rawKey(std::string_view json);
+        void rawValue(std::string_view json);
+
+        // Significant digits for doubles, or kShortestPrecision
+        void setPrecision(int precision) { m_precision = precision; }
+        int precision() const { return m_precision; }
+
+        const std::string& buffer() const { return m_buffer; }
+        const char* data() const { return m_buffer.data(); }
+        std::size_t size() const { return m_buffer.size(); }
+
+        // Formatting primitives, exposed for other writers
+        static void appendDouble(std::string& out, double number, int precision = kShortestPrecision);
+        static void appendEscaped(std::string& out, std::string_view text);
+
+    private:
+        void separate();
+
+        std::string m_buffer;
+        std::vector<bool> m_hasElements;  // one entry per open container
+        bool m_afterKey = false;
+        int m_precision;
+    };
+
+    // Module stats array as returned by getModuleStats():
+    // [{"cpu_percent":..,"cpu_time_seconds":..,"memory_mb":..,"name":"..","status":".."},...]
+    // status is one of moduleStatusName()
+    // jsonNames, if given, holds each module's name already escaped and
+    // quoted (see ModuleRegistry::jsonNames()), in snapshot order
+    void writeModuleStatsJson(JsonWriter& writer, const Snapshot& snapshot,
+                              const std::string_view* jsonNames = nullptr);
+
+    // Batch object as returned by getModuleStatsBatch()
+    void writeModuleStatsBatchJson(JsonWriter& writer, const Snapshot& snapshot,
+                                   const std::string_view* jsonNames = nullptr);
+
+    // The __process_stats__ entry the module writers end their array with
+    // when a snapshot has SelfStats:
+    // {"allocations":..,"bytes_read":..,"compute_ns":..,"max_tick_ns":..,"name":"__process_stats__",
+    //  "pids_sampled":..,"read_ns":..,"serialize_ns":..,"syscalls":..,"ticks":..}
+    void writeSelfStatsJson(JsonWriter& writer, const SelfStats& stats);
+}
+
+#endif // PROCESS_STATS_JSON_WRITER_H
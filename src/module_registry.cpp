@@ -0,0 +1,142 @@
+#include "module_registry.h"
+#include "json_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+
+namespace ProcessStats {
+
+namespace {
+    constexpr std::size_t kMinBlockSize = 4096;
+
+    // Shared by all registries so that generations never collide
+    std::atomic<uint64_t> s_lastGeneration{0};
+}
+
+    ModuleRegistry::ModuleRegistry() {
+        changed();
+    }
+
+    void ModuleRegistry::changed() {
+        m_generation = s_lastGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    std::string_view ModuleRegistry::store(std::string_view text) {
+        if (m_blocks.empty() || text.size() > m_blockSize - m_blockUsed) {
+            m_blockSize = std::max(kMinBlockSize, text.size());
+            m_blocks.push_back(std::make_unique<char[]>(m_blockSize));
+            m_blockUsed = 0;
+        }
+        char* stored = m_blocks.back().get() + m_blockUsed;
+        std::memcpy(stored, text.data(), text.size());
+        m_blockUsed += text.size();
+        m_arenaBytes += text.size();
+        return std::string_view(stored, text.size());
+    }
+
+    ModuleId ModuleRegistry::add(std::string_view name, int64_t pid) {
+        const ModuleId existing = find(name);
+        if (existing != kNoModule) {
+            return setPid(existing, pid) ? existing : kNoModule;
+        }
+        if (pid <= 0 || m_entries.size() >= kNoModule) {
+            return kNoModule;
+        }
+
+        std::string escaped;
+        JsonWriter::appendEscaped(escaped, name);
+        Entry entry;
+        entry.name = store(name);
+        entry.jsonName = store(escaped);
+        entry.position = m_modules.size();
+        entry.active = true;
+
+        const ModuleId id = static_cast<ModuleId>(m_entries.size());
+        m_entries.push_back(entry);
+        m_idByName.emplace(entry.name, id);
+        m_modules.push_back(ModuleRef{entry.name, pid});
+        m_ids.push_back(id);
+        m_jsonNames.push_back(entry.jsonName);
+        changed();
+        return id;
+    }
+
+    bool ModuleRegistry::setPid(ModuleId id, int64_t pid) {
+        if (!contains(id) || pid <= 0) {
+            return false;
+        }
+        ModuleRef& module = m_modules[m_entries[id].position];
+        if (module.pid != pid) {
+            module.pid = pid;
+            changed();
+        }
+        return true;
+    }
+
+    bool ModuleRegistry::remove(ModuleId id) {
+        if (!contains(id)) {
+            return false;
+        }
+        Entry& entry = m_entries[id];
+        const std::size_t position = entry.position;
+        m_idByName.erase(entry.name);
+        m_modules.erase(m_modules.begin() + position);
+        m_ids.erase(m_ids.begin() + position);
+        m_jsonNames.erase(m_jsonNames.begin() + position);
+        for (std::size_t i = position; i < m_ids.size(); ++i) {
+            m_entries[m_ids[i]].position = i;
+        }
+        m_deadBytes += entry.name.size() + entry.jsonName.size();
+        entry = Entry();
+        changed();
+
+        // Reclaim removed names once they are most of the arena
+        if (m_deadBytes > kMinBlockSize && m_deadBytes * 2 > m_arenaBytes) {
+            compact();
+        }
+        return true;
+    }
+
+    void ModuleRegistry::compact() {
+        std::vector<std::unique_ptr<char[]>> oldBlocks;
+        oldBlocks.swap(m_blocks);
+        m_blockUsed = 0;
+        m_blockSize = 0;
+        m_arenaBytes = 0;
+        m_deadBytes = 0;
+
+        m_idByName.clear();
+        for (std::size_t position = 0; position < m_ids.size(); ++position) {
+            const ModuleId id = m_ids[position];
+            Entry& entry = m_entries[id];
+            entry.name = store(entry.name);
+            entry.jsonName = store(entry.jsonName);
+            m_idByName.emplace(entry.name, id);
+            m_modules[position].name = entry.name;
+            m_jsonNames[position] = entry.jsonName;
+        }
+    }
+
+    ModuleId ModuleRegistry::find(std::string_view name) const {
+        auto found = m_idByName.find(name);
+        return found != m_idByName.end() ? found->second : kNoModule;
+    }
+
+    bool ModuleRegistry::contains(ModuleId id) const {
+        return id < m_entries.size() && m_entries[id].active;
+    }
+
+    std::string_view ModuleRegistry::name(ModuleId id) const {
+        return contains(id) ? m_entries[id].name : std::string_view();
+    }
+
+    int64_t ModuleRegistry::pid(ModuleId id) const {
+        return contains(id) ? m_modules[m_entries[id].position].pid : 0;
+    }
+
+    std::string_view ModuleRegistry::jsonName(ModuleId id) const {
+        return contains(id) ? m_entries[id].jsonName : std::string_view();
+    }
+
+}
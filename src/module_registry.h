@@ -0,0 +1,93 @@
+#ifndef PROCESS_STATS_MODULE_REGISTRY_H
+#define PROCESS_STATS_MODULE_REGISTRY_H
+
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    using ModuleId = uint32_t;
+    constexpr ModuleId kNoModule = UINT32_MAX;
+
+    // Persistent set of named modules, addressed by small integer ids
+    //
+    // A name is hashed and copied once, when it is registered: the registry
+    // keeps it in an arena together with its escaped JSON form, and
+    // modules() hands the sampler views of both, in registration order, that
+    // stay valid until the next change. Ids are never reused, so a stale id
+    // fails rather than reaching another module.
+    //
+    // Not thread-safe.
+    class ModuleRegistry {
+    public:
+        ModuleRegistry();
+
+        // Register name for pid, or move an already registered name to pid;
+        // returns its id, or kNoModule if pid <= 0
+        ModuleId add(std::string_view name, int64_t pid);
+
+        // For a module whose process restarted; false for an unknown id or
+        // a pid <= 0
+        bool setPid(ModuleId id, int64_t pid);
+
+        bool remove(ModuleId id);
+
+        // Id of a registered name, kNoModule if none
+        ModuleId find(std::string_view name) const;
+
+        bool contains(ModuleId id) const;
+        std::string_view name(ModuleId id) const;
+        int64_t pid(ModuleId id) const;
+
+        // Name as a quoted, escaped JSON string
+        std::string_view jsonName(ModuleId id) const;
+
+        // Registered modules in registration order, their ids and JSON names
+        const std::vector<ModuleRef>& modules() const { return m_modules; }
+        const std::vector<ModuleId>& ids() const { return m_ids; }
+        const std::vector<std::string_view>& jsonNames() const { return m_jsonNames; }
+        std::size_t size() const { return m_modules.size(); }
+
+        // Changes with every add, setPid and remove. Never 0, and unique
+        // across registries, so a copy of modules() can be tested for being
+        // current by generation alone
+        uint64_t generation() const { return m_generation; }
+
+        // Bytes held by the arena, including those of removed names until
+        // it is compacted
+        std::size_t arenaBytes() const { return m_arenaBytes; }
+
+    private:
+        struct Entry {
+            std::string_view name;
+            std::string_view jsonName;
+            std::size_t position = 0;   // in modules()
+            bool active = false;
+        };
+
+        std::string_view store(std::string_view text);
+        void compact();
+        void changed();
+
+        // Append-only blocks; stored strings never move until compact()
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        std::size_t m_blockUsed = 0;
+        std::size_t m_blockSize = 0;
+        std::size_t m_arenaBytes = 0;
+        std::size_t m_deadBytes = 0;
+
+        std::vector<Entry> m_entries;   // by id
+        std::unordered_map<std::string_view, ModuleId> m_idByName;
+
+        std::vector<ModuleRef> m_modules;
+        std::vector<ModuleId> m_ids;
+        std::vector<std::string_view> m_jsonNames;
+        uint64_t m_generation = 0;
+    };
+}
+
+#endif // PROCESS_STATS_MODULE_REGISTRY_H
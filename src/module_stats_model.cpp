@@ -0,0 +1,200 @@
+#include "module_stats_model.h"
+#include <algorithm>
+
+namespace ProcessStats {
+
+    ModuleStatsModel::ModuleStatsModel(QObject* parent)
+        : QAbstractTableModel(parent) {}
+
+    int ModuleStatsModel::rowCount(const QModelIndex& parent) const {
+        return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+    }
+
+    int ModuleStatsModel::columnCount(const QModelIndex& parent) const {
+        return parent.isValid() ? 0 : ColumnCount;
+    }
+
+    QVariant ModuleStatsModel::data(const QModelIndex& index, int role) const {
+        if (role != Qt::DisplayRole || !index.isValid() || index.row() >= rowCount()) {
+            return QVariant();
+        }
+        const ModuleSample& module = m_rows[static_cast<std::size_t>(index.row())];
+        switch (index.column()) {
+        case NameColumn:
+            return m_names[index.row()];
+        case PidColumn:
+            return static_cast<qint64>(module.pid);
+        case CpuPercentColumn:
+            return module.stats.cpuPercent;
+        case CpuTimeColumn:
+            return module.stats.cpuTimeSeconds;
+        case MemoryColumn:
+            return module.stats.memoryMB;
+        case StatusColumn:
+            return QString::fromUtf8(moduleStatusName(module.status));
+        default:
+            return QVariant();
+        }
+    }
+
+    QVariant ModuleStatsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+            return QAbstractTableModel::headerData(section, orientation, role);
+        }
+        switch (section) {
+        case NameColumn:
+            return QStringLiteral("Module");
+        case PidColumn:
+            return QStringLiteral("PID");
+        case CpuPercentColumn:
+            return QStringLiteral("CPU %");
+        case CpuTimeColumn:
+            return QStringLiteral("CPU time (s)");
+        case MemoryColumn:
+            return QStringLiteral("Memory (MB)");
+        case StatusColumn:
+            return QStringLiteral("Status");
+        default:
+            return QVariant();
+        }
+    }
+
+    void ModuleStatsModel::update(const Snapshot& snapshot) {
+        const std::vector<ModuleSample>& modules = snapshot.modules;
+
+        // Usually the same modules as last time, in the same order
+        bool aligned = modules.size() == m_rows.size();
+        for (std::size_t i = 0; aligned && i < modules.size(); ++i) {
+            aligned = modules[i].name == m_rows[i].name;
+        }
+
+        if (!aligned) {
+            m_incoming.clear();
+            for (std::size_t i = 0; i < modules.size(); ++i) {
+                m_incoming.emplace(modules[i].name, i);
+            }
+            removeMissing();
+        }
+        updateValues(modules, aligned);
+        if (!aligned) {
+            appendNew(modules);
+            m_incoming.clear();
+        }
+    }
+
+    void ModuleStatsModel::clear() {
+        if (m_rows.empty()) {
+            return;
+        }
+        beginResetModel();
+        m_rows.clear();
+        m_names.clear();
+        endResetModel();
+    }
+
+    // Drop rows of modules that are not in m_incoming, one signal per run
+    void ModuleStatsModel::removeMissing() {
+        int row = static_cast<int>(m_rows.size()) - 1;
+        while (row >= 0) {
+            if (m_incoming.count(m_rows[static_cast<std::size_t>(row)].name)) {
+                --row;
+                continue;
+            }
+            const int last = row;
+            while (row > 0 && !m_incoming.count(m_rows[static_cast<std::size_t>(row - 1)].name)) {
+                --row;
+            }
+            beginRemoveRows(QModelIndex(), row, last);
+            m_rows.erase(m_rows.begin() + row, m_rows.begin() + last + 1);
+            m_names.erase(m_names.begin() + row, m_names.begin() + last + 1);
+            endRemoveRows();
+            --row;
+        }
+    }
+
+    // Copy new values into the remaining rows. Consecutive rows whose
+    // changes span the same columns share one dataChanged()
+    void ModuleStatsModel::updateValues(const std::vector<ModuleSample>& modules, bool aligned) {
+        int runStart = -1;
+        int runFirst = 0;
+        int runLast = 0;
+        auto flush = [&](int end) {
+            if (runStart >= 0) {
+                emit dataChanged(index(runStart, runFirst), index(end - 1, runLast), {Qt::DisplayRole});
+                runStart = -1;
+            }
+        };
+
+        const int rows = static_cast<int>(m_rows.size());
+        for (int row = 0; row < rows; ++row) {
+            ModuleSample& shown = m_rows[static_cast<std::size_t>(row)];
+            const ModuleSample& next = aligned ? modules[static_cast<std::size_t>(row)]
+                                               : modules[m_incoming.find(shown.name)->second];
+            int first = ColumnCount;
+            int last = -1;
+            auto mark = [&](int column) {
+                first = std::min(first, column);
+                last = std::max(last, column);
+            };
+            if (next.pid != shown.pid) {
+                mark(PidColumn);
+            }
+            if (next.stats.cpuPercent != shown.stats.cpuPercent) {
+                mark(CpuPercentColumn);
+            }
+            if (next.stats.cpuTimeSeconds != shown.stats.cpuTimeSeconds) {
+                mark(CpuTimeColumn);
+            }
+            if (next.stats.memoryMB != shown.stats.memoryMB) {
+                mark(MemoryColumn);
+            }
+            if (next.status != shown.status) {
+                mark(StatusColumn);
+            }
+
+            // Everything but the name, which is the same
+            shown.pid = next.pid;
+            shown.stats = next.stats;
+            shown.windowMs = next.windowMs;
+            shown.readTimeNs = next.readTimeNs;
+            shown.status = next.status;
+
+            if (last < 0 || (runStart >= 0 && (first != runFirst || last != runLast))) {
+                flush(row);
+            }
+            if (last >= 0 && runStart < 0) {
+                runStart = row;
+                runFirst = first;
+                runLast = last;
+            }
+        }
+        flush(rows);
+    }
+
+    // Append modules that have no row yet, in snapshot order
+    void ModuleStatsModel::appendNew(const std::vector<ModuleSample>& modules) {
+        std::vector<bool> shown(modules.size(), false);
+        for (const ModuleSample& row : m_rows) {
+            shown[m_incoming.find(row.name)->second] = true;
+        }
+        std::vector<std::size_t> added;
+        for (std::size_t i = 0; i < modules.size(); ++i) {
+            // A name listed twice gets one row, from its first entry
+            if (!shown[i] && m_incoming.find(modules[i].name)->second == i) {
+                added.push_back(i);
+            }
+        }
+        if (added.empty()) {
+            return;
+        }
+
+        const int first = static_cast<int>(m_rows.size());
+        beginInsertRows(QModelIndex(), first, first + static_cast<int>(added.size()) - 1);
+        for (std::size_t i : added) {
+            m_rows.push_back(modules[i]);
+            m_names.push_back(QString::fromStdString(modules[i].name));
+        }
+        endInsertRows();
+    }
+
+}
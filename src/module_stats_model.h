@@ -0,0 +1,77 @@
+#ifndef PROCESS_STATS_MODULE_STATS_MODEL_H
+#define PROCESS_STATS_MODULE_STATS_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "snapshot.h"
+
+namespace ProcessStats {
+    // A table of the modules in the latest snapshot, one row per module
+    //
+    // update() applies a snapshot as a diff against the rows shown: rows are
+    // removed for modules that are gone and appended for new ones, and
+    // dataChanged() covers only the cells whose values moved, so views keep
+    // their selection and scroll position and repaint only what changed.
+    // The rows are the snapshot's ModuleSamples themselves. A tick over the
+    // same modules in the same order compares them in place without hashing
+    // a name.
+    //
+    // Connect ProcessMonitor::snapshotReady() to update() to keep a view live.
+    class ModuleStatsModel : public QAbstractTableModel {
+        Q_OBJECT
+
+    public:
+        enum Column {
+            NameColumn,
+            PidColumn,
+            CpuPercentColumn,
+            CpuTimeColumn,
+            MemoryColumn,
+            StatusColumn,   // why a module's stats are zero; see ModuleStatus
+            ColumnCount
+        };
+        Q_ENUM(Column)
+
+        explicit ModuleStatsModel(QObject* parent = nullptr);
+
+        int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+        int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+
+        // DisplayRole holds the raw value (QString, qint64 or double; the
+        // status as moduleStatusName()); formatting is left to the view's
+        // delegate
+        QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+        QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+        // The sample shown in row, which must be valid
+        const ModuleSample& module(int row) const { return m_rows[static_cast<std::size_t>(row)]; }
+
+    public slots:
+        // Show snapshot, emitting only the changes since the last one
+        void update(const ProcessStats::Snapshot& snapshot);
+
+        // Remove every row
+        void clear();
+
+    private:
+        void removeMissing();
+        void updateValues(const std::vector<ModuleSample>& modules, bool aligned);
+        void appendNew(const std::vector<ModuleSample>& modules);
+
+        std::vector<ModuleSample> m_rows;
+        QVector<QString> m_names;   // m_rows' names, converted once per row
+
+        // Index of each incoming module by name during update(), filled
+        // only when the modules differ from the rows shown
+        std::unordered_map<std::string_view, std::size_t> m_incoming;
+    };
+}
+
+#endif // PROCESS_STATS_MODULE_STATS_MODEL_H
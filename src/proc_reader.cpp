@@ -0,0 +1,250 @@
+#include "proc_reader.h"
+#include "self_stats.h"
+#include <cerrno>
+#include <chrono>
+#include <string>
+
+// Platform-specific includes for process monitoring
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
+
+#if defined(__APPLE__) && !TARGET_OS_IPHONE
+#define PROCESS_STATS_USE_LIBPROC 1
+#include <libproc.h>
+#include <mach/mach.h>
+#include <mach/task_info.h>
+#include <sys/sysctl.h>
+#elif defined(__linux__)
+#define PROCESS_STATS_USE_PROCFS 1
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/times.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace ProcessStats {
+
+namespace {
+#if PROCESS_STATS_SELF_STATS
+    // I/O of the readRawCounters() call in progress on this thread
+    thread_local uint16_t t_syscalls = 0;
+    thread_local uint32_t t_bytesRead = 0;
+#endif
+
+    inline void countIo(uint16_t syscalls, int64_t bytesRead) {
+    #if PROCESS_STATS_SELF_STATS
+        t_syscalls += syscalls;
+        t_bytesRead += bytesRead > 0 ? static_cast<uint32_t>(bytesRead) : 0;
+    #else
+        (void)syscalls, (void)bytesRead;
+    #endif
+    }
+
+#if defined(PROCESS_STATS_USE_LIBPROC) || defined(PROCESS_STATS_USE_PROCFS)
+    // Status for a read that failed with error
+    ModuleStatus statusFromErrno(int error) {
+        return error == EACCES || error == EPERM ? ModuleStatus::PermissionDenied : ModuleStatus::Exited;
+    }
+#endif
+
+    bool fail(ModuleStatus* status, ModuleStatus reason) {
+        if (status) {
+            *status = reason;
+        }
+        return false;
+    }
+
+#if defined(PROCESS_STATS_USE_LIBPROC)
+    bool readTaskInfo(int64_t pid, proc_taskinfo& taskInfo) {
+        countIo(1, 0);
+        return proc_pidinfo(static_cast<int>(pid), PROC_PIDTASKINFO, 0, &taskInfo, sizeof(taskInfo))
+            == sizeof(taskInfo);
+    }
+#elif defined(PROCESS_STATS_USE_PROCFS)
+    // Read /proc/[pid]/name into buffer and NUL-terminate it; these files
+    // are generated whole on the first read. Returns the length, or -1.
+    ssize_t readProcFile(int64_t pid, const char* name, char* buffer, std::size_t size) {
+        char path[64];
+        std::snprintf(path, sizeof(path), "/proc/%lld/%s", static_cast<long long>(pid), name);
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            countIo(1, 0);
+            return -1;
+        }
+        const ssize_t length = ::read(fd, buffer, size - 1);
+        ::close(fd);
+        countIo(3, length);
+        if (length < 0) {
+            return -1;
+        }
+        buffer[length] = '\0';
+        return length;
+    }
+#endif
+}
+
+    int64_t currentTimeMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t monotonicTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    RawCounters readRawCounters(int64_t pid) {
+        RawCounters counters;
+
+        if (pid <= 0) {
+            return counters;
+        }
+    #if PROCESS_STATS_SELF_STATS
+        t_syscalls = 0;
+        t_bytesRead = 0;
+    #endif
+
+    #if defined(PROCESS_STATS_USE_LIBPROC)
+        // macOS implementation using libproc
+        struct proc_taskinfo taskInfo;
+        if (readTaskInfo(pid, taskInfo)) {
+            // Get CPU time (user + system time) in microseconds, convert to seconds
+            uint64_t totalTime = taskInfo.pti_total_user + taskInfo.pti_total_system;
+            counters.cpuTimeSeconds = totalTime / 1e6;
+
+            // Get memory footprint (resident size) in bytes, convert to megabytes
+            counters.memoryMB = taskInfo.pti_resident_size / (1024.0 * 1024.0);
+            counters.valid = true;
+        } else {
+            counters.status = statusFromErrno(errno);
+        }
+        counters.readTimeNs = monotonicTimeNs();
+
+    #elif defined(PROCESS_STATS_USE_PROCFS)
+        // Linux implementation using /proc filesystem. A zombie's statm reads
+        // as zeros, so it is not opened once stat says Z
+        counters.valid = readCpuTimeSeconds(pid, counters.cpuTimeSeconds, &counters.status);
+        if (counters.status != ModuleStatus::Zombie) {
+            ModuleStatus memoryStatus = ModuleStatus::Ok;
+            counters.valid = readResidentMB(pid, counters.memoryMB, &memoryStatus) || counters.valid;
+            if (!counters.valid) {
+                counters.status = memoryStatus;
+            }
+        }
+        counters.readTimeNs = monotonicTimeNs();
+    #endif
+
+    #if PROCESS_STATS_SELF_STATS
+        counters.syscalls = t_syscalls;
+        counters.bytesRead = t_bytesRead;
+    #endif
+        return counters;
+    }
+
+    bool readCpuTimeSeconds(int64_t pid, double& seconds, ModuleStatus* status) {
+        seconds = 0.0;
+        if (pid <= 0) {
+            return fail(status, ModuleStatus::Exited);
+        }
+
+    #if defined(PROCESS_STATS_USE_LIBPROC)
+        struct proc_taskinfo taskInfo;
+        if (!readTaskInfo(pid, taskInfo)) {
+            return fail(status, statusFromErrno(errno));
+        }
+        seconds = (taskInfo.pti_total_user + taskInfo.pti_total_system) / 1e6;
+        return true;
+
+    #elif defined(PROCESS_STATS_USE_PROCFS)
+        // Fields up to stime fit well within this; the rest may be cut off
+        char buffer[1024];
+        if (readProcFile(pid, "stat", buffer, sizeof(buffer)) < 0) {
+            return fail(status, statusFromErrno(errno));
+        }
+
+        // comm (field 2) may contain spaces and parentheses, so parse
+        // from the last ')' onwards: state is field 3, utime field 14,
+        // stime field 15
+        const char* cursor = std::strrchr(buffer, ')');
+        if (!cursor) {
+            return true;
+        }
+        ++cursor;
+        while (*cursor == ' ') {
+            ++cursor;
+        }
+        if (*cursor == 'Z' || *cursor == 'X') {
+            return fail(status, ModuleStatus::Zombie);
+        }
+        for (int field = 3; field < 14; ++field) {
+            while (*cursor == ' ') {
+                ++cursor;
+            }
+            while (*cursor != ' ' && *cursor != '\0') {
+                ++cursor;
+            }
+        }
+        char* end = nullptr;
+        const unsigned long long utime = std::strtoull(cursor, &end, 10);
+        if (end == cursor) {
+            return true;
+        }
+        cursor = end;
+        const unsigned long long stime = std::strtoull(cursor, &end, 10);
+        if (end == cursor) {
+            return true;
+        }
+
+        // CPU time is in clock ticks, convert to seconds
+        static const long clockTicks = sysconf(_SC_CLK_TCK);
+        if (clockTicks > 0) {
+            seconds = (utime + stime) / static_cast<double>(clockTicks);
+        }
+        return true;
+
+    #else
+        return fail(status, ModuleStatus::Exited);
+    #endif
+    }
+
+    bool readResidentMB(int64_t pid, double& megabytes, ModuleStatus* status) {
+        megabytes = 0.0;
+        if (pid <= 0) {
+            return fail(status, ModuleStatus::Exited);
+        }
+
+    #if defined(PROCESS_STATS_USE_LIBPROC)
+        struct proc_taskinfo taskInfo;
+        if (!readTaskInfo(pid, taskInfo)) {
+            return fail(status, statusFromErrno(errno));
+        }
+        megabytes = taskInfo.pti_resident_size / (1024.0 * 1024.0);
+        return true;
+
+    #elif defined(PROCESS_STATS_USE_PROCFS)
+        // statm is "size resident shared text lib data dt" in pages; resident
+        // is the VmRSS of /proc/[pid]/status without formatting it
+        char buffer[256];
+        if (readProcFile(pid, "statm", buffer, sizeof(buffer)) < 0) {
+            return fail(status, statusFromErrno(errno));
+        }
+        char* end = nullptr;
+        std::strtoull(buffer, &end, 10);
+        const char* cursor = end;
+        const unsigned long long residentPages = std::strtoull(cursor, &end, 10);
+        if (end != cursor) {
+            static const long pageSize = sysconf(_SC_PAGESIZE);
+            megabytes = residentPages * static_cast<double>(pageSize) / (1024.0 * 1024.0);
+        }
+        return true;
+
+    #else
+        return fail(status, ModuleStatus::Exited);
+    #endif
+    }
+
+}
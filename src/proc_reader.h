@@ -0,0 +1,49 @@
+#ifndef PROCESS_STATS_PROC_READER_H
+#define PROCESS_STATS_PROC_READER_H
+
+#include "snapshot.h"
+#include <cstdint>
+
+namespace ProcessStats {
+    // Raw, cumulative counters for a process as read from the OS
+    // CPU percentage is derived from two of these by the Sampler
+    struct RawCounters {
+        double cpuTimeSeconds = 0.0;
+        double memoryMB = 0.0;
+        int64_t readTimeNs = 0;  // monotonic time of the read, see monotonicTimeNs()
+        bool valid = false;      // false if the process could not be read
+        ModuleStatus status = ModuleStatus::Ok;  // why not, if the source knows
+        uint16_t syscalls = 0;   // system calls the read made, if the source counts them
+        uint32_t bytesRead = 0;  // bytes it read from procfs
+    };
+
+    // Status a sampler reports for counters: Ok when valid, Exited when the
+    // source gave no reason
+    inline ModuleStatus statusOf(const RawCounters& counters) {
+        if (counters.valid) {
+            return ModuleStatus::Ok;
+        }
+        return counters.status == ModuleStatus::Ok ? ModuleStatus::Exited : counters.status;
+    }
+
+    // Read the current counters for pid; a process that has exited, may not
+    // be read or is a zombie is invalid, with status saying which
+    // Safe to call concurrently from multiple threads; touches no shared state
+    RawCounters readRawCounters(int64_t pid);
+
+    // Read a single counter of pid, for samplers that need only one; each
+    // reads and parses just the file that holds it (/proc/[pid]/stat for
+    // CPU time, /proc/[pid]/statm for resident memory on Linux). Return
+    // false if the process could not be read, with the reason in status if
+    // given. A zombie's CPU time is not read: it reports Zombie.
+    bool readCpuTimeSeconds(int64_t pid, double& seconds, ModuleStatus* status = nullptr);
+    bool readResidentMB(int64_t pid, double& megabytes, ModuleStatus* status = nullptr);
+
+    // Current wall-clock time in milliseconds since the epoch
+    int64_t currentTimeMs();
+
+    // Current monotonic time in nanoseconds; only differences are meaningful
+    int64_t monotonicTimeNs();
+}
+
+#endif // PROCESS_STATS_PROC_READER_H
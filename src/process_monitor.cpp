@@ -0,0 +1,198 @@
+#include "process_monitor.h"
+#include <QDebug>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace ProcessStats {
+
+namespace {
+    void warnToQt(std::string_view message) {
+        qWarning().noquote() << QString::fromUtf8(message.data(), static_cast<int>(message.size()));
+    }
+}
+
+    ProcessMonitor::ProcessMonitor(QObject* parent)
+        : ProcessMonitor(SamplerOptions(), parent) {}
+
+    ProcessMonitor::ProcessMonitor(SamplerOptions options, QObject* parent)
+        : QObject(parent),
+          m_engine(std::move(options), warnToQt) {
+        qRegisterMetaType<ProcessStats::Snapshot>();
+        qRegisterMetaType<ProcessStats::ProcessMonitor::Metric>();
+
+    #ifdef Q_OS_LINUX
+        m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (m_timerFd >= 0) {
+            m_notifier = new QSocketNotifier(m_timerFd, QSocketNotifier::Read, this);
+            m_notifier->setEnabled(false);
+            connect(m_notifier, &QSocketNotifier::activated, this, [this] { onTimerReady(); });
+            return;
+        }
+        warnToQt("timerfd unavailable, ProcessMonitor falls back to QTimer");
+    #endif
+        m_timer = new QTimer(this);
+        m_timer->setTimerType(Qt::PreciseTimer);
+        connect(m_timer, &QTimer::timeout, this, &ProcessMonitor::sampleNow);
+    }
+
+    ProcessMonitor::~ProcessMonitor() {
+    #ifdef Q_OS_LINUX
+        if (m_timerFd >= 0) {
+            // The notifier must go before the descriptor it watches
+            delete m_notifier;
+            ::close(m_timerFd);
+        }
+    #endif
+    }
+
+    bool ProcessMonitor::addModule(const QString& name, qint64 pid) {
+        const std::string key = name.toStdString();
+        const ModuleId existing = m_registry.find(key);
+        if (existing != kNoModule) {
+            if (!m_registry.setPid(existing, pid)) {
+                return false;
+            }
+            // A new process starts below every limit
+            m_limits.erase(existing);
+            return true;
+        }
+        return m_registry.add(key, pid) != kNoModule;
+    }
+
+    bool ProcessMonitor::removeModule(const QString& name) {
+        const ModuleId id = m_registry.find(name.toStdString());
+        m_limits.erase(id);
+        return m_registry.remove(id);
+    }
+
+    void ProcessMonitor::setInterval(int milliseconds) {
+        m_intervalMs = milliseconds > 0 ? milliseconds : 1;
+        if (m_active) {
+            arm();
+        }
+    }
+
+    void ProcessMonitor::setCpuThreshold(double percent) {
+        m_cpuThreshold = percent;
+    }
+
+    void ProcessMonitor::setMemoryThreshold(double megabytes) {
+        m_memoryThreshold = megabytes;
+    }
+
+    void ProcessMonitor::start() {
+        m_active = true;
+        arm();
+    }
+
+    void ProcessMonitor::stop() {
+        m_active = false;
+        arm();
+    }
+
+    void ProcessMonitor::arm() {
+        if (m_timer) {
+            if (m_active) {
+                m_timer->start(m_intervalMs);
+            } else {
+                m_timer->stop();
+            }
+            return;
+        }
+    #ifdef Q_OS_LINUX
+        // A zero it_value disarms the timer
+        itimerspec spec = {};
+        if (m_active) {
+            spec.it_interval.tv_sec = m_intervalMs / 1000;
+            spec.it_interval.tv_nsec = static_cast<long>(m_intervalMs % 1000) * 1000000L;
+            spec.it_value = spec.it_interval;
+        }
+        timerfd_settime(m_timerFd, 0, &spec, nullptr);
+        m_notifier->setEnabled(m_active);
+    #endif
+    }
+
+    void ProcessMonitor::onTimerReady() {
+    #ifdef Q_OS_LINUX
+        // The count of expirations since the last read; ticks missed while
+        // the event loop was busy are taken as one
+        uint64_t expirations = 0;
+        if (::read(m_timerFd, &expirations, sizeof(expirations)) != static_cast<ssize_t>(sizeof(expirations))) {
+            return;
+        }
+        sampleNow();
+    #endif
+    }
+
+    void ProcessMonitor::sampleNow() {
+        m_engine.sampleModules(m_registry, m_sample);
+        const Snapshot& snapshot = m_sample.snapshot;
+
+        // Collect every event before emitting any, since slots may add or
+        // remove modules
+        struct Crossing {
+            QString name;
+            Metric metric;
+            double value;
+            bool above;
+        };
+        std::vector<Crossing> crossings;
+        std::vector<std::pair<QString, qint64>> exited;
+        std::vector<ModuleId> exitedIds;
+        const std::vector<ModuleId>& ids = m_registry.ids();
+        for (std::size_t i = 0; i < snapshot.modules.size(); ++i) {
+            const ModuleSample& module = snapshot.modules[i];
+
+            // A zombie has exited too; one that may not be read stays
+            // registered but has no measurements to compare
+            if (module.status == ModuleStatus::Exited || module.status == ModuleStatus::Zombie) {
+                exited.emplace_back(QString::fromStdString(module.name), module.pid);
+                exitedIds.push_back(ids[i]);
+                continue;
+            }
+            if (module.status != ModuleStatus::Ok) {
+                continue;
+            }
+
+            Limits& limits = m_limits[ids[i]];
+            if (m_cpuThreshold > 0.0 && module.windowMs > 0) {
+                const bool above = module.stats.cpuPercent > m_cpuThreshold;
+                if (above != limits.cpuAbove) {
+                    limits.cpuAbove = above;
+                    crossings.push_back({QString::fromStdString(module.name), Metric::CpuPercent,
+                                         module.stats.cpuPercent, above});
+                }
+            }
+            if (m_memoryThreshold > 0.0) {
+                const bool above = module.stats.memoryMB > m_memoryThreshold;
+                if (above != limits.memoryAbove) {
+                    limits.memoryAbove = above;
+                    crossings.push_back({QString::fromStdString(module.name), Metric::MemoryMB,
+                                         module.stats.memoryMB, above});
+                }
+            }
+        }
+        for (ModuleId id : exitedIds) {
+            m_registry.remove(id);
+            m_limits.erase(id);
+        }
+
+        emit snapshotReady(snapshot);
+        for (const Crossing& crossing : crossings) {
+            emit thresholdCrossed(crossing.name, crossing.metric, crossing.value, crossing.above);
+        }
+        for (const auto& module : exited) {
+            emit moduleExited(module.first, module.second);
+        }
+    }
+
+}
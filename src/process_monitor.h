@@ -0,0 +1,107 @@
+#ifndef PROCESS_STATS_PROCESS_MONITOR_H
+#define PROCESS_STATS_PROCESS_MONITOR_H
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QtGlobal>
+#include <unordered_map>
+
+#include "module_registry.h"
+#include "snapshot.h"
+#include "stats_engine.h"
+
+class QSocketNotifier;
+class QTimer;
+
+namespace ProcessStats {
+    // Samples a set of modules on a fixed cadence and reports the result as
+    // signals, in place of a QTimer around getModuleStats() and a JSON parse
+    //
+    // The monitor owns a StatsEngine, so its CPU history and sinks are its
+    // own, and samples on the thread it lives in; move it to a worker
+    // thread to keep slow /proc reads off the GUI thread. On Linux the
+    // cadence comes from a timerfd watched by a QSocketNotifier, which
+    // sleeps in the event loop between ticks and folds ticks missed while
+    // the loop was busy into one sample; elsewhere a QTimer drives it.
+    class ProcessMonitor : public QObject {
+        Q_OBJECT
+
+    public:
+        enum class Metric {
+            CpuPercent,
+            MemoryMB
+        };
+        Q_ENUM(Metric)
+
+        explicit ProcessMonitor(QObject* parent = nullptr);
+        explicit ProcessMonitor(SamplerOptions options, QObject* parent = nullptr);
+        ~ProcessMonitor() override;
+
+        // Modules to sample; adding a name again moves it to pid. Returns
+        // false for a PID <= 0 or an unknown name.
+        bool addModule(const QString& name, qint64 pid);
+        bool removeModule(const QString& name);
+        int moduleCount() const { return static_cast<int>(m_registry.size()); }
+
+        // Time between samples, 1000 ms by default; applies from the next tick
+        void setInterval(int milliseconds);
+        int interval() const { return m_intervalMs; }
+
+        // thresholdCrossed() fires when a module's value moves to the other
+        // side of a limit; 0 (the default) switches a limit off
+        void setCpuThreshold(double percent);
+        void setMemoryThreshold(double megabytes);
+
+        void start();
+        void stop();
+        bool isActive() const { return m_active; }
+
+        // Sample now, emitting the same signals as a tick
+        void sampleNow();
+
+        // The engine behind the monitor, to enable sinks or swap its source
+        StatsEngine& engine() { return m_engine; }
+
+    signals:
+        // Every tick; the modules are in the order they were added
+        void snapshotReady(const ProcessStats::Snapshot& snapshot);
+
+        // A module's process has exited or become a zombie; the module has
+        // been removed by the time this is emitted
+        void moduleExited(const QString& name, qint64 pid);
+
+        // value is the module's new reading and above the side of the limit
+        // it is now on; CPU is checked from a module's second sample on
+        void thresholdCrossed(const QString& name, ProcessStats::ProcessMonitor::Metric metric,
+                              double value, bool above);
+
+    private:
+        void arm();
+        void onTimerReady();
+
+        StatsEngine m_engine;
+        ModuleRegistry m_registry;
+        RegistrySample m_sample;
+
+        int m_intervalMs = 1000;
+        bool m_active = false;
+        double m_cpuThreshold = 0.0;
+        double m_memoryThreshold = 0.0;
+
+        // Side of each limit a module was last seen on
+        struct Limits {
+            bool cpuAbove = false;
+            bool memoryAbove = false;
+        };
+        std::unordered_map<ModuleId, Limits> m_limits;
+
+        int m_timerFd = -1;
+        QSocketNotifier* m_notifier = nullptr;
+        QTimer* m_timer = nullptr;
+    };
+}
+
+Q_DECLARE_METATYPE(ProcessStats::Snapshot)
+
+#endif // PROCESS_STATS_PROCESS_MONITOR_H
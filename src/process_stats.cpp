@@ -1,209 +1,440 @@
 #include "process_stats.h"
 #include <QDebug>
-#include <QDateTime>
-#include <QJsonArray>
-#include <QJsonObject>
-#include <QJsonDocument>
-#include <QPair>
-#include <QSet>
-#include <cmath>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
-// Platform-specific includes for process monitoring
-#if (defined(Q_OS_MACOS) || defined(Q_OS_MAC)) && !defined(Q_OS_IOS)
-#include <libproc.h>
-#include <mach/mach.h>
-#include <mach/task_info.h>
-#include <sys/sysctl.h>
-#elif defined(Q_OS_LINUX)
-#include <sys/resource.h>
-#include <sys/times.h>
-#include <unistd.h>
-#include <fstream>
-#include <sstream>
-#endif
+#include "async_sampler.h"
+#include "binary_snapshot.h"
+#include "json_writer.h"
+#include "prometheus_writer.h"
+#include "stats_engine.h"
 
 namespace ProcessStats {
 
-// Internal state: tracks previous CPU times for percentage calculation
 namespace {
-    QHash<qint64, QPair<double, qint64>> s_previous_cpu_times;
+    // The engine behind every function here; its warnings go to qWarning()
+    StatsEngine& engine() {
+        static StatsEngine s_engine(SamplerOptions(), [](std::string_view message) {
+            qWarning().noquote() << QString::fromUtf8(message.data(), static_cast<int>(message.size()));
+        });
+        return s_engine;
+    }
+
+    // Worker behind sampleModulesAsync(); destroyed before the engine
+    AsyncSampler& asyncSampler() {
+        static AsyncSampler s_async(engine());
+        return s_async;
+    }
+
+    // Modules registered with registerModule() and the reusable sample of
+    // them; registration may happen on any thread, so both are guarded
+    std::mutex s_registry_mutex;
+    ModuleRegistry s_registry;
+    RegistrySample s_registry_sample;
+
+    // Names and PIDs of processes, in iteration order, as the engine takes
+    // them; the names stay valid until the next call on this thread
+    const std::vector<ModuleRef>& toModuleRefs(const QHash<QString, qint64>& processes) {
+        thread_local std::vector<std::string> names;
+        thread_local std::vector<ModuleRef> modules;
+        names.resize(processes.size());
+        modules.clear();
+        std::size_t i = 0;
+        for (auto it = processes.begin(); it != processes.end(); ++it, ++i) {
+            names[i] = it.key().toStdString();
+            modules.push_back(ModuleRef{names[i], it.value()});
+        }
+        return modules;
+    }
 }
 
     void clearHistory() {
-        s_previous_cpu_times.clear();
+        engine().clearHistory();
+    }
+
+    SelfStats getSelfStats() {
+        return engine().selfStats();
+    }
+
+    void resetSelfStats() {
+        engine().resetSelfStats();
+    }
+
+    void setSelfStatsReporting(bool enabled) {
+        engine().setSelfStatsReporting(enabled);
+    }
+
+    void setJsonPrecision(int significantDigits) {
+        engine().setJsonPrecision(significantDigits);
+    }
+
+    void setSampleSource(std::shared_ptr<SampleSource> source) {
+        engine().setSampleSource(std::move(source));
+    }
+
+    void setCoalescingWindow(int milliseconds) {
+        engine().setCoalescingWindow(milliseconds);
+    }
+
+    void setAlignedBatchTimestamps(bool enabled) {
+        engine().setAlignedBatchTimestamps(enabled);
+    }
+
+    void setSamplingThreads(int workers) {
+        engine().setSamplingThreads(workers);
+    }
+
+    ProcessStatsData getProcessStats(qint64 pid, ModuleStatus* status) {
+        return engine().sampleProcess(pid, status);
+    }
+
+    void getProcessStatsBatch(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out) {
+        engine().sampleBatch(pids, count, out);
+    }
+
+    Snapshot sampleModules(const QHash<QString, qint64>& processes) {
+        return engine().sampleModules(toModuleRefs(processes));
+    }
+
+    QFuture<Snapshot> sampleModulesAsync(const QHash<QString, qint64>& processes) {
+        return sampleModulesAsync(processes, nullptr, nullptr);
     }
 
-    ProcessStatsData getProcessStats(qint64 pid) {
-        ProcessStatsData stats = {0.0, 0.0, 0.0};
+    QFuture<Snapshot> sampleModulesAsync(const QHash<QString, qint64>& processes, QObject* context,
+                                         std::function<void(const Snapshot&)> callback) {
+        auto promise = std::make_shared<QFutureInterface<Snapshot>>();
+        promise->reportStarted();
+        QFuture<Snapshot> future = promise->future();
         
-        if (pid <= 0) {
-            return stats;
+        if (context && callback) {
+            // The watcher lives on context's thread and hears of the result
+            // through the future's own events, so the worker never touches
+            // context; it goes away with context or after delivering
+            auto* watcher = new QFutureWatcher<Snapshot>();
+            QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, callback]() {
+                if (!watcher->isCanceled()) {
+                    callback(watcher->result());
+                }
+                watcher->deleteLater();
+            });
+            QObject::connect(context, &QObject::destroyed, watcher, &QObject::deleteLater);
+            watcher->setFuture(future);
+            watcher->moveToThread(context->thread());
         }
         
-    #if (defined(Q_OS_MACOS) || defined(Q_OS_MAC)) && !defined(Q_OS_IOS)
-        // macOS implementation using libproc
-        struct proc_taskinfo taskInfo;
-        int ret = proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &taskInfo, sizeof(taskInfo));
+        const std::vector<ModuleRef>& modules = toModuleRefs(processes);
+        asyncSampler().submit(modules.data(), modules.size(),
+            [promise](const Snapshot* snapshot) {
+                if (!snapshot) {
+                    // Cancelled, or shut down before it ran
+                    promise->cancel();
+                    promise->reportFinished();
+                    return;
+                }
+                promise->reportResult(*snapshot);
+                promise->reportFinished();
+            },
+            [promise] { return promise->isCanceled(); });
+        return future;
+    }
+
+    const SnapshotPublisher<Snapshot>& latestSnapshot() {
+        return engine().latestSnapshot();
+    }
+
+    bool setSharedMemoryPublisher(const QString& name) {
+        return engine().setSharedMemoryPublisher(name.toStdString());
+    }
+
+    bool setRecordingFile(const QString& path) {
+        return engine().setRecordingFile(path.toStdString());
+    }
+
+    bool setRecordingDirectory(const QString& directory) {
+        return engine().setRecordingDirectory(directory.toStdString());
+    }
+
+    bool startExporter(const QString& unixSocketPath, int tcpPort) {
+        return engine().startExporter(unixSocketPath.toStdString(), tcpPort);
+    }
+
+    void stopExporter() {
+        engine().stopExporter();
+    }
+
+    quint16 exporterPort() {
+        return engine().exporterPort();
+    }
+
+    namespace {
+        // One writer per thread; its buffer is reused across calls
+        JsonWriter& threadJsonWriter() {
+            thread_local JsonWriter writer;
+            writer.clear();
+            writer.setPrecision(engine().jsonPrecision());
+            return writer;
+        }
         
-        if (ret == sizeof(taskInfo)) {
-            // Get CPU time (user + system time) in microseconds, convert to seconds
-            uint64_t totalTime = taskInfo.pti_total_user + taskInfo.pti_total_system;
-            stats.cpuTimeSeconds = totalTime / 1e6;
+        const JsonWriter& serializeModuleStats(const QHash<QString, qint64>& processes) {
+            qDebug() << "getModuleStats() called";
             
-            // Get memory footprint (resident size) in bytes, convert to megabytes
-            stats.memoryMB = taskInfo.pti_resident_size / (1024.0 * 1024.0);
+            Snapshot snapshot = sampleModules(processes);
             
-            // Calculate CPU percentage
-            qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-            if (s_previous_cpu_times.contains(pid)) {
-                QPair<double, qint64> previous = s_previous_cpu_times[pid];
-                double timeDelta = (currentTime - previous.second) / 1000.0; // Convert to seconds
-                double cpuDelta = stats.cpuTimeSeconds - previous.first;
-                
-                if (timeDelta > 0) {
-                    stats.cpuPercent = (cpuDelta / timeDelta) * 100.0;
-                }
+            for (const ModuleSample& module : snapshot.modules) {
+                const ProcessStatsData& stats = module.stats;
+                qDebug() << "Module stats for" << QString::fromStdString(module.name) 
+                        << "- CPU:" << stats.cpuPercent << "%" 
+                        << "(" << stats.cpuTimeSeconds << "s),"
+                        << "Memory:" << stats.memoryMB << "MB";
+            }
+            
+            // Serialize straight into the reusable buffer
+            JsonWriter& writer = threadJsonWriter();
+            {
+                SerializeTimer timer(engine().selfStatsCounters());
+                writeModuleStatsJson(writer, snapshot);
             }
             
-            // Update previous values
-            s_previous_cpu_times[pid] = QPair<double, qint64>(stats.cpuTimeSeconds, currentTime);
+            qDebug() << "Returning module stats JSON for" << snapshot.modules.size() << "modules";
+            return writer;
         }
         
-    #elif defined(Q_OS_LINUX)
-        // Linux implementation using /proc filesystem
-        QString statPath = QString("/proc/%1/stat").arg(pid);
-        QString statusPath = QString("/proc/%1/status").arg(pid);
-        
-        // Read CPU time from /proc/[pid]/stat
-        std::ifstream statFile(statPath.toStdString());
-        if (statFile.is_open()) {
-            std::string line;
-            std::getline(statFile, line);
-            std::istringstream iss(line);
-            std::string token;
+        const JsonWriter& serializeModuleStatsBatch(const QHash<QString, qint64>& processes) {
+            Snapshot snapshot = sampleModules(processes);
             
-            // Skip first 13 tokens (pid, comm, state, ppid, etc.)
-            // utime is token 14 (index 13), stime is token 15 (index 14)
-            for (int i = 0; i < 14 && iss >> token; ++i) {}
-            
-            unsigned long utime = 0, stime = 0;
-            if (iss >> utime && iss >> stime) {
-                // CPU time is in clock ticks, convert to seconds
-                long clockTicks = sysconf(_SC_CLK_TCK);
-                if (clockTicks > 0) {
-                    stats.cpuTimeSeconds = (utime + stime) / static_cast<double>(clockTicks);
-                }
-            }
-            statFile.close();
+            JsonWriter& writer = threadJsonWriter();
+            SerializeTimer timer(engine().selfStatsCounters());
+            writeModuleStatsBatchJson(writer, snapshot);
+            return writer;
         }
         
-        // Read memory from /proc/[pid]/status
-        std::ifstream statusFile(statusPath.toStdString());
-        if (statusFile.is_open()) {
-            std::string line;
-            while (std::getline(statusFile, line)) {
-                if (line.find("VmRSS:") == 0) {
-                    // Extract memory value (in KB)
-                    std::istringstream iss(line);
-                    std::string label, value, unit;
-                    iss >> label >> value >> unit;
-                    if (!value.empty()) {
-                        double memoryKB = std::stod(value);
-                        stats.memoryMB = memoryKB / 1024.0;
-                    }
-                    break;
-                }
-            }
-            statusFile.close();
+        const JsonWriter& serializeModuleStatsDelta(const QHash<QString, qint64>& processes, quint64 sinceSequence) {
+            const std::vector<ModuleRef>& modules = toModuleRefs(processes);
+            JsonWriter& writer = threadJsonWriter();
+            engine().writeModuleStatsDelta(modules.data(), modules.size(), sinceSequence, writer);
+            return writer;
         }
         
-        // Calculate CPU percentage
-        qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-        if (s_previous_cpu_times.contains(pid)) {
-            QPair<double, qint64> previous = s_previous_cpu_times[pid];
-            double timeDelta = (currentTime - previous.second) / 1000.0; // Convert to seconds
-            double cpuDelta = stats.cpuTimeSeconds - previous.first;
+        const JsonWriter& serializeRegisteredModuleStats() {
+            std::lock_guard<std::mutex> lock(s_registry_mutex);
+            engine().sampleModules(s_registry, s_registry_sample);
             
-            if (timeDelta > 0) {
-                stats.cpuPercent = (cpuDelta / timeDelta) * 100.0;
-            }
+            // Names come pre-escaped from the registry
+            JsonWriter& writer = threadJsonWriter();
+            SerializeTimer timer(engine().selfStatsCounters());
+            writeModuleStatsJson(writer, s_registry_sample.snapshot, s_registry.jsonNames().data());
+            return writer;
         }
         
-        // Update previous values
-        s_previous_cpu_times[pid] = QPair<double, qint64>(stats.cpuTimeSeconds, currentTime);
-        
-    #else
-        // Unsupported platform
-        qWarning() << "Process monitoring not supported on this platform";
-    #endif
-        
-        return stats;
-    }
-
-    char* getModuleStats(const QHash<QString, qint64>& processes) {
-        qDebug() << "getModuleStats() called";
-        
-        QJsonArray modulesArray;
+        const PrometheusWriter& renderModuleStatsPrometheus(const QHash<QString, qint64>& processes) {
+            // Keeps each module's rendered labels between scrapes on this thread
+            thread_local PrometheusWriter writer;
+            Snapshot snapshot = sampleModules(processes);
+            SerializeTimer timer(engine().selfStatsCounters());
+            writer.render(snapshot);
+            return writer;
+        }
         
-    #ifndef Q_OS_IOS
-        // Clean up stale entries from internal cache
-        // Build set of active PIDs
-        QSet<qint64> activePids;
-        for (auto it = processes.begin(); it != processes.end(); ++it) {
-            activePids.insert(it.value());
+        char* toCString(const JsonWriter& writer) {
+            // Allocate memory for the result string
+            char* result = new char[writer.size() + 1];
+            memcpy(result, writer.data(), writer.size());
+            result[writer.size()] = '\0';
+            return result;
         }
         
-        // Remove entries for processes that are no longer active
-        auto cacheIt = s_previous_cpu_times.begin();
-        while (cacheIt != s_previous_cpu_times.end()) {
-            if (!activePids.contains(cacheIt.key())) {
-                cacheIt = s_previous_cpu_times.erase(cacheIt);
-            } else {
-                ++cacheIt;
+        // Writer is JsonWriter, PrometheusWriter or std::string
+        template <typename Writer>
+        std::size_t copyTo(const Writer& writer, char* buffer, std::size_t bufferSize) {
+            if (buffer && bufferSize > 0) {
+                const std::size_t length = std::min(writer.size(), bufferSize - 1);
+                memcpy(buffer, writer.data(), length);
+                buffer[length] = '\0';
             }
+            return writer.size();
         }
         
-        // Iterate through provided processes
-        for (auto it = processes.begin(); it != processes.end(); ++it) {
-            QString pluginName = it.key();
-            qint64 pid = it.value();
-            
-            if (pid <= 0) {
-                qWarning() << "Invalid PID for plugin:" << pluginName;
-                continue;
+        // A document kept for snprintf-style callers, so that a size query and
+        // the call that follows it see the same sample. Key identifies the
+        // request (the processes, plus whatever else shapes the output).
+        template <typename Key>
+        struct SizedDocument {
+            Key key;
+            std::string text;
+            bool pending = false;   // measured by a size query, not yet copied out
+        };
+        
+        // A size query (no buffer) always samples and keeps the document; the
+        // next call with a buffer and the same key copies it out instead of
+        // sampling, once. Any other call samples straight into the buffer.
+        template <typename Key, typename Serialize>
+        std::size_t copySized(SizedDocument<Key>& document, const Key& key,
+                              char* buffer, std::size_t bufferSize, Serialize serialize) {
+            const bool query = !buffer || bufferSize == 0;
+            if (!query && document.pending && document.key == key) {
+                document.pending = false;
+                return copyTo(document.text, buffer, bufferSize);
             }
-            
-            // Get process statistics
-            ProcessStatsData stats = getProcessStats(pid);
-            
-            // Create JSON object for this module
-            QJsonObject moduleObj;
-            moduleObj["name"] = pluginName;
-            moduleObj["cpu_percent"] = stats.cpuPercent;
-            moduleObj["cpu_time_seconds"] = stats.cpuTimeSeconds;
-            moduleObj["memory_mb"] = stats.memoryMB;
-            
-            modulesArray.append(moduleObj);
-            
-            qDebug() << "Module stats for" << pluginName 
-                    << "- CPU:" << stats.cpuPercent << "%" 
-                    << "(" << stats.cpuTimeSeconds << "s),"
-                    << "Memory:" << stats.memoryMB << "MB";
+            const auto& writer = serialize();
+            document.pending = query;
+            if (query) {
+                document.text.assign(writer.data(), writer.size());
+                document.key = key;
+            }
+            return copyTo(writer, buffer, bufferSize);
         }
-    #endif // Q_OS_IOS
         
-        // Convert to JSON string
-        QJsonDocument doc(modulesArray);
-        QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
+        uint64_t registryGeneration() {
+            std::lock_guard<std::mutex> lock(s_registry_mutex);
+            return s_registry.generation();
+        }
         
-        // Allocate memory for the result string
-        char* result = new char[jsonData.size() + 1];
-        strcpy(result, jsonData.constData());
+        bool reserve(StatsBuffer& buffer, std::size_t needed) {
+            if (needed <= buffer.capacity) {
+                return true;
+            }
+            // Grow geometrically so a slowly growing module set settles quickly
+            const std::size_t capacity = std::max(needed, buffer.capacity * 2);
+            char* grown = static_cast<char*>(realloc(buffer.data, capacity));
+            if (!grown) {
+                qWarning() << "Failed to grow stats buffer to" << capacity << "bytes";
+                buffer.size = 0;
+                return false;
+            }
+            buffer.data = grown;
+            buffer.capacity = capacity;
+            return true;
+        }
         
-        qDebug() << "Returning module stats JSON for" << modulesArray.size() << "modules";
+        template <typename Writer>
+        std::size_t copyTo(const Writer& writer, StatsBuffer& buffer) {
+            if (!reserve(buffer, writer.size() + 1)) {
+                return 0;
+            }
+            memcpy(buffer.data, writer.data(), writer.size());
+            buffer.data[writer.size()] = '\0';
+            buffer.size = writer.size();
+            return buffer.size;
+        }
+    }
+
+    char* getModuleStats(const QHash<QString, qint64>& processes) {
+        return toCString(serializeModuleStats(processes));
+    }
+
+    char* getModuleStatsBatch(const QHash<QString, qint64>& processes) {
+        return toCString(serializeModuleStatsBatch(processes));
+    }
+
+    std::size_t getModuleStats(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize) {
+        thread_local SizedDocument<QHash<QString, qint64>> document;
+        return copySized(document, processes, buffer, bufferSize,
+                         [&]() -> const JsonWriter& { return serializeModuleStats(processes); });
+    }
+
+    std::size_t getModuleStatsBatch(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize) {
+        thread_local SizedDocument<QHash<QString, qint64>> document;
+        return copySized(document, processes, buffer, bufferSize,
+                         [&]() -> const JsonWriter& { return serializeModuleStatsBatch(processes); });
+    }
+
+    std::size_t getModuleStats(const QHash<QString, qint64>& processes, StatsBuffer& buffer) {
+        return copyTo(serializeModuleStats(processes), buffer);
+    }
+
+    std::size_t getModuleStatsBatch(const QHash<QString, qint64>& processes, StatsBuffer& buffer) {
+        return copyTo(serializeModuleStatsBatch(processes), buffer);
+    }
+
+    std::size_t getModuleStatsBinary(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize) {
+        Snapshot snapshot = sampleModules(processes);
+        SerializeTimer timer(engine().selfStatsCounters());
+        return encodeBinarySnapshot(snapshot, buffer, bufferSize);
+    }
+
+    std::size_t getModuleStatsBinary(const QHash<QString, qint64>& processes, StatsBuffer& buffer) {
+        Snapshot snapshot = sampleModules(processes);
         
-        return result;
+        // Encode in place: size first, then straight into the (possibly grown) buffer
+        const std::size_t size = encodeBinarySnapshot(snapshot, nullptr, 0);
+        if (!reserve(buffer, size)) {
+            return 0;
+        }
+        SerializeTimer timer(engine().selfStatsCounters());
+        encodeBinarySnapshot(snapshot, buffer.data, buffer.capacity);
+        buffer.size = size;
+        return size;
+    }
+
+    std::size_t getModuleStatsPrometheus(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize) {
+        thread_local SizedDocument<QHash<QString, qint64>> document;
+        return copySized(document, processes, buffer, bufferSize,
+                         [&]() -> const PrometheusWriter& { return renderModuleStatsPrometheus(processes); });
+    }
+
+    std::size_t getModuleStatsPrometheus(const QHash<QString, qint64>& processes, StatsBuffer& buffer) {
+        return copyTo(renderModuleStatsPrometheus(processes), buffer);
+    }
+
+    std::size_t getModuleStatsDelta(const QHash<QString, qint64>& processes, quint64 sinceSequence,
+                                    char* buffer, std::size_t bufferSize) {
+        // Keyed on the since sequence too; a fill that reuses the query's
+        // document does not take another sequence number
+        thread_local SizedDocument<std::pair<QHash<QString, qint64>, quint64>> document;
+        return copySized(document, std::make_pair(processes, sinceSequence), buffer, bufferSize,
+                         [&]() -> const JsonWriter& { return serializeModuleStatsDelta(processes, sinceSequence); });
+    }
+
+    std::size_t getModuleStatsDelta(const QHash<QString, qint64>& processes, quint64 sinceSequence,
+                                    StatsBuffer& buffer) {
+        return copyTo(serializeModuleStatsDelta(processes, sinceSequence), buffer);
+    }
+
+    void setDeltaOptions(const DeltaOptions& options) {
+        engine().setDeltaOptions(options);
+    }
+
+    ModuleId registerModule(const QString& name, qint64 pid) {
+        if (pid <= 0) {
+            qWarning() << "Invalid PID for module" << name;
+            return kNoModule;
+        }
+        std::lock_guard<std::mutex> lock(s_registry_mutex);
+        return s_registry.add(name.toStdString(), pid);
+    }
+
+    bool setModulePid(ModuleId id, qint64 pid) {
+        std::lock_guard<std::mutex> lock(s_registry_mutex);
+        return s_registry.setPid(id, pid);
+    }
+
+    bool unregisterModule(ModuleId id) {
+        std::lock_guard<std::mutex> lock(s_registry_mutex);
+        return s_registry.remove(id);
+    }
+
+    std::size_t getRegisteredModuleStats(char* buffer, std::size_t bufferSize) {
+        // Keyed on the registry generation, so a registry change in between
+        // makes the fill sample afresh
+        thread_local SizedDocument<uint64_t> document;
+        return copySized(document, registryGeneration(), buffer, bufferSize,
+                         []() -> const JsonWriter& { return serializeRegisteredModuleStats(); });
+    }
+
+    std::size_t getRegisteredModuleStats(StatsBuffer& buffer) {
+        return copyTo(serializeRegisteredModuleStats(), buffer);
+    }
+
+    void releaseStatsBuffer(StatsBuffer& buffer) {
+        free(buffer.data);
+        buffer = StatsBuffer();
     }
 
 }
@@ -1,21 +1,33 @@
 #ifndef PROCESS_STATS_H
 #define PROCESS_STATS_H
 
+#include <QFuture>
 #include <QHash>
+#include <QObject>
 #include <QString>
 #include <QtGlobal>
+#include <cstddef>
+#include <functional>
+#include <memory>
 
-namespace ProcessStats {
-    // Structure for process statistics
-    struct ProcessStatsData {
-        double cpuPercent;
-        double cpuTimeSeconds;
-        double memoryMB;
-    };
+#include "module_registry.h"
+#include "sample_source.h"
+#include "snapshot.h"
+#include "snapshot_delta.h"
+#include "snapshot_publisher.h"
 
+namespace ProcessStats {
     // Get process statistics (CPU and memory usage) for a given process ID
     // Returns ProcessStatsData structure with CPU percentage, CPU time, and memory usage
-    ProcessStatsData getProcessStats(qint64 pid);
+    // Stats are zeroed for a process that cannot be read; status, if given, says why
+    ProcessStatsData getProcessStats(qint64 pid, ModuleStatus* status = nullptr);
+
+    // Get statistics for count processes in one batch, written to parallel
+    // arrays (entry i of each non-null column for pids[i]); the primitive
+    // getModuleStats() and sampleModules() are built on. Cheaper than a
+    // getProcessStats() call per PID, which repeats the per-batch work.
+    // Invalid PIDs yield zeroed stats.
+    void getProcessStatsBatch(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out);
     
     // Get module statistics for the provided processes as JSON
     // @param processes: map of module name -> process ID
@@ -23,6 +35,183 @@ namespace ProcessStats {
     // The returned string must be freed by the caller
     char* getModuleStats(const QHash<QString, qint64>& processes);
 
+    // Get module statistics for one aligned batch as JSON
+    // Returns an object with the batch's monotonic start and end timestamps
+    // ("batch_start_ns", "batch_end_ns"), its measurement skew ("skew_ms"),
+    // and a "modules" array whose entries add each module's read time relative
+    // to the batch start ("read_offset_ns") and its CPU window ("window_ms")
+    // The returned string must be freed by the caller with delete[]
+    char* getModuleStatsBatch(const QHash<QString, qint64>& processes);
+
+    // Write the getModuleStats() JSON into a caller-owned buffer (snprintf semantics)
+    // At most bufferSize - 1 bytes are written, always followed by a NUL when
+    // bufferSize > 0. Returns the full JSON length excluding the NUL; a result
+    // >= bufferSize means the output was truncated. buffer may be nullptr when
+    // bufferSize is 0, to query the size: that samples and keeps the document
+    // on this thread, and the next call with a buffer for the same processes
+    // copies it out once instead of sampling, so a buffer of the returned
+    // size + 1 always fits. Other calls sample.
+    std::size_t getModuleStats(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize);
+    std::size_t getModuleStatsBatch(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize);
+
+    // Reusable output buffer for polling callers
+    // The library grows it with realloc() only when a document does not fit,
+    // so steady-state polling allocates nothing. Start zero-initialized and
+    // free with releaseStatsBuffer() (or free(data)).
+    struct StatsBuffer {
+        char* data = nullptr;       // NUL-terminated JSON after a successful call
+        std::size_t size = 0;       // JSON length excluding the NUL
+        std::size_t capacity = 0;   // allocated bytes
+    };
+
+    // Write the JSON into buffer, growing it if needed
+    // Returns the JSON length, or 0 if the buffer could not be grown
+    std::size_t getModuleStats(const QHash<QString, qint64>& processes, StatsBuffer& buffer);
+    std::size_t getModuleStatsBatch(const QHash<QString, qint64>& processes, StatsBuffer& buffer);
+
+    // Sample the provided processes and encode the result as a binary snapshot
+    // (layout in binary_snapshot_format.h, read in place with BinarySnapshotView)
+    // Returns the encoded size; unlike the JSON variants nothing is written
+    // unless the whole snapshot fits. buffer must be 8-byte aligned.
+    std::size_t getModuleStatsBinary(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize);
+    std::size_t getModuleStatsBinary(const QHash<QString, qint64>& processes, StatsBuffer& buffer);
+
+    // Sample the provided processes and render them in the Prometheus text
+    // exposition format (see PrometheusWriter for the metrics), with the same
+    // buffer semantics as the JSON variants
+    std::size_t getModuleStatsPrometheus(const QHash<QString, qint64>& processes, char* buffer, std::size_t bufferSize);
+    std::size_t getModuleStatsPrometheus(const QHash<QString, qint64>& processes, StatsBuffer& buffer);
+
+    // Sample the provided processes and return only what changed since the
+    // snapshot sinceSequence, as JSON:
+    //   {"full":false,"modules":[..],"removed":["name",..],"sequence":N,"since":S}
+    // "modules" entries are as in getModuleStats() and hold the modules that
+    // moved beyond the epsilons of setDeltaOptions(); "removed" names the
+    // modules gone since S. Pass the returned "sequence" as the next S;
+    // sequences count delta snapshots only, so other sampling calls in
+    // between do not affect them. When
+    // "full" is true (S is 0, unknown or too old, and on every
+    // fullSnapshotInterval-th snapshot) "modules" is the whole module set and
+    // the caller should replace its state with it. Buffer semantics as for
+    // getModuleStats().
+    std::size_t getModuleStatsDelta(const QHash<QString, qint64>& processes, quint64 sinceSequence,
+                                    char* buffer, std::size_t bufferSize);
+    std::size_t getModuleStatsDelta(const QHash<QString, qint64>& processes, quint64 sinceSequence,
+                                    StatsBuffer& buffer);
+
+    // Epsilons and resync interval for getModuleStatsDelta(); changing them
+    // makes the next delta of every caller full
+    void setDeltaOptions(const DeltaOptions& options);
+
+    // Register a module once and sample it by id from then on, for callers
+    // whose module set rarely changes: names are hashed, copied and escaped
+    // at registration only (see ModuleRegistry). Registering a name again
+    // moves it to pid. Returns kNoModule, with a warning, if pid <= 0.
+    ModuleId registerModule(const QString& name, qint64 pid);
+
+    // For a registered module whose process restarted
+    bool setModulePid(ModuleId id, qint64 pid);
+    bool unregisterModule(ModuleId id);
+
+    // getModuleStats() for every registered module, in registration order,
+    // with the same buffer semantics
+    std::size_t getRegisteredModuleStats(char* buffer, std::size_t bufferSize);
+    std::size_t getRegisteredModuleStats(StatsBuffer& buffer);
+
+    // Free a StatsBuffer's memory and reset it to empty
+    void releaseStatsBuffer(StatsBuffer& buffer);
+
+    // Sample the provided processes and return the structured result
+    // @param processes: map of module name -> process ID
+    // Invalid PIDs are skipped. The snapshot is also published to latestSnapshot()
+    Snapshot sampleModules(const QHash<QString, qint64>& processes);
+
+    // sampleModules() on a worker owned by the library, for callers such as
+    // a GUI thread that must not wait on /proc. Returns at once; the future
+    // finishes with the snapshot. Cancelling it before the worker gets to
+    // it skips the sample. Requests for the same processes that queue up
+    // behind a slow sample share the next one. The synchronous functions
+    // stay safe to call meanwhile; they take turns with the worker.
+    QFuture<Snapshot> sampleModulesAsync(const QHash<QString, qint64>& processes);
+
+    // As above, and also hand the snapshot to callback on context's thread
+    // through a queued call, unless the future was cancelled or context
+    // destroyed by then
+    QFuture<Snapshot> sampleModulesAsync(const QHash<QString, qint64>& processes, QObject* context,
+                                         std::function<void(const Snapshot&)> callback);
+
+    // Latest snapshot produced by sampleModules() or getModuleStats()
+    // Readers on any thread may pin() or read() it without blocking the sampler
+    const SnapshotPublisher<Snapshot>& latestSnapshot();
+
+    // Also publish every snapshot into a named shared memory ring (e.g.
+    // "/process_stats") that other processes read with ShmSnapshotReader
+    // without sampling themselves. An empty name stops publishing and removes
+    // the segment. Returns false if the segment could not be created.
+    bool setSharedMemoryPublisher(const QString& name);
+
+    // Also append every snapshot to a compressed recording file (about one to
+    // two bytes per module sample; see SnapshotRecorder and RecordingReader).
+    // Disk writes happen on a background thread. An empty path stops
+    // recording. Returns false if the file could not be opened.
+    bool setRecordingFile(const QString& path);
+
+    // Like setRecordingFile(), into a directory of segment files that
+    // TimeSeriesStore can query by module and time range. Replaces any
+    // recording file.
+    bool setRecordingDirectory(const QString& directory);
+
+    // Serve the latest snapshot to local scrapers (GET /metrics, /json or
+    // /binary) on a Unix domain socket and, if tcpPort >= 0, over HTTP on
+    // 127.0.0.1 (0 picks a free port). Responses come from what sampleModules()
+    // last published; scrapes never sample. Restarts a running exporter.
+    // Returns false if a listener could not be set up. Linux only.
+    bool startExporter(const QString& unixSocketPath, int tcpPort = -1);
+    void stopExporter();
+
+    // TCP port the exporter listens on, 0 if none
+    quint16 exporterPort();
+
+    // Set the number of threads used to read process counters in
+    // getModuleStats() and sampleModules(); 1 (the default) reads serially
+    void setSamplingThreads(int workers);
+
+    // Batch mode: derive the CPU percentages of all modules in a tick from one
+    // shared timestamp so they cover the same window and are comparable.
+    // Each module still reports its own read time; see getModuleStatsBatch()
+    void setAlignedBatchTimestamps(bool enabled);
+
+    // Share samples between concurrent callers (single-flight mode)
+    // Calls to getProcessStats(), getModuleStats() and sampleModules() whose
+    // PIDs were sampled less than `milliseconds` ago reuse that sample; calls
+    // arriving while a sample is running wait for it instead of reading /proc
+    // again. CPU baselines are then kept per PID across callers instead of
+    // being reset to each call's module set. 0 (the default) disables it.
+    // Those functions are safe to call concurrently either way; change the
+    // window during setup.
+    void setCoalescingWindow(int milliseconds);
+
+    // Read process counters from source instead of the OS, e.g. a
+    // ReplaySource replaying a recording; nullptr goes back to the OS. CPU
+    // percentages are derived as for live readings, and snapshot timestamps
+    // follow the source's clock. Clears the CPU history.
+    void setSampleSource(std::shared_ptr<SampleSource> source);
+
+    // The library's own cost since start or resetSelfStats(): ticks, PIDs
+    // read, system calls, procfs bytes, time in each phase, allocations and
+    // the longest tick. All zero when built with PROCESS_STATS_SELF_STATS=OFF.
+    SelfStats getSelfStats();
+    void resetSelfStats();
+
+    // Add a __process_stats__ entry with getSelfStats() to every output from
+    // now on: JSON arrays, Prometheus, binary snapshots and deltas. Off by default
+    void setSelfStatsReporting(bool enabled);
+
+    // Significant digits for numbers in every JSON output, including the
+    // exporter's /json from its next start. 0 or less (the default) writes
+    // the shortest digits that read back as the same double.
+    void setJsonPrecision(int significantDigits);
+
     // Clear internal CPU time history cache
     // Useful for test isolation and when resetting state
     void clearHistory();
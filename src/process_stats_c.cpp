@@ -0,0 +1,171 @@
+#include "process_stats_c.h"
+#include "binary_snapshot.h"
+#include "json_writer.h"
+#include "prometheus_writer.h"
+#include "stats_engine.h"
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <string_view>
+
+using ProcessStats::StatsEngine;
+
+struct ps_sampler {
+    StatsEngine engine;
+
+    ProcessStats::ModuleRegistry registry;
+    ProcessStats::RegistrySample sample;
+    bool sampled = false;
+    ProcessStats::JsonWriter json;
+    ProcessStats::PrometheusWriter prometheus;
+};
+
+namespace {
+    // Copies text the way snprintf does
+    std::size_t copyText(const char* data, std::size_t length, void* buffer, std::size_t size) {
+        if (buffer && size > 0) {
+            const std::size_t copied = length < size - 1 ? length : size - 1;
+            std::memcpy(buffer, data, copied);
+            static_cast<char*>(buffer)[copied] = '\0';
+        }
+        return length;
+    }
+}
+
+extern "C" {
+
+ps_sampler* ps_sampler_create(const ps_sampler_options* options) {
+    // Read only the fields the caller's struct has
+    ps_sampler_options settings = {sizeof(ps_sampler_options), 1, 0, 0, 0};
+    if (options) {
+        if (options->size < sizeof(uint32_t)) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        std::memcpy(&settings, options, options->size < sizeof(settings) ? options->size : sizeof(settings));
+    }
+
+    ps_sampler* sampler = new (std::nothrow) ps_sampler();
+    if (!sampler) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    try {
+        sampler->engine.setSamplingThreads(settings.sampling_threads);
+        sampler->engine.setAlignedBatchTimestamps(settings.aligned_timestamps != 0);
+        sampler->engine.setSelfStatsReporting(settings.self_stats != 0);
+        sampler->engine.setJsonPrecision(settings.json_precision);
+        sampler->json.setPrecision(sampler->engine.jsonPrecision());
+    } catch (const std::exception&) {
+        delete sampler;
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return sampler;
+}
+
+void ps_sampler_destroy(ps_sampler* sampler) {
+    delete sampler;
+}
+
+int ps_sampler_add_pid(ps_sampler* sampler, const char* name, int64_t pid) {
+    if (!sampler || !name || pid <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    try {
+        if (sampler->registry.add(name, pid) == ProcessStats::kNoModule) {
+            errno = ENOSPC;
+            return -1;
+        }
+    } catch (const std::exception&) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+int ps_sampler_remove(ps_sampler* sampler, const char* name) {
+    if (!sampler || !name) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!sampler->registry.remove(sampler->registry.find(name))) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
+
+size_t ps_sampler_module_count(const ps_sampler* sampler) {
+    return sampler ? sampler->registry.size() : 0;
+}
+
+int ps_sampler_sample(ps_sampler* sampler) {
+    if (!sampler) {
+        errno = EINVAL;
+        return -1;
+    }
+    try {
+        sampler->engine.sampleModules(sampler->registry, sampler->sample);
+        sampler->sampled = true;
+    } catch (const std::exception&) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+size_t ps_sampler_read(ps_sampler* sampler, ps_format format, void* buffer, size_t size) {
+    if (!sampler) {
+        errno = EINVAL;
+        return 0;
+    }
+    if (!sampler->sampled) {
+        errno = ENODATA;
+        return 0;
+    }
+    // Names come pre-escaped from the registry unless it changed since
+    // the sample was taken
+    const ProcessStats::Snapshot& snapshot = sampler->sample.snapshot;
+    const std::string_view* jsonNames = sampler->sample.generation == sampler->registry.generation()
+        ? sampler->registry.jsonNames().data()
+        : nullptr;
+    try {
+        ProcessStats::SerializeTimer timer(sampler->engine.selfStatsCounters());
+        switch (format) {
+        case PS_FORMAT_JSON:
+            sampler->json.clear();
+            ProcessStats::writeModuleStatsJson(sampler->json, snapshot, jsonNames);
+            return copyText(sampler->json.data(), sampler->json.size(), buffer, size);
+        case PS_FORMAT_BATCH_JSON:
+            sampler->json.clear();
+            ProcessStats::writeModuleStatsBatchJson(sampler->json, snapshot, jsonNames);
+            return copyText(sampler->json.data(), sampler->json.size(), buffer, size);
+        case PS_FORMAT_PROMETHEUS:
+            sampler->prometheus.render(snapshot);
+            return copyText(sampler->prometheus.data(), sampler->prometheus.size(), buffer, size);
+        case PS_FORMAT_BINARY:
+            return ProcessStats::encodeBinarySnapshot(snapshot, buffer, size);
+        }
+    } catch (const std::exception&) {
+        errno = ENOMEM;
+        return 0;
+    }
+    errno = EINVAL;
+    return 0;
+}
+
+int ps_sampler_self_stats(const ps_sampler* sampler, ps_self_stats* out) {
+    if (!sampler || !out) {
+        errno = EINVAL;
+        return -1;
+    }
+    const ProcessStats::SelfStats stats = sampler->engine.selfStats();
+    *out = ps_self_stats{stats.ticks, stats.pidsSampled, stats.syscalls, stats.bytesRead, stats.readNs,
+                         stats.computeNs, stats.serializeNs, stats.allocations, stats.maxTickNs};
+    return 0;
+}
+
+}
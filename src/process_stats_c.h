@@ -0,0 +1,86 @@
+/*
+ * C API for FFI consumers
+ *
+ * A ps_sampler is an opaque handle around its own sampling engine: register
+ * modules once with ps_sampler_add_pid(), then call ps_sampler_sample() every
+ * tick and ps_sampler_read() for each format wanted. Output goes into
+ * caller-owned buffers; the library never hands out memory to free.
+ *
+ * Functions returning int return 0 on success and -1 with errno set on
+ * failure. A handle may be used from one thread at a time; separate handles
+ * are independent. Nothing here throws.
+ */
+#ifndef PROCESS_STATS_C_H
+#define PROCESS_STATS_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "binary_snapshot_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ps_sampler ps_sampler;
+
+typedef enum ps_format {
+    PS_FORMAT_JSON = 0,         /* as getModuleStats() */
+    PS_FORMAT_BATCH_JSON = 1,   /* as getModuleStatsBatch() */
+    PS_FORMAT_PROMETHEUS = 2,   /* text exposition format */
+    PS_FORMAT_BINARY = 3        /* binary_snapshot_format.h */
+} ps_format;
+
+/*
+ * Set size to sizeof(ps_sampler_options); fields are only ever appended, and
+ * a library reading an older, smaller struct uses defaults for the rest
+ */
+typedef struct ps_sampler_options {
+    uint32_t size;
+    int32_t sampling_threads;   /* threads reading process counters, 1 by default */
+    int32_t aligned_timestamps; /* nonzero: one CPU window per tick, see setAlignedBatchTimestamps() */
+    int32_t self_stats;         /* nonzero: every format adds a __process_stats__ entry */
+    int32_t json_precision;     /* significant digits in JSON numbers; 0: shortest that round-trips */
+} ps_sampler_options;
+
+/* Returns NULL with errno set on failure; options may be NULL for defaults */
+ps_sampler* ps_sampler_create(const ps_sampler_options* options);
+void ps_sampler_destroy(ps_sampler* sampler);
+
+/*
+ * Monitor pid under name (UTF-8, copied); a name already registered moves to
+ * the new pid. Modules are sampled and reported in registration order.
+ * EINVAL for a NULL name or a pid <= 0.
+ */
+int ps_sampler_add_pid(ps_sampler* sampler, const char* name, int64_t pid);
+
+/* Stop monitoring name; ENOENT if it was not registered */
+int ps_sampler_remove(ps_sampler* sampler, const char* name);
+
+size_t ps_sampler_module_count(const ps_sampler* sampler);
+
+/* Sample every registered module; ps_sampler_read() reports this sample */
+int ps_sampler_sample(ps_sampler* sampler);
+
+/*
+ * Write the last sample in format into buffer and return its full size.
+ * Text formats follow snprintf: at most size - 1 bytes and a NUL, so a
+ * result >= size means truncation. PS_FORMAT_BINARY writes nothing unless
+ * all of it fits, and needs an 8-byte aligned buffer. buffer may be NULL
+ * when size is 0, to query the size. Returns 0 with errno set to ENODATA
+ * before the first sample, or EINVAL for an unknown format.
+ */
+size_t ps_sampler_read(ps_sampler* sampler, ps_format format, void* buffer, size_t size);
+
+/*
+ * The sampler's own cost since it was created: what the __process_stats__
+ * entry reports, whether or not that is enabled. All zero if the library
+ * was built with PROCESS_STATS_SELF_STATS=OFF.
+ */
+int ps_sampler_self_stats(const ps_sampler* sampler, ps_self_stats* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROCESS_STATS_C_H */
@@ -0,0 +1,239 @@
+#include "prometheus_writer.h"
+#include "json_writer.h"
+#include <charconv>
+#include <cmath>
+#include <iterator>
+
+namespace ProcessStats {
+
+namespace {
+    constexpr double kBytesPerMB = 1024.0 * 1024.0;
+
+    struct Family {
+        const char* header;   // HELP and TYPE lines
+        const char* name;
+        double (*value)(const ModuleSample&);
+    };
+
+    constexpr int kMaxFastDecimals = 6;
+    constexpr double kMaxExactInteger = 9007199254740992.0;  // 2^53
+
+    // Write mantissa / 10^decimals in plain decimal notation
+    void appendScaledInteger(std::string& out, int64_t mantissa, int decimals) {
+        if (mantissa < 0) {
+            out += '-';
+            mantissa = -mantissa;
+        }
+        char digits[24];
+        char* end = std::to_chars(digits, digits + sizeof(digits), mantissa).ptr;
+        const int length = static_cast<int>(end - digits);
+        if (decimals == 0) {
+            out.append(digits, end);
+        } else if (length <= decimals) {
+            out += "0.";
+            out.append(static_cast<std::size_t>(decimals - length), '0');
+            out.append(digits, end);
+        } else {
+            out.append(digits, end - decimals);
+            out += '.';
+            out.append(end - decimals, end);
+        }
+    }
+
+    const Family kModuleFamilies[] = {
+        {"# HELP process_stats_cpu_seconds_total Total CPU time consumed by the module process.\n"
+         "# TYPE process_stats_cpu_seconds_total counter\n",
+         "process_stats_cpu_seconds_total",
+         [](const ModuleSample& module) { return module.stats.cpuTimeSeconds; }},
+        {"# HELP process_stats_cpu_percent CPU usage of the module process over the last window.\n"
+         "# TYPE process_stats_cpu_percent gauge\n",
+         "process_stats_cpu_percent",
+         [](const ModuleSample& module) { return module.stats.cpuPercent; }},
+        {"# HELP process_stats_resident_bytes Resident memory of the module process.\n"
+         "# TYPE process_stats_resident_bytes gauge\n",
+         "process_stats_resident_bytes",
+         [](const ModuleSample& module) { return module.stats.memoryMB * kBytesPerMB; }},
+        {"# HELP process_stats_cpu_window_seconds Time window process_stats_cpu_percent was measured over.\n"
+         "# TYPE process_stats_cpu_window_seconds gauge\n",
+         "process_stats_cpu_window_seconds",
+         [](const ModuleSample& module) { return module.windowMs / 1000.0; }},
+    };
+
+    struct SelfFamily {
+        const char* header;
+        const char* sample;   // name and label block
+        double (*value)(const SelfStats&);
+    };
+
+    const SelfFamily kSelfFamilies[] = {
+        {"# HELP process_stats_self_ticks_total Sampling passes of this library.\n"
+         "# TYPE process_stats_self_ticks_total counter\n",
+         "process_stats_self_ticks_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return static_cast<double>(stats.ticks); }},
+        {"# HELP process_stats_self_pids_sampled_total Process reads issued by this library.\n"
+         "# TYPE process_stats_self_pids_sampled_total counter\n",
+         "process_stats_self_pids_sampled_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return static_cast<double>(stats.pidsSampled); }},
+        {"# HELP process_stats_self_syscalls_total System calls made by process reads.\n"
+         "# TYPE process_stats_self_syscalls_total counter\n",
+         "process_stats_self_syscalls_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return static_cast<double>(stats.syscalls); }},
+        {"# HELP process_stats_self_read_bytes_total Bytes read from procfs by process reads.\n"
+         "# TYPE process_stats_self_read_bytes_total counter\n",
+         "process_stats_self_read_bytes_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return static_cast<double>(stats.bytesRead); }},
+        {"# HELP process_stats_self_read_seconds_total Time spent in read phases.\n"
+         "# TYPE process_stats_self_read_seconds_total counter\n",
+         "process_stats_self_read_seconds_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return stats.readNs / 1e9; }},
+        {"# HELP process_stats_self_compute_seconds_total Time spent deriving rates and statuses.\n"
+         "# TYPE process_stats_self_compute_seconds_total counter\n",
+         "process_stats_self_compute_seconds_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return stats.computeNs / 1e9; }},
+        {"# HELP process_stats_self_serialize_seconds_total Time spent rendering output.\n"
+         "# TYPE process_stats_self_serialize_seconds_total counter\n",
+         "process_stats_self_serialize_seconds_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return stats.serializeNs / 1e9; }},
+        {"# HELP process_stats_self_allocations_total Buffers grown and module names copied by this library.\n"
+         "# TYPE process_stats_self_allocations_total counter\n",
+         "process_stats_self_allocations_total{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return static_cast<double>(stats.allocations); }},
+        {"# HELP process_stats_self_max_tick_seconds Longest sampling pass of this library.\n"
+         "# TYPE process_stats_self_max_tick_seconds gauge\n",
+         "process_stats_self_max_tick_seconds{module=\"__process_stats__\"} ",
+         [](const SelfStats& stats) { return stats.maxTickNs / 1e9; }},
+    };
+}
+
+    void PrometheusWriter::appendValue(std::string& out, double value) {
+        if (std::isnan(value)) {
+            out += "NaN";
+            return;
+        }
+        if (std::isinf(value)) {
+            out += value > 0 ? "+Inf" : "-Inf";
+            return;
+        }
+
+        // Fast path: most values have few decimals (clock-tick CPU seconds,
+        // KiB-based byte counts, millisecond windows). If value * 10^k rounds
+        // to an integer m with m / 10^k == value, then "m with k decimals"
+        // parses back to exactly value and integer formatting is much cheaper
+        // than the shortest-digits search
+        double scale = 1.0;
+        for (int decimals = 0; decimals <= kMaxFastDecimals; ++decimals, scale *= 10.0) {
+            const double scaled = value * scale;
+            if (std::fabs(scaled) >= kMaxExactInteger) {
+                break;
+            }
+            const double rounded = std::nearbyint(scaled);
+            if (rounded / scale == value) {
+                appendScaledInteger(out, static_cast<int64_t>(rounded), decimals);
+                return;
+            }
+        }
+        JsonWriter::appendDouble(out, value);
+    }
+
+    void PrometheusWriter::appendLabelValue(std::string& out, const std::string& value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+        out += '"';
+    }
+
+    PrometheusWriter::Labels& PrometheusWriter::labelsFor(const ModuleSample& module, std::size_t row) {
+        // Module sets rarely change between scrapes: try last scrape's row first
+        Labels* labels = row < m_rows.size() ? m_rows[row] : nullptr;
+        if (!labels || *labels->name != module.name) {
+            auto it = m_labels.try_emplace(module.name).first;
+            labels = &it->second;
+            labels->name = &it->first;
+        }
+
+        if (labels->rendered.empty() || labels->pid != module.pid) {
+            labels->pid = module.pid;
+            labels->rendered.clear();
+            labels->rendered += "{module=";
+            appendLabelValue(labels->rendered, module.name);
+            labels->rendered += ",pid=\"";
+            char digits[24];
+            char* end = std::to_chars(digits, digits + sizeof(digits), module.pid).ptr;
+            labels->rendered.append(digits, end);
+            labels->rendered += "\"} ";
+        }
+        labels->lastScrape = m_scrape;
+        return *labels;
+    }
+
+    void PrometheusWriter::render(const Snapshot& snapshot) {
+        ++m_scrape;
+        m_buffer.clear();
+
+        const std::size_t count = snapshot.modules.size();
+        for (std::size_t i = 0; i < count; ++i) {
+            Labels& labels = labelsFor(snapshot.modules[i], i);
+            if (i < m_rows.size()) {
+                m_rows[i] = &labels;
+            } else {
+                m_rows.push_back(&labels);
+            }
+        }
+        m_rows.resize(count);
+
+        // Forget modules that were not part of this scrape
+        if (m_labels.size() > count) {
+            for (auto it = m_labels.begin(); it != m_labels.end();) {
+                it = it->second.lastScrape == m_scrape ? std::next(it) : m_labels.erase(it);
+            }
+        }
+
+        for (const Family& family : kModuleFamilies) {
+            m_buffer += family.header;
+            for (std::size_t i = 0; i < snapshot.modules.size(); ++i) {
+                m_buffer += family.name;
+                m_buffer += m_rows[i]->rendered;
+                appendValue(m_buffer, family.value(snapshot.modules[i]));
+                m_buffer += '\n';
+            }
+        }
+
+        // One sample per module, labelled with its current status
+        m_buffer += "# HELP process_stats_module_status Status of the module process; 1 for the status labelled.\n"
+                    "# TYPE process_stats_module_status gauge\n";
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::string& rendered = m_rows[i]->rendered;
+            m_buffer += "process_stats_module_status";
+            m_buffer.append(rendered, 0, rendered.size() - 2);
+            m_buffer += ",status=\"";
+            m_buffer += moduleStatusName(snapshot.modules[i].status);
+            m_buffer += "\"} 1\n";
+        }
+
+        m_buffer += "# HELP process_stats_modules Number of modules in the last snapshot.\n"
+                    "# TYPE process_stats_modules gauge\n"
+                    "process_stats_modules ";
+        appendValue(m_buffer, static_cast<double>(snapshot.modules.size()));
+        m_buffer += "\n# HELP process_stats_batch_skew_seconds Spread of read times within the last snapshot.\n"
+                    "# TYPE process_stats_batch_skew_seconds gauge\n"
+                    "process_stats_batch_skew_seconds ";
+        appendValue(m_buffer, snapshot.skewNs() / 1e9);
+        m_buffer += '\n';
+
+        if (snapshot.hasSelfStats) {
+            for (const SelfFamily& family : kSelfFamilies) {
+                m_buffer += family.header;
+                m_buffer += family.sample;
+                appendValue(m_buffer, family.value(snapshot.selfStats));
+                m_buffer += '\n';
+            }
+        }
+    }
+
+}
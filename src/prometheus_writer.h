@@ -0,0 +1,68 @@
+#ifndef PROCESS_STATS_PROMETHEUS_WRITER_H
+#define PROCESS_STATS_PROMETHEUS_WRITER_H
+
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    // Renders snapshots in the Prometheus text exposition format (0.0.4)
+    //
+    // Per module:
+    //   process_stats_cpu_seconds_total   counter  cumulative CPU time
+    //   process_stats_cpu_percent         gauge    CPU usage over the last window
+    //   process_stats_resident_bytes      gauge    resident memory
+    //   process_stats_cpu_window_seconds  gauge    window the CPU usage covers
+    //   process_stats_module_status       gauge    1, with the status as a label
+    // Per snapshot:
+    //   process_stats_modules, process_stats_batch_skew_seconds
+    // With SelfStats, labelled {module="__process_stats__"}:
+    //   process_stats_self_{ticks,pids_sampled,syscalls,read_bytes,allocations}_total,
+    //   process_stats_self_{read,compute,serialize}_seconds_total,
+    //   process_stats_self_max_tick_seconds
+    //
+    // The {module="...",pid="..."} label block of each module is escaped and
+    // rendered once and reused on later scrapes; a module at the same position
+    // as last time is matched without a hash lookup. Modules missing from a
+    // scrape are dropped from the cache. Not thread-safe: use one writer per
+    // thread.
+    class PrometheusWriter {
+    public:
+        // Replace the buffer with the exposition of snapshot; keeps capacity
+        void render(const Snapshot& snapshot);
+
+        const std::string& buffer() const { return m_buffer; }
+        const char* data() const { return m_buffer.data(); }
+        std::size_t size() const { return m_buffer.size(); }
+
+        std::size_t cachedLabelCount() const { return m_labels.size(); }
+
+        // Exposition-format sample value that parses back to exactly value:
+        // plain decimals where at most six are needed, otherwise shortest
+        // round-trip digits; NaN/+Inf/-Inf for special values
+        static void appendValue(std::string& out, double value);
+
+        // Escape a label value (backslash, double quote, newline)
+        static void appendLabelValue(std::string& out, const std::string& value);
+
+    private:
+        struct Labels {
+            const std::string* name = nullptr;  // key in m_labels
+            int64_t pid = 0;
+            std::string rendered;     // {module="...",pid="..."}
+            uint64_t lastScrape = 0;
+        };
+
+        Labels& labelsFor(const ModuleSample& module, std::size_t row);
+
+        std::string m_buffer;
+        std::unordered_map<std::string, Labels> m_labels;   // by module name
+        std::vector<Labels*> m_rows;                        // labels per module, last scrape
+        uint64_t m_scrape = 0;
+    };
+}
+
+#endif // PROCESS_STATS_PROMETHEUS_WRITER_H
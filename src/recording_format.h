@@ -0,0 +1,84 @@
+#ifndef PROCESS_STATS_RECORDING_FORMAT_H
+#define PROCESS_STATS_RECORDING_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ProcessStats {
+    // Layout of a recording file written by SnapshotRecorder
+    //
+    //     FileHeader                       (padded to kDataOffset bytes)
+    //     block 0, block 1, ...            (blockSize bytes each)
+    //
+    // Blocks are fixed-size and self-contained, so block i starts at
+    // kDataOffset + i * blockSize and can be decoded on its own. Each block:
+    //
+    //     BlockHeader                      (64 bytes; doubles as the block index)
+    //     SeriesEntry[seriesCount]
+    //     module names                     (not NUL-terminated)
+    //     timestamp stream                 (one timestamp per row)
+    //     series streams
+    //
+    // A row is one recorded snapshot. A series is a run of consecutive rows of
+    // one module; a module that drops out and returns starts a new series.
+    // Streams use the Gorilla encodings in gorilla_codec.h: timestamps as
+    // delta-of-delta, values XOR-compressed. A series stream holds the first
+    // row's CPU percentage whole, then for every row the CPU time in
+    // milliseconds and the resident memory in KiB, both integral doubles so
+    // that successive XORs stay short. CPU percentages of later rows are
+    // derived from the CPU time and timestamp deltas.
+    //
+    // A block's header is written after the rest of it, so a block whose
+    // magic is valid is complete even while the file is being recorded to.
+    // All integers are native-endian. Unused bytes are zero.
+    namespace Recording {
+        constexpr uint32_t kFileMagic = 0x43525350u;   // "PSRC"
+        constexpr uint32_t kBlockMagic = 0x4b425350u;  // "PSBK"
+        constexpr uint16_t kVersion = 1;
+        constexpr std::size_t kDataOffset = 4096;
+        constexpr uint32_t kMinBlockSize = 4096;
+
+        struct FileHeader {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t headerSize;      // kDataOffset
+            uint32_t blockSize;       // a multiple of 4096
+            uint32_t reserved0;
+            int64_t createdMs;        // wall clock, milliseconds since the epoch
+            uint8_t reserved[40];
+        };
+
+        struct BlockHeader {
+            uint32_t magic;           // kBlockMagic; zero for a block never written
+            uint32_t seriesCount;
+            uint32_t rowCount;
+            uint32_t usedBytes;       // bytes of the block in use, header included
+            int64_t minTimeMs;        // first row
+            int64_t maxTimeMs;        // last row
+            uint64_t blockNumber;     // position in the file
+            uint32_t timeOffset;      // timestamp stream, from the block start
+            uint32_t timeBits;
+            uint32_t sampleCount;     // sum of the series' sampleCounts
+            uint8_t reserved[12];
+        };
+
+        struct SeriesEntry {
+            uint32_t nameOffset;      // from the block start
+            uint32_t nameLength;
+            uint32_t firstRow;
+            uint32_t sampleCount;     // rows firstRow .. firstRow + sampleCount - 1
+            uint32_t dataOffset;      // series stream, from the block start
+            uint32_t dataBits;
+        };
+
+        static_assert(sizeof(FileHeader) == 64, "recording file header layout changed");
+        static_assert(sizeof(BlockHeader) == 64, "recording block header layout changed");
+        static_assert(sizeof(SeriesEntry) == 24, "recording series entry layout changed");
+
+        constexpr std::size_t blockOffset(uint64_t index, uint32_t blockSize) {
+            return kDataOffset + static_cast<std::size_t>(index) * blockSize;
+        }
+    }
+}
+
+#endif // PROCESS_STATS_RECORDING_FORMAT_H
@@ -0,0 +1,184 @@
+#include "recording_reader.h"
+#include "gorilla_codec.h"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    bool fits(uint64_t offset, uint64_t length, uint64_t limit) {
+        return offset <= limit && length <= limit - offset;
+    }
+
+    uint64_t bytesFor(uint64_t bits) {
+        return (bits + 7) / 8;
+    }
+
+    // A block whose header passed validation
+    struct DecodedBlock {
+        const uint8_t* bytes = nullptr;
+        Recording::BlockHeader header;
+    };
+
+    bool openBlock(const void* block, std::size_t size, DecodedBlock& out, std::vector<int64_t>& timestamps) {
+        out.bytes = static_cast<const uint8_t*>(block);
+        Recording::BlockHeader& header = out.header;
+        if (size < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, out.bytes, sizeof(header));
+        const uint64_t used = header.usedBytes;
+        if (header.magic != Recording::kBlockMagic || used > size
+            || !fits(sizeof(header), uint64_t(header.seriesCount) * sizeof(Recording::SeriesEntry), used)
+            || !fits(header.timeOffset, bytesFor(header.timeBits), used)) {
+            return false;
+        }
+
+        timestamps.resize(header.rowCount);
+        BitReader timeBits(out.bytes + header.timeOffset, header.timeBits);
+        TimestampDecoder time;
+        for (int64_t& timestamp : timestamps) {
+            timestamp = time.next(timeBits);
+        }
+        return !timeBits.overrun();
+    }
+
+    bool readEntry(const DecodedBlock& block, uint32_t index, Recording::SeriesEntry& entry) {
+        if (index >= block.header.seriesCount) {
+            return false;
+        }
+        std::memcpy(&entry, block.bytes + sizeof(Recording::BlockHeader) + index * sizeof(entry), sizeof(entry));
+        const uint64_t used = block.header.usedBytes;
+        return fits(entry.nameOffset, entry.nameLength, used) && fits(entry.dataOffset, bytesFor(entry.dataBits), used)
+            && fits(entry.firstRow, entry.sampleCount, block.header.rowCount);
+    }
+
+    // Append the samples of one series with fromMs <= timestamp < toMs
+    bool decodeSeries(const DecodedBlock& block, const Recording::SeriesEntry& entry,
+                      const std::vector<int64_t>& timestamps, int64_t fromMs, int64_t toMs,
+                      std::vector<RecordedSample>& out) {
+        BitReader in(block.bytes + entry.dataOffset, entry.dataBits);
+        uint64_t firstCpuPercent = in.read(64);
+        XorDecoder cpuTime;
+        XorDecoder memory;
+        RecordedSample previous;
+        const std::size_t first = out.size();
+        for (uint32_t s = 0; s < entry.sampleCount; ++s) {
+            RecordedSample sample;
+            sample.timestampMs = timestamps[entry.firstRow + s];
+            sample.cpuTimeSeconds = cpuTime.next(in) / 1000.0;
+            sample.memoryMB = memory.next(in) / 1024.0;
+            if (s == 0) {
+                std::memcpy(&sample.cpuPercent, &firstCpuPercent, sizeof(double));
+            } else {
+                const int64_t elapsedMs = sample.timestampMs - previous.timestampMs;
+                sample.cpuPercent = elapsedMs > 0
+                    ? (sample.cpuTimeSeconds - previous.cpuTimeSeconds) * 1000.0 / elapsedMs * 100.0
+                    : 0.0;
+            }
+            if (sample.timestampMs >= fromMs && sample.timestampMs < toMs) {
+                out.push_back(sample);
+            }
+            previous = sample;
+        }
+        if (in.overrun()) {
+            out.resize(first);
+            return false;
+        }
+        return true;
+    }
+}
+
+    bool decodeRecordingBlock(const void* block, std::size_t size, std::vector<RecordedSeries>& out) {
+        thread_local std::vector<int64_t> timestamps;
+        DecodedBlock decoded;
+        if (!openBlock(block, size, decoded, timestamps)) {
+            return false;
+        }
+
+        const std::size_t first = out.size();
+        for (uint32_t i = 0; i < decoded.header.seriesCount; ++i) {
+            Recording::SeriesEntry entry;
+            if (!readEntry(decoded, i, entry)) {
+                out.resize(first);
+                return false;
+            }
+            out.emplace_back();
+            RecordedSeries& series = out.back();
+            series.name.assign(reinterpret_cast<const char*>(decoded.bytes + entry.nameOffset), entry.nameLength);
+            series.samples.reserve(entry.sampleCount);
+            if (!decodeSeries(decoded, entry, timestamps, std::numeric_limits<int64_t>::min(),
+                              std::numeric_limits<int64_t>::max(), series.samples)) {
+                out.resize(first);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool decodeRecordingSeries(const void* block, std::size_t size, uint32_t series,
+                               int64_t fromMs, int64_t toMs, std::vector<RecordedSample>& out) {
+        thread_local std::vector<int64_t> timestamps;
+        DecodedBlock decoded;
+        Recording::SeriesEntry entry;
+        return openBlock(block, size, decoded, timestamps) && readEntry(decoded, series, entry)
+            && decodeSeries(decoded, entry, timestamps, fromMs, toMs, out);
+    }
+
+    std::unique_ptr<RecordingReader> RecordingReader::open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        Recording::FileHeader header{};
+        if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || header.magic != Recording::kFileMagic || header.version != Recording::kVersion
+            || header.headerSize != Recording::kDataOffset || header.blockSize < Recording::kMinBlockSize) {
+            close(fd);
+            errno = EINVAL;
+            return nullptr;
+        }
+        return std::unique_ptr<RecordingReader>(new RecordingReader(fd, header.blockSize));
+    }
+
+    RecordingReader::RecordingReader(int fd, uint32_t blockSize)
+        : m_fd(fd),
+          m_blockSize(blockSize) {}
+
+    RecordingReader::~RecordingReader() {
+        close(m_fd);
+    }
+
+    uint64_t RecordingReader::blockCount() const {
+        struct stat info;
+        if (fstat(m_fd, &info) != 0 || static_cast<uint64_t>(info.st_size) <= Recording::kDataOffset) {
+            return 0;
+        }
+        return (static_cast<uint64_t>(info.st_size) - Recording::kDataOffset + m_blockSize - 1) / m_blockSize;
+    }
+
+    bool RecordingReader::blockHeader(uint64_t index, Recording::BlockHeader& out) const {
+        const off_t offset = static_cast<off_t>(Recording::blockOffset(index, m_blockSize));
+        return pread(m_fd, &out, sizeof(out), offset) == static_cast<ssize_t>(sizeof(out))
+            && out.magic == Recording::kBlockMagic;
+    }
+
+    bool RecordingReader::readBlock(uint64_t index, std::vector<RecordedSeries>& out) const {
+        Recording::BlockHeader header;
+        if (!blockHeader(index, header) || header.usedBytes > m_blockSize) {
+            return false;
+        }
+        // Only the used part of the block is read
+        m_buffer.resize(header.usedBytes);
+        const off_t offset = static_cast<off_t>(Recording::blockOffset(index, m_blockSize));
+        if (pread(m_fd, m_buffer.data(), m_buffer.size(), offset) != static_cast<ssize_t>(m_buffer.size())) {
+            return false;
+        }
+        return decodeRecordingBlock(m_buffer.data(), m_buffer.size(), out);
+    }
+
+}
@@ -0,0 +1,66 @@
+#ifndef PROCESS_STATS_RECORDING_READER_H
+#define PROCESS_STATS_RECORDING_READER_H
+
+#include "recording_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ProcessStats {
+    struct RecordedSample {
+        int64_t timestampMs = 0;
+        double cpuPercent = 0.0;
+        double cpuTimeSeconds = 0.0;
+        double memoryMB = 0.0;
+    };
+
+    // Consecutive samples of one module from one block
+    struct RecordedSeries {
+        std::string name;
+        std::vector<RecordedSample> samples;
+    };
+
+    // Decode one block of a recording (recording_format.h); appends its
+    // series to out. Returns false if the block is unused or malformed.
+    bool decodeRecordingBlock(const void* block, std::size_t size, std::vector<RecordedSeries>& out);
+
+    // Decode only the series-th series of a block, appending its samples with
+    // fromMs <= timestampMs < toMs. Returns false if the block or the series
+    // is malformed.
+    bool decodeRecordingSeries(const void* block, std::size_t size, uint32_t series,
+                               int64_t fromMs, int64_t toMs, std::vector<RecordedSample>& out);
+
+    // Reads a recording file block by block
+    class RecordingReader {
+    public:
+        // Returns nullptr and leaves errno set on failure (EINVAL if path is
+        // not a recording)
+        static std::unique_ptr<RecordingReader> open(const std::string& path);
+        ~RecordingReader();
+
+        RecordingReader(const RecordingReader&) = delete;
+        RecordingReader& operator=(const RecordingReader&) = delete;
+
+        uint32_t blockSize() const { return m_blockSize; }
+
+        // Blocks in the file, including any not yet written in full
+        uint64_t blockCount() const;
+
+        // Index entry of block index: time range and counts, without decoding.
+        // Returns false for an unused or unreadable block.
+        bool blockHeader(uint64_t index, Recording::BlockHeader& out) const;
+
+        bool readBlock(uint64_t index, std::vector<RecordedSeries>& out) const;
+
+    private:
+        RecordingReader(int fd, uint32_t blockSize);
+
+        int m_fd;
+        uint32_t m_blockSize;
+        mutable std::vector<uint8_t> m_buffer;
+    };
+}
+
+#endif // PROCESS_STATS_RECORDING_READER_H
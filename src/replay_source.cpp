@@ -0,0 +1,180 @@
+#include "replay_source.h"
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+
+namespace ProcessStats {
+
+    std::shared_ptr<ReplaySource> ReplaySource::open(const std::string& path, ReplayOptions options) {
+        std::unique_ptr<TimeSeriesStore> store = TimeSeriesStore::open(path);
+        if (!store) {
+            return nullptr;
+        }
+        std::shared_ptr<ReplaySource> source(new ReplaySource(std::move(store), options));
+
+        // Whole segments before the start need not be decoded at all
+        while (source->m_segment + 1 < source->m_store->segmentCount()
+               && source->m_store->segment(source->m_segment).maxTimeMs < options.startMs) {
+            ++source->m_segment;
+        }
+        int64_t timeMs = 0;
+        do {
+            if (!source->nextRowTime(timeMs)) {
+                errno = ENODATA;
+                return nullptr;
+            }
+            source->applyRow();
+        } while (timeMs < options.startMs);
+        source->m_rowCount = 1;
+        return source;
+    }
+
+    ReplaySource::ReplaySource(std::unique_ptr<TimeSeriesStore> store, ReplayOptions options)
+        : m_store(std::move(store)),
+          m_options(options) {}
+
+    void ReplaySource::beginTick() {
+        catchUp();
+    }
+
+    // Reads the clock without moving rows, so a tick reads one row however
+    // often the Sampler asks for the time
+    int64_t ReplaySource::nowNs() {
+        if (m_options.speed <= 0 || m_clockStartNs == 0) {
+            return m_rowTimeMs * 1000000;
+        }
+        return m_clockStartMs * 1000000
+            + static_cast<int64_t>((monotonicTimeNs() - m_clockStartNs) * m_options.speed);
+    }
+
+    int64_t ReplaySource::wallTimeMs() {
+        return nowNs() / 1000000;
+    }
+
+    RawCounters ReplaySource::read(int64_t pid) const {
+        RawCounters counters;
+        counters.readTimeNs = m_rowTimeMs * 1000000;
+        if (pid < 1 || static_cast<uint64_t>(pid) > m_latest.size()) {
+            return counters;
+        }
+        // Only a module present in the current row is running
+        const RecordedSample& sample = m_latest[pid - 1];
+        if (sample.timestampMs == m_rowTimeMs) {
+            counters.cpuTimeSeconds = sample.cpuTimeSeconds;
+            counters.memoryMB = sample.memoryMB;
+            counters.valid = true;
+        }
+        return counters;
+    }
+
+    bool ReplaySource::advance() {
+        int64_t timeMs = 0;
+        if (!nextRowTime(timeMs)) {
+            return false;
+        }
+        applyRow();
+        m_clockStartNs = 0;  // a running clock restarts from this row
+        return true;
+    }
+
+    bool ReplaySource::atEnd() {
+        int64_t timeMs = 0;
+        return !nextRowTime(timeMs);
+    }
+
+    int64_t ReplaySource::pid(const std::string& module) const {
+        auto it = m_indexByName.find(module);
+        return it == m_indexByName.end() ? 0 : static_cast<int64_t>(it->second) + 1;
+    }
+
+    const std::vector<std::pair<std::string, int64_t>>& ReplaySource::activeModules() {
+        catchUp();
+        return m_active;
+    }
+
+    bool ReplaySource::loadNextBlock() {
+        while (m_segment < m_store->segmentCount()) {
+            if (m_block >= m_store->segment(m_segment).blockCount) {
+                ++m_segment;
+                m_block = 0;
+                continue;
+            }
+            m_series.clear();
+            if (!m_store->readBlock(m_segment, m_block++, m_series)) {
+                continue;
+            }
+
+            // A block holds whole rows; its series interleave by row time
+            m_events.clear();
+            m_nextEvent = 0;
+            for (const RecordedSeries& series : m_series) {
+                const uint32_t module = moduleIndex(series.name);
+                for (const RecordedSample& sample : series.samples) {
+                    m_events.push_back(Event{sample.timestampMs, module, sample});
+                }
+            }
+            std::stable_sort(m_events.begin(), m_events.end(),
+                             [](const Event& a, const Event& b) { return a.timestampMs < b.timestampMs; });
+            if (!m_events.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReplaySource::nextRowTime(int64_t& timeMs) {
+        if (m_nextEvent == m_events.size() && !loadNextBlock()) {
+            return false;
+        }
+        timeMs = m_events[m_nextEvent].timestampMs;
+        return true;
+    }
+
+    void ReplaySource::applyRow() {
+        const int64_t timeMs = m_events[m_nextEvent].timestampMs;
+        std::size_t active = 0;
+        for (; m_nextEvent < m_events.size() && m_events[m_nextEvent].timestampMs == timeMs; ++m_nextEvent, ++active) {
+            const Event& event = m_events[m_nextEvent];
+            m_latest[event.module] = event.sample;
+            // Assigned in place so steady replay reuses the strings
+            if (active == m_active.size()) {
+                m_active.emplace_back();
+            }
+            m_active[active].first = m_names[event.module];
+            m_active[active].second = static_cast<int64_t>(event.module) + 1;
+        }
+        m_active.resize(active);
+        m_rowTimeMs = timeMs;
+        ++m_rowCount;
+    }
+
+    void ReplaySource::catchUp() {
+        if (m_options.speed <= 0) {
+            return;
+        }
+        if (m_clockStartNs == 0) {
+            m_clockStartNs = monotonicTimeNs();
+            m_clockStartMs = m_rowTimeMs;
+        }
+        const int64_t virtualNowNs = nowNs();
+        int64_t timeMs = 0;
+        while (nextRowTime(timeMs) && timeMs * 1000000 <= virtualNowNs) {
+            applyRow();
+        }
+    }
+
+    uint32_t ReplaySource::moduleIndex(const std::string& name) {
+        auto it = m_indexByName.find(name);
+        if (it != m_indexByName.end()) {
+            return it->second;
+        }
+        const uint32_t index = static_cast<uint32_t>(m_names.size());
+        m_indexByName.emplace(name, index);
+        m_names.push_back(name);
+        RecordedSample never;
+        never.timestampMs = std::numeric_limits<int64_t>::min();
+        m_latest.push_back(never);
+        return index;
+    }
+
+}
@@ -0,0 +1,112 @@
+#ifndef PROCESS_STATS_REPLAY_SOURCE_H
+#define PROCESS_STATS_REPLAY_SOURCE_H
+
+#include "sample_source.h"
+#include "timeseries_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ProcessStats {
+    struct ReplayOptions {
+        // Recorded time per real time; 0 steps one recorded row per advance()
+        double speed = 1.0;
+
+        // Recorded time to start at; rows before it are skipped. 0 starts at
+        // the first row.
+        int64_t startMs = 0;
+    };
+
+    // Replays a recording through a Sampler in place of the OS
+    //
+    // Opens what SnapshotRecorder wrote (a file or a segment directory) and
+    // walks its rows on a virtual clock. Every recorded module gets a
+    // synthetic PID, pid(name); read() returns its counters from the current
+    // row, stamped with the row's recorded time, so the Sampler recomputes
+    // CPU percentages from recorded CPU time the same way it does live. A
+    // module missing from the current row reads like an exited process.
+    //
+    // With speed > 0 the clock starts at the first beginTick() and runs at
+    // speed times real time; each beginTick() moves to the row due then. With speed 0 it stays on a row until advance(),
+    // which replays as fast as the consumer can go and the same way every
+    // time.
+    //
+    // read() may be called from the Sampler's workers; everything else
+    // belongs to the sampling thread.
+    class ReplaySource : public SampleSource {
+    public:
+        // Returns nullptr and leaves errno set on failure (ENODATA if there
+        // is nothing to replay at or after options.startMs)
+        static std::shared_ptr<ReplaySource> open(const std::string& path, ReplayOptions options = ReplayOptions());
+
+        void beginTick() override;
+        int64_t nowNs() override;
+        int64_t wallTimeMs() override;
+        RawCounters read(int64_t pid) const override;
+
+        // Step to the next row; false, staying put, after the last one.
+        // With speed > 0 this also jumps the clock ahead to that row.
+        bool advance();
+
+        // Whether the current row is the last one
+        bool atEnd();
+
+        // Recorded time of the current row
+        int64_t rowTimeMs() const { return m_rowTimeMs; }
+
+        // Rows stepped through so far, counting the first
+        uint64_t rowCount() const { return m_rowCount; }
+
+        // Synthetic PID of a recorded module, 0 if there is none
+        int64_t pid(const std::string& module) const;
+
+        // (name, PID) of each module in the current row; what a live caller
+        // would pass to getModuleStats()
+        const std::vector<std::pair<std::string, int64_t>>& activeModules();
+
+    private:
+        struct Event {
+            int64_t timestampMs;
+            uint32_t module;
+            RecordedSample sample;
+        };
+
+        ReplaySource(std::unique_ptr<TimeSeriesStore> store, ReplayOptions options);
+
+        bool loadNextBlock();
+        bool nextRowTime(int64_t& timeMs);
+        void applyRow();
+        void catchUp();
+        uint32_t moduleIndex(const std::string& name);
+
+        std::unique_ptr<TimeSeriesStore> m_store;
+        ReplayOptions m_options;
+
+        // Block cursor, and the rows of the current block as time-ordered
+        // events
+        std::size_t m_segment = 0;
+        std::size_t m_block = 0;
+        std::vector<RecordedSeries> m_series;
+        std::vector<Event> m_events;
+        std::size_t m_nextEvent = 0;
+
+        // Latest recorded sample per module, indexed by PID - 1
+        std::vector<std::string> m_names;
+        std::vector<RecordedSample> m_latest;
+        std::unordered_map<std::string, uint32_t> m_indexByName;
+        std::vector<std::pair<std::string, int64_t>> m_active;
+
+        int64_t m_rowTimeMs = 0;
+        uint64_t m_rowCount = 0;
+
+        // Real-time mode: monotonic time the clock started at, 0 until then
+        int64_t m_clockStartNs = 0;
+        int64_t m_clockStartMs = 0;
+    };
+}
+
+#endif // PROCESS_STATS_REPLAY_SOURCE_H
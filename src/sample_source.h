@@ -0,0 +1,44 @@
+#ifndef PROCESS_STATS_SAMPLE_SOURCE_H
+#define PROCESS_STATS_SAMPLE_SOURCE_H
+
+#include "proc_reader.h"
+#include <cstdint>
+
+namespace ProcessStats {
+    // Where a Sampler gets raw counters and time from
+    //
+    // The Sampler derives CPU percentages from what a source returns exactly
+    // as it does for live readings, so a source only supplies cumulative
+    // counters and a clock.
+    class SampleSource {
+    public:
+        virtual ~SampleSource() = default;
+
+        // Called by the Sampler on its own thread once per tick, before it
+        // reads the clock and the counters; read() answers as of the latest
+        // call until the next. A replay moves to the row due now.
+        virtual void beginTick() {}
+
+        // Monotonic time in nanoseconds; only differences are meaningful.
+        // May be called several times per tick and must not change what
+        // read() returns.
+        virtual int64_t nowNs() = 0;
+
+        // Wall-clock time in milliseconds since the epoch, for timestamps
+        virtual int64_t wallTimeMs() = 0;
+
+        // Counters of pid, stamped with readTimeNs on the nowNs() clock.
+        // Called concurrently from the Sampler's read workers.
+        virtual RawCounters read(int64_t pid) const = 0;
+    };
+
+    // Reads the OS: /proc on Linux, libproc on macOS
+    class LiveSampleSource : public SampleSource {
+    public:
+        int64_t nowNs() override { return monotonicTimeNs(); }
+        int64_t wallTimeMs() override { return currentTimeMs(); }
+        RawCounters read(int64_t pid) const override { return readRawCounters(pid); }
+    };
+}
+
+#endif // PROCESS_STATS_SAMPLE_SOURCE_H
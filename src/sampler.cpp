@@ -0,0 +1,267 @@
+#include "sampler.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+namespace ProcessStats {
+
+    Sampler::Sampler(SamplerOptions options)
+        : m_options(options),
+          m_pool(new WorkStealingPool(options.workerCount)) {
+        if (!m_options.source) {
+            m_options.source = std::make_shared<LiveSampleSource>();
+        }
+    }
+
+    Sampler::~Sampler() = default;
+
+    void Sampler::setWorkerCount(std::size_t workerCount) {
+        if (workerCount == 0) {
+            workerCount = 1;
+        }
+        if (workerCount == m_pool->workerCount()) {
+            return;
+        }
+        m_options.workerCount = workerCount;
+        m_pool.reset(new WorkStealingPool(workerCount));
+    }
+
+    void Sampler::setSource(std::shared_ptr<SampleSource> source) {
+        m_options.source = source ? std::move(source) : std::make_shared<LiveSampleSource>();
+        m_history.clear();
+        m_failures.clear();
+    }
+
+    ProcessStatsData Sampler::sampleProcess(int64_t pid, ModuleStatus* status) {
+        ModuleStatus result = ModuleStatus::Exited;
+        ProcessStatsData stats = {0.0, 0.0, 0.0};
+        if (pid > 0) {
+            m_options.source->beginTick();
+            const int64_t nowNs = m_options.source->nowNs();
+            if (!backingOff(pid, nowNs, result)) {
+                ++m_readCount;
+                const int64_t startNs = kSelfStatsEnabled ? monotonicTimeNs() : 0;
+                RawCounters counters = m_options.source->read(pid);
+                const int64_t readEndNs = kSelfStatsEnabled ? monotonicTimeNs() : 0;
+                recordRead(pid, counters, nowNs);
+                result = statusOf(counters);
+                stats = computeStats(pid, counters, counters.readTimeNs);
+                if (kSelfStatsEnabled) {
+                    const int64_t endNs = monotonicTimeNs();
+                    m_self.addTick(1, counters.syscalls, counters.bytesRead, readEndNs - startNs, endNs - readEndNs);
+                    m_self.noteTickNs(endNs - startNs);
+                }
+            }
+        }
+        if (status) {
+            *status = result;
+        }
+        return stats;
+    }
+
+    bool Sampler::backingOff(int64_t pid, int64_t timeNs, ModuleStatus& status) const {
+        auto it = m_failures.find(pid);
+        if (it == m_failures.end() || timeNs >= it->second.retryAtNs) {
+            return false;
+        }
+        status = it->second.status;
+        return true;
+    }
+
+    // Only failures the source gives a reason for are cached; a source that
+    // just has nothing for a PID now (a replay between rows) is asked again
+    void Sampler::recordRead(int64_t pid, const RawCounters& counters, int64_t timeNs) {
+        if (counters.valid || counters.status == ModuleStatus::Ok) {
+            if (!m_failures.empty()) {
+                m_failures.erase(pid);
+            }
+            return;
+        }
+        // A PID that comes back is another process: start it afresh
+        m_history.erase(pid);
+        if (m_options.retryBackoffMinMs <= 0) {
+            return;
+        }
+        const int64_t minNs = m_options.retryBackoffMinMs * 1000000;
+        const int64_t maxNs = std::max(m_options.retryBackoffMaxMs * 1000000, minNs);
+        auto entry = m_failures.try_emplace(pid, Failure{counters.status, 0, minNs});
+        Failure& failure = entry.first->second;
+        if (!entry.second) {
+            failure.delayNs = std::min(failure.delayNs * 2, maxNs);
+        }
+        failure.status = counters.status;
+        failure.retryAtNs = timeNs + failure.delayNs;
+    }
+
+    template<typename Store>
+    void Sampler::sampleInto(const int64_t* pids, std::size_t count, Store&& store) {
+        // The source's clock may be a replay's; the sampler's own cost is
+        // measured on the real one
+        const int64_t selfStartNs = kSelfStatsEnabled ? monotonicTimeNs() : 0;
+        const std::size_t capacity = m_counters.capacity();
+        m_counters.resize(count);
+        m_self.addAllocations(m_counters.capacity() != capacity);
+        RawCounters* counters = m_counters.data();
+        const SampleSource* source = m_options.source.get();
+        m_options.source->beginTick();
+        m_lastBatch.startNs = m_options.source->nowNs();
+
+        // PIDs in the negative cache that are not due yet are not read
+        const uint8_t* skip = nullptr;
+        if (!m_failures.empty()) {
+            m_skip.assign(count, 0);
+            for (std::size_t i = 0; i < count; ++i) {
+                auto it = m_failures.find(pids[i]);
+                m_skip[i] = it != m_failures.end() && m_lastBatch.startNs < it->second.retryAtNs;
+            }
+            skip = m_skip.data();
+        }
+
+        // Read phase: independent per PID, spread across the pool
+        m_pool->parallelFor(count, m_options.chunkSize,
+                            [pids, counters, source, skip](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (!skip || !skip[i]) {
+                    counters[i] = source->read(pids[i]);
+                }
+            }
+        });
+        m_lastBatch.endNs = m_options.source->nowNs();
+        const int64_t selfReadEndNs = kSelfStatsEnabled ? monotonicTimeNs() : 0;
+
+        // In batch mode every PID shares the midpoint of the read phase
+        const int64_t batchTimeNs = m_lastBatch.startNs + (m_lastBatch.endNs - m_lastBatch.startNs) / 2;
+
+        // Rate phase: touches the history map, so stays on the calling thread
+        const uint64_t readCount = m_readCount;
+        uint64_t syscalls = 0;
+        uint64_t bytesRead = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            int64_t window = 0;
+            ProcessStatsData stats = {0.0, 0.0, 0.0};
+            ModuleStatus status = ModuleStatus::Exited;
+            int64_t readTimeNs = counters[i].readTimeNs;
+            if (skip && skip[i]) {
+                status = m_failures.find(pids[i])->second.status;
+                readTimeNs = m_lastBatch.startNs;
+            } else if (pids[i] > 0) {
+                ++m_readCount;
+                if (kSelfStatsEnabled) {
+                    syscalls += counters[i].syscalls;
+                    bytesRead += counters[i].bytesRead;
+                }
+                const int64_t timeNs = m_options.alignBatchTimestamps ? batchTimeNs : counters[i].readTimeNs;
+                recordRead(pids[i], counters[i], m_lastBatch.startNs);
+                status = statusOf(counters[i]);
+                stats = computeStats(pids[i], counters[i], timeNs, &window);
+            }
+            store(i, stats, window, readTimeNs, status);
+        }
+
+        if (kSelfStatsEnabled) {
+            const int64_t endNs = monotonicTimeNs();
+            m_self.addTick(m_readCount - readCount, syscalls, bytesRead, selfReadEndNs - selfStartNs,
+                           endNs - selfReadEndNs);
+            m_self.noteTickNs(endNs - selfStartNs);
+        }
+    }
+
+    void Sampler::sample(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out) {
+        sampleInto(pids, count, [&out](std::size_t i, const ProcessStatsData& stats, int64_t windowMs,
+                                       int64_t readTimeNs, ModuleStatus status) {
+            if (out.cpuPercent) {
+                out.cpuPercent[i] = stats.cpuPercent;
+            }
+            if (out.cpuTimeSeconds) {
+                out.cpuTimeSeconds[i] = stats.cpuTimeSeconds;
+            }
+            if (out.memoryMB) {
+                out.memoryMB[i] = stats.memoryMB;
+            }
+            if (out.windowMs) {
+                out.windowMs[i] = windowMs;
+            }
+            if (out.readTimeNs) {
+                out.readTimeNs[i] = readTimeNs;
+            }
+            if (out.status) {
+                out.status[i] = status;
+            }
+        });
+    }
+
+    void Sampler::sample(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                         int64_t* windowMs, int64_t* readTimeNs, ModuleStatus* status) {
+        sampleInto(pids, count, [out, windowMs, readTimeNs, status](std::size_t i, const ProcessStatsData& stats,
+                                                                    int64_t window, int64_t readTime,
+                                                                    ModuleStatus moduleStatus) {
+            out[i] = stats;
+            if (windowMs) {
+                windowMs[i] = window;
+            }
+            if (readTimeNs) {
+                readTimeNs[i] = readTime;
+            }
+            if (status) {
+                status[i] = moduleStatus;
+            }
+        });
+    }
+
+    void Sampler::retainOnly(const int64_t* pids, std::size_t count) {
+        std::unordered_set<int64_t> active(pids, pids + count);
+        for (auto it = m_history.begin(); it != m_history.end();) {
+            if (active.count(it->first) == 0) {
+                it = m_history.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = m_failures.begin(); it != m_failures.end();) {
+            if (active.count(it->first) == 0) {
+                it = m_failures.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void Sampler::forget(int64_t pid) {
+        m_history.erase(pid);
+        m_failures.erase(pid);
+    }
+
+    void Sampler::clearHistory() {
+        m_history.clear();
+        m_failures.clear();
+    }
+
+    ProcessStatsData Sampler::computeStats(int64_t pid, const RawCounters& counters, int64_t timeNs,
+                                           int64_t* windowMs) {
+        ProcessStatsData stats = {0.0, counters.cpuTimeSeconds, counters.memoryMB};
+        if (!counters.valid) {
+            return stats;
+        }
+
+        // Calculate CPU percentage against the previous reading, then replace
+        // it, with a single hash lookup
+        auto entry = m_history.try_emplace(pid, CpuBaseline{stats.cpuTimeSeconds, timeNs});
+        if (!entry.second) {
+            CpuBaseline& previous = entry.first->second;
+            const int64_t elapsedNs = timeNs - previous.timeNs;
+            double timeDelta = elapsedNs / 1e9; // Convert to seconds
+            double cpuDelta = stats.cpuTimeSeconds - previous.cpuTimeSeconds;
+
+            if (timeDelta > 0) {
+                stats.cpuPercent = (cpuDelta / timeDelta) * 100.0;
+                if (windowMs) {
+                    *windowMs = elapsedNs / 1000000;
+                }
+            }
+            previous = CpuBaseline{stats.cpuTimeSeconds, timeNs};
+        }
+        return stats;
+    }
+
+}
@@ -0,0 +1,158 @@
+#ifndef PROCESS_STATS_SAMPLER_H
+#define PROCESS_STATS_SAMPLER_H
+
+#include "proc_reader.h"
+#include "sample_source.h"
+#include "self_stats.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    class WorkStealingPool;
+
+    struct SamplerOptions {
+        // Threads used to read process counters, including the calling thread
+        // 1 reads everything serially on the caller
+        std::size_t workerCount = 1;
+
+        // PIDs handed to a worker at a time
+        std::size_t chunkSize = 64;
+
+        // Batch mode: derive CPU percentages of every PID in a sample() call
+        // from one shared timestamp, the midpoint of the read phase, so all
+        // modules in a tick cover the same time window. Off by default, in
+        // which case each PID uses its own read time.
+        bool alignBatchTimestamps = false;
+
+        // Negative cache: a PID the source reports as exited, unreadable or a
+        // zombie is not read again until a retry delay has passed, which
+        // doubles from retryBackoffMinMs to at most retryBackoffMaxMs while
+        // the PID stays that way. Until then it reports the same status. A
+        // minimum of 0 reads every PID on every call.
+        int64_t retryBackoffMinMs = 1000;
+        int64_t retryBackoffMaxMs = 60000;
+
+        // Where counters come from; nullptr reads the OS (LiveSampleSource).
+        // A ReplaySource replays a recording instead.
+        std::shared_ptr<SampleSource> source;
+    };
+
+    // Monotonic bounds of the read phase of the last sample() call
+    // endNs - startNs is the measurement skew across the batch
+    struct BatchTiming {
+        int64_t startNs = 0;
+        int64_t endNs = 0;
+    };
+
+    // Samples CPU and memory statistics for sets of processes
+    //
+    // Counters are read in parallel across the configured workers; CPU
+    // percentages are then derived serially from the previous reading of
+    // each PID. A Sampler is not safe for concurrent use.
+    class Sampler {
+    public:
+        explicit Sampler(SamplerOptions options = SamplerOptions());
+        ~Sampler();
+
+        Sampler(const Sampler&) = delete;
+        Sampler& operator=(const Sampler&) = delete;
+
+        // Sample a single process; invalid PIDs yield zeroed stats, with the
+        // reason in status if given
+        ProcessStatsData sampleProcess(int64_t pid, ModuleStatus* status = nullptr);
+
+        // Sample count processes into parallel arrays, each holding count
+        // entries (or null); invalid PIDs yield zeroed stats. The batch reads
+        // the clock, sets up its reads and visits the CPU history once per
+        // PID; per-PID calls to sampleProcess() repeat all of that.
+        void sample(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out);
+
+        // The same with the stats for pids[i] at out[i]. If windowMs is given
+        // it receives the elapsed time each CPU percentage was measured over
+        // (0 on the first reading of a PID); readTimeNs receives each PID's
+        // monotonic read time, and status why it yielded zeroed stats
+        void sample(const int64_t* pids, std::size_t count, ProcessStatsData* out,
+                    int64_t* windowMs = nullptr, int64_t* readTimeNs = nullptr,
+                    ModuleStatus* status = nullptr);
+
+        // Timing of the read phase of the last sample() call
+        const BatchTiming& lastBatchTiming() const { return m_lastBatch; }
+
+        // Forget the CPU history and retry delay of every PID not in pids
+        void retainOnly(const int64_t* pids, std::size_t count);
+
+        // Forget the CPU history and retry delay of a single PID
+        void forget(int64_t pid);
+
+        // Forget all CPU history and retry delays
+        void clearHistory();
+
+        // Change the number of read workers; restarts the pool
+        void setWorkerCount(std::size_t workerCount);
+
+        // Switch batch timestamp alignment; see SamplerOptions
+        void setAlignBatchTimestamps(bool align) { m_options.alignBatchTimestamps = align; }
+
+        // Read from source from now on (nullptr: the OS); clears all CPU
+        // history and retry delays, since times from another clock do not
+        // carry over
+        void setSource(std::shared_ptr<SampleSource> source);
+        SampleSource& source() const { return *m_options.source; }
+
+        const SamplerOptions& options() const { return m_options; }
+
+        // Number of process counter reads issued so far; each read opens the
+        // process's stat and statm files on Linux. PIDs waiting out a retry
+        // delay are not read.
+        uint64_t readCount() const { return m_readCount; }
+
+        // PIDs in the negative cache, waiting out or due for a retry
+        std::size_t backoffCount() const { return m_failures.size(); }
+
+        // The sampler's own cost; a StatsEngine adds its serialization,
+        // allocations and tick latency to the same counters
+        SelfStatsCounters& selfStats() { return m_self; }
+        const SelfStatsCounters& selfStats() const { return m_self; }
+
+    private:
+        struct CpuBaseline {
+            double cpuTimeSeconds;
+            int64_t timeNs;
+        };
+
+        struct Failure {
+            ModuleStatus status;
+            int64_t retryAtNs;
+            int64_t delayNs;
+        };
+
+        // Whether pid is waiting out a retry delay at timeNs; sets status if so
+        bool backingOff(int64_t pid, int64_t timeNs, ModuleStatus& status) const;
+
+        // Track the outcome of reading pid at timeNs in the negative cache
+        void recordRead(int64_t pid, const RawCounters& counters, int64_t timeNs);
+
+        ProcessStatsData computeStats(int64_t pid, const RawCounters& counters, int64_t timeNs,
+                                      int64_t* windowMs = nullptr);
+
+        // Both sample() layouts: store(i, stats, windowMs, readTimeNs, status) per PID
+        template<typename Store>
+        void sampleInto(const int64_t* pids, std::size_t count, Store&& store);
+
+        SamplerOptions m_options;
+        std::unique_ptr<WorkStealingPool> m_pool;
+        std::unordered_map<int64_t, CpuBaseline> m_history;
+        std::unordered_map<int64_t, Failure> m_failures;
+        std::vector<RawCounters> m_counters;  // reused between ticks
+        std::vector<uint8_t> m_skip;          // PIDs of this tick that are backing off
+        uint64_t m_readCount = 0;
+        BatchTiming m_lastBatch;
+        SelfStatsCounters m_self;
+    };
+}
+
+#endif // PROCESS_STATS_SAMPLER_H
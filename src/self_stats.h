@@ -0,0 +1,130 @@
+#ifndef PROCESS_STATS_SELF_STATS_H
+#define PROCESS_STATS_SELF_STATS_H
+
+#include "proc_reader.h"
+#include "snapshot.h"
+#include <atomic>
+#include <cstdint>
+
+// Configure with -DPROCESS_STATS_SELF_STATS=OFF to compile the counters out:
+// every call below is then empty and no clock is read for them
+#ifndef PROCESS_STATS_SELF_STATS
+#define PROCESS_STATS_SELF_STATS 1
+#endif
+
+namespace ProcessStats {
+    constexpr bool kSelfStatsEnabled = PROCESS_STATS_SELF_STATS != 0;
+
+    // Accumulates a sampler's SelfStats
+    //
+    // Updated a few times per tick, never per PID, with relaxed atomics, so
+    // load() may run on any thread while a tick is in progress.
+    class SelfStatsCounters {
+    public:
+        void addTick(uint64_t pids, uint64_t syscalls, uint64_t bytesRead, int64_t readNs, int64_t computeNs) {
+        #if PROCESS_STATS_SELF_STATS
+            m_ticks.fetch_add(1, std::memory_order_relaxed);
+            m_pidsSampled.fetch_add(pids, std::memory_order_relaxed);
+            m_syscalls.fetch_add(syscalls, std::memory_order_relaxed);
+            m_bytesRead.fetch_add(bytesRead, std::memory_order_relaxed);
+            m_readNs.fetch_add(static_cast<uint64_t>(readNs), std::memory_order_relaxed);
+            m_computeNs.fetch_add(static_cast<uint64_t>(computeNs), std::memory_order_relaxed);
+        #else
+            (void)pids, (void)syscalls, (void)bytesRead, (void)readNs, (void)computeNs;
+        #endif
+        }
+
+        void addSerializeNs(int64_t ns) {
+        #if PROCESS_STATS_SELF_STATS
+            m_serializeNs.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+        #else
+            (void)ns;
+        #endif
+        }
+
+        void addAllocations(uint64_t count) {
+        #if PROCESS_STATS_SELF_STATS
+            if (count > 0) {
+                m_allocations.fetch_add(count, std::memory_order_relaxed);
+            }
+        #else
+            (void)count;
+        #endif
+        }
+
+        // Keeps the longest tick seen
+        void noteTickNs(int64_t ns) {
+        #if PROCESS_STATS_SELF_STATS
+            const uint64_t value = static_cast<uint64_t>(ns);
+            uint64_t max = m_maxTickNs.load(std::memory_order_relaxed);
+            while (value > max && !m_maxTickNs.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+            }
+        #else
+            (void)ns;
+        #endif
+        }
+
+        // All zero when compiled out
+        SelfStats load() const {
+            SelfStats stats;
+        #if PROCESS_STATS_SELF_STATS
+            stats.ticks = m_ticks.load(std::memory_order_relaxed);
+            stats.pidsSampled = m_pidsSampled.load(std::memory_order_relaxed);
+            stats.syscalls = m_syscalls.load(std::memory_order_relaxed);
+            stats.bytesRead = m_bytesRead.load(std::memory_order_relaxed);
+            stats.readNs = m_readNs.load(std::memory_order_relaxed);
+            stats.computeNs = m_computeNs.load(std::memory_order_relaxed);
+            stats.serializeNs = m_serializeNs.load(std::memory_order_relaxed);
+            stats.allocations = m_allocations.load(std::memory_order_relaxed);
+            stats.maxTickNs = m_maxTickNs.load(std::memory_order_relaxed);
+        #endif
+            return stats;
+        }
+
+        void reset() {
+        #if PROCESS_STATS_SELF_STATS
+            for (std::atomic<uint64_t>* counter : {&m_ticks, &m_pidsSampled, &m_syscalls, &m_bytesRead, &m_readNs,
+                                                   &m_computeNs, &m_serializeNs, &m_allocations, &m_maxTickNs}) {
+                counter->store(0, std::memory_order_relaxed);
+            }
+        #endif
+        }
+
+    private:
+    #if PROCESS_STATS_SELF_STATS
+        std::atomic<uint64_t> m_ticks{0};
+        std::atomic<uint64_t> m_pidsSampled{0};
+        std::atomic<uint64_t> m_syscalls{0};
+        std::atomic<uint64_t> m_bytesRead{0};
+        std::atomic<uint64_t> m_readNs{0};
+        std::atomic<uint64_t> m_computeNs{0};
+        std::atomic<uint64_t> m_serializeNs{0};
+        std::atomic<uint64_t> m_allocations{0};
+        std::atomic<uint64_t> m_maxTickNs{0};
+    #endif
+    };
+
+    // Adds the time until it goes out of scope to a SelfStatsCounters'
+    // serialization time; null counters are skipped
+    class SerializeTimer {
+    public:
+        explicit SerializeTimer(SelfStatsCounters* counters)
+            : m_counters(kSelfStatsEnabled ? counters : nullptr),
+              m_startNs(m_counters ? monotonicTimeNs() : 0) {}
+        explicit SerializeTimer(SelfStatsCounters& counters) : SerializeTimer(&counters) {}
+        ~SerializeTimer() {
+            if (m_counters) {
+                m_counters->addSerializeNs(monotonicTimeNs() - m_startNs);
+            }
+        }
+
+        SerializeTimer(const SerializeTimer&) = delete;
+        SerializeTimer& operator=(const SerializeTimer&) = delete;
+
+    private:
+        SelfStatsCounters* m_counters;
+        int64_t m_startNs;
+    };
+}
+
+#endif // PROCESS_STATS_SELF_STATS_H
@@ -0,0 +1,139 @@
+#include "shm_snapshot_publisher.h"
+#include "binary_snapshot.h"
+#include <cerrno>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    ShmRing::Slot* slotAt(ShmRing::Header* header, uint64_t index) {
+        char* base = reinterpret_cast<char*>(header) + sizeof(ShmRing::Header);
+        return reinterpret_cast<ShmRing::Slot*>(base + ShmRing::slotStride(header->slotSize) * index);
+    }
+
+    uint32_t roundSlotSize(uint32_t slotSize) {
+        const uint32_t alignment = static_cast<uint32_t>(ShmRing::kAlignment);
+        if (slotSize < alignment) {
+            return alignment;
+        }
+        return (slotSize + alignment - 1) / alignment * alignment;
+    }
+}
+
+    ShmSnapshotPublisher::ShmSnapshotPublisher(int fd, std::string name, void* mapping, std::size_t size)
+        : m_fd(fd),
+          m_name(std::move(name)),
+          m_mapping(mapping),
+          m_size(size),
+          m_header(static_cast<ShmRing::Header*>(mapping)) {}
+
+    ShmSnapshotPublisher::~ShmSnapshotPublisher() {
+        munmap(m_mapping, m_size);
+        close(m_fd);
+        if (!m_name.empty()) {
+            shm_unlink(m_name.c_str());
+        }
+    }
+
+    std::unique_ptr<ShmSnapshotPublisher> ShmSnapshotPublisher::create(const std::string& name,
+                                                                       uint32_t slotCount,
+                                                                       uint32_t slotSize) {
+        // Replace rather than reuse: readers of an old segment keep their
+        // mapping, new readers get a freshly initialized ring
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto publisher = initialize(fd, name, slotCount, slotSize);
+        if (!publisher) {
+            const int error = errno;
+            shm_unlink(name.c_str());
+            errno = error;
+        }
+        return publisher;
+    }
+
+#ifdef __linux__
+    std::unique_ptr<ShmSnapshotPublisher> ShmSnapshotPublisher::createAnonymous(uint32_t slotCount,
+                                                                                uint32_t slotSize) {
+        int fd = memfd_create("process_stats", MFD_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        return initialize(fd, std::string(), slotCount, slotSize);
+    }
+#endif
+
+    std::unique_ptr<ShmSnapshotPublisher> ShmSnapshotPublisher::initialize(int fd, std::string name,
+                                                                           uint32_t slotCount,
+                                                                           uint32_t slotSize) {
+        // Two slots minimum, so the latest snapshot is never the one being written
+        slotCount = slotCount < 2 ? 2 : slotCount;
+        slotSize = roundSlotSize(slotSize);
+        const std::size_t size = ShmRing::segmentSize(slotCount, slotSize);
+
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return nullptr;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return nullptr;
+        }
+
+        // ftruncate() zero-filled the segment; construct the atomics in place
+        auto* header = new (mapping) ShmRing::Header();
+        header->version = ShmRing::kVersion;
+        header->headerSize = sizeof(ShmRing::Header);
+        header->slotCount = slotCount;
+        header->slotSize = slotSize;
+        header->latest.store(0, std::memory_order_relaxed);
+        header->writerPid = getpid();
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            ShmRing::Slot* slot = new (slotAt(header, i)) ShmRing::Slot();
+            slot->sequence.store(0, std::memory_order_relaxed);
+            slot->size.store(0, std::memory_order_relaxed);
+        }
+
+        // Readers only trust a segment once the magic is visible
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = ShmRing::kMagic;
+
+        return std::unique_ptr<ShmSnapshotPublisher>(new ShmSnapshotPublisher(fd, std::move(name), mapping, size));
+    }
+
+    bool ShmSnapshotPublisher::publish(const Snapshot& snapshot) {
+        const std::size_t size = encodeBinarySnapshot(snapshot, nullptr, 0);
+        if (size > m_header->slotSize) {
+            ++m_dropped;
+            return false;
+        }
+
+        const uint64_t next = m_header->latest.load(std::memory_order_relaxed) + 1;
+        ShmRing::Slot* slot = slotAt(m_header, (next - 1) % m_header->slotCount);
+        char* payload = reinterpret_cast<char*>(slot) + sizeof(ShmRing::Slot);
+
+        // Seqlock write: odd sequence, payload, even sequence
+        const uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        encodeBinarySnapshot(snapshot, payload, m_header->slotSize);
+        slot->size.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+        m_header->latest.store(next, std::memory_order_release);
+        return true;
+    }
+
+}
@@ -0,0 +1,67 @@
+#ifndef PROCESS_STATS_SHM_SNAPSHOT_PUBLISHER_H
+#define PROCESS_STATS_SHM_SNAPSHOT_PUBLISHER_H
+
+#include "shm_snapshot_ring.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ProcessStats {
+    // Writes snapshots into a shared-memory ring for reader processes
+    //
+    // One process owns the publisher and samples; any number of processes map
+    // the segment read-only with ShmSnapshotReader and pick up the latest
+    // snapshot with plain memory reads. See shm_snapshot_ring.h for the layout.
+    // publish() must be called from one thread at a time.
+    class ShmSnapshotPublisher {
+    public:
+        static constexpr uint32_t kDefaultSlotCount = 4;
+        static constexpr uint32_t kDefaultSlotSize = 64 * 1024;
+
+        // Create (or replace) a named POSIX shared memory segment, e.g.
+        // "/process_stats". The segment is unlinked again on destruction.
+        // Returns nullptr and leaves errno set on failure.
+        static std::unique_ptr<ShmSnapshotPublisher> create(const std::string& name,
+                                                            uint32_t slotCount = kDefaultSlotCount,
+                                                            uint32_t slotSize = kDefaultSlotSize);
+
+#ifdef __linux__
+        // Create an anonymous memfd segment; hand fd() to readers by fork()
+        // or over a Unix socket (SCM_RIGHTS)
+        static std::unique_ptr<ShmSnapshotPublisher> createAnonymous(uint32_t slotCount = kDefaultSlotCount,
+                                                                     uint32_t slotSize = kDefaultSlotSize);
+#endif
+
+        ~ShmSnapshotPublisher();
+
+        ShmSnapshotPublisher(const ShmSnapshotPublisher&) = delete;
+        ShmSnapshotPublisher& operator=(const ShmSnapshotPublisher&) = delete;
+
+        // Encode snapshot into the next slot and make it the latest
+        // Returns false if the encoded snapshot is larger than a slot; readers
+        // then keep seeing the previous one
+        bool publish(const Snapshot& snapshot);
+
+        int fd() const { return m_fd; }
+        const std::string& name() const { return m_name; }
+        uint32_t slotSize() const { return m_header->slotSize; }
+        uint64_t publishedCount() const { return m_header->latest.load(std::memory_order_relaxed); }
+        uint64_t droppedCount() const { return m_dropped; }
+
+    private:
+        ShmSnapshotPublisher(int fd, std::string name, void* mapping, std::size_t size);
+        static std::unique_ptr<ShmSnapshotPublisher> initialize(int fd, std::string name,
+                                                                uint32_t slotCount, uint32_t slotSize);
+
+        int m_fd;
+        std::string m_name;   // empty for anonymous segments
+        void* m_mapping;
+        std::size_t m_size;
+        ShmRing::Header* m_header;
+        uint64_t m_dropped = 0;
+    };
+}
+
+#endif // PROCESS_STATS_SHM_SNAPSHOT_PUBLISHER_H
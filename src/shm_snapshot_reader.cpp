@@ -0,0 +1,119 @@
+#include "shm_snapshot_reader.h"
+#include "binary_snapshot.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    const ShmRing::Slot* slotAt(const ShmRing::Header* header, uint64_t index) {
+        const char* base = reinterpret_cast<const char*>(header) + sizeof(ShmRing::Header);
+        return reinterpret_cast<const ShmRing::Slot*>(base + ShmRing::slotStride(header->slotSize) * index);
+    }
+}
+
+    ShmSnapshotReader::ShmSnapshotReader(int fd, const void* mapping, std::size_t size)
+        : m_fd(fd),
+          m_mapping(mapping),
+          m_size(size),
+          m_header(static_cast<const ShmRing::Header*>(mapping)),
+          m_buffer(new uint64_t[m_header->slotSize / sizeof(uint64_t)]) {}
+
+    ShmSnapshotReader::~ShmSnapshotReader() {
+        munmap(const_cast<void*>(m_mapping), m_size);
+        close(m_fd);
+    }
+
+    std::unique_ptr<ShmSnapshotReader> ShmSnapshotReader::open(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return nullptr;
+        }
+        return map(fd);
+    }
+
+    std::unique_ptr<ShmSnapshotReader> ShmSnapshotReader::fromFd(int fd) {
+        int own = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (own < 0) {
+            return nullptr;
+        }
+        return map(own);
+    }
+
+    std::unique_ptr<ShmSnapshotReader> ShmSnapshotReader::map(int fd) {
+        auto fail = [fd](int error) -> std::unique_ptr<ShmSnapshotReader> {
+            close(fd);
+            errno = error;
+            return nullptr;
+        };
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            return fail(errno);
+        }
+        const std::size_t size = static_cast<std::size_t>(info.st_size);
+        if (size < sizeof(ShmRing::Header)) {
+            return fail(EINVAL);
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            return fail(errno);
+        }
+
+        const auto* header = static_cast<const ShmRing::Header*>(mapping);
+        const bool valid = header->magic == ShmRing::kMagic
+            && header->version == ShmRing::kVersion
+            && header->headerSize == sizeof(ShmRing::Header)
+            && header->slotCount >= 2
+            && header->slotSize % ShmRing::kAlignment == 0
+            && ShmRing::segmentSize(header->slotCount, header->slotSize) <= size;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!valid) {
+            munmap(mapping, size);
+            return fail(EINVAL);
+        }
+        return std::unique_ptr<ShmSnapshotReader>(new ShmSnapshotReader(fd, mapping, size));
+    }
+
+    uint64_t ShmSnapshotReader::publishedCount() const {
+        return m_header->latest.load(std::memory_order_acquire);
+    }
+
+    const void* ShmSnapshotReader::readLatest(std::size_t* size) {
+        for (;;) {
+            const uint64_t latest = m_header->latest.load(std::memory_order_acquire);
+            if (latest == 0) {
+                return nullptr;
+            }
+            const ShmRing::Slot* slot = slotAt(m_header, (latest - 1) % m_header->slotCount);
+            const char* payload = reinterpret_cast<const char*>(slot) + sizeof(ShmRing::Slot);
+
+            // Seqlock read: copy, then accept only if no write overlapped the copy.
+            // The slot may hold a newer snapshot than `latest` by then; that is fine
+            const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+            const uint32_t used = slot->size.load(std::memory_order_relaxed);
+            if ((before & 1) == 0 && used <= m_header->slotSize) {
+                memcpy(m_buffer.get(), payload, used);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                    if (size) {
+                        *size = used;
+                    }
+                    return m_buffer.get();
+                }
+            }
+            ++m_retries;
+        }
+    }
+
+    bool ShmSnapshotReader::readLatest(Snapshot& out) {
+        std::size_t size = 0;
+        const void* data = readLatest(&size);
+        return data && decodeBinarySnapshot(data, size, out);
+    }
+
+}
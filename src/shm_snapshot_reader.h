@@ -0,0 +1,60 @@
+#ifndef PROCESS_STATS_SHM_SNAPSHOT_READER_H
+#define PROCESS_STATS_SHM_SNAPSHOT_READER_H
+
+#include "shm_snapshot_ring.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ProcessStats {
+    // Read-only view of a ShmSnapshotPublisher segment in another process
+    //
+    // Opening maps the segment once; after that every read is plain memory
+    // access with no system calls. Reads never block the publisher. A reader
+    // is not thread-safe; give each thread its own or guard it externally.
+    class ShmSnapshotReader {
+    public:
+        // Map a named segment created by ShmSnapshotPublisher::create()
+        // Returns nullptr and leaves errno set on failure
+        static std::unique_ptr<ShmSnapshotReader> open(const std::string& name);
+
+        // Map a segment from a file descriptor (e.g. an inherited memfd)
+        // The reader keeps its own duplicate of fd
+        static std::unique_ptr<ShmSnapshotReader> fromFd(int fd);
+
+        ~ShmSnapshotReader();
+
+        ShmSnapshotReader(const ShmSnapshotReader&) = delete;
+        ShmSnapshotReader& operator=(const ShmSnapshotReader&) = delete;
+
+        // Number of snapshots published so far; cheap enough to poll for changes
+        uint64_t publishedCount() const;
+
+        // Copy the latest binary snapshot into this reader's buffer
+        // Returns a pointer to it, valid until the next read, or nullptr if
+        // nothing was published yet. size receives the encoded size; read it
+        // in place with BinarySnapshotView.
+        const void* readLatest(std::size_t* size);
+
+        // Copy and decode the latest snapshot; false if none was published yet
+        bool readLatest(Snapshot& out);
+
+        // Reads that had to be retried because the writer lapped the reader
+        uint64_t retryCount() const { return m_retries; }
+
+    private:
+        ShmSnapshotReader(int fd, const void* mapping, std::size_t size);
+        static std::unique_ptr<ShmSnapshotReader> map(int fd);
+
+        int m_fd;
+        const void* m_mapping;
+        std::size_t m_size;
+        const ShmRing::Header* m_header;
+        std::unique_ptr<uint64_t[]> m_buffer;  // 8-byte aligned copy of one payload
+        uint64_t m_retries = 0;
+    };
+}
+
+#endif // PROCESS_STATS_SHM_SNAPSHOT_READER_H
@@ -0,0 +1,57 @@
+#ifndef PROCESS_STATS_SHM_SNAPSHOT_RING_H
+#define PROCESS_STATS_SHM_SNAPSHOT_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ProcessStats {
+    // Layout of a shared-memory snapshot segment, shared by
+    // ShmSnapshotPublisher and ShmSnapshotReader
+    //
+    //     ShmRingHeader                                     (64 bytes)
+    //     slotCount x { ShmRingSlot (64 bytes), payload[slotSize] }
+    //
+    // Each payload holds one binary snapshot (binary_snapshot_format.h).
+    // Every slot is guarded by its own seqlock: the writer makes the slot's
+    // sequence odd, writes the payload, then makes it even again. Readers copy
+    // a payload and accept it only if the sequence was even and unchanged
+    // around the copy. `latest` counts completed writes and names the newest
+    // slot, so readers never wait for the writer and the writer never waits
+    // for readers; a reader only retries if it falls a whole ring behind.
+    namespace ShmRing {
+        constexpr uint32_t kMagic = 0x47525350u;  // "PSRG"
+        constexpr uint16_t kVersion = 1;
+        constexpr std::size_t kAlignment = 64;
+
+        struct alignas(64) Header {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t headerSize;
+            uint32_t slotCount;
+            uint32_t slotSize;               // payload bytes per slot, a multiple of 64
+            std::atomic<uint64_t> latest;    // completed writes; the newest is in slot (latest - 1) % slotCount
+            int64_t writerPid;
+        };
+
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> sequence;  // odd while the writer is inside the slot
+            std::atomic<uint32_t> size;      // payload bytes in use
+        };
+
+        static_assert(sizeof(Header) == 64, "shared memory header layout changed");
+        static_assert(sizeof(Slot) == 64, "shared memory slot layout changed");
+        static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                      "shared memory seqlock needs address-free 64-bit atomics");
+
+        constexpr std::size_t slotStride(uint32_t slotSize) {
+            return sizeof(Slot) + slotSize;
+        }
+
+        constexpr std::size_t segmentSize(uint32_t slotCount, uint32_t slotSize) {
+            return sizeof(Header) + slotStride(slotSize) * slotCount;
+        }
+    }
+}
+
+#endif // PROCESS_STATS_SHM_SNAPSHOT_RING_H
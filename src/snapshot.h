@@ -0,0 +1,104 @@
+#ifndef PROCESS_STATS_SNAPSHOT_H
+#define PROCESS_STATS_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ProcessStats {
+    // Why a module did or did not yield statistics
+    enum class ModuleStatus : uint8_t {
+        Ok,
+        Exited,             // no such process
+        PermissionDenied,   // the process exists but may not be read
+        Zombie              // the process has exited and awaits its parent
+    };
+
+    // Name used for status in JSON: "ok", "exited", "permission_denied", "zombie"
+    inline const char* moduleStatusName(ModuleStatus status) {
+        switch (status) {
+        case ModuleStatus::Ok:
+            return "ok";
+        case ModuleStatus::Exited:
+            return "exited";
+        case ModuleStatus::PermissionDenied:
+            return "permission_denied";
+        case ModuleStatus::Zombie:
+            return "zombie";
+        }
+        return "ok";
+    }
+
+    // Structure for process statistics
+    struct ProcessStatsData {
+        double cpuPercent;
+        double cpuTimeSeconds;
+        double memoryMB;
+    };
+
+    // Batch results as parallel arrays: entry i of each column belongs to the
+    // i-th PID sampled, and a null column is skipped
+    struct ProcessStatsColumns {
+        double* cpuPercent = nullptr;
+        double* cpuTimeSeconds = nullptr;
+        double* memoryMB = nullptr;
+        int64_t* windowMs = nullptr;     // time cpuPercent was measured over, 0 on a first reading
+        int64_t* readTimeNs = nullptr;   // monotonic time each PID was read
+        ModuleStatus* status = nullptr;  // why a PID yielded zeroed stats, Ok otherwise
+    };
+
+    // A module to sample: its name and the PID of its process
+    struct ModuleRef {
+        std::string_view name;
+        int64_t pid = 0;
+    };
+
+    // Statistics for a single named module within a snapshot
+    struct ModuleSample {
+        std::string name;
+        int64_t pid = 0;
+        ProcessStatsData stats = {0.0, 0.0, 0.0};
+        int64_t windowMs = 0;  // time cpuPercent was measured over, 0 on a first reading
+        int64_t readTimeNs = 0;  // monotonic time this module was read
+        ModuleStatus status = ModuleStatus::Ok;
+    };
+
+    // A sampler's own cost, cumulative since it was created or reset
+    struct SelfStats {
+        uint64_t ticks = 0;         // sampling passes
+        uint64_t pidsSampled = 0;   // process reads issued
+        uint64_t syscalls = 0;      // system calls those reads made
+        uint64_t bytesRead = 0;     // bytes they read from procfs
+        uint64_t readNs = 0;        // read phases: system calls and parsing procfs text
+        uint64_t computeNs = 0;     // rate phases: CPU percentages and statuses
+        uint64_t serializeNs = 0;   // rendering JSON, Prometheus and binary output
+        uint64_t allocations = 0;   // reused buffers grown and module names copied
+        uint64_t maxTickNs = 0;     // longest pass from the first read to publishing
+    };
+
+    // Name of the synthetic entry that outputs report SelfStats under
+    constexpr std::string_view kSelfStatsName = "__process_stats__";
+
+    // Result of one sampling pass over a set of modules
+    // sequence increases by one for every snapshot produced by the same source
+    // batchStartNs/batchEndNs are monotonic timestamps taken around the read
+    // phase; every module's readTimeNs falls between them
+    struct Snapshot {
+        uint64_t sequence = 0;
+        int64_t timestampMs = 0;
+        int64_t batchStartNs = 0;
+        int64_t batchEndNs = 0;
+        std::vector<ModuleSample> modules;
+
+        // Set when the engine reports its own cost, as of this snapshot;
+        // outputs then add a __process_stats__ entry
+        bool hasSelfStats = false;
+        SelfStats selfStats;
+
+        // Spread of read times across the batch
+        int64_t skewNs() const { return batchEndNs - batchStartNs; }
+    };
+}
+
+#endif // PROCESS_STATS_SNAPSHOT_H
@@ -0,0 +1,150 @@
+#include "snapshot_delta.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ProcessStats {
+
+namespace {
+    bool identical(const ProcessStatsData& a, const ProcessStatsData& b) {
+        return a.cpuPercent == b.cpuPercent && a.cpuTimeSeconds == b.cpuTimeSeconds && a.memoryMB == b.memoryMB;
+    }
+}
+
+    DeltaTracker::DeltaTracker(DeltaOptions options)
+        : m_options(options) {
+        m_options.fullSnapshotInterval = std::max<uint32_t>(m_options.fullSnapshotInterval, 1);
+    }
+
+    void DeltaTracker::setOptions(const DeltaOptions& options) {
+        *this = DeltaTracker(options);
+    }
+
+    bool DeltaTracker::movedBeyondEpsilon(const ProcessStatsData& reported, const ProcessStatsData& current) const {
+        // Written so that a NaN on either side counts as moved
+        return !(std::fabs(current.cpuPercent - reported.cpuPercent) <= m_options.cpuPercentEpsilon)
+            || !(std::fabs(current.cpuTimeSeconds - reported.cpuTimeSeconds) <= m_options.cpuTimeSecondsEpsilon)
+            || !(std::fabs(current.memoryMB - reported.memoryMB) <= m_options.memoryMBEpsilon);
+    }
+
+    void DeltaTracker::update(const Snapshot& snapshot) {
+        const uint64_t sequence = snapshot.sequence;
+        const uint64_t interval = m_options.fullSnapshotInterval;
+        if (m_sequence == 0) {
+            m_oldestSince = sequence;
+        }
+        m_sequence = sequence;
+        m_hasSelfStats = snapshot.hasSelfStats;
+        m_selfStats = snapshot.selfStats;
+
+        // A resync snapshot reports exact values, so epsilons only ever hold
+        // back an interval's worth of drift
+        const bool resync = sequence % interval == 0;
+        for (const ModuleSample& module : snapshot.modules) {
+            auto found = m_indexByName.find(module.name);
+            if (found == m_indexByName.end()) {
+                m_indexByName.emplace(module.name, m_entries.size());
+                Entry entry;
+                entry.name = module.name;
+                entry.reported = module.stats;
+                entry.status = module.status;
+                entry.changedAt = sequence;
+                entry.seenAt = sequence;
+                m_entries.push_back(std::move(entry));
+                continue;
+            }
+            Entry& entry = m_entries[found->second];
+            entry.seenAt = sequence;
+            const bool changed = entry.removedAt != 0 || entry.status != module.status
+                || (resync ? !identical(entry.reported, module.stats) : movedBeyondEpsilon(entry.reported, module.stats));
+            if (changed) {
+                entry.reported = module.stats;
+                entry.status = module.status;
+                entry.changedAt = sequence;
+                entry.removedAt = 0;
+            }
+        }
+        for (Entry& entry : m_entries) {
+            if (entry.removedAt == 0 && entry.seenAt != sequence) {
+                entry.removedAt = sequence;
+            }
+        }
+
+        m_oldestSince = std::max(m_oldestSince, sequence > interval ? sequence - interval : 0);
+        if (resync) {
+            pruneRemoved();
+        }
+    }
+
+    void DeltaTracker::pruneRemoved() {
+        // No delta that is still allowed can carry these removals
+        auto gone = [this](const Entry& entry) { return entry.removedAt != 0 && entry.removedAt <= m_oldestSince; };
+        if (std::none_of(m_entries.begin(), m_entries.end(), gone)) {
+            return;
+        }
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), gone), m_entries.end());
+        m_indexByName.clear();
+        for (std::size_t i = 0; i < m_entries.size(); ++i) {
+            m_indexByName.emplace(m_entries[i].name, i);
+        }
+    }
+
+    bool DeltaTracker::isFull(uint64_t sinceSequence) const {
+        return sinceSequence == 0 || sinceSequence > m_sequence || sinceSequence < m_oldestSince
+            || m_sequence % m_options.fullSnapshotInterval == 0;
+    }
+
+    std::size_t DeltaTracker::changedCount(uint64_t sinceSequence) const {
+        const bool full = isFull(sinceSequence);
+        return static_cast<std::size_t>(std::count_if(m_entries.begin(), m_entries.end(), [&](const Entry& entry) {
+            return entry.removedAt == 0 && (full || entry.changedAt > sinceSequence);
+        }));
+    }
+
+    void DeltaTracker::writeJson(JsonWriter& writer, uint64_t sinceSequence) const {
+        const bool full = isFull(sinceSequence);
+
+        // Keys in QJsonObject order (sorted)
+        writer.beginObject();
+        writer.key("full");
+        writer.value(full);
+        writer.key("modules");
+        writer.beginArray();
+        for (const Entry& entry : m_entries) {
+            if (entry.removedAt != 0 || (!full && entry.changedAt <= sinceSequence)) {
+                continue;
+            }
+            writer.beginObject();
+            writer.key("cpu_percent");
+            writer.value(entry.reported.cpuPercent);
+            writer.key("cpu_time_seconds");
+            writer.value(entry.reported.cpuTimeSeconds);
+            writer.key("memory_mb");
+            writer.value(entry.reported.memoryMB);
+            writer.key("name");
+            writer.value(std::string_view(entry.name));
+            writer.key("status");
+            writer.value(std::string_view(moduleStatusName(entry.status)));
+            writer.endObject();
+        }
+        if (m_hasSelfStats) {
+            writeSelfStatsJson(writer, m_selfStats);
+        }
+        writer.endArray();
+        writer.key("removed");
+        writer.beginArray();
+        if (!full) {
+            for (const Entry& entry : m_entries) {
+                if (entry.removedAt > sinceSequence) {
+                    writer.value(std::string_view(entry.name));
+                }
+            }
+        }
+        writer.endArray();
+        writer.key("sequence");
+        writer.value(static_cast<int64_t>(m_sequence));
+        writer.key("since");
+        writer.value(static_cast<int64_t>(sinceSequence));
+        writer.endObject();
+    }
+
+}
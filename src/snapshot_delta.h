@@ -0,0 +1,86 @@
+#ifndef PROCESS_STATS_SNAPSHOT_DELTA_H
+#define PROCESS_STATS_SNAPSHOT_DELTA_H
+
+#include "json_writer.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    struct DeltaOptions {
+        // A module is sent again once any metric has moved further than its
+        // epsilon from the value last sent; 0 sends every change
+        double cpuPercentEpsilon = 0.0;
+        double cpuTimeSecondsEpsilon = 0.0;
+        double memoryMBEpsilon = 0.0;
+
+        // Every fullSnapshotInterval-th snapshot goes out whole, with exact
+        // values, and deltas reach back at most this many snapshots
+        uint32_t fullSnapshotInterval = 60;
+    };
+
+    // Reduces a stream of snapshots to what changed since a given sequence
+    //
+    // Keeps one reported value per module: the value from the last snapshot
+    // in which the module moved beyond an epsilon or changed status, stamped
+    // with that snapshot's sequence. A delta since sequence s lists the modules
+    // stamped after s and the modules removed after s. Because that state is
+    // shared, every caller applying deltas in order holds the same values,
+    // and rounding never accumulates past an epsilon. update() costs one hash
+    // lookup per module, however many callers take deltas.
+    //
+    // Not thread-safe.
+    class DeltaTracker {
+    public:
+        explicit DeltaTracker(DeltaOptions options = DeltaOptions());
+
+        // Replaces the options and forgets everything seen
+        void setOptions(const DeltaOptions& options);
+        const DeltaOptions& options() const { return m_options; }
+
+        // Fold in the next snapshot; sequences must increase
+        void update(const Snapshot& snapshot);
+
+        // Sequence of the latest snapshot, 0 before the first
+        uint64_t sequence() const { return m_sequence; }
+
+        // Whether a delta since sinceSequence must be a full snapshot: 0 or
+        // an unknown sequence, one too far back, or a resync snapshot
+        bool isFull(uint64_t sinceSequence) const;
+
+        // Modules a delta since sinceSequence would carry; all present ones
+        // when it is full
+        std::size_t changedCount(uint64_t sinceSequence) const;
+
+        // {"full":..,"modules":[..],"removed":[..],"sequence":..,"since":..}
+        // with module entries as in getModuleStats(), and the latest
+        // snapshot's __process_stats__ entry, if it had one, in every delta
+        void writeJson(JsonWriter& writer, uint64_t sinceSequence) const;
+
+    private:
+        struct Entry {
+            std::string name;
+            ProcessStatsData reported = {0.0, 0.0, 0.0};
+            ModuleStatus status = ModuleStatus::Ok;
+            uint64_t changedAt = 0;    // sequence the reported value is from
+            uint64_t seenAt = 0;       // last sequence the module was in
+            uint64_t removedAt = 0;    // 0 while present
+        };
+
+        bool movedBeyondEpsilon(const ProcessStatsData& reported, const ProcessStatsData& current) const;
+        void pruneRemoved();
+
+        DeltaOptions m_options;
+        std::vector<Entry> m_entries;   // in order of first appearance
+        std::unordered_map<std::string, std::size_t> m_indexByName;
+        uint64_t m_sequence = 0;
+        uint64_t m_oldestSince = 0;     // deltas from before this are full
+        bool m_hasSelfStats = false;
+        SelfStats m_selfStats;
+    };
+}
+
+#endif // PROCESS_STATS_SNAPSHOT_DELTA_H
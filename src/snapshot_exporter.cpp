@@ -0,0 +1,414 @@
+#include "snapshot_exporter.h"
+#include "binary_snapshot.h"
+#include "json_writer.h"
+#include "prometheus_writer.h"
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    constexpr std::size_t kMaxRequestSize = 8192;
+    constexpr std::size_t kMaxConnections = 1024;
+    constexpr int kMaxEvents = 64;
+
+    enum Format { Prometheus, Json, Binary, FormatCount };
+
+    const char* const kContentTypes[FormatCount] = {
+        "text/plain; version=0.0.4; charset=utf-8",
+        "application/json",
+        "application/octet-stream",
+    };
+
+    std::string statusResponse(const char* status) {
+        std::string response = "HTTP/1.1 ";
+        response += status;
+        response += "\r\nContent-Type: text/plain\r\nContent-Length: ";
+        response += std::to_string(std::strlen(status) + 1);
+        response += "\r\nConnection: close\r\n\r\n";
+        response += status;
+        response += '\n';
+        return response;
+    }
+
+    // Listening sockets are non-blocking and close-on-exec
+    int listenUnix(const std::string& path) {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        // A stale socket file from an earlier run would make bind fail
+        unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        return fd;
+    }
+
+    int listenTcp(int port, uint16_t* boundPort) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0
+            || getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        *boundPort = ntohs(address.sin_port);
+        return fd;
+    }
+}
+
+    class SnapshotExporter::Loop {
+    public:
+        Loop(const SnapshotPublisher<Snapshot>& source, SelfStatsCounters* selfStats,
+             std::atomic<uint64_t>& requests, std::atomic<uint64_t>& renders)
+            : m_source(source), m_selfStats(selfStats), m_requests(requests), m_renders(renders) {}
+
+        ~Loop() {
+            for (auto& entry : m_connections) {
+                close(entry.first);
+            }
+            for (int fd : {m_unixFd, m_tcpFd, m_wakeFd, m_epollFd}) {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+        }
+
+        bool open(const ExporterOptions& options, uint16_t* tcpPort) {
+            m_json.setPrecision(options.jsonPrecision);
+            m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+            m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (m_epollFd < 0 || m_wakeFd < 0 || !watch(m_wakeFd, EPOLLIN)) {
+                return false;
+            }
+            if (!options.unixSocketPath.empty()) {
+                m_unixFd = listenUnix(options.unixSocketPath);
+                if (m_unixFd < 0 || !watch(m_unixFd, EPOLLIN)) {
+                    return false;
+                }
+            }
+            if (options.tcpPort >= 0) {
+                m_tcpFd = listenTcp(options.tcpPort, tcpPort);
+                if (m_tcpFd < 0 || !watch(m_tcpFd, EPOLLIN)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void run() {
+            epoll_event events[kMaxEvents];
+            for (;;) {
+                const int count = epoll_wait(m_epollFd, events, kMaxEvents, -1);
+                if (count < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                for (int i = 0; i < count; ++i) {
+                    const int fd = events[i].data.fd;
+                    if (fd == m_wakeFd) {
+                        return;
+                    }
+                    if (fd == m_unixFd || fd == m_tcpFd) {
+                        accept(fd);
+                    } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        drop(fd);
+                    } else if (events[i].events & EPOLLIN) {
+                        receive(fd);
+                    } else if (events[i].events & EPOLLOUT) {
+                        send(fd);
+                    }
+                }
+            }
+        }
+
+        void wake() {
+            const uint64_t one = 1;
+            (void)::write(m_wakeFd, &one, sizeof(one));
+        }
+
+    private:
+        struct Connection {
+            std::string request;
+            std::shared_ptr<const std::string> response;
+            std::size_t written = 0;
+        };
+
+        // Rendered response for one format, valid for one publisher sequence
+        struct Cached {
+            uint64_t sequence = 0;
+            std::shared_ptr<const std::string> response;
+        };
+
+        bool watch(int fd, uint32_t events) {
+            epoll_event event{};
+            event.events = events;
+            event.data.fd = fd;
+            return epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+        }
+
+        void accept(int listenFd) {
+            for (;;) {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    return;  // EAGAIN once the backlog is drained
+                }
+                if (m_connections.size() >= kMaxConnections || !watch(fd, EPOLLIN)) {
+                    close(fd);
+                    continue;
+                }
+                m_connections.emplace(fd, Connection());
+            }
+        }
+
+        void drop(int fd) {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            m_connections.erase(fd);
+        }
+
+        void receive(int fd) {
+            Connection& connection = m_connections[fd];
+            char chunk[1024];
+            for (;;) {
+                const ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+                if (received > 0) {
+                    connection.request.append(chunk, static_cast<std::size_t>(received));
+                    if (connection.request.size() > kMaxRequestSize) {
+                        respond(fd, connection, statusShared(m_tooLarge, "431 Request Header Fields Too Large"));
+                        return;
+                    }
+                    continue;
+                }
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                }
+                // A client may half-close once its request is sent
+                // (shutdown(SHUT_WR), nc -N); it still gets the response
+                if (received == 0 && headersComplete(connection.request)) {
+                    break;
+                }
+                drop(fd);  // peer closed before sending a full request, or error
+                return;
+            }
+            if (!headersComplete(connection.request)) {
+                return;  // wait for the rest of the headers
+            }
+            respond(fd, connection, route(connection.request));
+        }
+
+        static bool headersComplete(const std::string& request) {
+            return request.find("\r\n\r\n") != std::string::npos || request.find("\n\n") != std::string::npos;
+        }
+
+        void respond(int fd, Connection& connection, std::shared_ptr<const std::string> response) {
+            m_requests.fetch_add(1, std::memory_order_relaxed);
+            connection.request.clear();
+            connection.response = std::move(response);
+            send(fd);
+        }
+
+        void send(int fd) {
+            Connection& connection = m_connections[fd];
+            const std::string& response = *connection.response;
+            while (connection.written < response.size()) {
+                const ssize_t sent = ::send(fd, response.data() + connection.written,
+                                            response.size() - connection.written, MSG_NOSIGNAL);
+                if (sent > 0) {
+                    connection.written += static_cast<std::size_t>(sent);
+                    continue;
+                }
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    // Socket buffer full: continue once it drains
+                    epoll_event event{};
+                    event.events = EPOLLOUT;
+                    event.data.fd = fd;
+                    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event);
+                    return;
+                }
+                break;
+            }
+            drop(fd);
+        }
+
+        std::shared_ptr<const std::string> route(const std::string& request) {
+            const std::size_t methodEnd = request.find(' ');
+            const std::size_t pathEnd = methodEnd == std::string::npos ? methodEnd : request.find_first_of(" ?\r\n", methodEnd + 1);
+            if (pathEnd == std::string::npos) {
+                return statusShared(m_badRequest, "400 Bad Request");
+            }
+            if (request.compare(0, methodEnd, "GET") != 0) {
+                return statusShared(m_notAllowed, "405 Method Not Allowed");
+            }
+            const std::string path = request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+            if (path == "/" || path == "/metrics") {
+                return cached(Prometheus);
+            }
+            if (path == "/json") {
+                return cached(Json);
+            }
+            if (path == "/binary") {
+                return cached(Binary);
+            }
+            return statusShared(m_notFound, "404 Not Found");
+        }
+
+        // Response for the latest snapshot, rendered at most once per publication
+        std::shared_ptr<const std::string> cached(Format format) {
+            Cached& cache = m_cache[format];
+            if (cache.response && cache.sequence == m_source.sequence()) {
+                return cache.response;
+            }
+
+            auto guard = m_source.pin();
+            if (!guard) {
+                return statusShared(m_unavailable, "503 Service Unavailable");
+            }
+            const Snapshot& snapshot = *guard;
+            const std::string* body = nullptr;
+            SerializeTimer timer(m_selfStats);
+            switch (format) {
+            case Prometheus:
+                m_prometheus.render(snapshot);
+                body = &m_prometheus.buffer();
+                break;
+            case Json:
+                m_json.clear();
+                writeModuleStatsBatchJson(m_json, snapshot);
+                body = &m_json.buffer();
+                break;
+            default:
+                encodeBinarySnapshot(snapshot, m_binary);
+                body = &m_binary;
+                break;
+            }
+
+            auto response = std::make_shared<std::string>();
+            response->reserve(body->size() + 128);
+            *response += "HTTP/1.1 200 OK\r\nContent-Type: ";
+            *response += kContentTypes[format];
+            *response += "\r\nContent-Length: ";
+            *response += std::to_string(body->size());
+            *response += "\r\nConnection: close\r\n\r\n";
+            *response += *body;
+
+            cache.sequence = guard.sequence();
+            cache.response = std::move(response);
+            m_renders.fetch_add(1, std::memory_order_relaxed);
+            return cache.response;
+        }
+
+        static std::shared_ptr<const std::string>& statusShared(std::shared_ptr<const std::string>& slot, const char* status) {
+            if (!slot) {
+                slot = std::make_shared<const std::string>(statusResponse(status));
+            }
+            return slot;
+        }
+
+        const SnapshotPublisher<Snapshot>& m_source;
+        SelfStatsCounters* m_selfStats;
+        std::atomic<uint64_t>& m_requests;
+        std::atomic<uint64_t>& m_renders;
+
+        int m_epollFd = -1;
+        int m_wakeFd = -1;
+        int m_unixFd = -1;
+        int m_tcpFd = -1;
+        std::unordered_map<int, Connection> m_connections;
+
+        Cached m_cache[FormatCount];
+        PrometheusWriter m_prometheus;
+        JsonWriter m_json;
+        std::string m_binary;
+
+        std::shared_ptr<const std::string> m_badRequest;
+        std::shared_ptr<const std::string> m_notAllowed;
+        std::shared_ptr<const std::string> m_notFound;
+        std::shared_ptr<const std::string> m_tooLarge;
+        std::shared_ptr<const std::string> m_unavailable;
+    };
+
+    SnapshotExporter::SnapshotExporter(const SnapshotPublisher<Snapshot>& source, SelfStatsCounters* selfStats)
+        : m_source(source),
+          m_selfStats(selfStats) {}
+
+    SnapshotExporter::~SnapshotExporter() {
+        stop();
+    }
+
+    bool SnapshotExporter::start(const ExporterOptions& options) {
+        stop();
+        auto loop = std::make_unique<Loop>(m_source, m_selfStats, m_requests, m_renders);
+        uint16_t tcpPort = 0;
+        if (!loop->open(options, &tcpPort)) {
+            const int error = errno;
+            loop.reset();
+            if (!options.unixSocketPath.empty()) {
+                unlink(options.unixSocketPath.c_str());
+            }
+            errno = error;
+            return false;
+        }
+        m_loop = std::move(loop);
+        m_unixSocketPath = options.unixSocketPath;
+        m_tcpPort = tcpPort;
+        m_thread = std::thread([loop = m_loop.get()] { loop->run(); });
+        return true;
+    }
+
+    void SnapshotExporter::stop() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+        m_loop->wake();
+        m_thread.join();
+        m_loop.reset();
+        if (!m_unixSocketPath.empty()) {
+            unlink(m_unixSocketPath.c_str());
+            m_unixSocketPath.clear();
+        }
+        m_tcpPort = 0;
+    }
+
+}
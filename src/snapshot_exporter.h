@@ -0,0 +1,73 @@
+#ifndef PROCESS_STATS_SNAPSHOT_EXPORTER_H
+#define PROCESS_STATS_SNAPSHOT_EXPORTER_H
+
+#include "json_writer.h"
+#include "self_stats.h"
+#include "snapshot.h"
+#include "snapshot_publisher.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace ProcessStats {
+    struct ExporterOptions {
+        std::string unixSocketPath;  // empty: no Unix domain socket
+        int tcpPort = -1;            // HTTP on 127.0.0.1; -1 disables, 0 picks a free port
+        int jsonPrecision = JsonWriter::kShortestPrecision;  // for /json, see JsonWriter::setPrecision()
+    };
+
+    // Serves the latest published snapshot to local scrapers
+    //
+    // Speaks minimal HTTP/1.x on a Unix domain socket and/or localhost TCP:
+    //   GET /metrics  Prometheus text exposition (also "/")
+    //   GET /json     getModuleStatsBatch() JSON
+    //   GET /binary   binary snapshot (binary_snapshot_format.h)
+    // Each response is rendered once per published snapshot, headers included,
+    // and shared by every connection asking for that format; requests never
+    // trigger a sample. One epoll thread handles all connections with
+    // non-blocking I/O, closing each after its response. Linux only.
+    class SnapshotExporter {
+    public:
+        // source, and selfStats if given, must outlive the exporter; rendering
+        // time is added to selfStats
+        explicit SnapshotExporter(const SnapshotPublisher<Snapshot>& source,
+                                  SelfStatsCounters* selfStats = nullptr);
+        ~SnapshotExporter();
+
+        SnapshotExporter(const SnapshotExporter&) = delete;
+        SnapshotExporter& operator=(const SnapshotExporter&) = delete;
+
+        // Bind the listeners and start the event loop
+        // Returns false and leaves errno set if a listener could not be set up
+        bool start(const ExporterOptions& options);
+
+        // Stop the event loop and close every connection; removes the socket file
+        void stop();
+
+        bool isRunning() const { return m_thread.joinable(); }
+
+        // Port actually bound for HTTP, 0 if TCP is disabled
+        uint16_t tcpPort() const { return m_tcpPort; }
+
+        uint64_t requestCount() const { return m_requests.load(std::memory_order_relaxed); }
+
+        // Number of times a format was rendered; at most once per format per snapshot
+        uint64_t renderCount() const { return m_renders.load(std::memory_order_relaxed); }
+
+    private:
+        class Loop;
+
+        const SnapshotPublisher<Snapshot>& m_source;
+        SelfStatsCounters* m_selfStats;
+        std::unique_ptr<Loop> m_loop;
+        std::thread m_thread;
+        std::string m_unixSocketPath;
+        uint16_t m_tcpPort = 0;
+        std::atomic<uint64_t> m_requests{0};
+        std::atomic<uint64_t> m_renders{0};
+    };
+}
+
+#endif // PROCESS_STATS_SNAPSHOT_EXPORTER_H
@@ -0,0 +1,167 @@
+#ifndef PROCESS_STATS_SNAPSHOT_PUBLISHER_H
+#define PROCESS_STATS_SNAPSHOT_PUBLISHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace ProcessStats {
+    // Publishes the latest value from a single writer to any number of readers
+    // without locks.
+    //
+    // Values live in a fixed pool of slots. The writer fills a slot that is
+    // neither current nor pinned by a reader, then swaps the current index.
+    // Readers pin the current slot with a reference count and re-check the
+    // index; they only retry when they race a publication. Neither side ever
+    // takes a mutex or waits for the other: if every spare slot is pinned, the
+    // publication is dropped and reported to the writer instead.
+    //
+    // Keep slotCount at least two larger than the number of readers that may
+    // hold a ReadGuard at the same time to guarantee publications never drop.
+    template <typename T>
+    class SnapshotPublisher {
+        struct Slot {
+            std::atomic<uint32_t> readers{0};
+            uint64_t sequence = 0;
+            T value{};
+        };
+
+    public:
+        // Read-only view of a pinned slot; the writer will not reuse the slot
+        // until the guard is released
+        class ReadGuard {
+        public:
+            ReadGuard() = default;
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+            ReadGuard(ReadGuard&& other) noexcept : m_slot(std::exchange(other.m_slot, nullptr)) {}
+            ReadGuard& operator=(ReadGuard&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    m_slot = std::exchange(other.m_slot, nullptr);
+                }
+                return *this;
+            }
+            ~ReadGuard() { release(); }
+
+            explicit operator bool() const { return m_slot != nullptr; }
+            const T& operator*() const { return m_slot->value; }
+            const T* operator->() const { return &m_slot->value; }
+            uint64_t sequence() const { return m_slot ? m_slot->sequence : 0; }
+
+            void release() {
+                if (m_slot) {
+                    m_slot->readers.fetch_sub(1, std::memory_order_release);
+                    m_slot = nullptr;
+                }
+            }
+
+        private:
+            friend class SnapshotPublisher;
+            explicit ReadGuard(Slot* slot) : m_slot(slot) {}
+            Slot* m_slot = nullptr;
+        };
+
+        explicit SnapshotPublisher(std::size_t slotCount = 8)
+            : m_slotCount(slotCount < 2 ? 2 : slotCount),
+              m_slots(new Slot[m_slotCount]) {}
+
+        SnapshotPublisher(const SnapshotPublisher&) = delete;
+        SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+        // Writer side: fill a free slot in place through fill(T&) and publish it.
+        // The slot still holds an older value, so containers keep their capacity
+        // and steady-state publication does not allocate.
+        // Returns false if no slot was free; the previous value stays current.
+        template <typename Fill>
+        bool publishWith(Fill&& fill) {
+            Slot* slot = acquireFreeSlot();
+            if (!slot) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            fill(slot->value);
+            slot->sequence = m_sequence.load(std::memory_order_relaxed) + 1;
+            m_current.store(static_cast<uint32_t>(slot - m_slots.get()), std::memory_order_seq_cst);
+            m_sequence.store(slot->sequence, std::memory_order_release);
+            return true;
+        }
+
+        // Writer side: publish a copy of value
+        bool publish(const T& value) {
+            return publishWith([&value](T& target) { target = value; });
+        }
+
+        // Reader side: pin the current value. Returns an empty guard if nothing
+        // has been published yet.
+        ReadGuard pin() const {
+            for (;;) {
+                uint32_t index = m_current.load(std::memory_order_seq_cst);
+                if (index == kNoSlot) {
+                    return ReadGuard();
+                }
+                Slot* slot = &m_slots[index];
+                slot->readers.fetch_add(1, std::memory_order_seq_cst);
+                // The writer never fills the current slot, so if the index is
+                // unchanged after pinning the slot holds a complete value
+                if (m_current.load(std::memory_order_seq_cst) == index) {
+                    return ReadGuard(slot);
+                }
+                slot->readers.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        // Reader side: copy the current value into out
+        // Returns false if nothing has been published yet
+        bool read(T& out, uint64_t* sequence = nullptr) const {
+            ReadGuard guard = pin();
+            if (!guard) {
+                return false;
+            }
+            out = *guard;
+            if (sequence) {
+                *sequence = guard.sequence();
+            }
+            return true;
+        }
+
+        // Sequence number of the latest publication, 0 if none
+        uint64_t sequence() const { return m_sequence.load(std::memory_order_acquire); }
+
+        // Number of publications dropped because every spare slot was pinned
+        uint64_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+        std::size_t slotCount() const { return m_slotCount; }
+
+    private:
+        static constexpr uint32_t kNoSlot = ~uint32_t(0);
+
+        Slot* acquireFreeSlot() {
+            uint32_t current = m_current.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < m_slotCount; ++i) {
+                std::size_t index = (m_nextSlot + i) % m_slotCount;
+                if (index == current) {
+                    continue;
+                }
+                // Pairs with the reader's pin: either the reader sees the new
+                // index and backs off, or this load sees its pin
+                if (m_slots[index].readers.load(std::memory_order_seq_cst) == 0) {
+                    m_nextSlot = (index + 1) % m_slotCount;
+                    return &m_slots[index];
+                }
+            }
+            return nullptr;
+        }
+
+        const std::size_t m_slotCount;
+        std::unique_ptr<Slot[]> m_slots;
+        std::atomic<uint32_t> m_current{kNoSlot};
+        std::atomic<uint64_t> m_sequence{0};
+        std::atomic<uint64_t> m_dropped{0};
+        std::size_t m_nextSlot = 0; // writer-only
+    };
+}
+
+#endif // PROCESS_STATS_SNAPSHOT_PUBLISHER_H
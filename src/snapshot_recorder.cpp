@@ -0,0 +1,459 @@
+#include "snapshot_recorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    constexpr std::size_t kNoSeries = static_cast<std::size_t>(-1);
+
+    uint32_t roundBlockSize(uint32_t blockSize) {
+        if (blockSize < Recording::kMinBlockSize) {
+            return Recording::kMinBlockSize;
+        }
+        return (blockSize + Recording::kMinBlockSize - 1) / Recording::kMinBlockSize * Recording::kMinBlockSize;
+    }
+
+    // Integral doubles keep the XOR of successive values short
+    double cpuTimeMs(const ModuleSample& module) {
+        return std::nearbyint(module.stats.cpuTimeSeconds * 1000.0);
+    }
+
+    double memoryKiB(const ModuleSample& module) {
+        return std::nearbyint(module.stats.memoryMB * 1024.0);
+    }
+
+    bool writeAll(int fd, const void* data, std::size_t size, off_t offset) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t written = pwrite(fd, bytes, size, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+            offset += written;
+        }
+        return true;
+    }
+
+    template<typename T>
+    void put(std::vector<uint8_t>& block, std::size_t offset, const T& value) {
+        std::memcpy(block.data() + offset, &value, sizeof(T));
+    }
+
+    // Write the file header of an empty recording, or validate an existing
+    // one and adopt its block size. Sets blocks to the number of block slots
+    // in use. Returns 0 or an errno value (EINVAL for a foreign file).
+    int prepareFile(int fd, uint32_t& blockSize, uint64_t& blocks) {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            return errno;
+        }
+        if (info.st_size == 0) {
+            blockSize = roundBlockSize(blockSize);
+            std::vector<uint8_t> header(Recording::kDataOffset, 0);
+            Recording::FileHeader fileHeader{};
+            fileHeader.magic = Recording::kFileMagic;
+            fileHeader.version = Recording::kVersion;
+            fileHeader.headerSize = static_cast<uint16_t>(Recording::kDataOffset);
+            fileHeader.blockSize = blockSize;
+            fileHeader.createdMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            put(header, 0, fileHeader);
+            blocks = 0;
+            return writeAll(fd, header.data(), header.size(), 0) ? 0 : errno;
+        }
+
+        Recording::FileHeader fileHeader{};
+        if (pread(fd, &fileHeader, sizeof(fileHeader), 0) != static_cast<ssize_t>(sizeof(fileHeader))
+            || fileHeader.magic != Recording::kFileMagic || fileHeader.version != Recording::kVersion
+            || fileHeader.headerSize != Recording::kDataOffset
+            || fileHeader.blockSize != roundBlockSize(fileHeader.blockSize)) {
+            return EINVAL;
+        }
+        blockSize = fileHeader.blockSize;
+        // A block cut short by a crash keeps its slot; appending starts after it
+        const uint64_t data = static_cast<uint64_t>(info.st_size) > Recording::kDataOffset
+            ? static_cast<uint64_t>(info.st_size) - Recording::kDataOffset : 0;
+        blocks = (data + blockSize - 1) / blockSize;
+        return 0;
+    }
+}
+
+    std::unique_ptr<SnapshotRecorder> SnapshotRecorder::open(const std::string& path, uint32_t blockSize) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return nullptr;
+        }
+        uint64_t nextBlock = 0;
+        // One recorder per file; a second one would interleave blocks
+        const int error = flock(fd, LOCK_EX | LOCK_NB) != 0 ? errno : prepareFile(fd, blockSize, nextBlock);
+        if (error) {
+            close(fd);
+            errno = error;
+            return nullptr;
+        }
+        return std::unique_ptr<SnapshotRecorder>(
+            new SnapshotRecorder(fd, blockSize, 0, nextBlock, std::string(), 0, -1));
+    }
+
+    std::unique_ptr<SnapshotRecorder> SnapshotRecorder::openDirectory(const std::string& directory,
+                                                                      uint32_t blocksPerSegment,
+                                                                      uint32_t blockSize) {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+            return nullptr;
+        }
+        const int lockFd = ::open((directory + "/LOCK").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd < 0) {
+            return nullptr;
+        }
+        auto fail = [lockFd](int fd, int error) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            close(lockFd);
+            errno = error;
+            return nullptr;
+        };
+        if (flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+            return fail(-1, errno);
+        }
+
+        // Continue in the newest segment while it has room
+        uint64_t segment = 0;
+        DIR* entries = opendir(directory.c_str());
+        if (!entries) {
+            return fail(-1, errno);
+        }
+        while (dirent* entry = readdir(entries)) {
+            unsigned long long number = 0;
+            char suffix[8] = {};
+            if (std::sscanf(entry->d_name, "segment-%llu.%7s", &number, suffix) == 2
+                && std::strcmp(suffix, "psrc") == 0 && number > segment) {
+                segment = number;
+            }
+        }
+        closedir(entries);
+
+        blocksPerSegment = blocksPerSegment < 1 ? 1 : blocksPerSegment;
+        for (;;) {
+            const int fd = ::open(segmentPath(directory, segment).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                return fail(-1, errno);
+            }
+            uint64_t nextBlock = 0;
+            if (const int error = prepareFile(fd, blockSize, nextBlock)) {
+                return fail(fd, error);
+            }
+            if (nextBlock < blocksPerSegment) {
+                return std::unique_ptr<SnapshotRecorder>(
+                    new SnapshotRecorder(fd, blockSize, segment, nextBlock, directory, blocksPerSegment, lockFd));
+            }
+            close(fd);
+            ++segment;
+        }
+    }
+
+    std::string SnapshotRecorder::segmentPath(const std::string& directory, uint64_t segment) {
+        char name[40];
+        std::snprintf(name, sizeof(name), "/segment-%06llu.psrc", static_cast<unsigned long long>(segment));
+        return directory + name;
+    }
+
+    SnapshotRecorder::SnapshotRecorder(int fd, uint32_t blockSize, uint64_t segment, uint64_t nextBlock,
+                                       std::string directory, uint32_t blocksPerSegment, int lockFd)
+        : m_fd(fd),
+          m_fdSegment(segment),
+          m_lockFd(lockFd),
+          m_directory(std::move(directory)),
+          m_blocksPerSegment(blocksPerSegment),
+          m_blockSize(blockSize),
+          m_segment(segment),
+          m_nextBlock(nextBlock) {
+        resetBlock();
+        m_writer = std::thread([this] { writerLoop(); });
+    }
+
+    SnapshotRecorder::~SnapshotRecorder() {
+        seal();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+        if (m_lockFd >= 0) {
+            close(m_lockFd);
+        }
+    }
+
+    void SnapshotRecorder::record(const Snapshot& snapshot) {
+        if (snapshot.modules.empty()) {
+            return;
+        }
+        const uint32_t before = m_blockSamples;
+        if (!appendRow(snapshot)) {
+            const bool emptyBlock = m_rows == 0;
+            seal();
+            if (emptyBlock || !appendRow(snapshot)) {
+                // Too many modules for one block
+                m_droppedSamples.fetch_add(snapshot.modules.size(), std::memory_order_relaxed);
+                return;
+            }
+            m_recordedSamples += m_blockSamples;
+            return;
+        }
+        m_recordedSamples += m_blockSamples - before;
+    }
+
+    void SnapshotRecorder::flush() {
+        seal();
+    }
+
+    bool SnapshotRecorder::appendRow(const Snapshot& snapshot) {
+        // State to restore if the row turns out not to fit
+        struct Undo {
+            std::size_t series;
+            std::size_t previous;     // replaced m_seriesByName entry, new series only
+            std::size_t bits;
+            XorEncoder cpuTime;
+            XorEncoder memory;
+        };
+        thread_local std::vector<Undo> undo;
+        undo.clear();
+        const std::size_t seriesBefore = m_series.size();
+        const std::size_t timeBitsBefore = m_timeBits.bitCount();
+        const TimestampEncoder timeBefore = m_time;
+        const std::size_t fixedBefore = m_fixedBytes;
+        const std::size_t streamBefore = m_streamBytes;
+        const uint32_t samplesBefore = m_blockSamples;
+
+        const uint32_t row = m_rows;
+        m_time.append(m_timeBits, snapshot.timestampMs);
+
+        for (const ModuleSample& module : snapshot.modules) {
+            auto it = m_seriesByName.find(module.name);
+            std::size_t index = it == m_seriesByName.end() ? kNoSeries : it->second;
+            if (index != kNoSeries) {
+                const Series& series = m_series[index];
+                const uint32_t end = series.firstRow + series.sampleCount;
+                if (end == row + 1) {
+                    continue;  // module listed twice in this snapshot
+                }
+                if (end == row) {
+                    undo.push_back({index, kNoSeries, series.bits.bitCount(), series.cpuTime, series.memory});
+                } else {
+                    index = kNoSeries;  // module is back after a gap
+                }
+            }
+            if (index == kNoSeries) {
+                const std::size_t previous = it == m_seriesByName.end() ? kNoSeries : it->second;
+                index = m_series.size();
+                m_series.emplace_back();
+                Series& series = m_series.back();
+                series.name = module.name;
+                series.firstRow = row;
+                m_seriesByName[module.name] = index;
+                undo.push_back({index, previous, 0, XorEncoder(), XorEncoder()});
+                m_fixedBytes += sizeof(Recording::SeriesEntry) + module.name.size();
+            }
+
+            Series& series = m_series[index];
+            const std::size_t bytesBefore = series.bits.byteCount();
+            if (series.sampleCount == 0) {
+                uint64_t cpuPercent;
+                std::memcpy(&cpuPercent, &module.stats.cpuPercent, sizeof(cpuPercent));
+                series.bits.write(cpuPercent, 64);
+            }
+            series.cpuTime.append(series.bits, cpuTimeMs(module));
+            series.memory.append(series.bits, memoryKiB(module));
+            m_streamBytes += series.bits.byteCount() - bytesBefore;
+            ++series.sampleCount;
+            ++m_blockSamples;
+        }
+
+        if (m_fixedBytes + m_timeBits.byteCount() + m_streamBytes > m_blockSize) {
+            for (auto entry = undo.rbegin(); entry != undo.rend(); ++entry) {
+                if (entry->series >= seriesBefore) {
+                    const std::string& name = m_series[entry->series].name;
+                    if (entry->previous == kNoSeries) {
+                        m_seriesByName.erase(name);
+                    } else {
+                        m_seriesByName[name] = entry->previous;
+                    }
+                    continue;
+                }
+                Series& series = m_series[entry->series];
+                series.bits.truncate(entry->bits);
+                series.cpuTime = entry->cpuTime;
+                series.memory = entry->memory;
+                --series.sampleCount;
+            }
+            m_series.resize(seriesBefore);
+            m_timeBits.truncate(timeBitsBefore);
+            m_time = timeBefore;
+            m_fixedBytes = fixedBefore;
+            m_streamBytes = streamBefore;
+            m_blockSamples = samplesBefore;
+            return false;
+        }
+
+        if (row == 0) {
+            m_minTimeMs = m_maxTimeMs = snapshot.timestampMs;
+        } else {
+            m_minTimeMs = std::min(m_minTimeMs, snapshot.timestampMs);
+            m_maxTimeMs = std::max(m_maxTimeMs, snapshot.timestampMs);
+        }
+        ++m_rows;
+        return true;
+    }
+
+    void SnapshotRecorder::seal() {
+        if (m_rows == 0) {
+            return;
+        }
+
+        std::vector<uint8_t> block;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.size() >= kMaxPendingBlocks) {
+                m_droppedSamples.fetch_add(m_blockSamples, std::memory_order_relaxed);
+                resetBlock();
+                return;
+            }
+            if (!m_freeBuffers.empty()) {
+                block = std::move(m_freeBuffers.back());
+                m_freeBuffers.pop_back();
+            }
+        }
+        block.assign(m_blockSize, 0);
+
+        Recording::BlockHeader header{};
+        header.magic = Recording::kBlockMagic;
+        header.seriesCount = static_cast<uint32_t>(m_series.size());
+        header.rowCount = m_rows;
+        header.minTimeMs = m_minTimeMs;
+        header.maxTimeMs = m_maxTimeMs;
+        header.blockNumber = m_nextBlock;
+        header.sampleCount = m_blockSamples;
+
+        std::size_t names = sizeof(Recording::BlockHeader) + m_series.size() * sizeof(Recording::SeriesEntry);
+        std::size_t streams = m_fixedBytes;
+
+        header.timeOffset = static_cast<uint32_t>(streams);
+        header.timeBits = static_cast<uint32_t>(m_timeBits.bitCount());
+        std::memcpy(block.data() + streams, m_timeBits.data(), m_timeBits.byteCount());
+        streams += m_timeBits.byteCount();
+
+        for (std::size_t i = 0; i < m_series.size(); ++i) {
+            const Series& series = m_series[i];
+            Recording::SeriesEntry entry{};
+            entry.nameOffset = static_cast<uint32_t>(names);
+            entry.nameLength = static_cast<uint32_t>(series.name.size());
+            entry.firstRow = series.firstRow;
+            entry.sampleCount = series.sampleCount;
+            entry.dataOffset = static_cast<uint32_t>(streams);
+            entry.dataBits = static_cast<uint32_t>(series.bits.bitCount());
+            put(block, sizeof(Recording::BlockHeader) + i * sizeof(Recording::SeriesEntry), entry);
+
+            std::memcpy(block.data() + names, series.name.data(), series.name.size());
+            names += series.name.size();
+            std::memcpy(block.data() + streams, series.bits.data(), series.bits.byteCount());
+            streams += series.bits.byteCount();
+        }
+        header.usedBytes = static_cast<uint32_t>(streams);
+        put(block, 0, header);
+        m_encodedBytes += streams;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.push_back({m_segment, m_nextBlock, std::move(block)});
+        }
+        if (++m_nextBlock == m_blocksPerSegment) {
+            // The writer thread creates the next segment file
+            ++m_segment;
+            m_nextBlock = 0;
+        }
+        m_wake.notify_one();
+        resetBlock();
+    }
+
+    void SnapshotRecorder::resetBlock() {
+        m_series.clear();
+        m_seriesByName.clear();
+        m_timeBits.clear();
+        m_time = TimestampEncoder();
+        m_rows = 0;
+        m_blockSamples = 0;
+        m_fixedBytes = sizeof(Recording::BlockHeader);
+        m_streamBytes = 0;
+    }
+
+    void SnapshotRecorder::writerLoop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [this] { return m_stopping || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                return;  // stopping, and everything queued is written
+            }
+            PendingBlock block = std::move(m_pending.front());
+            m_pending.pop_front();
+            lock.unlock();
+
+            if (block.segment != m_fdSegment) {
+                switchSegment(block.segment);
+            }
+            // Header last: readers of a live file take a block with a valid
+            // magic to be complete
+            const off_t offset = static_cast<off_t>(Recording::blockOffset(block.index, m_blockSize));
+            const std::size_t headerSize = sizeof(Recording::BlockHeader);
+            const bool written = m_fd >= 0
+                && writeAll(m_fd, block.data.data() + headerSize, block.data.size() - headerSize,
+                            offset + static_cast<off_t>(headerSize))
+                && writeAll(m_fd, block.data.data(), headerSize, offset);
+
+            lock.lock();
+            if (written) {
+                m_blocksWritten.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                Recording::BlockHeader header;
+                std::memcpy(&header, block.data.data(), sizeof(header));
+                m_droppedSamples.fetch_add(header.sampleCount, std::memory_order_relaxed);
+                m_writeErrors.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_freeBuffers.push_back(std::move(block.data));
+        }
+    }
+
+    void SnapshotRecorder::switchSegment(uint64_t segment) {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+        m_fdSegment = segment;
+        m_fd = ::open(segmentPath(m_directory, segment).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        uint32_t blockSize = m_blockSize;
+        uint64_t blocks = 0;
+        if (m_fd >= 0 && (prepareFile(m_fd, blockSize, blocks) != 0 || blockSize != m_blockSize)) {
+            // Blocks for this segment fail and are counted as dropped
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+}
@@ -0,0 +1,143 @@
+#ifndef PROCESS_STATS_SNAPSHOT_RECORDER_H
+#define PROCESS_STATS_SNAPSHOT_RECORDER_H
+
+#include "gorilla_codec.h"
+#include "recording_format.h"
+#include "snapshot.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    // Appends snapshots to a compressed recording file
+    //
+    // Each module sample (timestamp, CPU and resident memory) costs one to two
+    // bytes for typical workloads: see recording_format.h for the layout. CPU
+    // time is kept to the millisecond and memory to the KiB. record() only
+    // encodes into the current in-memory block; full blocks are written by a
+    // background thread, so the caller never waits for the disk. If the
+    // writer falls kMaxPendingBlocks behind, further blocks are dropped and
+    // counted rather than queued without bound.
+    //
+    // record() and flush() must be called from one thread at a time.
+    class SnapshotRecorder {
+    public:
+        static constexpr uint32_t kDefaultBlockSize = 256 * 1024;
+        static constexpr uint32_t kDefaultBlocksPerSegment = 256;
+        static constexpr std::size_t kMaxPendingBlocks = 16;
+
+        // Open path for appending, creating it if needed. An existing
+        // recording keeps its block size. Returns nullptr and leaves errno set
+        // on failure (EINVAL if path holds something other than a recording).
+        static std::unique_ptr<SnapshotRecorder> open(const std::string& path,
+                                                      uint32_t blockSize = kDefaultBlockSize);
+
+        // Record into a directory of segment files (segmentPath()), starting a
+        // new segment every blocksPerSegment blocks; TimeSeriesStore reads
+        // them back. Creates the directory if needed and continues in the
+        // newest segment while it has room. Returns nullptr and leaves errno
+        // set on failure (EWOULDBLOCK if another recorder has the directory).
+        static std::unique_ptr<SnapshotRecorder> openDirectory(const std::string& directory,
+                                                               uint32_t blocksPerSegment = kDefaultBlocksPerSegment,
+                                                               uint32_t blockSize = kDefaultBlockSize);
+
+        // directory/segment-NNNNNN.psrc; names sort in recording order
+        static std::string segmentPath(const std::string& directory, uint64_t segment);
+
+        // Writes the partial block and waits for the writer to finish
+        ~SnapshotRecorder();
+
+        SnapshotRecorder(const SnapshotRecorder&) = delete;
+        SnapshotRecorder& operator=(const SnapshotRecorder&) = delete;
+
+        void record(const Snapshot& snapshot);
+
+        // Queue the current partial block for writing without waiting; the
+        // rest of its fixed-size slot in the file stays unused
+        void flush();
+
+        uint32_t blockSize() const { return m_blockSize; }
+        uint64_t recordedSamples() const { return m_recordedSamples; }
+        uint64_t blocksWritten() const { return m_blocksWritten.load(std::memory_order_relaxed); }
+
+        // Samples lost to a backed-up writer, failed writes, or a snapshot
+        // with more modules than fit in one block
+        uint64_t droppedSamples() const { return m_droppedSamples.load(std::memory_order_relaxed); }
+        uint64_t writeErrors() const { return m_writeErrors.load(std::memory_order_relaxed); }
+
+        // Encoded bytes of every sealed block, excluding the unused tail of each
+        uint64_t encodedBytes() const { return m_encodedBytes; }
+
+    private:
+        struct Series {
+            std::string name;
+            uint32_t firstRow = 0;
+            uint32_t sampleCount = 0;
+            BitWriter bits;
+            XorEncoder cpuTime;
+            XorEncoder memory;
+        };
+
+        struct PendingBlock {
+            uint64_t segment = 0;
+            uint64_t index = 0;       // within the segment
+            std::vector<uint8_t> data;
+        };
+
+        SnapshotRecorder(int fd, uint32_t blockSize, uint64_t segment, uint64_t nextBlock,
+                         std::string directory, uint32_t blocksPerSegment, int lockFd);
+
+        bool appendRow(const Snapshot& snapshot);
+        void seal();
+        void resetBlock();
+        void writerLoop();
+        void switchSegment(uint64_t segment);
+
+        // Writer thread's file; m_fd and m_fdSegment are owned by the writer
+        // once it runs
+        int m_fd;
+        uint64_t m_fdSegment;
+        int m_lockFd;                     // directory lock, segmented mode only
+        const std::string m_directory;    // empty for a single file
+        const uint32_t m_blocksPerSegment;  // 0: unlimited
+        const uint32_t m_blockSize;
+
+        // Where the next sealed block goes
+        uint64_t m_segment;
+        uint64_t m_nextBlock;
+
+        // Block being built; only touched by the recording thread
+        std::vector<Series> m_series;
+        std::unordered_map<std::string, std::size_t> m_seriesByName;   // latest series per module
+        BitWriter m_timeBits;
+        TimestampEncoder m_time;
+        int64_t m_minTimeMs = 0;
+        int64_t m_maxTimeMs = 0;
+        uint32_t m_rows = 0;
+        uint32_t m_blockSamples = 0;
+        std::size_t m_fixedBytes = 0;    // header, series entries and names
+        std::size_t m_streamBytes = 0;   // series streams
+        uint64_t m_recordedSamples = 0;
+        uint64_t m_encodedBytes = 0;
+
+        // Hand-off to the writer thread
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<PendingBlock> m_pending;
+        std::vector<std::vector<uint8_t>> m_freeBuffers;
+        bool m_stopping = false;
+        std::atomic<uint64_t> m_blocksWritten{0};
+        std::atomic<uint64_t> m_droppedSamples{0};
+        std::atomic<uint64_t> m_writeErrors{0};
+        std::thread m_writer;
+    };
+}
+
+#endif // PROCESS_STATS_SNAPSHOT_RECORDER_H
@@ -0,0 +1,390 @@
+#include "stats_engine.h"
+#include "shm_snapshot_publisher.h"
+#include "snapshot_recorder.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
+
+#if defined(__linux__)
+#define PROCESS_STATS_HAVE_EXPORTER 1
+#include "snapshot_exporter.h"
+#endif
+
+namespace ProcessStats {
+
+namespace {
+    std::string describe(const char* what, std::string_view name, int error) {
+        std::string message(what);
+        message += ' ';
+        message += name;
+        message += ": ";
+        message += std::strerror(error);
+        return message;
+    }
+}
+
+    StatsEngine::StatsEngine(SamplerOptions options, WarningHandler warn)
+        : m_warn(std::move(warn)),
+          m_sampler(std::move(options)),
+          m_coalescer(m_sampler, std::chrono::milliseconds(0), std::chrono::seconds(60), &m_samplerMutex) {}
+
+    // Out of line, where the sink types are complete
+    StatsEngine::~StatsEngine() = default;
+
+    void StatsEngine::warn(std::string_view message) const {
+        if (m_warn) {
+            m_warn(message);
+        } else {
+            std::fprintf(stderr, "%.*s\n", static_cast<int>(message.size()), message.data());
+        }
+    }
+
+    void StatsEngine::clearHistory() {
+        m_coalescer.clear();
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        m_sampler.clearHistory();
+    }
+
+    void StatsEngine::setSampleSource(std::shared_ptr<SampleSource> source) {
+        m_coalescer.clear();
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        m_sampler.setSource(std::move(source));
+    }
+
+    void StatsEngine::setCoalescingWindow(int milliseconds) {
+        milliseconds = std::max(milliseconds, 0);
+        m_coalescer.setWindow(std::chrono::milliseconds(milliseconds));
+        m_coalescingWindowMs.store(milliseconds);
+    }
+
+    void StatsEngine::setAlignedBatchTimestamps(bool enabled) {
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        m_sampler.setAlignBatchTimestamps(enabled);
+    }
+
+    void StatsEngine::setSamplingThreads(int workers) {
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        m_sampler.setWorkerCount(workers > 0 ? static_cast<std::size_t>(workers) : 1);
+    }
+
+    ProcessStatsData StatsEngine::sampleProcess(int64_t pid, ModuleStatus* status) {
+    #if !defined(__linux__) && !(defined(__APPLE__) && !TARGET_OS_IPHONE)
+        warn("Process monitoring not supported on this platform");
+    #endif
+        if (m_coalescingWindowMs.load() > 0) {
+            int64_t pids[1] = {pid};
+            ProcessStatsData stats;
+            m_coalescer.sample(pids, 1, &stats, nullptr, nullptr, status);
+            return stats;
+        }
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        return m_sampler.sampleProcess(pid, status);
+    }
+
+    void StatsEngine::sampleBatch(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out) {
+        if (m_coalescingWindowMs.load() == 0) {
+            std::lock_guard<std::mutex> lock(m_samplerMutex);
+            m_sampler.sample(pids, count, out);
+            return;
+        }
+        sampleCoalesced(pids, count, out);
+    }
+
+    void StatsEngine::sampleCoalesced(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out) {
+        thread_local std::vector<ProcessStatsData> stats;
+        stats.resize(count);
+        m_coalescer.sample(pids, count, stats.data(), out.windowMs, out.readTimeNs, out.status);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (out.cpuPercent) {
+                out.cpuPercent[i] = stats[i].cpuPercent;
+            }
+            if (out.cpuTimeSeconds) {
+                out.cpuTimeSeconds[i] = stats[i].cpuTimeSeconds;
+            }
+            if (out.memoryMB) {
+                out.memoryMB[i] = stats[i].memoryMB;
+            }
+        }
+    }
+
+    Snapshot StatsEngine::sampleModules(const ModuleRef* modules, std::size_t count) {
+        Snapshot snapshot;
+        sampleInto(modules, count, snapshot, false, false);
+        return snapshot;
+    }
+
+    void StatsEngine::sampleModules(const ModuleRegistry& registry, RegistrySample& out) {
+        const bool namesCurrent = out.generation == registry.generation();
+        if (!namesCurrent) {
+            trackRegistryPids(out.snapshot, registry.modules());
+        }
+        out.generation = registry.generation();
+        sampleInto(registry.modules().data(), registry.size(), out.snapshot, namesCurrent, true);
+    }
+
+    // previous holds the modules this sample last read, if any. PIDs stay
+    // referenced while any registry sample still reads them; the history of
+    // those no longer read by any is dropped.
+    void StatsEngine::trackRegistryPids(const Snapshot& previous, const std::vector<ModuleRef>& modules) {
+        std::lock_guard<std::mutex> lock(m_samplerMutex);
+        for (const ModuleRef& module : modules) {
+            if (module.pid > 0) {
+                ++m_registryPids[module.pid];
+            }
+        }
+        for (const ModuleSample& module : previous.modules) {
+            auto it = m_registryPids.find(module.pid);
+            if (it != m_registryPids.end() && --it->second == 0) {
+                m_registryPids.erase(it);
+                m_sampler.forget(module.pid);
+            }
+        }
+    }
+
+    // With namesCurrent, out already holds these modules' names and PIDs
+    // from an earlier call, and only the measurements are replaced. Registry
+    // samples leave the CPU history alone; removals from a registry are
+    // tracked by trackRegistryPids() instead.
+    void StatsEngine::sampleInto(const ModuleRef* modules, std::size_t count, Snapshot& out, bool namesCurrent,
+                                 bool fromRegistry) {
+        const int64_t tickStartNs = kSelfStatsEnabled ? monotonicTimeNs() : 0;
+        {
+            // The source may be swapped by setSampleSource() at any time
+            std::lock_guard<std::mutex> lock(m_samplerMutex);
+            out.timestampMs = m_sampler.source().wallTimeMs();
+        }
+        out.batchStartNs = 0;
+        out.batchEndNs = 0;
+
+    #if !(defined(__APPLE__) && TARGET_OS_IPHONE)
+        const bool coalescing = m_coalescingWindowMs.load() > 0;
+
+        // Collect valid processes in a stable order for the sampler
+        thread_local std::vector<int64_t> pids;
+        pids.clear();
+        const std::size_t pidCapacity = pids.capacity();
+        const std::size_t moduleCapacity = out.modules.capacity();
+        uint64_t allocations = 0;
+        if (!namesCurrent) {
+            out.modules.clear();
+            out.modules.reserve(count);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            if (modules[i].pid <= 0) {
+                warn("Invalid PID for module " + std::string(modules[i].name));
+                continue;
+            }
+            if (!namesCurrent) {
+                ModuleSample module;
+                module.name = std::string(modules[i].name);
+                allocations += module.name.size() > std::string().capacity();
+                module.pid = modules[i].pid;
+                out.modules.push_back(std::move(module));
+            }
+            pids.push_back(modules[i].pid);
+        }
+
+        // Read every process, possibly in parallel, as one batch into
+        // per-thread columns. When coalescing, callers within the window
+        // share one tick
+        struct Columns {
+            std::vector<double> cpuPercent, cpuTimeSeconds, memoryMB;
+            std::vector<int64_t> windowMs, readTimeNs;
+            std::vector<ModuleStatus> status;
+        };
+        thread_local Columns columns;
+        const std::size_t columnCapacity = columns.cpuPercent.capacity();
+        columns.cpuPercent.resize(pids.size());
+        columns.cpuTimeSeconds.resize(pids.size());
+        columns.memoryMB.resize(pids.size());
+        columns.windowMs.resize(pids.size());
+        columns.readTimeNs.resize(pids.size());
+        columns.status.resize(pids.size());
+        const ProcessStatsColumns columnsOut{columns.cpuPercent.data(), columns.cpuTimeSeconds.data(),
+                                             columns.memoryMB.data(), columns.windowMs.data(),
+                                             columns.readTimeNs.data(), columns.status.data()};
+        if (coalescing) {
+            sampleCoalesced(pids.data(), pids.size(), columnsOut);
+        } else {
+            std::lock_guard<std::mutex> lock(m_samplerMutex);
+            if (!fromRegistry) {
+                // Forget processes that are no longer monitored, here or
+                // by a registry
+                thread_local std::vector<int64_t> retained;
+                retained.assign(pids.begin(), pids.end());
+                for (const auto& registered : m_registryPids) {
+                    retained.push_back(registered.first);
+                }
+                m_sampler.retainOnly(retained.data(), retained.size());
+            }
+            m_sampler.sample(pids.data(), pids.size(), columnsOut);
+            out.batchStartNs = m_sampler.lastBatchTiming().startNs;
+            out.batchEndNs = m_sampler.lastBatchTiming().endNs;
+        }
+        // Columns grow together, six buffers at a time
+        allocations += (pids.capacity() != pidCapacity) + (out.modules.capacity() != moduleCapacity)
+            + 6 * (columns.cpuPercent.capacity() != columnCapacity);
+        m_sampler.selfStats().addAllocations(allocations);
+        const std::vector<int64_t>& readTimes = columns.readTimeNs;
+        for (std::size_t i = 0; i < pids.size(); ++i) {
+            out.modules[i].stats = {columns.cpuPercent[i], columns.cpuTimeSeconds[i], columns.memoryMB[i]};
+            out.modules[i].windowMs = columns.windowMs[i];
+            out.modules[i].readTimeNs = readTimes[i];
+            out.modules[i].status = columns.status[i];
+        }
+
+        // Coalesced results may come from several ticks: bound their read times
+        if (coalescing && !readTimes.empty()) {
+            auto bounds = std::minmax_element(readTimes.begin(), readTimes.end());
+            out.batchStartNs = *bounds.first;
+            out.batchEndNs = *bounds.second;
+        }
+    #endif
+
+        publish(out);
+        if (kSelfStatsEnabled) {
+            m_sampler.selfStats().noteTickNs(monotonicTimeNs() - tickStartNs);
+        }
+    }
+
+    void StatsEngine::publish(Snapshot& snapshot) {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        snapshot.sequence = ++m_sequence;
+        snapshot.hasSelfStats = m_selfStatsReporting.load(std::memory_order_relaxed);
+        if (snapshot.hasSelfStats) {
+            snapshot.selfStats = m_sampler.selfStats().load();
+        }
+        m_publisher.publish(snapshot);
+        if (m_shmPublisher && !m_shmPublisher->publish(snapshot)) {
+            warn("Snapshot does not fit a shared memory slot of " + std::to_string(m_shmPublisher->slotSize())
+                 + " bytes");
+        }
+        if (m_recorder) {
+            m_recorder->record(snapshot);
+        }
+    }
+
+    void StatsEngine::writeModuleStatsDelta(const ModuleRef* modules, std::size_t count, uint64_t sinceSequence,
+                                            JsonWriter& writer) {
+        Snapshot snapshot = sampleModules(modules, count);
+
+        // Written from the tracker's latest state, which another caller may
+        // have moved past our own snapshot; "sequence" says which
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        if (snapshot.sequence > m_deltaFedSequence) {
+            m_deltaFedSequence = snapshot.sequence;
+            snapshot.sequence = ++m_deltaSequence;
+            m_deltaTracker.update(snapshot);
+        }
+        SerializeTimer timer(m_sampler.selfStats());
+        writer.setPrecision(jsonPrecision());
+        m_deltaTracker.writeJson(writer, sinceSequence);
+    }
+
+    void StatsEngine::setDeltaOptions(const DeltaOptions& options) {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        m_deltaTracker.setOptions(options);
+    }
+
+    bool StatsEngine::setSharedMemoryPublisher(std::string_view name) {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        m_shmPublisher.reset();
+        if (name.empty()) {
+            return true;
+        }
+        m_shmPublisher = ShmSnapshotPublisher::create(std::string(name));
+        if (!m_shmPublisher) {
+            const int error = errno;
+            warn(describe("Failed to create shared memory segment", name, error));
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    bool StatsEngine::setRecordingFile(std::string_view path) {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        // Closing writes out the partial block and releases the file lock
+        m_recorder.reset();
+        if (path.empty()) {
+            return true;
+        }
+        m_recorder = SnapshotRecorder::open(std::string(path));
+        if (!m_recorder) {
+            const int error = errno;
+            warn(describe("Failed to open recording", path, error));
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    bool StatsEngine::setRecordingDirectory(std::string_view directory) {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        m_recorder.reset();
+        if (directory.empty()) {
+            return true;
+        }
+        m_recorder = SnapshotRecorder::openDirectory(std::string(directory));
+        if (!m_recorder) {
+            const int error = errno;
+            warn(describe("Failed to open recording directory", directory, error));
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    #ifdef PROCESS_STATS_HAVE_EXPORTER
+    bool StatsEngine::startExporter(std::string_view unixSocketPath, int tcpPort) {
+        std::lock_guard<std::mutex> lock(m_exporterMutex);
+        if (!m_exporter) {
+            m_exporter = std::make_unique<SnapshotExporter>(m_publisher, &m_sampler.selfStats());
+        }
+        ExporterOptions options;
+        options.unixSocketPath = std::string(unixSocketPath);
+        options.tcpPort = tcpPort;
+        options.jsonPrecision = jsonPrecision();
+        if (!m_exporter->start(options)) {
+            const int error = errno;
+            warn(describe("Failed to start exporter on", std::string(unixSocketPath) + " port "
+                          + std::to_string(tcpPort), error));
+            errno = error;
+            return false;
+        }
+        return true;
+    }
+
+    void StatsEngine::stopExporter() {
+        std::lock_guard<std::mutex> lock(m_exporterMutex);
+        if (m_exporter) {
+            m_exporter->stop();
+        }
+    }
+
+    uint16_t StatsEngine::exporterPort() {
+        std::lock_guard<std::mutex> lock(m_exporterMutex);
+        return m_exporter ? m_exporter->tcpPort() : 0;
+    }
+    #else
+    bool StatsEngine::startExporter(std::string_view, int) {
+        warn("The snapshot exporter is only available on Linux");
+        errno = ENOTSUP;
+        return false;
+    }
+
+    void StatsEngine::stopExporter() {}
+
+    uint16_t StatsEngine::exporterPort() {
+        return 0;
+    }
+    #endif
+
+}
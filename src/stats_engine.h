@@ -0,0 +1,175 @@
+#ifndef PROCESS_STATS_STATS_ENGINE_H
+#define PROCESS_STATS_STATS_ENGINE_H
+
+#include "coalescing_sampler.h"
+#include "json_writer.h"
+#include "module_registry.h"
+#include "sample_source.h"
+#include "sampler.h"
+#include "self_stats.h"
+#include "snapshot.h"
+#include "snapshot_delta.h"
+#include "snapshot_publisher.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ProcessStats {
+    class ShmSnapshotPublisher;
+    class SnapshotExporter;
+    class SnapshotRecorder;
+
+    // Reusable result of sampling a ModuleRegistry
+    struct RegistrySample {
+        Snapshot snapshot;              // modules in registry order
+        uint64_t generation = 0;        // registry generation the names are from
+    };
+
+    // The sampling engine behind process_stats.h, in standard C++17
+    //
+    // Samples named modules into Snapshots and hands every snapshot to the
+    // sinks that are switched on: latestSnapshot() for readers in the
+    // process, a shared-memory ring, a recording, delta output and the
+    // local exporter. Sinks are created only when enabled, so an engine that
+    // only samples costs a Sampler and its CPU history. The Qt functions
+    // forward to one engine of their own; other programs create theirs.
+    //
+    // Sampling calls may run concurrently from any thread: without a
+    // coalescing window they take turns on the sampler, with one, callers
+    // within the window share a tick. Changing the window is meant for
+    // setup; the other calls are safe at any time.
+    class StatsEngine {
+    public:
+        using WarningHandler = std::function<void(std::string_view message)>;
+
+        // Warnings (invalid PIDs, sinks that fail) go to warn, or to stderr
+        explicit StatsEngine(SamplerOptions options = SamplerOptions(), WarningHandler warn = WarningHandler());
+        ~StatsEngine();
+
+        StatsEngine(const StatsEngine&) = delete;
+        StatsEngine& operator=(const StatsEngine&) = delete;
+
+        // Stats of one process; invalid PIDs yield zeroed stats, with the
+        // reason in status if given
+        ProcessStatsData sampleProcess(int64_t pid, ModuleStatus* status = nullptr);
+
+        // Stats of count processes in one batch; see Sampler::sample()
+        void sampleBatch(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out);
+
+        // Sample count modules and publish the snapshot to every sink.
+        // Modules with invalid PIDs are skipped with a warning; CPU history
+        // of PIDs neither passed nor read by a registry sample is dropped
+        // unless coalescing.
+        Snapshot sampleModules(const ModuleRef* modules, std::size_t count);
+        Snapshot sampleModules(const std::vector<ModuleRef>& modules) {
+            return sampleModules(modules.data(), modules.size());
+        }
+
+        // Sample every module of registry into out and publish it. out keeps
+        // its storage between calls, and names are copied into it only when
+        // the registry changed since it was last filled, so ticks over a
+        // steady module set do no string work. Only the CPU history of PIDs
+        // that left the registry is dropped.
+        void sampleModules(const ModuleRegistry& registry, RegistrySample& out);
+
+        // sampleModules(), then write what changed since sinceSequence; see
+        // getModuleStatsDelta() for the document
+        void writeModuleStatsDelta(const ModuleRef* modules, std::size_t count, uint64_t sinceSequence,
+                                   JsonWriter& writer);
+        void setDeltaOptions(const DeltaOptions& options);
+
+        // Latest snapshot; readers on any thread never block the sampler
+        const SnapshotPublisher<Snapshot>& latestSnapshot() const { return m_publisher; }
+
+        // Sinks; an empty name or path switches one off. Each returns false,
+        // with a warning and errno set, if it could not be set up.
+        bool setSharedMemoryPublisher(std::string_view name);
+        bool setRecordingFile(std::string_view path);
+        bool setRecordingDirectory(std::string_view directory);
+
+        // Local exporter over HTTP (Linux only); see SnapshotExporter
+        bool startExporter(std::string_view unixSocketPath, int tcpPort = -1);
+        void stopExporter();
+        uint16_t exporterPort();
+
+        // The engine's own cost since it was created or last reset; all zero
+        // when compiled out with PROCESS_STATS_SELF_STATS=0
+        SelfStats selfStats() const { return m_sampler.selfStats().load(); }
+        void resetSelfStats() { m_sampler.selfStats().reset(); }
+
+        // Counters that code rendering this engine's snapshots adds its time
+        // to, with a SerializeTimer
+        SelfStatsCounters& selfStatsCounters() { return m_sampler.selfStats(); }
+
+        // Attach selfStats() to every snapshot from now on, so each output
+        // carries a __process_stats__ entry; off by default
+        void setSelfStatsReporting(bool enabled) { m_selfStatsReporting.store(enabled && kSelfStatsEnabled); }
+        bool selfStatsReporting() const { return m_selfStatsReporting.load(); }
+
+        // Significant digits for the JSON of writeModuleStatsDelta() and the
+        // exporter (from its next start), and for callers that render this
+        // engine's snapshots to apply; 0 or less means shortest round-trip
+        void setJsonPrecision(int significantDigits) {
+            m_jsonPrecision.store(significantDigits > 0 ? significantDigits : JsonWriter::kShortestPrecision);
+        }
+        int jsonPrecision() const { return m_jsonPrecision.load(); }
+
+        void setSamplingThreads(int workers);
+        void setAlignedBatchTimestamps(bool enabled);
+        void setCoalescingWindow(int milliseconds);
+        void setSampleSource(std::shared_ptr<SampleSource> source);
+        void clearHistory();
+
+    private:
+        void warn(std::string_view message) const;
+        void sampleInto(const ModuleRef* modules, std::size_t count, Snapshot& out, bool namesCurrent,
+                        bool fromRegistry);
+        void trackRegistryPids(const Snapshot& previous, const std::vector<ModuleRef>& modules);
+        void publish(Snapshot& snapshot);
+        void sampleCoalesced(const int64_t* pids, std::size_t count, const ProcessStatsColumns& out);
+
+        WarningHandler m_warn;
+
+        // Guards the sampler: its history, negative cache, source and
+        // workers. Coalescer ticks take it too.
+        std::mutex m_samplerMutex;
+        Sampler m_sampler;
+
+        // Registry samples reading each PID; their CPU history survives
+        // sampleModules() calls for other module sets
+        std::unordered_map<int64_t, uint32_t> m_registryPids;
+
+        // Single-flight front used while a coalescing window is set
+        CoalescingSampler m_coalescer;
+        std::atomic<int> m_coalescingWindowMs{0};
+
+        // Concurrent samplers serialize on the publish mutex, which guards
+        // the sequence and every sink below; readers never take it
+        SnapshotPublisher<Snapshot> m_publisher;
+        std::mutex m_publishMutex;
+        uint64_t m_sequence = 0;
+        std::unique_ptr<ShmSnapshotPublisher> m_shmPublisher;
+        std::unique_ptr<SnapshotRecorder> m_recorder;
+
+        std::atomic<bool> m_selfStatsReporting{false};
+        std::atomic<int> m_jsonPrecision{JsonWriter::kShortestPrecision};
+
+        // Fed only by writeModuleStatsDelta(), numbering its snapshots with
+        // a sequence of its own, so modules sampled by other calls neither
+        // show up as added and removed nor skip its resync snapshots
+        DeltaTracker m_deltaTracker;
+        uint64_t m_deltaSequence = 0;
+        uint64_t m_deltaFedSequence = 0;   // engine sequence of the last snapshot fed
+
+        std::mutex m_exporterMutex;
+        std::unique_ptr<SnapshotExporter> m_exporter;
+    };
+}
+
+#endif // PROCESS_STATS_STATS_ENGINE_H
@@ -0,0 +1,307 @@
+#include "timeseries_store.h"
+#include "recording_format.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+    bool isSegmentName(const char* name) {
+        const std::size_t length = std::strlen(name);
+        return length > 13 && std::strncmp(name, "segment-", 8) == 0
+            && std::strcmp(name + length - 5, ".psrc") == 0;
+    }
+
+    bool hasBit(const std::vector<uint64_t>& bitmap, uint32_t bit) {
+        const std::size_t word = bit / 64;
+        return word < bitmap.size() && (bitmap[word] >> (bit % 64) & 1u);
+    }
+
+    void setBit(std::vector<uint64_t>& bitmap, uint32_t bit) {
+        const std::size_t word = bit / 64;
+        if (word >= bitmap.size()) {
+            bitmap.resize(word + 1, 0);
+        }
+        bitmap[word] |= uint64_t(1) << (bit % 64);
+    }
+
+    int64_t bucketStart(int64_t timestampMs, int64_t bucketMs) {
+        const int64_t offset = timestampMs % bucketMs;
+        return timestampMs - (offset < 0 ? offset + bucketMs : offset);
+    }
+}
+
+    std::unique_ptr<TimeSeriesStore> TimeSeriesStore::open(const std::string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return nullptr;
+        }
+        const bool directory = S_ISDIR(info.st_mode);
+        std::unique_ptr<TimeSeriesStore> store(new TimeSeriesStore(directory ? path : std::string()));
+        if (!directory && !store->addSegment(path)) {
+            return nullptr;
+        }
+        if (!store->refresh()) {
+            return nullptr;
+        }
+        return store;
+    }
+
+    TimeSeriesStore::TimeSeriesStore(std::string directory)
+        : m_directory(std::move(directory)) {}
+
+    TimeSeriesStore::~TimeSeriesStore() {
+        for (const auto& segment : m_segments) {
+            if (segment->data) {
+                munmap(const_cast<uint8_t*>(segment->data), segment->mapped);
+            }
+            close(segment->fd);
+        }
+    }
+
+    TimeSeriesStore::SegmentInfo TimeSeriesStore::segment(std::size_t index) const {
+        const Segment& segment = *m_segments[index];
+        SegmentInfo info;
+        info.path = segment.path;
+        info.minTimeMs = segment.minTimeMs;
+        info.maxTimeMs = segment.maxTimeMs;
+        info.blockCount = segment.blocks.size();
+        info.sampleCount = segment.sampleCount;
+        for (uint64_t word : segment.modules) {
+            info.moduleCount += static_cast<std::size_t>(__builtin_popcountll(word));
+        }
+        return info;
+    }
+
+    bool TimeSeriesStore::addSegment(const std::string& path) {
+        auto segment = std::make_unique<Segment>();
+        segment->path = path;
+        segment->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (segment->fd < 0) {
+            return false;
+        }
+        Recording::FileHeader header{};
+        if (pread(segment->fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || header.magic != Recording::kFileMagic || header.version != Recording::kVersion
+            || header.headerSize != Recording::kDataOffset || header.blockSize < Recording::kMinBlockSize) {
+            close(segment->fd);
+            errno = EINVAL;
+            return false;
+        }
+        segment->blockSize = header.blockSize;
+        m_segments.push_back(std::move(segment));
+        return true;
+    }
+
+    bool TimeSeriesStore::refresh() {
+        if (!m_directory.empty()) {
+            // Segment names sort in recording order; only newer ones can appear
+            DIR* entries = opendir(m_directory.c_str());
+            if (!entries) {
+                return false;
+            }
+            std::vector<std::string> found;
+            while (dirent* entry = readdir(entries)) {
+                if (isSegmentName(entry->d_name)) {
+                    found.push_back(m_directory + "/" + entry->d_name);
+                }
+            }
+            closedir(entries);
+            std::sort(found.begin(), found.end());
+            for (const std::string& path : found) {
+                if (m_segments.empty() || path > m_segments.back()->path) {
+                    if (!addSegment(path)) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        for (const auto& segment : m_segments) {
+            if (!scan(*segment)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool TimeSeriesStore::scan(Segment& segment) {
+        struct stat info;
+        if (fstat(segment.fd, &info) != 0) {
+            return false;
+        }
+        const std::size_t size = static_cast<std::size_t>(info.st_size);
+        if (size > segment.mapped) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, segment.fd, 0);
+            if (mapping == MAP_FAILED) {
+                return false;
+            }
+            // Queries jump between blocks; read-ahead would mostly be wasted
+            madvise(mapping, size, MADV_RANDOM);
+            if (segment.data) {
+                munmap(const_cast<uint8_t*>(segment.data), segment.mapped);
+            }
+            segment.data = static_cast<const uint8_t*>(mapping);
+            segment.mapped = size;
+        }
+
+        const uint64_t blockSize = segment.blockSize;
+        const uint64_t available = segment.mapped > Recording::kDataOffset
+            ? (segment.mapped - Recording::kDataOffset) / blockSize : 0;
+        for (; segment.scannedBlocks < available; ++segment.scannedBlocks) {
+            const std::size_t offset = Recording::blockOffset(segment.scannedBlocks, segment.blockSize);
+            Recording::BlockHeader header;
+            std::memcpy(&header, segment.data + offset, sizeof(header));
+            if (header.magic != Recording::kBlockMagic || header.usedBytes > blockSize
+                || sizeof(header) + uint64_t(header.seriesCount) * sizeof(Recording::SeriesEntry) > header.usedBytes) {
+                if (segment.scannedBlocks + 1 == available) {
+                    break;  // possibly still being written; look again on the next refresh
+                }
+                continue;
+            }
+
+            Block block;
+            block.minTimeMs = header.minTimeMs;
+            block.maxTimeMs = header.maxTimeMs;
+            block.offset = offset;
+            block.usedBytes = header.usedBytes;
+            block.series.reserve(header.seriesCount);
+            for (uint32_t i = 0; i < header.seriesCount; ++i) {
+                Recording::SeriesEntry entry;
+                std::memcpy(&entry, segment.data + offset + sizeof(header) + i * sizeof(entry), sizeof(entry));
+                if (entry.nameOffset > header.usedBytes || entry.nameLength > header.usedBytes - entry.nameOffset) {
+                    continue;
+                }
+                const uint32_t id = intern(reinterpret_cast<const char*>(segment.data + offset + entry.nameOffset),
+                                           entry.nameLength);
+                block.series.emplace_back(id, i);
+                setBit(segment.modules, id);
+            }
+            std::sort(block.series.begin(), block.series.end());
+
+            if (segment.blocks.empty()) {
+                segment.minTimeMs = header.minTimeMs;
+                segment.maxTimeMs = header.maxTimeMs;
+            } else {
+                // A wall clock stepping back breaks the order queries search by
+                const Block& last = segment.blocks.back();
+                segment.ordered = segment.ordered && header.minTimeMs >= last.minTimeMs
+                    && header.maxTimeMs >= last.maxTimeMs;
+                segment.minTimeMs = std::min(segment.minTimeMs, header.minTimeMs);
+                segment.maxTimeMs = std::max(segment.maxTimeMs, header.maxTimeMs);
+            }
+            segment.sampleCount += header.sampleCount;
+            segment.blocks.push_back(std::move(block));
+        }
+        return true;
+    }
+
+    uint32_t TimeSeriesStore::intern(const char* name, std::size_t length) {
+        thread_local std::string key;
+        key.assign(name, length);
+        auto it = m_moduleIds.find(key);
+        if (it != m_moduleIds.end()) {
+            return it->second;
+        }
+        const uint32_t id = static_cast<uint32_t>(m_moduleNames.size());
+        m_moduleIds.emplace(key, id);
+        m_moduleNames.push_back(key);
+        return id;
+    }
+
+    template<typename Visit>
+    void TimeSeriesStore::forEachSeries(const std::string& module, int64_t fromMs, int64_t toMs, Visit&& visit) const {
+        auto it = m_moduleIds.find(module);
+        if (it == m_moduleIds.end() || fromMs >= toMs) {
+            return;
+        }
+        const uint32_t id = it->second;
+        for (const auto& segment : m_segments) {
+            if (segment->blocks.empty() || segment->maxTimeMs < fromMs || segment->minTimeMs >= toMs
+                || !hasBit(segment->modules, id)) {
+                continue;
+            }
+            // In an ordered segment, start at the first block ending at or
+            // after fromMs and stop at the first starting at or after toMs
+            auto first = segment->blocks.begin();
+            if (segment->ordered) {
+                first = std::partition_point(segment->blocks.begin(), segment->blocks.end(),
+                                             [fromMs](const Block& block) { return block.maxTimeMs < fromMs; });
+            }
+            for (auto next = first; next != segment->blocks.end(); ++next) {
+                const Block& block = *next;
+                if (block.minTimeMs >= toMs) {
+                    if (segment->ordered) {
+                        break;
+                    }
+                    continue;
+                }
+                if (block.maxTimeMs < fromMs) {
+                    continue;
+                }
+                auto range = std::equal_range(block.series.begin(), block.series.end(), std::make_pair(id, 0u),
+                                              [](const auto& a, const auto& b) { return a.first < b.first; });
+                if (range.first == range.second) {
+                    continue;
+                }
+                ++m_blocksDecoded;
+                for (auto entry = range.first; entry != range.second; ++entry) {
+                    visit(*segment, block, entry->second);
+                }
+            }
+        }
+    }
+
+    std::size_t TimeSeriesStore::query(const std::string& module, int64_t fromMs, int64_t toMs,
+                                       std::vector<RecordedSample>& out) const {
+        const std::size_t before = out.size();
+        forEachSeries(module, fromMs, toMs, [&](const Segment& segment, const Block& block, uint32_t entry) {
+            decodeRecordingSeries(segment.data + block.offset, block.usedBytes, entry, fromMs, toMs, out);
+        });
+        return out.size() - before;
+    }
+
+    bool TimeSeriesStore::readBlock(std::size_t segment, std::size_t index, std::vector<RecordedSeries>& out) const {
+        const Segment& owner = *m_segments[segment];
+        const Block& block = owner.blocks[index];
+        return decodeRecordingBlock(owner.data + block.offset, block.usedBytes, out);
+    }
+
+    std::size_t TimeSeriesStore::aggregate(const std::string& module, int64_t fromMs, int64_t toMs, int64_t bucketMs,
+                                           std::vector<AggregatedSample>& out) const {
+        if (bucketMs <= 0) {
+            return 0;
+        }
+        const std::size_t before = out.size();
+        thread_local std::vector<RecordedSample> samples;
+        forEachSeries(module, fromMs, toMs, [&](const Segment& segment, const Block& block, uint32_t entry) {
+            samples.clear();
+            decodeRecordingSeries(segment.data + block.offset, block.usedBytes, entry, fromMs, toMs, samples);
+            for (const RecordedSample& sample : samples) {
+                const int64_t start = bucketStart(sample.timestampMs, bucketMs);
+                if (out.size() == before || out.back().startMs != start) {
+                    out.emplace_back();
+                    out.back().startMs = start;
+                }
+                AggregatedSample& bucket = out.back();
+                ++bucket.count;
+                bucket.cpuPercentMean += (sample.cpuPercent - bucket.cpuPercentMean) / bucket.count;
+                bucket.memoryMBMean += (sample.memoryMB - bucket.memoryMBMean) / bucket.count;
+                if (bucket.count == 1 || sample.cpuPercent > bucket.cpuPercentMax) {
+                    bucket.cpuPercentMax = sample.cpuPercent;
+                }
+                if (bucket.count == 1 || sample.memoryMB > bucket.memoryMBMax) {
+                    bucket.memoryMBMax = sample.memoryMB;
+                }
+            }
+        });
+        return out.size() - before;
+    }
+
+}
@@ -0,0 +1,124 @@
+#ifndef PROCESS_STATS_TIMESERIES_STORE_H
+#define PROCESS_STATS_TIMESERIES_STORE_H
+
+#include "recording_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ProcessStats {
+    // Samples of one module summarized over a time bucket
+    struct AggregatedSample {
+        int64_t startMs = 0;          // bucket start, a multiple of the bucket width
+        uint32_t count = 0;
+        double cpuPercentMean = 0.0;
+        double cpuPercentMax = 0.0;
+        double memoryMBMean = 0.0;
+        double memoryMBMax = 0.0;
+    };
+
+    // Range queries over recordings, read through mmap
+    //
+    // Opens a single recording file or a directory of segments written by
+    // SnapshotRecorder::openDirectory(). Opening reads only block headers and
+    // series directories to index every segment and block by time range and
+    // module set (a bitmap over interned module ids per segment, sorted
+    // module ids per block). A query skips segments and blocks outside the
+    // range or without the module and decodes just that module's series in
+    // the blocks that remain. refresh() indexes what was recorded since.
+    //
+    // Not thread-safe; use one store per thread.
+    class TimeSeriesStore {
+    public:
+        struct SegmentInfo {
+            std::string path;
+            int64_t minTimeMs = 0;
+            int64_t maxTimeMs = 0;
+            uint64_t blockCount = 0;
+            uint64_t sampleCount = 0;
+            std::size_t moduleCount = 0;
+        };
+
+        // Returns nullptr and leaves errno set on failure (EINVAL if a file
+        // is not a recording)
+        static std::unique_ptr<TimeSeriesStore> open(const std::string& path);
+        ~TimeSeriesStore();
+
+        TimeSeriesStore(const TimeSeriesStore&) = delete;
+        TimeSeriesStore& operator=(const TimeSeriesStore&) = delete;
+
+        // Index blocks and segments added since the last call; false if a
+        // segment could not be read
+        bool refresh();
+
+        std::size_t segmentCount() const { return m_segments.size(); }
+        SegmentInfo segment(std::size_t index) const;
+
+        // Every module seen, in order of first appearance
+        const std::vector<std::string>& modules() const { return m_moduleNames; }
+
+        // Append module's samples with fromMs <= timestampMs < toMs, in
+        // recording order; returns the number appended
+        std::size_t query(const std::string& module, int64_t fromMs, int64_t toMs,
+                          std::vector<RecordedSample>& out) const;
+
+        // Append one aggregate per non-empty bucketMs-wide bucket of the same
+        // range; returns the number appended
+        std::size_t aggregate(const std::string& module, int64_t fromMs, int64_t toMs, int64_t bucketMs,
+                              std::vector<AggregatedSample>& out) const;
+
+        // Append every series of a segment's index-th block (below
+        // segment(s).blockCount), for reading a recording start to end
+        bool readBlock(std::size_t segment, std::size_t index, std::vector<RecordedSeries>& out) const;
+
+        // Blocks decoded by queries so far, for checking that queries seek
+        uint64_t blocksDecoded() const { return m_blocksDecoded; }
+
+    private:
+        struct Block {
+            int64_t minTimeMs = 0;
+            int64_t maxTimeMs = 0;
+            std::size_t offset = 0;       // in the segment mapping
+            uint32_t usedBytes = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> series;   // (module id, series entry), by module id
+        };
+
+        struct Segment {
+            std::string path;
+            int fd = -1;
+            const uint8_t* data = nullptr;
+            std::size_t mapped = 0;
+            uint32_t blockSize = 0;
+            uint64_t scannedBlocks = 0;
+            int64_t minTimeMs = 0;
+            int64_t maxTimeMs = 0;
+            uint64_t sampleCount = 0;
+            std::vector<uint64_t> modules;   // bitmap over module ids
+            std::vector<Block> blocks;
+            bool ordered = true;             // block min and max times never decrease
+        };
+
+        explicit TimeSeriesStore(std::string directory);
+
+        bool addSegment(const std::string& path);
+        bool scan(Segment& segment);
+        uint32_t intern(const char* name, std::size_t length);
+
+        // Calls visit(segment, block, entry) for every series of module
+        // overlapping [fromMs, toMs)
+        template<typename Visit>
+        void forEachSeries(const std::string& module, int64_t fromMs, int64_t toMs, Visit&& visit) const;
+
+        std::string m_directory;    // empty when a single file is open
+        std::vector<std::unique_ptr<Segment>> m_segments;
+        std::unordered_map<std::string, uint32_t> m_moduleIds;
+        std::vector<std::string> m_moduleNames;
+        mutable uint64_t m_blocksDecoded = 0;
+    };
+}
+
+#endif // PROCESS_STATS_TIMESERIES_STORE_H
@@ -0,0 +1,126 @@
+#ifndef PROCESS_STATS_TYPED_SAMPLER_H
+#define PROCESS_STATS_TYPED_SAMPLER_H
+
+#include "proc_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+namespace ProcessStats {
+    // Metrics a TypedSampler reads, combined with |
+    using MetricSet = unsigned;
+    namespace Metrics {
+        constexpr MetricSet Cpu = 1u << 0;   // CPU time and percentage (/proc/[pid]/stat)
+        constexpr MetricSet Rss = 1u << 1;   // resident memory (/proc/[pid]/statm)
+        constexpr MetricSet All = Cpu | Rss;
+    }
+
+    // A sampler whose metrics are fixed at compile time
+    //
+    // Only the files behind the selected metrics are read and parsed, and
+    // Reading has fields for those metrics alone: a memory-only watchdog,
+    // TypedSampler<Metrics::Rss>, does one small statm read per PID and
+    // keeps no state, while Metrics::Cpu adds the stat read and the CPU
+    // history that percentages are derived from. Reads always go to the OS;
+    // the runtime-configured Sampler remains the one that takes a
+    // SampleSource, read workers and batch alignment.
+    //
+    // A TypedSampler is not safe for concurrent use.
+    template <MetricSet M>
+    class TypedSampler {
+        static_assert(M != 0 && (M & ~Metrics::All) == 0, "TypedSampler needs a set of known metrics");
+
+        static constexpr bool kCpu = (M & Metrics::Cpu) != 0;
+        static constexpr bool kRss = (M & Metrics::Rss) != 0;
+
+        struct NoCpu {};
+        struct CpuFields {
+            double cpuPercent = 0.0;
+            double cpuTimeSeconds = 0.0;
+            int64_t windowMs = 0;   // time cpuPercent was measured over, 0 on a first reading
+        };
+        struct NoRss {};
+        struct RssFields {
+            double memoryMB = 0.0;
+        };
+
+        struct CpuBaseline {
+            double cpuTimeSeconds;
+            int64_t timeNs;
+        };
+        struct NoHistory {};
+
+    public:
+        static constexpr MetricSet metrics = M;
+
+        // One process's statistics, with members for the selected metrics only
+        struct Reading : std::conditional_t<kCpu, CpuFields, NoCpu>, std::conditional_t<kRss, RssFields, NoRss> {
+            bool valid = false;   // false if the process could not be read
+        };
+
+        // Sample a single process; invalid PIDs yield a zeroed, invalid reading
+        Reading sample(int64_t pid) {
+            Reading reading;
+            if constexpr (kCpu) {
+                if (readCpuTimeSeconds(pid, reading.cpuTimeSeconds)) {
+                    reading.valid = true;
+                    updateCpu(pid, reading, monotonicTimeNs());
+                }
+            }
+            if constexpr (kRss) {
+                reading.valid = readResidentMB(pid, reading.memoryMB) || reading.valid;
+            }
+            return reading;
+        }
+
+        // Sample count processes into out, which holds count readings
+        void sample(const int64_t* pids, std::size_t count, Reading* out) {
+            for (std::size_t i = 0; i < count; ++i) {
+                out[i] = sample(pids[i]);
+            }
+        }
+
+        // Drop the CPU history of pid, or of every process
+        void forget(int64_t pid) {
+            if constexpr (kCpu) {
+                m_history.erase(pid);
+            }
+        }
+        void clearHistory() {
+            if constexpr (kCpu) {
+                m_history.clear();
+            }
+        }
+
+        // Processes with CPU history; always 0 without Metrics::Cpu
+        std::size_t historySize() const {
+            if constexpr (kCpu) {
+                return m_history.size();
+            } else {
+                return 0;
+            }
+        }
+
+    private:
+        // Percentage against the previous reading of pid, which is then
+        // replaced, as Sampler derives it
+        void updateCpu(int64_t pid, Reading& reading, int64_t timeNs) {
+            auto entry = m_history.try_emplace(pid, CpuBaseline{reading.cpuTimeSeconds, timeNs});
+            if (entry.second) {
+                return;
+            }
+            CpuBaseline& previous = entry.first->second;
+            const int64_t elapsedNs = timeNs - previous.timeNs;
+            if (elapsedNs > 0) {
+                reading.cpuPercent = (reading.cpuTimeSeconds - previous.cpuTimeSeconds) / (elapsedNs / 1e9) * 100.0;
+                reading.windowMs = elapsedNs / 1000000;
+            }
+            previous = CpuBaseline{reading.cpuTimeSeconds, timeNs};
+        }
+
+        std::conditional_t<kCpu, std::unordered_map<int64_t, CpuBaseline>, NoHistory> m_history;
+    };
+}
+
+#endif // PROCESS_STATS_TYPED_SAMPLER_H
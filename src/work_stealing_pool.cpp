@@ -0,0 +1,154 @@
+#include "work_stealing_pool.h"
+#include <algorithm>
+
+namespace ProcessStats {
+
+namespace {
+    inline uint64_t packRange(uint32_t front, uint32_t back) {
+        return (static_cast<uint64_t>(front) << 32) | back;
+    }
+
+    inline uint32_t rangeFront(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+    inline uint32_t rangeBack(uint64_t range) { return static_cast<uint32_t>(range); }
+}
+
+    WorkStealingPool::WorkStealingPool(std::size_t workerCount)
+        : m_queues(std::max<std::size_t>(workerCount, 1)) {
+        m_threads.reserve(m_queues.size() - 1);
+        for (std::size_t worker = 1; worker < m_queues.size(); ++worker) {
+            m_threads.emplace_back(&WorkStealingPool::workerLoop, this, worker);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void WorkStealingPool::parallelFor(std::size_t count, std::size_t chunkSize, const RangeFunction& body) {
+        if (count == 0) {
+            return;
+        }
+        chunkSize = std::max<std::size_t>(chunkSize, 1);
+        const std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+        // Nothing to share: skip the handoff entirely
+        if (m_threads.empty() || chunkCount == 1) {
+            for (std::size_t begin = 0; begin < count; begin += chunkSize) {
+                body(begin, std::min(begin + chunkSize, count));
+            }
+            return;
+        }
+
+        // Deal contiguous runs of chunks to the workers so neighbouring
+        // indices are handled by the same thread unless stolen
+        const std::size_t workers = m_queues.size();
+        for (std::size_t worker = 0; worker < workers; ++worker) {
+            uint32_t front = static_cast<uint32_t>(chunkCount * worker / workers);
+            uint32_t back = static_cast<uint32_t>(chunkCount * (worker + 1) / workers);
+            m_queues[worker].range.store(packRange(front, back), std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_body = &body;
+            m_count = count;
+            m_chunkSize = chunkSize;
+            m_busyWorkers = m_threads.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        runChunks(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_busyWorkers == 0; });
+        m_body = nullptr;
+    }
+
+    void WorkStealingPool::workerLoop(std::size_t worker) {
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_stopping || m_generation != seenGeneration; });
+                if (m_stopping) {
+                    return;
+                }
+                seenGeneration = m_generation;
+            }
+
+            runChunks(worker);
+
+            bool last = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                last = --m_busyWorkers == 0;
+            }
+            if (last) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    void WorkStealingPool::runChunks(std::size_t worker) {
+        uint32_t chunk = 0;
+        while (popFront(worker, chunk)) {
+            runChunk(chunk);
+        }
+
+        // Own run exhausted: steal from the others, starting with the neighbour
+        const std::size_t workers = m_queues.size();
+        for (std::size_t offset = 1; offset < workers; ++offset) {
+            std::size_t victim = (worker + offset) % workers;
+            while (stealBack(victim, chunk)) {
+                runChunk(chunk);
+            }
+        }
+    }
+
+    bool WorkStealingPool::popFront(std::size_t worker, uint32_t& chunk) {
+        std::atomic<uint64_t>& range = m_queues[worker].range;
+        uint64_t current = range.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t front = rangeFront(current);
+            uint32_t back = rangeBack(current);
+            if (front >= back) {
+                return false;
+            }
+            if (range.compare_exchange_weak(current, packRange(front + 1, back), std::memory_order_acq_rel)) {
+                chunk = front;
+                return true;
+            }
+        }
+    }
+
+    bool WorkStealingPool::stealBack(std::size_t victim, uint32_t& chunk) {
+        std::atomic<uint64_t>& range = m_queues[victim].range;
+        uint64_t current = range.load(std::memory_order_acquire);
+        for (;;) {
+            uint32_t front = rangeFront(current);
+            uint32_t back = rangeBack(current);
+            if (front >= back) {
+                return false;
+            }
+            if (range.compare_exchange_weak(current, packRange(front, back - 1), std::memory_order_acq_rel)) {
+                chunk = back - 1;
+                return true;
+            }
+        }
+    }
+
+    void WorkStealingPool::runChunk(uint32_t chunk) {
+        std::size_t begin = static_cast<std::size_t>(chunk) * m_chunkSize;
+        std::size_t end = std::min(begin + m_chunkSize, m_count);
+        (*m_body)(begin, end);
+    }
+
+}
@@ -0,0 +1,69 @@
+#ifndef PROCESS_STATS_WORK_STEALING_POOL_H
+#define PROCESS_STATS_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ProcessStats {
+    // Small fixed-size thread pool that runs one parallel loop at a time
+    //
+    // parallelFor() splits [0, count) into chunks and hands each worker a
+    // contiguous run of chunks. A worker takes chunks from the front of its own
+    // run and, once empty, steals from the back of the other runs. Workers are
+    // not pinned to CPUs or NUMA nodes. The calling thread acts as worker 0, so
+    // a pool of one worker runs everything inline without starting a thread.
+    class WorkStealingPool {
+    public:
+        // Body of a parallel loop; called with a half-open index range
+        using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+        explicit WorkStealingPool(std::size_t workerCount = 1);
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // Run body over [0, count) in chunks of at most chunkSize indices and
+        // return once every chunk has completed. Not reentrant.
+        void parallelFor(std::size_t count, std::size_t chunkSize, const RangeFunction& body);
+
+        std::size_t workerCount() const { return m_queues.size(); }
+
+    private:
+        // Per-worker run of chunk indices packed as (front << 32 | back) so the
+        // owner and thieves can both claim a chunk with a single CAS
+        struct alignas(64) ChunkQueue {
+            std::atomic<uint64_t> range{0};
+        };
+
+        void workerLoop(std::size_t worker);
+        void runChunks(std::size_t worker);
+        bool popFront(std::size_t worker, uint32_t& chunk);
+        bool stealBack(std::size_t victim, uint32_t& chunk);
+        void runChunk(uint32_t chunk);
+
+        std::vector<ChunkQueue> m_queues;
+        std::vector<std::thread> m_threads;
+
+        // Current job, written by parallelFor() before waking the workers
+        const RangeFunction* m_body = nullptr;
+        std::size_t m_count = 0;
+        std::size_t m_chunkSize = 1;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        uint64_t m_generation = 0;
+        std::size_t m_busyWorkers = 0;
+        bool m_stopping = false;
+    };
+}
+
+#endif // PROCESS_STATS_WORK_STEALING_POOL_H
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include "adaptive_scheduler.h"
+#include "sampler.h"
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+
+using ProcessStats::AdaptiveIntervalOptions;
+using ProcessStats::AdaptiveScheduler;
+using ProcessStats::ModuleSample;
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Sampler;
+using std::chrono::milliseconds;
+
+// =============================================================================
+// AdaptiveScheduler::nextInterval Tests
+// =============================================================================
+
+// Verifies that a module with fast-changing CPU gets a shorter interval
+TEST(AdaptiveSchedulerTest, NextIntervalShrinksWhenCpuChanges) {
+    AdaptiveIntervalOptions options;
+    ProcessStatsData previous = {1.0, 10.0, 100.0};
+    ProcessStatsData current = {40.0, 11.0, 100.0};
+
+    EXPECT_EQ(AdaptiveScheduler::nextInterval(previous, current, milliseconds(1000), options), milliseconds(500));
+}
+
+// Verifies that a module with fast-changing memory gets a shorter interval
+TEST(AdaptiveSchedulerTest, NextIntervalShrinksWhenMemoryChanges) {
+    AdaptiveIntervalOptions options;
+    ProcessStatsData previous = {1.0, 10.0, 100.0};
+    ProcessStatsData current = {1.0, 10.0, 120.0};
+
+    EXPECT_EQ(AdaptiveScheduler::nextInterval(previous, current, milliseconds(1000), options), milliseconds(500));
+}
+
+// Verifies that a stable module gets a longer interval
+TEST(AdaptiveSchedulerTest, NextIntervalGrowsWhenStable) {
+    AdaptiveIntervalOptions options;
+    ProcessStatsData previous = {0.5, 10.0, 100.0};
+    ProcessStatsData current = {0.7, 10.1, 100.5};
+
+    EXPECT_EQ(AdaptiveScheduler::nextInterval(previous, current, milliseconds(1000), options), milliseconds(1500));
+}
+
+// Verifies that intervals stay within the configured bounds
+TEST(AdaptiveSchedulerTest, NextIntervalIsClamped) {
+    AdaptiveIntervalOptions options;
+    options.minInterval = milliseconds(200);
+    options.maxInterval = milliseconds(2000);
+    ProcessStatsData idle = {0.0, 1.0, 50.0};
+    ProcessStatsData busy = {90.0, 2.0, 50.0};
+
+    EXPECT_EQ(AdaptiveScheduler::nextInterval(idle, idle, milliseconds(1800), options), milliseconds(2000));
+    EXPECT_EQ(AdaptiveScheduler::nextInterval(idle, busy, milliseconds(300), options), milliseconds(200));
+}
+
+// =============================================================================
+// AdaptiveScheduler Tests
+// =============================================================================
+
+// Verifies that new modules are due immediately and then wait their interval
+TEST(AdaptiveSchedulerTest, ModulesAreSampledWhenDue) {
+    Sampler sampler;
+    AdaptiveIntervalOptions options;
+    options.initialInterval = milliseconds(1000);
+    AdaptiveScheduler scheduler(sampler, options);
+    const auto start = AdaptiveScheduler::Clock::now();
+
+    scheduler.addModule("self", getpid(), start);
+    scheduler.addModule("parent", getppid(), start);
+    EXPECT_EQ(scheduler.nextDeadline(), start);
+
+    std::vector<ModuleSample> out;
+    EXPECT_EQ(scheduler.sampleDue(start, out), 2u);
+    EXPECT_EQ(out.size(), 2u);
+    EXPECT_EQ(scheduler.nextDeadline(), start + milliseconds(1000));
+
+    out.clear();
+    EXPECT_EQ(scheduler.sampleDue(start + milliseconds(999), out), 0u);
+    EXPECT_EQ(scheduler.sampleDue(start + milliseconds(1000), out), 2u);
+}
+
+// Verifies that modules are sampled in deadline order and only when due
+TEST(AdaptiveSchedulerTest, OnlyDueModulesAreSampled) {
+    Sampler sampler;
+    AdaptiveScheduler scheduler(sampler);
+    const auto start = AdaptiveScheduler::Clock::now();
+
+    scheduler.addModule("early", getpid(), start);
+    scheduler.addModule("late", getppid(), start + milliseconds(5000));
+
+    std::vector<ModuleSample> out;
+    ASSERT_EQ(scheduler.sampleDue(start + milliseconds(10), out), 1u);
+    EXPECT_EQ(out[0].name, "early");
+}
+
+// Verifies that removed modules are never sampled again
+TEST(AdaptiveSchedulerTest, RemovedModulesAreNotSampled) {
+    Sampler sampler;
+    AdaptiveScheduler scheduler(sampler);
+    const auto start = AdaptiveScheduler::Clock::now();
+
+    scheduler.addModule("self", getpid(), start);
+    EXPECT_TRUE(scheduler.removeModule("self"));
+    EXPECT_FALSE(scheduler.removeModule("self"));
+
+    std::vector<ModuleSample> out;
+    EXPECT_EQ(scheduler.sampleDue(start + milliseconds(60000), out), 0u);
+    EXPECT_EQ(scheduler.nextDeadline(), AdaptiveScheduler::Clock::time_point::max());
+    EXPECT_EQ(scheduler.moduleCount(), 0u);
+}
+
+// Verifies that CPU percentages carry the real window they were measured over
+TEST(AdaptiveSchedulerTest, ReportsActualMeasurementWindow) {
+    Sampler sampler;
+    AdaptiveScheduler scheduler(sampler);
+    const auto start = AdaptiveScheduler::Clock::now();
+    scheduler.addModule("self", getpid(), start);
+
+    std::vector<ModuleSample> out;
+    scheduler.sampleDue(start, out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0].windowMs, 0);
+
+    usleep(30000);
+    out.clear();
+    scheduler.sampleDue(start + milliseconds(60000), out);
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_GE(out[0].windowMs, 25);
+    EXPECT_LT(out[0].windowMs, 5000);
+}
+
+// Verifies that a stable module's interval grows up to the maximum
+TEST(AdaptiveSchedulerTest, StableModuleBacksOff) {
+    Sampler sampler;
+    AdaptiveIntervalOptions options;
+    options.initialInterval = milliseconds(1000);
+    options.maxInterval = milliseconds(3000);
+    options.cpuChangePercent = 1000.0;   // nothing counts as changing
+    options.memoryChangeRatio = 1000.0;
+    AdaptiveScheduler scheduler(sampler, options);
+
+    auto now = AdaptiveScheduler::Clock::now();
+    scheduler.addModule("parent", getppid(), now);
+    std::vector<ModuleSample> out;
+    for (int i = 0; i < 6; ++i) {
+        usleep(2000);
+        scheduler.sampleDue(now, out);
+        now = scheduler.nextDeadline();
+    }
+    EXPECT_EQ(scheduler.interval("parent"), milliseconds(3000));
+}
+
+// Verifies that a dead module reports why and is polled at the maximum
+// interval rather than treated as changing
+TEST(AdaptiveSchedulerTest, DeadModuleReportsStatusAndSlowsDown) {
+    using ProcessStats::ModuleStatus;
+    Sampler sampler;
+    AdaptiveIntervalOptions options;
+    options.initialInterval = milliseconds(1000);
+    options.maxInterval = milliseconds(8000);
+    AdaptiveScheduler scheduler(sampler, options);
+
+    auto now = AdaptiveScheduler::Clock::now();
+    scheduler.addModule("self", getpid(), now);
+    scheduler.addModule("dead", 999999999, now);
+    std::vector<ModuleSample> out;
+    for (int i = 0; i < 3; ++i) {
+        out.clear();
+        scheduler.sampleDue(now, out);
+        for (const ModuleSample& sample : out) {
+            if (sample.name == "dead") {
+                EXPECT_EQ(sample.status, ModuleStatus::Exited);
+                EXPECT_EQ(sample.stats.memoryMB, 0.0);
+            } else {
+                EXPECT_EQ(sample.status, ModuleStatus::Ok);
+                EXPECT_GT(sample.readTimeNs, 0);
+            }
+        }
+        EXPECT_EQ(scheduler.interval("dead"), milliseconds(8000));
+        now += milliseconds(8000);
+    }
+}
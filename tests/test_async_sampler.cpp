@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "async_sampler.h"
+#include "stats_engine.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using ProcessStats::AsyncSampler;
+using ProcessStats::ModuleRef;
+using ProcessStats::RawCounters;
+using ProcessStats::SamplerOptions;
+using ProcessStats::SampleSource;
+using ProcessStats::Snapshot;
+using ProcessStats::StatsEngine;
+
+namespace {
+    // Reads block until released, like /proc under heavy load
+    struct GatedSource : SampleSource {
+        std::mutex mutex;
+        std::condition_variable released;
+        bool open = false;
+        std::atomic<int> waiting{0};
+        std::atomic<int> reads{0};
+
+        int64_t nowNs() override { return 1000000000; }
+        int64_t wallTimeMs() override { return 1000; }
+        RawCounters read(int64_t pid) const override {
+            auto* self = const_cast<GatedSource*>(this);
+            std::unique_lock<std::mutex> lock(self->mutex);
+            ++self->waiting;
+            self->released.wait(lock, [self] { return self->open; });
+            ++self->reads;
+            RawCounters counters;
+            counters.memoryMB = static_cast<double>(pid);
+            counters.readTimeNs = 1000000000;
+            counters.valid = true;
+            return counters;
+        }
+
+        void release() {
+            std::lock_guard<std::mutex> lock(mutex);
+            open = true;
+            released.notify_all();
+        }
+    };
+
+    // Collects completions from the worker
+    struct Results {
+        std::mutex mutex;
+        std::condition_variable arrived;
+        std::vector<const Snapshot*> received;   // nullptr entries for cancellations
+        std::deque<Snapshot> snapshots;     // stable addresses
+        std::vector<std::thread::id> threads;
+
+        AsyncSampler::Completion completion() {
+            return [this](const Snapshot* snapshot) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.push_back(snapshot ? &snapshots.emplace_back(*snapshot) : nullptr);
+                threads.push_back(std::this_thread::get_id());
+                arrived.notify_all();
+            };
+        }
+
+        bool waitFor(std::size_t count) {
+            std::unique_lock<std::mutex> lock(mutex);
+            return arrived.wait_for(lock, std::chrono::seconds(5), [&] { return received.size() >= count; });
+        }
+    };
+
+    SamplerOptions withSource(std::shared_ptr<SampleSource> source) {
+        SamplerOptions options;
+        options.source = std::move(source);
+        return options;
+    }
+}
+
+// =============================================================================
+// AsyncSampler Tests
+// =============================================================================
+
+// Verifies that submit() returns while reads are stuck, and that the
+// snapshot arrives later on the worker
+TEST(AsyncSamplerTest, NeverBlocksTheCaller) {
+    auto source = std::make_shared<GatedSource>();
+    StatsEngine engine(withSource(source));
+    AsyncSampler sampler(engine);
+    Results results;
+
+    const std::vector<ModuleRef> modules = {{"a", 10}, {"b", 20}};
+    auto start = std::chrono::steady_clock::now();
+    sampler.submit(modules.data(), modules.size(), results.completion());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+    EXPECT_EQ(sampler.pending(), 1u);
+
+    source->release();
+    ASSERT_TRUE(results.waitFor(1));
+    ASSERT_NE(results.received[0], nullptr);
+    ASSERT_EQ(results.received[0]->modules.size(), 2u);
+    EXPECT_EQ(results.received[0]->modules[1].name, "b");
+    EXPECT_EQ(results.received[0]->modules[1].stats.memoryMB, 20.0);
+    EXPECT_NE(results.threads[0], std::this_thread::get_id());
+    EXPECT_EQ(engine.latestSnapshot().sequence(), 1u);
+}
+
+// Verifies that requests for the same modules queued behind a slow sample
+// share one sample, and that cancelled ones are skipped
+TEST(AsyncSamplerTest, ServesQueuedDuplicatesTogether) {
+    auto source = std::make_shared<GatedSource>();
+    StatsEngine engine(withSource(source));
+    AsyncSampler sampler(engine);
+    Results results;
+
+    const std::vector<ModuleRef> modules = {{"a", 10}};
+    const std::vector<ModuleRef> others = {{"b", 20}};
+    sampler.submit(modules.data(), modules.size(), results.completion());
+    while (source->waiting.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    // Queued while the first sample waits on its read
+    std::atomic<bool> cancelled{true};
+    for (int i = 0; i < 5; ++i) {
+        sampler.submit(modules.data(), modules.size(), results.completion());
+    }
+    sampler.submit(others.data(), others.size(), results.completion(), [&] { return cancelled.load(); });
+    sampler.submit(modules.data(), modules.size(), results.completion(), [&] { return cancelled.load(); });
+    EXPECT_EQ(sampler.pending(), 8u);
+
+    source->release();
+    ASSERT_TRUE(results.waitFor(8));
+    EXPECT_EQ(sampler.sampleCount(), 2u);
+    int skipped = 0;
+    for (const Snapshot* snapshot : results.received) {
+        skipped += snapshot == nullptr;
+    }
+    EXPECT_EQ(skipped, 2);
+    EXPECT_EQ(sampler.pending(), 0u);
+}
+
+// Verifies that shutting down completes queued requests as cancelled
+TEST(AsyncSamplerTest, ShutdownCancelsQueuedRequests) {
+    auto source = std::make_shared<GatedSource>();
+    StatsEngine engine(withSource(source));
+    Results results;
+    std::thread releaser;
+    {
+        AsyncSampler sampler(engine);
+        const std::vector<ModuleRef> first = {{"a", 10}};
+        const std::vector<ModuleRef> second = {{"b", 20}};
+        sampler.submit(first.data(), first.size(), results.completion());
+        while (source->waiting.load() == 0) {
+            std::this_thread::yield();
+        }
+        sampler.submit(second.data(), second.size(), results.completion());
+
+        // Let the running sample finish once shutdown has begun
+        releaser = std::thread([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            source->release();
+        });
+    }
+    releaser.join();
+    ASSERT_EQ(results.received.size(), 2u);
+    EXPECT_NE(results.received[0], nullptr);    // the running one, finished
+    EXPECT_EQ(results.received[1], nullptr);    // the queued one, dropped
+}
+
+// Verifies that synchronous sampling on another thread waits for the
+// worker's sample instead of racing it on the engine's history
+TEST(AsyncSamplerTest, SynchronousCallersTakeTurnsWithWorker) {
+    auto source = std::make_shared<GatedSource>();
+    StatsEngine engine(withSource(source));
+    AsyncSampler sampler(engine);
+    Results results;
+
+    const std::vector<ModuleRef> modules = {{"a", 10}};
+    sampler.submit(modules.data(), modules.size(), results.completion());
+    while (source->waiting.load() == 0) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> done{false};
+    std::thread caller([&] {
+        const std::vector<ModuleRef> others = {{"b", 20}};
+        engine.sampleModules(others);
+        engine.sampleProcess(30);
+        done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(source->waiting.load(), 1);   // still behind the worker's read
+    EXPECT_FALSE(done.load());
+
+    source->release();
+    caller.join();
+    ASSERT_TRUE(results.waitFor(1));
+    EXPECT_EQ(source->reads.load(), 3);
+    EXPECT_EQ(engine.latestSnapshot().sequence(), 2u);
+}
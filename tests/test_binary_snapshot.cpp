@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include "binary_snapshot.h"
+#include "json_writer.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using ProcessStats::BinarySnapshotView;
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleSample;
+using ProcessStats::ModuleStatus;
+using ProcessStats::Snapshot;
+
+namespace {
+    Snapshot makeSnapshot() {
+        Snapshot snapshot;
+        snapshot.sequence = 42;
+        snapshot.timestampMs = 1700000000123;
+        snapshot.batchStartNs = 5000000;
+        snapshot.batchEndNs = 5250000;
+
+        const char* names[] = {"chat", "wallet", "caf\xc3\xa9 \"q\"", "chat", ""};
+        for (int i = 0; i < 5; ++i) {
+            ModuleSample module;
+            module.name = names[i];
+            module.pid = 1000 + i;
+            module.stats = {i * 12.5 + 0.1, i * 3.3, 40.0 + i / 3.0};
+            module.windowMs = 1000 + i;
+            module.readTimeNs = snapshot.batchStartNs + i * 50000;
+            module.status = static_cast<ModuleStatus>(i % 4);
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    std::string toJson(const Snapshot& snapshot) {
+        JsonWriter writer;
+        writeModuleStatsBatchJson(writer, snapshot);
+        return writer.buffer();
+    }
+}
+
+// =============================================================================
+// Binary Snapshot Tests
+// =============================================================================
+
+// Verifies that encode -> decode produces the same JSON as the original snapshot
+TEST(BinarySnapshotTest, RoundTripMatchesJson) {
+    const Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+
+    Snapshot decoded;
+    ASSERT_TRUE(ProcessStats::decodeBinarySnapshot(encoded.data(), encoded.size(), decoded));
+    EXPECT_EQ(toJson(decoded), toJson(original));
+    for (std::size_t i = 0; i < original.modules.size(); ++i) {
+        EXPECT_EQ(decoded.modules[i].pid, original.modules[i].pid);
+        EXPECT_EQ(decoded.modules[i].status, original.modules[i].status);
+    }
+}
+
+// Verifies that records can be read in place through the view and the C helpers
+TEST(BinarySnapshotTest, ViewReadsInPlace) {
+    const Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+
+    BinarySnapshotView view(encoded.data(), encoded.size());
+    ASSERT_TRUE(view.isValid());
+    EXPECT_EQ(view.sequence(), 42u);
+    ASSERT_EQ(view.moduleCount(), original.modules.size());
+    for (uint32_t i = 0; i < view.moduleCount(); ++i) {
+        EXPECT_EQ(view.name(i), original.modules[i].name);
+        EXPECT_EQ(view.record(i).cpu_percent, original.modules[i].stats.cpuPercent);
+        EXPECT_EQ(view.record(i).memory_mb, original.modules[i].stats.memoryMB);
+        EXPECT_EQ(view.status(i), original.modules[i].status);
+    }
+
+    const ps_snapshot_header* header = ps_snapshot_validate(encoded.data(), encoded.size());
+    ASSERT_NE(header, nullptr);
+    EXPECT_STREQ(ps_snapshot_name(header, ps_snapshot_record(header, 1)), "wallet");
+    EXPECT_EQ(ps_module_status(header, ps_snapshot_record(header, 1)), PS_MODULE_EXITED);
+    EXPECT_EQ(ps_module_status(header, ps_snapshot_record(header, 3)), PS_MODULE_ZOMBIE);
+}
+
+// Verifies that records written before the status field read as Ok
+TEST(BinarySnapshotTest, ReadsRecordsWithoutStatus) {
+    const Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+
+    // Re-lay the records at the old stride, as an older writer would
+    ps_snapshot_header header;
+    memcpy(&header, encoded.data(), sizeof(header));
+    const std::size_t shrink = (sizeof(ps_module_record) - PS_MODULE_RECORD_MIN_SIZE) * header.module_count;
+    std::string old(encoded.data(), sizeof(header));
+    for (uint32_t i = 0; i < header.module_count; ++i) {
+        old.append(encoded.data() + sizeof(header) + i * sizeof(ps_module_record), PS_MODULE_RECORD_MIN_SIZE);
+    }
+    old.append(encoded.data() + header.names_offset, encoded.size() - header.names_offset);
+    header.record_size = PS_MODULE_RECORD_MIN_SIZE;
+    header.names_offset -= static_cast<uint32_t>(shrink);
+    header.total_size -= static_cast<uint32_t>(shrink);
+    header.self_offset = 0;
+    memcpy(&old[0], &header, sizeof(header));
+
+    Snapshot decoded;
+    ASSERT_TRUE(ProcessStats::decodeBinarySnapshot(old.data(), old.size(), decoded));
+    ASSERT_EQ(decoded.modules.size(), original.modules.size());
+    for (std::size_t i = 0; i < decoded.modules.size(); ++i) {
+        EXPECT_EQ(decoded.modules[i].name, original.modules[i].name);
+        EXPECT_EQ(decoded.modules[i].pid, original.modules[i].pid);
+        EXPECT_EQ(decoded.modules[i].status, ModuleStatus::Ok);
+    }
+}
+
+// Verifies that repeated names are stored once in the name table
+TEST(BinarySnapshotTest, InternsRepeatedNames) {
+    const Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+
+    BinarySnapshotView view(encoded.data(), encoded.size());
+    ASSERT_TRUE(view.isValid());
+    EXPECT_EQ(view.record(0).name_offset, view.record(3).name_offset);
+    EXPECT_EQ(view.header().total_size, encoded.size());
+    EXPECT_EQ(encoded.size() % 8, 0u);
+}
+
+// Verifies that the size query and a too-small buffer leave memory untouched
+TEST(BinarySnapshotTest, EncodesOnlyWhenItFits) {
+    const Snapshot original = makeSnapshot();
+    const std::size_t size = ProcessStats::encodeBinarySnapshot(original, nullptr, 0);
+
+    std::vector<uint64_t> storage(size / 8, 0xabababababababab);
+    EXPECT_EQ(ProcessStats::encodeBinarySnapshot(original, storage.data(), size - 1), size);
+    EXPECT_EQ(storage[0], 0xabababababababab);
+
+    EXPECT_EQ(ProcessStats::encodeBinarySnapshot(original, storage.data(), size), size);
+    EXPECT_TRUE(BinarySnapshotView(storage.data(), size).isValid());
+}
+
+// Verifies that corrupt, truncated or foreign-version data is rejected
+TEST(BinarySnapshotTest, RejectsInvalidData) {
+    const Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+
+    Snapshot decoded;
+    EXPECT_FALSE(ProcessStats::decodeBinarySnapshot(encoded.data(), encoded.size() - 8, decoded));
+    EXPECT_FALSE(ProcessStats::decodeBinarySnapshot(nullptr, 0, decoded));
+
+    std::string badMagic = encoded;
+    badMagic[0] ^= 0x1;
+    EXPECT_FALSE(BinarySnapshotView(badMagic.data(), badMagic.size()).isValid());
+
+    std::string newerVersion = encoded;
+    ps_snapshot_header header;
+    memcpy(&header, newerVersion.data(), sizeof(header));
+    header.version = PS_SNAPSHOT_VERSION + 1;
+    memcpy(&newerVersion[0], &header, sizeof(header));
+    EXPECT_FALSE(BinarySnapshotView(newerVersion.data(), newerVersion.size()).isValid());
+}
+
+// Verifies that the __process_stats__ entry round-trips and is absent by default
+TEST(BinarySnapshotTest, CarriesSelfStats) {
+    Snapshot original = makeSnapshot();
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+    EXPECT_EQ(BinarySnapshotView(encoded.data(), encoded.size()).self(), nullptr);
+
+    original.hasSelfStats = true;
+    original.selfStats = {3, 6, 36, 1800, 40000, 5000, 7000, 2, 21000};
+    ProcessStats::encodeBinarySnapshot(original, encoded);
+    BinarySnapshotView view(encoded.data(), encoded.size());
+    ASSERT_TRUE(view.isValid());
+    ASSERT_NE(view.self(), nullptr);
+    EXPECT_EQ(view.self()->syscalls, 36u);
+    EXPECT_EQ(view.self()->max_tick_ns, 21000u);
+    EXPECT_EQ(view.name(1), "wallet");
+
+    Snapshot decoded;
+    ASSERT_TRUE(ProcessStats::decodeBinarySnapshot(encoded.data(), encoded.size(), decoded));
+    EXPECT_EQ(toJson(decoded), toJson(original));
+    ASSERT_TRUE(decoded.hasSelfStats);
+    EXPECT_EQ(decoded.selfStats.bytesRead, 1800u);
+}
+
+// Verifies that an empty snapshot encodes to just the header
+TEST(BinarySnapshotTest, EmptySnapshotIsHeaderOnly) {
+    Snapshot empty;
+    std::string encoded;
+    ProcessStats::encodeBinarySnapshot(empty, encoded);
+    EXPECT_EQ(encoded.size(), sizeof(ps_snapshot_header));
+
+    Snapshot decoded = makeSnapshot();
+    ASSERT_TRUE(ProcessStats::decodeBinarySnapshot(encoded.data(), encoded.size(), decoded));
+    EXPECT_TRUE(decoded.modules.empty());
+}
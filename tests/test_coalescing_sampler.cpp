@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "coalescing_sampler.h"
+#include "proc_reader.h"
+#include "sampler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using ProcessStats::CoalescingSampler;
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Sampler;
+
+namespace {
+    void burnCpu(std::chrono::milliseconds duration) {
+        auto end = std::chrono::steady_clock::now() + duration;
+        volatile double sum = 0.0;
+        while (std::chrono::steady_clock::now() < end) {
+            for (int i = 0; i < 10000; ++i) {
+                sum += i * 0.1;
+            }
+        }
+    }
+}
+
+// =============================================================================
+// CoalescingSampler Tests
+// =============================================================================
+
+// Verifies that a second call inside the window is served from the last tick
+TEST(CoalescingSamplerTest, CallInsideWindowReusesTick) {
+    Sampler sampler;
+    CoalescingSampler coalescer(sampler, std::chrono::seconds(10));
+    const int64_t self = getpid();
+
+    ProcessStatsData first;
+    coalescer.sample(&self, 1, &first);
+    const uint64_t reads = sampler.readCount();
+
+    ProcessStatsData second;
+    coalescer.sample(&self, 1, &second);
+
+    EXPECT_EQ(coalescer.tickCount(), 1u);
+    EXPECT_EQ(sampler.readCount(), reads);
+    EXPECT_EQ(second.memoryMB, first.memoryMB);
+    EXPECT_EQ(second.cpuTimeSeconds, first.cpuTimeSeconds);
+}
+
+// Verifies that a call after the window has passed starts a new tick
+TEST(CoalescingSamplerTest, CallAfterWindowStartsNewTick) {
+    Sampler sampler;
+    CoalescingSampler coalescer(sampler, std::chrono::milliseconds(5));
+    const int64_t self = getpid();
+
+    ProcessStatsData stats;
+    coalescer.sample(&self, 1, &stats);
+    usleep(20000);
+    coalescer.sample(&self, 1, &stats);
+
+    EXPECT_EQ(coalescer.tickCount(), 2u);
+}
+
+// Verifies that callers get only their own PIDs, in their own order, and that
+// invalid PIDs yield zeroed stats without a tick
+TEST(CoalescingSamplerTest, EachCallerGetsItsSubset) {
+    Sampler sampler;
+    CoalescingSampler coalescer(sampler, std::chrono::seconds(10));
+    const int64_t self = getpid();
+    const int64_t parent = getppid();
+
+    const int64_t both[] = {parent, self};
+    ProcessStatsData bothStats[2];
+    coalescer.sample(both, 2, bothStats);
+
+    const int64_t subset[] = {-1, self};
+    ProcessStatsData subsetStats[2];
+    coalescer.sample(subset, 2, subsetStats);
+
+    EXPECT_EQ(coalescer.tickCount(), 1u);
+    EXPECT_EQ(subsetStats[0].memoryMB, 0.0);
+    EXPECT_EQ(subsetStats[1].memoryMB, bothStats[1].memoryMB);
+}
+
+// Verifies that a caller with a different PID set does not reset the CPU
+// baseline of another caller's PIDs
+TEST(CoalescingSamplerTest, OtherCallersKeepBaselines) {
+    Sampler sampler;
+    CoalescingSampler coalescer(sampler, std::chrono::milliseconds(1));
+    const int64_t self = getpid();
+    const int64_t parent = getppid();
+
+    ProcessStatsData stats;
+    coalescer.sample(&self, 1, &stats);
+    EXPECT_EQ(stats.cpuPercent, 0.0);
+    const double baseline = stats.cpuTimeSeconds;
+
+    usleep(5000);
+    coalescer.sample(&parent, 1, &stats);
+
+    // Until the CPU time has moved by a clock tick, however loaded the machine
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    do {
+        burnCpu(std::chrono::milliseconds(100));
+    } while (ProcessStats::readRawCounters(self).cpuTimeSeconds <= baseline
+             && std::chrono::steady_clock::now() < deadline);
+    coalescer.sample(&self, 1, &stats);
+    EXPECT_GT(stats.cpuPercent, 0.0);
+}
+
+// Verifies that concurrent callers share ticks and all get valid results
+TEST(CoalescingSamplerTest, ConcurrentCallersShareTicks) {
+    constexpr int kCallers = 8;
+    constexpr int kCallsPerCaller = 20;
+    Sampler sampler;
+    CoalescingSampler coalescer(sampler, std::chrono::milliseconds(50));
+    const int64_t self = getpid();
+    const int64_t parent = getppid();
+
+    std::atomic<int> invalid{0};
+    std::vector<std::thread> callers;
+    for (int c = 0; c < kCallers; ++c) {
+        callers.emplace_back([&, c]() {
+            // Overlapping sets: everyone wants self, odd callers also the parent
+            std::vector<int64_t> pids = {self};
+            if (c % 2 == 1) {
+                pids.push_back(parent);
+            }
+            std::vector<ProcessStatsData> out(pids.size());
+            for (int call = 0; call < kCallsPerCaller; ++call) {
+                coalescer.sample(pids.data(), pids.size(), out.data());
+                if (out[0].memoryMB <= 0.0) {
+                    invalid.fetch_add(1);
+                }
+                usleep(1000);
+            }
+        });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+
+    EXPECT_EQ(invalid.load(), 0);
+    EXPECT_LT(coalescer.tickCount(), static_cast<uint64_t>(kCallers * kCallsPerCaller));
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "snapshot.h"
+#include <cmath>
+#include <limits>
+#include <string>
+
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleSample;
+using ProcessStats::Snapshot;
+
+namespace {
+    std::string formatDouble(double value, int precision = JsonWriter::kShortestPrecision) {
+        std::string out;
+        JsonWriter::appendDouble(out, value, precision);
+        return out;
+    }
+
+    std::string escape(const std::string& text) {
+        std::string out;
+        JsonWriter::appendEscaped(out, text);
+        return out;
+    }
+}
+
+// =============================================================================
+// Number Formatting Tests
+// =============================================================================
+
+// Verifies that shortest formatting matches QJsonDocument's compact output
+TEST(JsonWriterTest, ShortestDoublesMatchQtLayout) {
+    EXPECT_EQ(formatDouble(0.0), "0");
+    EXPECT_EQ(formatDouble(1.0), "1");
+    EXPECT_EQ(formatDouble(-2.5), "-2.5");
+    EXPECT_EQ(formatDouble(0.1), "0.1");
+    EXPECT_EQ(formatDouble(12.345), "12.345");
+    EXPECT_EQ(formatDouble(0.0001), "0.0001");
+    EXPECT_EQ(formatDouble(0.00001), "1e-05");
+    EXPECT_EQ(formatDouble(1.5e-7), "1.5e-07");
+    EXPECT_EQ(formatDouble(10000.0), "10000");
+    EXPECT_EQ(formatDouble(100000.0), "1e+05");
+    EXPECT_EQ(formatDouble(123456.0), "123456");
+    EXPECT_EQ(formatDouble(1234567890123.0), "1234567890123");
+    EXPECT_EQ(formatDouble(1e21), "1e+21");
+    EXPECT_EQ(formatDouble(1.7976931348623157e308), "1.7976931348623157e+308");
+}
+
+// Verifies that values JSON cannot represent are written as null
+TEST(JsonWriterTest, NonFiniteDoublesAreNull) {
+    EXPECT_EQ(formatDouble(std::numeric_limits<double>::infinity()), "null");
+    EXPECT_EQ(formatDouble(-std::numeric_limits<double>::infinity()), "null");
+    EXPECT_EQ(formatDouble(std::nan("")), "null");
+}
+
+// Verifies that a fixed precision limits significant digits
+TEST(JsonWriterTest, FixedPrecisionLimitsDigits) {
+    EXPECT_EQ(formatDouble(12.3456789, 3), "12.3");
+    EXPECT_EQ(formatDouble(0.5, 3), "0.5");
+}
+
+// =============================================================================
+// String Escaping Tests
+// =============================================================================
+
+// Verifies that strings are escaped the way QJsonDocument escapes them
+TEST(JsonWriterTest, EscapesLikeQt) {
+    EXPECT_EQ(escape("plain_name"), "\"plain_name\"");
+    EXPECT_EQ(escape("a\"b\\c"), "\"a\\\"b\\\\c\"");
+    EXPECT_EQ(escape("\b\f\n\r\t"), "\"\\b\\f\\n\\r\\t\"");
+    EXPECT_EQ(escape(std::string("\x01\x1f", 2)), "\"\\u0001\\u001f\"");
+    EXPECT_EQ(escape("caf\xc3\xa9"), "\"caf\xc3\xa9\"");
+}
+
+// =============================================================================
+// Document Tests
+// =============================================================================
+
+// Verifies that commas are placed correctly in nested containers
+TEST(JsonWriterTest, WritesNestedContainers) {
+    JsonWriter writer;
+    writer.beginObject();
+    writer.key("a");
+    writer.beginArray();
+    writer.value(int64_t(1));
+    writer.beginObject();
+    writer.endObject();
+    writer.beginArray();
+    writer.endArray();
+    writer.value(std::string_view("x"));
+    writer.endArray();
+    writer.key("b");
+    writer.value(0.5);
+    writer.endObject();
+
+    EXPECT_EQ(writer.buffer(), "{\"a\":[1,{},[],\"x\"],\"b\":0.5}");
+}
+
+// Verifies that clear() starts a fresh document without dropping capacity
+TEST(JsonWriterTest, ClearKeepsCapacity) {
+    JsonWriter writer;
+    writer.beginArray();
+    for (int i = 0; i < 100; ++i) {
+        writer.value(int64_t(i));
+    }
+    writer.endArray();
+    const std::size_t capacity = writer.buffer().capacity();
+
+    writer.clear();
+    writer.beginArray();
+    writer.endArray();
+    EXPECT_EQ(writer.buffer(), "[]");
+    EXPECT_EQ(writer.buffer().capacity(), capacity);
+}
+
+// Verifies the getModuleStats() layout
+TEST(JsonWriterTest, WritesModuleStats) {
+    Snapshot snapshot;
+    ModuleSample module;
+    module.name = "chat";
+    module.stats = {12.5, 3.25, 48.0};
+    snapshot.modules.push_back(module);
+
+    JsonWriter writer;
+    writeModuleStatsJson(writer, snapshot);
+    EXPECT_EQ(writer.buffer(),
+              "[{\"cpu_percent\":12.5,\"cpu_time_seconds\":3.25,\"memory_mb\":48,\"name\":\"chat\",\"status\":\"ok\"}]");
+}
+
+// Verifies that every status is written under its name
+TEST(JsonWriterTest, WritesModuleStatus) {
+    using ProcessStats::ModuleStatus;
+    Snapshot snapshot;
+    for (ModuleStatus status : {ModuleStatus::Ok, ModuleStatus::Exited, ModuleStatus::PermissionDenied,
+                                ModuleStatus::Zombie}) {
+        ModuleSample module;
+        module.name = ProcessStats::moduleStatusName(status);
+        module.stats = {0.0, 0.0, 0.0};
+        module.status = status;
+        snapshot.modules.push_back(module);
+    }
+
+    JsonWriter writer;
+    writeModuleStatsJson(writer, snapshot);
+    const std::string& json = writer.buffer();
+    EXPECT_NE(json.find("\"name\":\"ok\",\"status\":\"ok\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"exited\",\"status\":\"exited\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"permission_denied\",\"status\":\"permission_denied\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"zombie\",\"status\":\"zombie\""), std::string::npos);
+}
+
+// Verifies that the __process_stats__ entry follows the modules when present
+TEST(JsonWriterTest, WritesSelfStatsEntry) {
+    Snapshot snapshot;
+    ModuleSample module;
+    module.name = "chat";
+    module.stats = {1.0, 2.0, 3.0};
+    snapshot.modules.push_back(module);
+    snapshot.hasSelfStats = true;
+    snapshot.selfStats = {3, 6, 36, 1800, 40000, 5000, 7000, 2, 21000};
+
+    JsonWriter writer;
+    writeModuleStatsJson(writer, snapshot);
+    EXPECT_EQ(writer.buffer(),
+              "[{\"cpu_percent\":1,\"cpu_time_seconds\":2,\"memory_mb\":3,\"name\":\"chat\",\"status\":\"ok\"},"
+              "{\"allocations\":2,\"bytes_read\":1800,\"compute_ns\":5000,\"max_tick_ns\":21000,"
+              "\"name\":\"__process_stats__\",\"pids_sampled\":6,\"read_ns\":40000,\"serialize_ns\":7000,"
+              "\"syscalls\":36,\"ticks\":3}]");
+
+    writer.clear();
+    writeModuleStatsBatchJson(writer, snapshot);
+    EXPECT_NE(writer.buffer().find("\"status\":\"ok\",\"window_ms\":0},{\"allocations\":2,"), std::string::npos)
+        << writer.buffer();
+}
+
+// Verifies the getModuleStatsBatch() layout
+TEST(JsonWriterTest, WritesModuleStatsBatch) {
+    Snapshot snapshot;
+    snapshot.sequence = 7;
+    snapshot.timestampMs = 1700000000000;
+    snapshot.batchStartNs = 1000;
+    snapshot.batchEndNs = 1501000;
+    ModuleSample module;
+    module.name = "wallet";
+    module.stats = {0.0, 1.0, 2.0};
+    module.windowMs = 1000;
+    module.readTimeNs = 2000;
+    snapshot.modules.push_back(module);
+
+    JsonWriter writer;
+    writeModuleStatsBatchJson(writer, snapshot);
+    EXPECT_EQ(writer.buffer(),
+              "{\"batch_end_ns\":1501000,\"batch_start_ns\":1000,\"modules\":["
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":1,\"memory_mb\":2,\"name\":\"wallet\","
+              "\"read_offset_ns\":1000,\"status\":\"ok\",\"window_ms\":1000}],"
+              "\"sequence\":7,\"skew_ms\":1.5,\"timestamp_ms\":1700000000000}");
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "module_registry.h"
+#include "stats_engine.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using ProcessStats::JsonWriter;
+using ProcessStats::kNoModule;
+using ProcessStats::ModuleId;
+using ProcessStats::ModuleRegistry;
+using ProcessStats::RawCounters;
+using ProcessStats::RegistrySample;
+using ProcessStats::SamplerOptions;
+using ProcessStats::SampleSource;
+using ProcessStats::Snapshot;
+using ProcessStats::StatsEngine;
+
+namespace {
+    // One second per tick; pid p burns p% CPU and holds p MB
+    struct TickSource : SampleSource {
+        int64_t tick = 1;
+        int64_t nowNs() override { return tick * 1000000000; }
+        int64_t wallTimeMs() override { return tick * 1000; }
+        RawCounters read(int64_t pid) const override {
+            RawCounters counters;
+            counters.cpuTimeSeconds = pid * tick / 100.0;
+            counters.memoryMB = static_cast<double>(pid);
+            counters.readTimeNs = tick * 1000000000;
+            counters.valid = true;
+            return counters;
+        }
+    };
+}
+
+// =============================================================================
+// ModuleRegistry Tests
+// =============================================================================
+
+// Verifies ids, lookups and that registering a name again moves it
+TEST(ModuleRegistryTest, RegistersOncePerName) {
+    ModuleRegistry registry;
+    const ModuleId a = registry.add("alpha", 10);
+    const ModuleId b = registry.add("beta", 20);
+    EXPECT_NE(a, kNoModule);
+    EXPECT_NE(b, kNoModule);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(registry.add("alpha", 11), a);
+    EXPECT_EQ(registry.size(), 2u);
+    EXPECT_EQ(registry.find("beta"), b);
+    EXPECT_EQ(registry.find("gamma"), kNoModule);
+    EXPECT_EQ(registry.name(a), "alpha");
+    EXPECT_EQ(registry.pid(a), 11);
+
+    EXPECT_EQ(registry.add("zero", 0), kNoModule);
+    EXPECT_FALSE(registry.setPid(b, -1));
+    EXPECT_TRUE(registry.setPid(b, 21));
+    EXPECT_EQ(registry.modules()[1].pid, 21);
+}
+
+// Verifies that removal keeps registration order and never reuses ids
+TEST(ModuleRegistryTest, RemovesWithoutReusingIds) {
+    ModuleRegistry registry;
+    const ModuleId a = registry.add("a", 1);
+    const ModuleId b = registry.add("b", 2);
+    const ModuleId c = registry.add("c", 3);
+    EXPECT_TRUE(registry.remove(b));
+    EXPECT_FALSE(registry.remove(b));
+    EXPECT_FALSE(registry.contains(b));
+    EXPECT_EQ(registry.name(b), "");
+    EXPECT_FALSE(registry.setPid(b, 5));
+
+    ASSERT_EQ(registry.size(), 2u);
+    EXPECT_EQ(registry.modules()[0].name, "a");
+    EXPECT_EQ(registry.modules()[1].name, "c");
+    EXPECT_EQ(registry.ids(), (std::vector<ModuleId>{a, c}));
+    EXPECT_EQ(registry.pid(c), 3);
+
+    const ModuleId again = registry.add("b", 2);
+    EXPECT_NE(again, b);
+    EXPECT_EQ(registry.modules()[2].name, "b");
+}
+
+// Verifies that names are escaped once, as JsonWriter would escape them
+TEST(ModuleRegistryTest, StoresEscapedNames) {
+    ModuleRegistry registry;
+    const ModuleId id = registry.add("quote\"tab\t", 1);
+    EXPECT_EQ(registry.jsonName(id), "\"quote\\\"tab\\t\"");
+    EXPECT_EQ(registry.jsonNames()[0], registry.jsonName(id));
+}
+
+// Verifies that generations change with every edit and differ between
+// registries
+TEST(ModuleRegistryTest, GenerationTracksChanges) {
+    ModuleRegistry first;
+    ModuleRegistry second;
+    EXPECT_NE(first.generation(), 0u);
+    EXPECT_NE(first.generation(), second.generation());
+
+    uint64_t generation = first.generation();
+    const ModuleId id = first.add("a", 1);
+    EXPECT_NE(first.generation(), generation);
+    generation = first.generation();
+    first.setPid(id, 1);
+    EXPECT_EQ(first.generation(), generation);
+    first.setPid(id, 2);
+    EXPECT_NE(first.generation(), generation);
+}
+
+// Verifies that compaction reclaims removed names and keeps the rest intact
+TEST(ModuleRegistryTest, CompactsRemovedNames) {
+    ModuleRegistry registry;
+    const ModuleId kept = registry.add("kept", 1);
+    for (int round = 0; round < 50; ++round) {
+        std::vector<ModuleId> ids;
+        for (int i = 0; i < 20; ++i) {
+            ids.push_back(registry.add("transient_module_" + std::to_string(round) + "_" + std::to_string(i), 100 + i));
+        }
+        for (ModuleId id : ids) {
+            registry.remove(id);
+        }
+    }
+    EXPECT_LT(registry.arenaBytes(), 16384u);
+    EXPECT_EQ(registry.name(kept), "kept");
+    EXPECT_EQ(registry.jsonName(kept), "\"kept\"");
+    EXPECT_EQ(registry.find("kept"), kept);
+    EXPECT_EQ(registry.modules()[0].name, "kept");
+}
+
+// Verifies that sampling a registry gives the same snapshot and JSON as
+// sampling by name, and follows registry changes
+TEST(ModuleRegistryTest, SamplesThroughEngine) {
+    auto source = std::make_shared<TickSource>();
+    SamplerOptions options;
+    options.source = source;
+    StatsEngine byName(options);
+    StatsEngine byId(options);
+
+    ModuleRegistry registry;
+    registry.add("a", 10);
+    const ModuleId b = registry.add("b\"", 20);
+    RegistrySample sample;
+    for (int64_t tick = 1; tick <= 3; ++tick) {
+        source->tick = tick;
+        if (tick == 3) {
+            registry.remove(b);
+            registry.add("c", 30);
+        }
+        Snapshot expected = byName.sampleModules(registry.modules());
+        byId.sampleModules(registry, sample);
+        EXPECT_EQ(sample.generation, registry.generation());
+
+        JsonWriter plain;
+        JsonWriter escapedOnce;
+        ProcessStats::writeModuleStatsJson(plain, expected);
+        ProcessStats::writeModuleStatsJson(escapedOnce, sample.snapshot, registry.jsonNames().data());
+        EXPECT_EQ(escapedOnce.buffer(), plain.buffer()) << "tick " << tick;
+
+        plain.clear();
+        escapedOnce.clear();
+        ProcessStats::writeModuleStatsBatchJson(plain, expected);
+        ProcessStats::writeModuleStatsBatchJson(escapedOnce, sample.snapshot, registry.jsonNames().data());
+        EXPECT_EQ(escapedOnce.buffer(), plain.buffer()) << "tick " << tick;
+    }
+    ASSERT_EQ(sample.snapshot.modules.size(), 2u);
+    EXPECT_EQ(sample.snapshot.modules[1].name, "c");
+    EXPECT_EQ(sample.snapshot.sequence, 3u);
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include "module_stats_model.h"
+#include <QAbstractItemModelTester>
+#include <QString>
+#include <string>
+#include <vector>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::ModuleStatsModel;
+using ProcessStats::Snapshot;
+
+namespace {
+    struct Row {
+        std::string name;
+        int64_t pid;
+        double cpuPercent;
+        double memoryMB;
+    };
+
+    Snapshot snapshotOf(const std::vector<Row>& rows) {
+        Snapshot snapshot;
+        for (const Row& row : rows) {
+            ModuleSample module;
+            module.name = row.name;
+            module.pid = row.pid;
+            module.stats = {row.cpuPercent, 1.0, row.memoryMB};
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    // Records the structural and data signals of a model
+    struct Changes {
+        struct Range {
+            int firstRow, lastRow, firstColumn, lastColumn;
+        };
+        std::vector<Range> changed;
+        std::vector<std::pair<int, int>> inserted;
+        std::vector<std::pair<int, int>> removed;
+
+        explicit Changes(ModuleStatsModel& model) {
+            QObject::connect(&model, &QAbstractItemModel::dataChanged,
+                             [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+                changed.push_back({topLeft.row(), bottomRight.row(), topLeft.column(), bottomRight.column()});
+            });
+            QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+                             [this](const QModelIndex&, int first, int last) {
+                inserted.emplace_back(first, last);
+            });
+            QObject::connect(&model, &QAbstractItemModel::rowsRemoved,
+                             [this](const QModelIndex&, int first, int last) {
+                removed.emplace_back(first, last);
+            });
+        }
+
+        void clear() {
+            changed.clear();
+            inserted.clear();
+            removed.clear();
+        }
+    };
+
+    QString nameAt(const ModuleStatsModel& model, int row) {
+        return model.data(model.index(row, ModuleStatsModel::NameColumn)).toString();
+    }
+}
+
+// =============================================================================
+// ModuleStatsModel Tests
+// =============================================================================
+
+// Verifies that the first snapshot inserts every row and that an unchanged
+// one emits nothing
+TEST(ModuleStatsModelTest, InsertsThenStaysQuiet) {
+    ModuleStatsModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::Fatal);
+    Changes changes(model);
+
+    const Snapshot first = snapshotOf({{"a", 10, 1.0, 10.0}, {"b", 20, 2.0, 20.0}, {"c", 30, 3.0, 30.0}});
+    model.update(first);
+    ASSERT_EQ(changes.inserted.size(), 1u);
+    EXPECT_EQ(changes.inserted[0], std::make_pair(0, 2));
+    EXPECT_EQ(model.rowCount(), 3);
+    EXPECT_EQ(model.columnCount(), ModuleStatsModel::ColumnCount);
+    EXPECT_EQ(nameAt(model, 1), QString("b"));
+    EXPECT_EQ(model.data(model.index(2, ModuleStatsModel::PidColumn)).toLongLong(), 30);
+    EXPECT_EQ(model.data(model.index(2, ModuleStatsModel::MemoryColumn)).toDouble(), 30.0);
+    EXPECT_EQ(model.headerData(ModuleStatsModel::CpuPercentColumn, Qt::Horizontal).toString(), QString("CPU %"));
+
+    changes.clear();
+    model.update(first);
+    EXPECT_TRUE(changes.changed.empty());
+    EXPECT_TRUE(changes.inserted.empty());
+    EXPECT_TRUE(changes.removed.empty());
+}
+
+// Verifies that only changed cells are reported, and that neighbouring
+// rows with the same change share one signal
+TEST(ModuleStatsModelTest, ReportsChangedCellsOnly) {
+    ModuleStatsModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::Fatal);
+    model.update(snapshotOf({{"a", 10, 1.0, 10.0}, {"b", 20, 2.0, 20.0}, {"c", 30, 3.0, 30.0}, {"d", 40, 4.0, 40.0}}));
+    Changes changes(model);
+
+    // a and b: CPU only; c: nothing; d: memory only
+    model.update(snapshotOf({{"a", 10, 5.0, 10.0}, {"b", 20, 6.0, 20.0}, {"c", 30, 3.0, 30.0}, {"d", 40, 4.0, 41.0}}));
+    ASSERT_EQ(changes.changed.size(), 2u);
+    EXPECT_EQ(changes.changed[0].firstRow, 0);
+    EXPECT_EQ(changes.changed[0].lastRow, 1);
+    EXPECT_EQ(changes.changed[0].firstColumn, ModuleStatsModel::CpuPercentColumn);
+    EXPECT_EQ(changes.changed[0].lastColumn, ModuleStatsModel::CpuPercentColumn);
+    EXPECT_EQ(changes.changed[1].firstRow, 3);
+    EXPECT_EQ(changes.changed[1].lastRow, 3);
+    EXPECT_EQ(changes.changed[1].firstColumn, ModuleStatsModel::MemoryColumn);
+    EXPECT_TRUE(changes.inserted.empty());
+    EXPECT_TRUE(changes.removed.empty());
+    EXPECT_EQ(model.data(model.index(1, ModuleStatsModel::CpuPercentColumn)).toDouble(), 6.0);
+}
+
+// Verifies that exited modules are removed and new ones appended without
+// disturbing the other rows
+TEST(ModuleStatsModelTest, RemovesAndAppendsModules) {
+    ModuleStatsModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::Fatal);
+    model.update(snapshotOf({{"a", 10, 1.0, 10.0}, {"b", 20, 2.0, 20.0}, {"c", 30, 3.0, 30.0}, {"d", 40, 4.0, 40.0}}));
+    Changes changes(model);
+
+    // b and c exit, e starts, and d arrives in a different position
+    model.update(snapshotOf({{"d", 40, 4.0, 40.0}, {"e", 50, 5.0, 50.0}, {"a", 10, 1.0, 10.0}}));
+    ASSERT_EQ(changes.removed.size(), 1u);
+    EXPECT_EQ(changes.removed[0], std::make_pair(1, 2));
+    ASSERT_EQ(changes.inserted.size(), 1u);
+    EXPECT_EQ(changes.inserted[0], std::make_pair(2, 2));
+    EXPECT_TRUE(changes.changed.empty());
+    ASSERT_EQ(model.rowCount(), 3);
+    EXPECT_EQ(nameAt(model, 0), QString("a"));
+    EXPECT_EQ(nameAt(model, 1), QString("d"));
+    EXPECT_EQ(nameAt(model, 2), QString("e"));
+    EXPECT_EQ(model.module(2).pid, 50);
+
+    // Rows keep their place while values move
+    changes.clear();
+    model.update(snapshotOf({{"d", 40, 4.0, 40.0}, {"e", 51, 5.0, 50.0}, {"a", 10, 1.0, 10.0}}));
+    ASSERT_EQ(changes.changed.size(), 1u);
+    EXPECT_EQ(changes.changed[0].firstRow, 2);
+    EXPECT_EQ(changes.changed[0].firstColumn, ModuleStatsModel::PidColumn);
+
+    model.clear();
+    EXPECT_EQ(model.rowCount(), 0);
+}
+
+// Verifies that the status column shows why a module reads as zero, and
+// that a status change is reported like any other value
+TEST(ModuleStatsModelTest, ShowsModuleStatus) {
+    using ProcessStats::ModuleStatus;
+    ModuleStatsModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::Fatal);
+    model.update(snapshotOf({{"a", 10, 1.0, 10.0}, {"b", 20, 2.0, 20.0}}));
+    EXPECT_EQ(model.data(model.index(1, ModuleStatsModel::StatusColumn)).toString(), QString("ok"));
+    EXPECT_EQ(model.headerData(ModuleStatsModel::StatusColumn, Qt::Horizontal).toString(), QString("Status"));
+    Changes changes(model);
+
+    // b exits: its stats go to zero and its status says why
+    Snapshot exited = snapshotOf({{"a", 10, 1.0, 10.0}, {"b", 20, 0.0, 0.0}});
+    exited.modules[1].stats.cpuTimeSeconds = 0.0;
+    exited.modules[1].status = ModuleStatus::Exited;
+    model.update(exited);
+    ASSERT_EQ(changes.changed.size(), 1u);
+    EXPECT_EQ(changes.changed[0].firstRow, 1);
+    EXPECT_EQ(changes.changed[0].firstColumn, ModuleStatsModel::CpuPercentColumn);
+    EXPECT_EQ(changes.changed[0].lastColumn, ModuleStatsModel::StatusColumn);
+    EXPECT_EQ(model.module(1).status, ModuleStatus::Exited);
+    EXPECT_EQ(model.data(model.index(1, ModuleStatsModel::StatusColumn)).toString(), QString("exited"));
+
+    // Only the status moves
+    changes.clear();
+    exited.modules[1].status = ModuleStatus::PermissionDenied;
+    model.update(exited);
+    ASSERT_EQ(changes.changed.size(), 1u);
+    EXPECT_EQ(changes.changed[0].firstColumn, ModuleStatsModel::StatusColumn);
+    EXPECT_EQ(changes.changed[0].lastColumn, ModuleStatsModel::StatusColumn);
+    EXPECT_EQ(model.data(model.index(1, ModuleStatsModel::StatusColumn)).toString(),
+              QString("permission_denied"));
+}
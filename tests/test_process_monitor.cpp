@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+#include "process_monitor.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+#include <memory>
+#include <set>
+#include <vector>
+
+using ProcessStats::ProcessMonitor;
+using ProcessStats::RawCounters;
+using ProcessStats::SamplerOptions;
+using ProcessStats::SampleSource;
+using ProcessStats::Snapshot;
+
+namespace {
+    // One second per tick; every process burns the CPU given to advance()
+    // and pid p holds p MB, until it is marked exited or denied
+    struct ScriptedSource : SampleSource {
+        int64_t tick = 1;
+        double cpuSeconds = 0.1;
+        std::set<int64_t> exited;
+        std::set<int64_t> denied;
+
+        void advance(double percent = 10.0) {
+            ++tick;
+            cpuSeconds += percent / 100.0;
+        }
+
+        int64_t nowNs() override { return tick * 1000000000; }
+        int64_t wallTimeMs() override { return tick * 1000; }
+        RawCounters read(int64_t pid) const override {
+            RawCounters counters;
+            counters.readTimeNs = tick * 1000000000;
+            if (exited.count(pid)) {
+                return counters;
+            }
+            if (denied.count(pid)) {
+                counters.status = ProcessStats::ModuleStatus::PermissionDenied;
+                return counters;
+            }
+            counters.cpuTimeSeconds = cpuSeconds;
+            counters.memoryMB = static_cast<double>(pid);
+            counters.valid = true;
+            return counters;
+        }
+    };
+
+    struct Crossing {
+        QString name;
+        ProcessMonitor::Metric metric;
+        double value;
+        bool above;
+    };
+
+    // Records every signal of a monitor
+    struct Recorder {
+        std::vector<Snapshot> snapshots;
+        std::vector<std::pair<QString, qint64>> exits;
+        std::vector<Crossing> crossings;
+
+        explicit Recorder(ProcessMonitor& monitor) {
+            QObject::connect(&monitor, &ProcessMonitor::snapshotReady, [this](const Snapshot& snapshot) {
+                snapshots.push_back(snapshot);
+            });
+            QObject::connect(&monitor, &ProcessMonitor::moduleExited, [this](const QString& name, qint64 pid) {
+                exits.emplace_back(name, pid);
+            });
+            QObject::connect(&monitor, &ProcessMonitor::thresholdCrossed,
+                             [this](const QString& name, ProcessMonitor::Metric metric, double value, bool above) {
+                crossings.push_back({name, metric, value, above});
+            });
+        }
+    };
+
+    SamplerOptions withSource(std::shared_ptr<SampleSource> source) {
+        SamplerOptions options;
+        options.source = std::move(source);
+        return options;
+    }
+}
+
+// =============================================================================
+// ProcessMonitor Tests
+// =============================================================================
+
+// Verifies that a tick emits the structured snapshot in the order modules
+// were added
+TEST(ProcessMonitorTest, EmitsSnapshots) {
+    auto source = std::make_shared<ScriptedSource>();
+    ProcessMonitor monitor(withSource(source));
+    Recorder recorder(monitor);
+    EXPECT_TRUE(monitor.addModule("b", 20));
+    EXPECT_TRUE(monitor.addModule("a", 10));
+    EXPECT_FALSE(monitor.addModule("zero", 0));
+    EXPECT_EQ(monitor.moduleCount(), 2);
+
+    monitor.sampleNow();
+    source->advance();
+    monitor.sampleNow();
+    ASSERT_EQ(recorder.snapshots.size(), 2u);
+    const Snapshot& latest = recorder.snapshots[1];
+    ASSERT_EQ(latest.modules.size(), 2u);
+    EXPECT_EQ(latest.modules[0].name, "b");
+    EXPECT_EQ(latest.modules[1].name, "a");
+    EXPECT_EQ(latest.modules[1].stats.memoryMB, 10.0);
+    EXPECT_NEAR(latest.modules[1].stats.cpuPercent, 10.0, 1e-9);
+    EXPECT_EQ(latest.sequence, 2u);
+
+    EXPECT_TRUE(monitor.removeModule("b"));
+    EXPECT_FALSE(monitor.removeModule("b"));
+    monitor.sampleNow();
+    EXPECT_EQ(recorder.snapshots[2].modules.size(), 1u);
+}
+
+// Verifies that a module whose process goes away is reported once and dropped
+TEST(ProcessMonitorTest, ReportsExitedModules) {
+    auto source = std::make_shared<ScriptedSource>();
+    ProcessMonitor monitor(withSource(source));
+    Recorder recorder(monitor);
+    monitor.addModule("stays", 10);
+    monitor.addModule("leaves", 20);
+
+    monitor.sampleNow();
+    EXPECT_TRUE(recorder.exits.empty());
+    source->exited.insert(20);
+    source->advance();
+    monitor.sampleNow();
+    ASSERT_EQ(recorder.exits.size(), 1u);
+    EXPECT_EQ(recorder.exits[0].first, QString("leaves"));
+    EXPECT_EQ(recorder.exits[0].second, 20);
+    EXPECT_EQ(monitor.moduleCount(), 1);
+
+    source->advance();
+    monitor.sampleNow();
+    EXPECT_EQ(recorder.exits.size(), 1u);
+    EXPECT_EQ(recorder.snapshots.back().modules.size(), 1u);
+}
+
+// Verifies that a module that may not be read stays registered without
+// exiting or crossing thresholds
+TEST(ProcessMonitorTest, KeepsUnreadableModules) {
+    auto source = std::make_shared<ScriptedSource>();
+    SamplerOptions options = withSource(source);
+    options.retryBackoffMinMs = 0;
+    ProcessMonitor monitor(options);
+    Recorder recorder(monitor);
+    monitor.setMemoryThreshold(15.0);
+    monitor.addModule("hidden", 20);
+
+    source->denied.insert(20);
+    monitor.sampleNow();
+    EXPECT_TRUE(recorder.exits.empty());
+    EXPECT_TRUE(recorder.crossings.empty());
+    EXPECT_EQ(monitor.moduleCount(), 1);
+    ASSERT_EQ(recorder.snapshots.back().modules.size(), 1u);
+    EXPECT_EQ(recorder.snapshots.back().modules[0].status, ProcessStats::ModuleStatus::PermissionDenied);
+
+    source->denied.clear();
+    source->advance();
+    monitor.sampleNow();
+    ASSERT_EQ(recorder.crossings.size(), 1u);
+    EXPECT_TRUE(recorder.crossings[0].above);
+}
+
+// Verifies that thresholds fire on crossings in both directions, not on
+// every tick above them
+TEST(ProcessMonitorTest, ReportsThresholdCrossings) {
+    auto source = std::make_shared<ScriptedSource>();
+    ProcessMonitor monitor(withSource(source));
+    Recorder recorder(monitor);
+    monitor.setCpuThreshold(50.0);
+    monitor.setMemoryThreshold(15.0);
+    monitor.addModule("small", 10);
+    monitor.addModule("large", 20);
+
+    // First sample: only memory can be judged
+    monitor.sampleNow();
+    ASSERT_EQ(recorder.crossings.size(), 1u);
+    EXPECT_EQ(recorder.crossings[0].name, QString("large"));
+    EXPECT_EQ(recorder.crossings[0].metric, ProcessMonitor::Metric::MemoryMB);
+    EXPECT_TRUE(recorder.crossings[0].above);
+
+    // CPU rises above the limit for two ticks, then falls back
+    for (int i = 0; i < 2; ++i) {
+        source->advance(80.0);
+        monitor.sampleNow();
+    }
+    source->advance(10.0);
+    monitor.sampleNow();
+
+    std::vector<Crossing> cpu;
+    for (const Crossing& crossing : recorder.crossings) {
+        if (crossing.metric == ProcessMonitor::Metric::CpuPercent) {
+            cpu.push_back(crossing);
+        }
+    }
+    ASSERT_EQ(cpu.size(), 4u);
+    EXPECT_TRUE(cpu[0].above);
+    EXPECT_TRUE(cpu[1].above);
+    EXPECT_NEAR(cpu[0].value, 80.0, 1e-9);
+    EXPECT_NEAR(cpu[2].value, 10.0, 1e-9);
+    EXPECT_FALSE(cpu[2].above);
+    EXPECT_FALSE(cpu[3].above);
+    EXPECT_EQ(recorder.crossings.size(), 5u);
+}
+
+// Verifies that the monitor ticks from the event loop at its interval
+TEST(ProcessMonitorTest, TicksFromEventLoop) {
+    int argc = 1;
+    char name[] = "process_stats_tests";
+    char* argv[] = {name, nullptr};
+    QCoreApplication app(argc, argv);
+
+    auto source = std::make_shared<ScriptedSource>();
+    ProcessMonitor monitor(withSource(source));
+    Recorder recorder(monitor);
+    monitor.addModule("a", 10);
+    monitor.setInterval(20);
+    monitor.start();
+    EXPECT_TRUE(monitor.isActive());
+
+    QElapsedTimer timer;
+    timer.start();
+    while (recorder.snapshots.size() < 3 && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    }
+    EXPECT_GE(recorder.snapshots.size(), 3u);
+
+    monitor.stop();
+    EXPECT_FALSE(monitor.isActive());
+    const std::size_t stopped = recorder.snapshots.size();
+    timer.restart();
+    while (timer.elapsed() < 100) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 20);
+    }
+    EXPECT_EQ(recorder.snapshots.size(), stopped);
+}
@@ -1,11 +1,17 @@
 #include <gtest/gtest.h>
 #include "process_stats.h"
+#include "json_writer.h"
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QProcess>
+#include <QThread>
 #include <cstring>
+#include <ctime>
+#include <string>
 #include <unistd.h>
 
 // Test fixture for process stats tests
@@ -199,8 +205,10 @@ TEST_F(ProcessStatsTest, GetModuleStats_ReturnsValidJsonStructure) {
     EXPECT_TRUE(moduleObj.contains("cpu_percent"));
     EXPECT_TRUE(moduleObj.contains("cpu_time_seconds"));
     EXPECT_TRUE(moduleObj.contains("memory_mb"));
+    EXPECT_TRUE(moduleObj.contains("status"));
     
     EXPECT_EQ(moduleObj["name"].toString().toStdString(), "test_plugin");
+    EXPECT_EQ(moduleObj["status"].toString().toStdString(), "ok");
     EXPECT_GE(moduleObj["cpu_percent"].toDouble(), 0.0);
     EXPECT_GE(moduleObj["cpu_time_seconds"].toDouble(), 0.0);
     EXPECT_GE(moduleObj["memory_mb"].toDouble(), 0.0);
@@ -287,3 +295,277 @@ TEST_F(ProcessStatsTest, GetModuleStats_SkipsInvalidPids) {
     // Clean up
     delete[] result;
 }
+
+// =============================================================================
+// Caller-Provided Buffer Tests
+// =============================================================================
+
+// Verifies snprintf semantics: size query, truncation with NUL, and exact fit
+TEST_F(ProcessStatsTest, GetModuleStatsIntoBuffer_FollowsSnprintfSemantics) {
+    QHash<QString, qint64> emptyProcesses;
+    
+    EXPECT_EQ(ProcessStats::getModuleStats(emptyProcesses, nullptr, 0), 2u);
+    
+    char small[2] = {'x', 'x'};
+    EXPECT_EQ(ProcessStats::getModuleStats(emptyProcesses, small, sizeof(small)), 2u);
+    EXPECT_STREQ(small, "[");
+    
+    char exact[3];
+    EXPECT_EQ(ProcessStats::getModuleStats(emptyProcesses, exact, sizeof(exact)), 2u);
+    EXPECT_STREQ(exact, "[]");
+}
+
+// Verifies that a size query and the call after it see the same document
+TEST_F(ProcessStatsTest, GetModuleStatsIntoBuffer_SizeQueryMatchesNextCall) {
+    QProcess* testProcess = createTestProcess();
+    QHash<QString, qint64> processes;
+    processes["test_plugin"] = testProcess->processId();
+    processes["self"] = getpid();
+    
+    for (int i = 0; i < 20; ++i) {
+        const std::size_t length = ProcessStats::getModuleStats(processes, nullptr, 0);
+        std::string buffer(length + 1, 'x');
+        EXPECT_EQ(ProcessStats::getModuleStats(processes, &buffer[0], buffer.size()), length);
+        EXPECT_EQ(strlen(buffer.c_str()), length);
+        EXPECT_TRUE(QJsonDocument::fromJson(QByteArray(buffer.c_str())).isArray());
+        
+        const std::size_t batchLength = ProcessStats::getModuleStatsBatch(processes, nullptr, 0);
+        std::string batch(batchLength + 1, 'x');
+        EXPECT_EQ(ProcessStats::getModuleStatsBatch(processes, &batch[0], batch.size()), batchLength);
+        EXPECT_EQ(strlen(batch.c_str()), batchLength);
+    }
+}
+
+// Verifies that every size query samples, so rounds separated by CPU work differ
+TEST_F(ProcessStatsTest, GetModuleStatsIntoBuffer_SizeQuerySamplesAfresh) {
+    QHash<QString, qint64> processes;
+    processes["self"] = getpid();
+    
+    auto selfCpuTime = [&processes]() {
+        const std::size_t length = ProcessStats::getModuleStats(processes, nullptr, 0);
+        std::string buffer(length + 1, 'x');
+        EXPECT_EQ(ProcessStats::getModuleStats(processes, &buffer[0], buffer.size()), length);
+        const QJsonArray modules = QJsonDocument::fromJson(QByteArray(buffer.c_str())).array();
+        EXPECT_EQ(modules.size(), 1);
+        return modules.isEmpty() ? -1.0 : modules[0].toObject()["cpu_time_seconds"].toDouble();
+    };
+    
+    const double before = selfCpuTime();
+    
+    // Burn well over a clock tick of CPU time
+    const std::clock_t start = std::clock();
+    volatile double sink = 0;
+    while (std::clock() - start < CLOCKS_PER_SEC / 10) {
+        sink = sink + 1.0;
+    }
+    
+    EXPECT_NE(selfCpuTime(), before);
+}
+
+// Verifies that a large enough caller buffer receives the complete JSON
+TEST_F(ProcessStatsTest, GetModuleStatsIntoBuffer_WritesCompleteJson) {
+    QProcess* testProcess = createTestProcess();
+    QHash<QString, qint64> processes;
+    processes["test_plugin"] = testProcess->processId();
+    
+    char buffer[4096];
+    std::size_t length = ProcessStats::getModuleStats(processes, buffer, sizeof(buffer));
+    ASSERT_LT(length, sizeof(buffer));
+    EXPECT_EQ(length, strlen(buffer));
+    
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray(buffer, static_cast<int>(length)));
+    ASSERT_TRUE(doc.isArray());
+    EXPECT_EQ(doc.array().size(), 1);
+    
+    length = ProcessStats::getModuleStatsBatch(processes, buffer, sizeof(buffer));
+    ASSERT_LT(length, sizeof(buffer));
+    EXPECT_TRUE(QJsonDocument::fromJson(QByteArray(buffer, static_cast<int>(length))).isObject());
+}
+
+// Verifies that a StatsBuffer grows when needed and is reused afterwards
+TEST_F(ProcessStatsTest, GetModuleStatsIntoStatsBuffer_ReusesAllocation) {
+    QHash<QString, qint64> emptyProcesses;
+    ProcessStats::StatsBuffer buffer;
+    
+    EXPECT_EQ(ProcessStats::getModuleStats(emptyProcesses, buffer), 2u);
+    ASSERT_NE(buffer.data, nullptr);
+    EXPECT_STREQ(buffer.data, "[]");
+    
+    // Same size document: no reallocation
+    char* data = buffer.data;
+    const std::size_t capacity = buffer.capacity;
+    for (int i = 0; i < 10; ++i) {
+        ProcessStats::getModuleStats(emptyProcesses, buffer);
+    }
+    EXPECT_EQ(buffer.data, data);
+    EXPECT_EQ(buffer.capacity, capacity);
+    
+    // Larger document: grows to fit
+    QProcess* testProcess = createTestProcess();
+    QHash<QString, qint64> processes;
+    processes["test_plugin"] = testProcess->processId();
+    std::size_t length = ProcessStats::getModuleStatsBatch(processes, buffer);
+    EXPECT_GT(length, 2u);
+    EXPECT_EQ(buffer.size, length);
+    EXPECT_GT(buffer.capacity, length);
+    EXPECT_EQ(strlen(buffer.data), length);
+    
+    ProcessStats::releaseStatsBuffer(buffer);
+    EXPECT_EQ(buffer.data, nullptr);
+    EXPECT_EQ(buffer.capacity, 0u);
+}
+
+// =============================================================================
+// getModuleStatsBatch Tests
+// =============================================================================
+
+// Verifies that getModuleStatsBatch() reports batch timing and per-module read times
+TEST_F(ProcessStatsTest, GetModuleStatsBatch_ReportsTimingAndSkew) {
+    QProcess* process1 = createTestProcess();
+    QProcess* process2 = createTestProcess();
+    
+    QHash<QString, qint64> processes;
+    processes["plugin_one"] = process1->processId();
+    processes["plugin_two"] = process2->processId();
+    
+    char* result = ProcessStats::getModuleStatsBatch(processes);
+    ASSERT_NE(result, nullptr);
+    
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray(result));
+    ASSERT_TRUE(doc.isObject());
+    QJsonObject batch = doc.object();
+    
+    EXPECT_TRUE(batch.contains("batch_start_ns"));
+    EXPECT_TRUE(batch.contains("batch_end_ns"));
+    EXPECT_TRUE(batch.contains("skew_ms"));
+    EXPECT_GE(batch["skew_ms"].toDouble(), 0.0);
+    
+    const double skewNs = batch["batch_end_ns"].toDouble() - batch["batch_start_ns"].toDouble();
+    QJsonArray modulesArray = batch["modules"].toArray();
+    ASSERT_EQ(modulesArray.size(), 2);
+    for (const QJsonValue& val : modulesArray) {
+        QJsonObject moduleObj = val.toObject();
+        EXPECT_TRUE(moduleObj.contains("name"));
+        EXPECT_TRUE(moduleObj.contains("window_ms"));
+        EXPECT_GE(moduleObj["read_offset_ns"].toDouble(), 0.0);
+        EXPECT_LE(moduleObj["read_offset_ns"].toDouble(), skewNs);
+    }
+    
+    delete[] result;
+}
+
+// =============================================================================
+// JsonWriter / QJsonDocument Parity Tests
+// =============================================================================
+
+// Verifies that the streaming writer produces the same bytes as QJsonDocument
+TEST_F(ProcessStatsTest, JsonWriter_MatchesQJsonDocumentByteForByte) {
+    const double values[] = {0.0, 1.0, -2.5, 0.1, 1.0 / 3.0, 12.345, 0.0001, 0.00001,
+                             1.5e-7, 10000.0, 100000.0, 123456.0, 6.02e23, 1234567890123.0};
+    
+    ProcessStats::Snapshot snapshot;
+    QJsonArray expected;
+    int index = 0;
+    for (double value : values) {
+        ProcessStats::ModuleSample module;
+        module.name = "module_" + std::to_string(index++) + "\t\"q\"";
+        module.stats = {value, value * 7.0, value / 3.0};
+        snapshot.modules.push_back(module);
+        
+        QJsonObject moduleObj;
+        moduleObj["name"] = QString::fromStdString(module.name);
+        moduleObj["cpu_percent"] = module.stats.cpuPercent;
+        moduleObj["cpu_time_seconds"] = module.stats.cpuTimeSeconds;
+        moduleObj["memory_mb"] = module.stats.memoryMB;
+        expected.append(moduleObj);
+    }
+    
+    ProcessStats::JsonWriter writer;
+    ProcessStats::writeModuleStatsJson(writer, snapshot);
+    
+    EXPECT_EQ(QByteArray::fromStdString(writer.buffer()), QJsonDocument(expected).toJson(QJsonDocument::Compact));
+}
+
+// Verifies that setJsonPrecision() limits the digits of getModuleStats()
+TEST_F(ProcessStatsTest, SetJsonPrecision_LimitsSignificantDigits) {
+    QHash<QString, qint64> processes;
+    processes["self"] = getpid();
+    
+    ProcessStats::setJsonPrecision(1);
+    char* json = ProcessStats::getModuleStats(processes);
+    ProcessStats::setJsonPrecision(0);
+    
+    const std::string text(json);
+    delete[] json;
+    const std::size_t memory = text.find("\"memory_mb\":");
+    ASSERT_NE(memory, std::string::npos) << text;
+    // One nonzero digit, then the end of the value or an exponent
+    const std::size_t digit = memory + strlen("\"memory_mb\":");
+    EXPECT_NE(std::string("123456789").find(text[digit]), std::string::npos) << text;
+    EXPECT_NE(std::string(",}e").find(text[digit + 1]), std::string::npos) << text;
+}
+
+// =============================================================================
+// sampleModulesAsync Tests
+// =============================================================================
+
+// Verifies that the future finishes with a snapshot of the requested processes
+TEST_F(ProcessStatsTest, SampleModulesAsync_FinishesFuture) {
+    QHash<QString, qint64> processes;
+    processes["self"] = getpid();
+    
+    QFuture<ProcessStats::Snapshot> future = ProcessStats::sampleModulesAsync(processes);
+    future.waitForFinished();
+    
+    ASSERT_FALSE(future.isCanceled());
+    ProcessStats::Snapshot snapshot = future.result();
+    ASSERT_EQ(snapshot.modules.size(), 1u);
+    EXPECT_EQ(snapshot.modules[0].name, "self");
+    EXPECT_GT(snapshot.modules[0].stats.memoryMB, 0.0);
+}
+
+// Verifies that the callback is queued to the context's thread and skipped
+// once the future is cancelled
+TEST_F(ProcessStatsTest, SampleModulesAsync_DeliversCallbackThroughEventLoop) {
+    int argc = 1;
+    char name[] = "process_stats_tests";
+    char* argv[] = {name, nullptr};
+    QCoreApplication app(argc, argv);
+    QObject context;
+    
+    QHash<QString, qint64> processes;
+    processes["self"] = getpid();
+    
+    int calls = 0;
+    QThread* deliveredOn = nullptr;
+    auto callback = [&](const ProcessStats::Snapshot& snapshot) {
+        EXPECT_EQ(snapshot.modules.size(), 1u);
+        deliveredOn = QThread::currentThread();
+        ++calls;
+    };
+    QFuture<ProcessStats::Snapshot> delivered = ProcessStats::sampleModulesAsync(processes, &context, callback);
+    delivered.waitForFinished();
+    QFuture<ProcessStats::Snapshot> cancelled = ProcessStats::sampleModulesAsync(processes, &context, callback);
+    cancelled.waitForFinished();
+    cancelled.cancel();
+    
+    // Nothing runs on this thread until its event loop does
+    EXPECT_EQ(calls, 0);
+    QElapsedTimer timer;
+    timer.start();
+    while (calls == 0 && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+    }
+    QCoreApplication::processEvents();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(deliveredOn, context.thread());
+    
+    // A context destroyed before delivery takes its pending callback along
+    auto* shortLived = new QObject();
+    QFuture<ProcessStats::Snapshot> orphaned = ProcessStats::sampleModulesAsync(processes, shortLived, callback);
+    orphaned.waitForFinished();
+    delete shortLived;
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    EXPECT_EQ(calls, 1);
+}
@@ -0,0 +1,247 @@
+/*
+ * C API tests, built as C to catch anything in process_stats_c.h that only a
+ * C++ compiler accepts. Exits nonzero if any check fails.
+ */
+#include "binary_snapshot_format.h"
+#include "process_stats_c.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,   \
+                    #condition);                                                \
+            ++failures;                                                         \
+        }                                                                       \
+    } while (0)
+
+/* Reads format into a freshly allocated, NUL-terminated buffer */
+static char* readAll(ps_sampler* sampler, ps_format format, size_t* length)
+{
+    char* buffer;
+    *length = ps_sampler_read(sampler, format, NULL, 0);
+    buffer = (char*)malloc(*length + 1);
+    if (buffer && ps_sampler_read(sampler, format, buffer, *length + 1) != *length) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+/* Registration is validated, and a name registers only once */
+static void testRegistration(void)
+{
+    ps_sampler* sampler = ps_sampler_create(NULL);
+    CHECK(sampler != NULL);
+
+    errno = 0;
+    CHECK(ps_sampler_add_pid(sampler, NULL, getpid()) == -1 && errno == EINVAL);
+    errno = 0;
+    CHECK(ps_sampler_add_pid(sampler, "zero", 0) == -1 && errno == EINVAL);
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_add_pid(sampler, "parent", getppid()) == 0);
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_module_count(sampler) == 2);
+
+    CHECK(ps_sampler_remove(sampler, "parent") == 0);
+    errno = 0;
+    CHECK(ps_sampler_remove(sampler, "parent") == -1 && errno == ENOENT);
+    CHECK(ps_sampler_module_count(sampler) == 1);
+
+    ps_sampler_destroy(sampler);
+    ps_sampler_destroy(NULL);
+}
+
+/* Every format reports the last sample, with snprintf-style truncation */
+static void testReadFormats(void)
+{
+    char small[8];
+    char* json;
+    char* text;
+    void* binary;
+    size_t length;
+    ps_sampler* sampler = ps_sampler_create(NULL);
+
+    errno = 0;
+    CHECK(ps_sampler_read(sampler, PS_FORMAT_JSON, NULL, 0) == 0 && errno == ENODATA);
+
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_add_pid(sampler, "parent", getppid()) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+
+    json = readAll(sampler, PS_FORMAT_JSON, &length);
+    CHECK(json != NULL && strlen(json) == length);
+    CHECK(json != NULL && json[0] == '[' && strstr(json, "\"name\":\"self\"") != NULL);
+    CHECK(ps_sampler_read(sampler, PS_FORMAT_JSON, small, sizeof(small)) == length);
+    CHECK(strlen(small) == sizeof(small) - 1 && strncmp(small, json, sizeof(small) - 1) == 0);
+    free(json);
+
+    text = readAll(sampler, PS_FORMAT_BATCH_JSON, &length);
+    CHECK(text != NULL && strstr(text, "\"batch_start_ns\"") != NULL);
+    free(text);
+
+    text = readAll(sampler, PS_FORMAT_PROMETHEUS, &length);
+    CHECK(text != NULL && strstr(text, "module=\"parent\"") != NULL);
+    free(text);
+
+    /* malloc returns memory aligned for any type, which covers 8 bytes */
+    length = ps_sampler_read(sampler, PS_FORMAT_BINARY, NULL, 0);
+    binary = malloc(length);
+    CHECK(binary != NULL && ps_sampler_read(sampler, PS_FORMAT_BINARY, binary, length) == length);
+    if (binary) {
+        const ps_snapshot_header* header = ps_snapshot_validate(binary, length);
+        CHECK(header != NULL);
+        if (header) {
+            const ps_module_record* record = ps_snapshot_record(header, 0);
+            const char* name = ps_snapshot_name(header, record);
+            CHECK(header->module_count == 2);
+            CHECK(header->sequence == 1);
+            CHECK(name != NULL && strcmp(name, "self") == 0);
+            CHECK(record->pid == getpid());
+            CHECK(record->memory_mb > 0.0);
+        }
+        free(binary);
+    }
+
+    errno = 0;
+    CHECK(ps_sampler_read(sampler, (ps_format)99, NULL, 0) == 0 && errno == EINVAL);
+    ps_sampler_destroy(sampler);
+}
+
+/* Options carry their size, so older callers keep working */
+static void testOptions(void)
+{
+    ps_sampler_options options;
+    ps_sampler* sampler;
+    char* json;
+    size_t length;
+
+    memset(&options, 0, sizeof(options));
+    errno = 0;
+    CHECK(ps_sampler_create(&options) == NULL && errno == EINVAL);
+
+    /* A caller built before sampling_threads existed */
+    options.size = sizeof(uint32_t);
+    sampler = ps_sampler_create(&options);
+    CHECK(sampler != NULL);
+    ps_sampler_destroy(sampler);
+
+    options.size = sizeof(options);
+    options.sampling_threads = 2;
+    options.aligned_timestamps = 1;
+    sampler = ps_sampler_create(&options);
+    CHECK(sampler != NULL);
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+    CHECK(ps_sampler_read(sampler, PS_FORMAT_JSON, NULL, 0) > 0);
+    ps_sampler_destroy(sampler);
+
+    /* One significant digit: memory in MB renders as an exponent */
+    options.json_precision = 1;
+    sampler = ps_sampler_create(&options);
+    CHECK(sampler != NULL);
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+    json = readAll(sampler, PS_FORMAT_JSON, &length);
+    CHECK(json != NULL && strstr(json, "\"memory_mb\":") != NULL);
+    if (json) {
+        const char* memory = strstr(json, "\"memory_mb\":");
+        CHECK(memory != NULL && strchr("123456789", memory[12]) != NULL
+              && (memory[13] == ',' || memory[13] == 'e' || memory[13] == '}'));
+    }
+    free(json);
+    ps_sampler_destroy(sampler);
+}
+
+/* The sampler's own cost, and the __process_stats__ entry when asked for */
+static void testSelfStats(void)
+{
+    ps_sampler_options options;
+    ps_self_stats stats;
+    char* json;
+    size_t length;
+    ps_sampler* sampler;
+
+    memset(&options, 0, sizeof(options));
+    options.size = sizeof(options);
+    options.sampling_threads = 1;
+    options.self_stats = 1;
+    sampler = ps_sampler_create(&options);
+    CHECK(sampler != NULL);
+    CHECK(ps_sampler_self_stats(sampler, NULL) == -1 && errno == EINVAL);
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+    CHECK(ps_sampler_self_stats(sampler, &stats) == 0);
+
+#if !defined(PROCESS_STATS_SELF_STATS) || PROCESS_STATS_SELF_STATS
+    CHECK(stats.ticks == 1 && stats.pids_sampled == 1);
+    json = readAll(sampler, PS_FORMAT_JSON, &length);
+    CHECK(json != NULL && strstr(json, "\"name\":\"__process_stats__\"") != NULL);
+    free(json);
+    CHECK(ps_sampler_self_stats(sampler, &stats) == 0 && stats.serialize_ns > 0);
+#else
+    CHECK(stats.ticks == 0);
+    (void)json;
+    (void)length;
+#endif
+    ps_sampler_destroy(sampler);
+}
+
+/* Every format says which modules could not be read */
+static void testModuleStatus(void)
+{
+    char* text;
+    void* binary;
+    size_t length;
+    ps_sampler* sampler = ps_sampler_create(NULL);
+
+    /* Far above any pid_max */
+    CHECK(ps_sampler_add_pid(sampler, "self", getpid()) == 0);
+    CHECK(ps_sampler_add_pid(sampler, "gone", 1 << 30) == 0);
+    CHECK(ps_sampler_sample(sampler) == 0);
+
+    text = readAll(sampler, PS_FORMAT_JSON, &length);
+    CHECK(text != NULL && strstr(text, "\"status\":\"exited\"") != NULL);
+    free(text);
+
+    text = readAll(sampler, PS_FORMAT_PROMETHEUS, &length);
+    CHECK(text != NULL && strstr(text, "process_stats_module_status{module=\"gone\"") != NULL);
+    CHECK(text != NULL && strstr(text, ",status=\"exited\"} 1\n") != NULL);
+    free(text);
+
+    length = ps_sampler_read(sampler, PS_FORMAT_BINARY, NULL, 0);
+    binary = malloc(length);
+    CHECK(binary != NULL && ps_sampler_read(sampler, PS_FORMAT_BINARY, binary, length) == length);
+    if (binary) {
+        const ps_snapshot_header* header = ps_snapshot_validate(binary, length);
+        CHECK(header != NULL && header->module_count == 2);
+        if (header && header->module_count == 2) {
+            CHECK(ps_module_status(header, ps_snapshot_record(header, 0)) == PS_MODULE_OK);
+            CHECK(ps_module_status(header, ps_snapshot_record(header, 1)) == PS_MODULE_EXITED);
+        }
+        free(binary);
+    }
+    ps_sampler_destroy(sampler);
+}
+
+int main(void)
+{
+    testRegistration();
+    testReadFormats();
+    testOptions();
+    testSelfStats();
+    testModuleStatus();
+    if (failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All C API checks passed\n");
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "prometheus_writer.h"
+#include <cmath>
+#include <limits>
+#include <map>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::PrometheusWriter;
+using ProcessStats::Snapshot;
+
+namespace {
+    Snapshot makeSnapshot(std::size_t modules) {
+        Snapshot snapshot;
+        snapshot.batchStartNs = 1000;
+        snapshot.batchEndNs = 2501000;
+        for (std::size_t i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(i);
+            module.pid = static_cast<int64_t>(100 + i);
+            module.stats = {i * 1.5, 10.0 + i, 64.0 + i / 4.0};
+            module.windowMs = 1000;
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    // Checks text against the Prometheus text exposition format 0.0.4:
+    // line grammar, metric/label names, escaped label values, float values,
+    // TYPE before samples, contiguous families and unique label sets.
+    // Returns an empty string if valid, otherwise the first problem found.
+    std::string validateExposition(const std::string& text) {
+        static const std::regex kHelp(R"(# HELP ([a-zA-Z_:][a-zA-Z0-9_:]*) (?:[^\\\n]|\\\\|\\n)*)");
+        static const std::regex kType(R"(# TYPE ([a-zA-Z_:][a-zA-Z0-9_:]*) (counter|gauge|histogram|summary|untyped))");
+        static const std::regex kSample(
+            R"(([a-zA-Z_:][a-zA-Z0-9_:]*))"
+            R"((\{(?:[a-zA-Z_][a-zA-Z0-9_]*="(?:[^"\\\n]|\\\\|\\"|\\n)*"(?:,[a-zA-Z_][a-zA-Z0-9_]*="(?:[^"\\\n]|\\\\|\\"|\\n)*")*,?)?\})?)"
+            R"( ([-+]?(?:[0-9]+(?:\.[0-9]*)?|\.[0-9]+)(?:[eE][-+]?[0-9]+)?|NaN|[-+]Inf))"
+            R"((?: -?[0-9]+)?)");
+
+        if (text.empty() || text.back() != '\n') {
+            return "output must end with a newline";
+        }
+
+        std::map<std::string, std::string> types;
+        std::set<std::string> finishedFamilies;
+        std::set<std::string> seriesSeen;
+        std::string currentFamily;
+
+        std::istringstream lines(text);
+        std::string line;
+        int number = 0;
+        while (std::getline(lines, line)) {
+            ++number;
+            const std::string where = "line " + std::to_string(number) + ": ";
+            std::smatch match;
+            if (std::regex_match(line, match, kHelp)) {
+                continue;
+            }
+            if (std::regex_match(line, match, kType)) {
+                const std::string name = match[1];
+                if (types.count(name)) {
+                    return where + "duplicate TYPE for " + name;
+                }
+                types[name] = match[2];
+                continue;
+            }
+            if (!std::regex_match(line, match, kSample)) {
+                return where + "not a valid sample: " + line;
+            }
+            const std::string name = match[1];
+            const std::string family = name;
+            if (!types.count(family)) {
+                return where + "sample before TYPE: " + name;
+            }
+            if (types[family] == "counter" && (name.size() < 6 || name.compare(name.size() - 6, 6, "_total") != 0)) {
+                return where + "counter without _total suffix: " + name;
+            }
+            if (family != currentFamily) {
+                if (finishedFamilies.count(family)) {
+                    return where + "family is not contiguous: " + family;
+                }
+                if (!currentFamily.empty()) {
+                    finishedFamilies.insert(currentFamily);
+                }
+                currentFamily = family;
+            }
+            if (!seriesSeen.insert(name + std::string(match[2])).second) {
+                return where + "duplicate series: " + line;
+            }
+        }
+        return std::string();
+    }
+
+    std::string renderValue(double value) {
+        std::string out;
+        PrometheusWriter::appendValue(out, value);
+        return out;
+    }
+}
+
+// =============================================================================
+// PrometheusWriter Tests
+// =============================================================================
+
+// Verifies that a rendered scrape passes the exposition format grammar
+TEST(PrometheusWriterTest, OutputMatchesExpositionGrammar) {
+    PrometheusWriter writer;
+    writer.render(makeSnapshot(25));
+    EXPECT_EQ(validateExposition(writer.buffer()), "");
+}
+
+// Verifies that the __process_stats__ series are valid and only written when present
+TEST(PrometheusWriterTest, WritesSelfStatsSeries) {
+    Snapshot snapshot = makeSnapshot(3);
+    PrometheusWriter writer;
+    writer.render(snapshot);
+    EXPECT_EQ(writer.buffer().find("__process_stats__"), std::string::npos);
+
+    snapshot.hasSelfStats = true;
+    snapshot.selfStats = {3, 6, 36, 1800, 40000, 5000, 7000, 2, 21000};
+    writer.render(snapshot);
+    EXPECT_EQ(validateExposition(writer.buffer()), "");
+    EXPECT_NE(writer.buffer().find("process_stats_self_ticks_total{module=\"__process_stats__\"} 3\n"),
+              std::string::npos);
+    EXPECT_NE(writer.buffer().find("process_stats_self_read_seconds_total{module=\"__process_stats__\"} 0.00004\n"),
+              std::string::npos) << writer.buffer();
+    EXPECT_NE(writer.buffer().find("# TYPE process_stats_self_max_tick_seconds gauge\n"), std::string::npos);
+}
+// Verifies that the validator itself rejects malformed exposition text
+TEST(PrometheusWriterTest, ValidatorRejectsMalformedText) {
+    EXPECT_NE(validateExposition("no_type 1\n"), "");
+    EXPECT_NE(validateExposition("# TYPE a gauge\na{x=\"1} 2\n"), "");
+    EXPECT_NE(validateExposition("# TYPE a gauge\na 1\n# TYPE b gauge\nb 1\na{x=\"y\"} 2\n"), "");
+    EXPECT_NE(validateExposition("# TYPE a gauge\na one\n"), "");
+    EXPECT_NE(validateExposition("# TYPE a gauge\na 1"), "");
+}
+
+// Verifies the exact lines written for one module
+TEST(PrometheusWriterTest, WritesModuleSeries) {
+    Snapshot snapshot = makeSnapshot(0);
+    ModuleSample module;
+    module.name = "chat";
+    module.pid = 42;
+    module.stats = {12.5, 3.25, 2.0};
+    module.windowMs = 1500;
+    snapshot.modules.push_back(module);
+
+    PrometheusWriter writer;
+    writer.render(snapshot);
+    const std::string& text = writer.buffer();
+    EXPECT_NE(text.find("\nprocess_stats_cpu_seconds_total{module=\"chat\",pid=\"42\"} 3.25\n"), std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_cpu_percent{module=\"chat\",pid=\"42\"} 12.5\n"), std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_resident_bytes{module=\"chat\",pid=\"42\"} 2097152\n"), std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_cpu_window_seconds{module=\"chat\",pid=\"42\"} 1.5\n"), std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_module_status{module=\"chat\",pid=\"42\",status=\"ok\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_modules 1\n"), std::string::npos);
+    EXPECT_NE(text.find("\nprocess_stats_batch_skew_seconds 0.0025\n"), std::string::npos);
+}
+
+// Verifies that each module's status is labelled on its status series
+TEST(PrometheusWriterTest, WritesModuleStatus) {
+    Snapshot snapshot = makeSnapshot(3);
+    snapshot.modules[1].status = ProcessStats::ModuleStatus::PermissionDenied;
+    snapshot.modules[2].status = ProcessStats::ModuleStatus::Zombie;
+
+    PrometheusWriter writer;
+    writer.render(snapshot);
+    const std::string& text = writer.buffer();
+    EXPECT_EQ(validateExposition(text), "");
+    EXPECT_NE(text.find("# TYPE process_stats_module_status gauge\n"), std::string::npos);
+    EXPECT_NE(text.find("process_stats_module_status{module=\"module_0\",pid=\"100\",status=\"ok\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("process_stats_module_status{module=\"module_1\",pid=\"101\",status=\"permission_denied\"} 1\n"),
+              std::string::npos) << text;
+    EXPECT_NE(text.find("process_stats_module_status{module=\"module_2\",pid=\"102\",status=\"zombie\"} 1\n"),
+              std::string::npos);
+}
+
+// Verifies that awkward module names are escaped and still valid
+TEST(PrometheusWriterTest, EscapesLabelValues) {
+    Snapshot snapshot = makeSnapshot(0);
+    ModuleSample module;
+    module.name = "odd \"name\"\\with\nnewline";
+    module.pid = 7;
+    module.stats = {1.0, 1.0, 1.0};
+    snapshot.modules.push_back(module);
+
+    PrometheusWriter writer;
+    writer.render(snapshot);
+    EXPECT_NE(writer.buffer().find("{module=\"odd \\\"name\\\"\\\\with\\nnewline\",pid=\"7\"}"), std::string::npos);
+    EXPECT_EQ(validateExposition(writer.buffer()), "");
+}
+
+// Verifies special float values use the exposition spelling
+TEST(PrometheusWriterTest, WritesSpecialValues) {
+    EXPECT_EQ(renderValue(std::numeric_limits<double>::quiet_NaN()), "NaN");
+    EXPECT_EQ(renderValue(std::numeric_limits<double>::infinity()), "+Inf");
+    EXPECT_EQ(renderValue(-std::numeric_limits<double>::infinity()), "-Inf");
+    EXPECT_EQ(renderValue(1e-7), "1e-07");
+}
+
+// Verifies that labels are cached across scrapes and dropped for departed modules
+TEST(PrometheusWriterTest, CachesLabelsPerModule) {
+    PrometheusWriter writer;
+    writer.render(makeSnapshot(10));
+    EXPECT_EQ(writer.cachedLabelCount(), 10u);
+
+    writer.render(makeSnapshot(10));
+    EXPECT_EQ(writer.cachedLabelCount(), 10u);
+
+    writer.render(makeSnapshot(4));
+    EXPECT_EQ(writer.cachedLabelCount(), 4u);
+    EXPECT_EQ(writer.buffer().find("module_7"), std::string::npos);
+    EXPECT_EQ(validateExposition(writer.buffer()), "");
+}
+
+// Verifies that a PID change for a known module re-renders its labels
+TEST(PrometheusWriterTest, PidChangeUpdatesLabels) {
+    Snapshot snapshot = makeSnapshot(1);
+    PrometheusWriter writer;
+    writer.render(snapshot);
+
+    snapshot.modules[0].pid = 999;
+    writer.render(snapshot);
+    EXPECT_NE(writer.buffer().find("pid=\"999\""), std::string::npos);
+    EXPECT_EQ(writer.buffer().find("pid=\"100\""), std::string::npos);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "replay_source.h"
+#include "sampler.h"
+#include "snapshot_recorder.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::ProcessStatsData;
+using ProcessStats::RawCounters;
+using ProcessStats::ReplayOptions;
+using ProcessStats::ReplaySource;
+using ProcessStats::Sampler;
+using ProcessStats::SamplerOptions;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotRecorder;
+
+namespace {
+    constexpr int64_t kStartMs = 1700000000000;
+    constexpr int kRows = 600;
+
+    std::string recordingPath(const char* name) {
+        return "/tmp/process_stats_replay_" + std::string(name) + "_" + std::to_string(getpid()) + ".psrc";
+    }
+
+    // One row per second; module m uses m% CPU, and module_9 exits after
+    // row 99
+    void record(const std::string& path) {
+        std::remove(path.c_str());
+        auto recorder = SnapshotRecorder::open(path, 4096);
+        ASSERT_NE(recorder, nullptr) << std::strerror(errno);
+        for (int row = 0; row < kRows; ++row) {
+            Snapshot snapshot;
+            snapshot.timestampMs = kStartMs + row * 1000;
+            for (int m = 0; m < (row < 100 ? 10 : 9); ++m) {
+                ModuleSample module;
+                module.name = "module_" + std::to_string(m);
+                module.stats.cpuPercent = m;
+                module.stats.cpuTimeSeconds = (row * m) / 100.0;
+                module.stats.memoryMB = 10.0 + m + (row % 4) / 4.0;
+                snapshot.modules.push_back(module);
+            }
+            recorder->record(snapshot);
+        }
+    }
+
+    SamplerOptions replayOptions(std::shared_ptr<ReplaySource> source) {
+        SamplerOptions options;
+        options.source = std::move(source);
+        return options;
+    }
+}
+
+// =============================================================================
+// ReplaySource Tests
+// =============================================================================
+
+// Verifies that stepping a replay through a Sampler reproduces the recorded
+// counters and recomputes CPU percentages from them
+TEST(ReplaySourceTest, StepsRowsThroughSampler) {
+    const std::string path = recordingPath("step");
+    record(path);
+    ReplayOptions options;
+    options.speed = 0;
+    auto replay = ReplaySource::open(path, options);
+    ASSERT_NE(replay, nullptr) << std::strerror(errno);
+    EXPECT_EQ(replay->rowTimeMs(), kStartMs);
+
+    Sampler sampler(replayOptions(replay));
+    std::vector<int64_t> pids;
+    for (int m = 0; m < 9; ++m) {
+        pids.push_back(replay->pid("module_" + std::to_string(m)));
+        EXPECT_GT(pids.back(), 0);
+    }
+    std::vector<ProcessStatsData> stats(pids.size());
+    std::vector<int64_t> windows(pids.size());
+    int row = 0;
+    do {
+        EXPECT_EQ(sampler.source().wallTimeMs(), kStartMs + row * 1000);
+        sampler.sample(pids.data(), pids.size(), stats.data(), windows.data());
+        for (int m = 0; m < 9; ++m) {
+            EXPECT_DOUBLE_EQ(stats[m].cpuTimeSeconds, (row * m) / 100.0);
+            EXPECT_DOUBLE_EQ(stats[m].memoryMB, 10.0 + m + (row % 4) / 4.0);
+            if (row > 0) {
+                EXPECT_NEAR(stats[m].cpuPercent, m, 1e-9) << "row " << row;
+                EXPECT_EQ(windows[m], 1000);
+            }
+        }
+        ++row;
+    } while (replay->advance());
+    EXPECT_EQ(row, kRows);
+    EXPECT_EQ(replay->rowCount(), static_cast<uint64_t>(kRows));
+    EXPECT_TRUE(replay->atEnd());
+    EXPECT_FALSE(replay->advance());
+    std::remove(path.c_str());
+}
+
+// Verifies that a module missing from the current row reads as exited
+TEST(ReplaySourceTest, ModuleLeavingReadsAsExited) {
+    const std::string path = recordingPath("exit");
+    record(path);
+    ReplayOptions options;
+    options.speed = 0;
+    auto replay = ReplaySource::open(path, options);
+    ASSERT_NE(replay, nullptr);
+    const int64_t pid = replay->pid("module_9");
+    ASSERT_GT(pid, 0);
+    EXPECT_EQ(replay->pid("missing"), 0);
+
+    while (replay->rowTimeMs() < kStartMs + 99 * 1000) {
+        ASSERT_TRUE(replay->advance());
+    }
+    EXPECT_TRUE(replay->read(pid).valid);
+    EXPECT_EQ(replay->activeModules().size(), 10u);
+
+    ASSERT_TRUE(replay->advance());
+    const RawCounters counters = replay->read(pid);
+    EXPECT_FALSE(counters.valid);
+    EXPECT_EQ(counters.readTimeNs, (kStartMs + 100 * 1000) * 1000000);
+    EXPECT_EQ(replay->activeModules().size(), 9u);
+    for (const auto& module : replay->activeModules()) {
+        EXPECT_EQ(module.second, replay->pid(module.first));
+    }
+    EXPECT_FALSE(replay->read(0).valid);
+    EXPECT_FALSE(replay->read(1000).valid);
+    std::remove(path.c_str());
+}
+
+// Verifies that a replay can start part way through and not past the end
+TEST(ReplaySourceTest, StartsAtRequestedTime) {
+    const std::string path = recordingPath("start");
+    record(path);
+    ReplayOptions options;
+    options.speed = 0;
+    options.startMs = kStartMs + 450 * 1000 + 500;
+    auto replay = ReplaySource::open(path, options);
+    ASSERT_NE(replay, nullptr);
+    EXPECT_EQ(replay->rowTimeMs(), kStartMs + 451 * 1000);
+    EXPECT_EQ(replay->rowCount(), 1u);
+
+    options.startMs = kStartMs + kRows * 1000;
+    errno = 0;
+    EXPECT_EQ(ReplaySource::open(path, options), nullptr);
+    EXPECT_EQ(errno, ENODATA);
+    std::remove(path.c_str());
+}
+
+// Verifies that an accelerated clock moves through rows in real time
+TEST(ReplaySourceTest, AcceleratedClockFollowsRealTime) {
+    const std::string path = recordingPath("speed");
+    record(path);
+    ReplayOptions options;
+    options.speed = 1000;  // a recorded second per real millisecond
+    auto replay = ReplaySource::open(path, options);
+    ASSERT_NE(replay, nullptr);
+
+    replay->beginTick();
+    const int64_t startNs = replay->nowNs();
+    const int64_t startRowMs = replay->rowTimeMs();
+    usleep(100 * 1000);
+
+    // Reading the clock does not move rows; only a new tick does
+    EXPECT_GT(replay->nowNs(), startNs);
+    EXPECT_EQ(replay->rowTimeMs(), startRowMs);
+    replay->beginTick();
+    const int64_t elapsedNs = replay->nowNs() - startNs;
+    EXPECT_GE(elapsedNs, 100 * 1000000000LL);
+    EXPECT_LT(elapsedNs, 400 * 1000000000LL);
+    EXPECT_GE(replay->rowTimeMs(), kStartMs + 100 * 1000);
+    EXPECT_LE(replay->rowTimeMs() * 1000000, startNs + elapsedNs);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,409 @@
+#include <gtest/gtest.h>
+#include "sampler.h"
+#include "work_stealing_pool.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Sampler;
+using ProcessStats::SamplerOptions;
+using ProcessStats::WorkStealingPool;
+
+// =============================================================================
+// WorkStealingPool Tests
+// =============================================================================
+
+// Verifies that parallelFor() visits every index exactly once for a range of
+// worker counts and chunk sizes
+TEST(WorkStealingPoolTest, ParallelForVisitsEveryIndexOnce) {
+    for (std::size_t workers : {1u, 2u, 4u, 8u}) {
+        WorkStealingPool pool(workers);
+        for (std::size_t chunkSize : {1u, 3u, 64u, 1000u}) {
+            constexpr std::size_t kCount = 997;
+            std::vector<std::atomic<int>> visits(kCount);
+            pool.parallelFor(kCount, chunkSize, [&](std::size_t begin, std::size_t end) {
+                ASSERT_LE(end - begin, chunkSize);
+                for (std::size_t i = begin; i < end; ++i) {
+                    visits[i].fetch_add(1);
+                }
+            });
+            for (std::size_t i = 0; i < kCount; ++i) {
+                EXPECT_EQ(visits[i].load(), 1) << "workers=" << workers << " chunk=" << chunkSize << " i=" << i;
+            }
+        }
+    }
+}
+
+// Verifies that an empty range does not call the body
+TEST(WorkStealingPoolTest, ParallelForWithNoItemsDoesNothing) {
+    WorkStealingPool pool(4);
+    int calls = 0;
+    pool.parallelFor(0, 16, [&](std::size_t, std::size_t) { ++calls; });
+    EXPECT_EQ(calls, 0);
+}
+
+// Verifies that idle workers steal chunks from a busy worker
+TEST(WorkStealingPoolTest, IdleWorkersStealFromBusyWorker) {
+    WorkStealingPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    // Chunk 0 belongs to the calling thread and blocks it long enough for the
+    // other workers to drain their own runs and steal the rest of its run
+    pool.parallelFor(64, 1, [&](std::size_t begin, std::size_t) {
+        if (begin == 0) {
+            usleep(50000);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+
+    EXPECT_GT(threads.size(), 1u);
+}
+
+// Verifies that the pool can run many loops back to back
+TEST(WorkStealingPoolTest, RunsConsecutiveLoops) {
+    WorkStealingPool pool(3);
+    std::atomic<std::size_t> total{0};
+    for (int round = 0; round < 200; ++round) {
+        pool.parallelFor(50, 4, [&](std::size_t begin, std::size_t end) {
+            total.fetch_add(end - begin);
+        });
+    }
+    EXPECT_EQ(total.load(), 200u * 50u);
+}
+
+// =============================================================================
+// Sampler Tests
+// =============================================================================
+
+// Verifies that results land at the index of their PID, whatever the worker count
+TEST(SamplerTest, ParallelSampleKeepsStableOrder) {
+    const int64_t self = getpid();
+    std::vector<int64_t> pids;
+    for (int i = 0; i < 40; ++i) {
+        pids.push_back(i % 4 == 3 ? -1 : self);
+    }
+
+    for (std::size_t workers : {1u, 2u, 4u}) {
+        SamplerOptions options;
+        options.workerCount = workers;
+        options.chunkSize = 3;
+        Sampler sampler(options);
+
+        std::vector<ProcessStatsData> out(pids.size());
+        sampler.sample(pids.data(), pids.size(), out.data());
+
+        for (std::size_t i = 0; i < pids.size(); ++i) {
+            if (pids[i] > 0) {
+                EXPECT_GT(out[i].memoryMB, 0.0) << "index " << i;
+            } else {
+                EXPECT_EQ(out[i].memoryMB, 0.0) << "index " << i;
+                EXPECT_EQ(out[i].cpuTimeSeconds, 0.0) << "index " << i;
+            }
+        }
+    }
+}
+
+// Verifies that CPU percent is zero on the first reading and non-negative after
+TEST(SamplerTest, CpuPercentNeedsBaseline) {
+    Sampler sampler;
+    const int64_t self = getpid();
+
+    ProcessStatsData first = sampler.sampleProcess(self);
+    EXPECT_EQ(first.cpuPercent, 0.0);
+
+    volatile double sum = 0.0;
+    for (int i = 0; i < 1000000; ++i) {
+        sum += i * 0.1;
+    }
+    usleep(10000);
+
+    ProcessStatsData second = sampler.sampleProcess(self);
+    EXPECT_GE(second.cpuPercent, 0.0);
+}
+
+// Verifies that retainOnly() drops baselines for PIDs that are no longer tracked
+TEST(SamplerTest, RetainOnlyDropsOtherBaselines) {
+    Sampler sampler;
+    const int64_t self = getpid();
+    sampler.sampleProcess(self);
+
+    const int64_t other = self + 1;
+    sampler.retainOnly(&other, 1);
+
+    // Baseline gone, so this is a first reading again
+    ProcessStatsData stats = sampler.sampleProcess(self);
+    EXPECT_EQ(stats.cpuPercent, 0.0);
+}
+
+// Verifies that the worker count can be changed between ticks
+TEST(SamplerTest, SetWorkerCountRebuildsPool) {
+    Sampler sampler;
+    sampler.setWorkerCount(4);
+    EXPECT_EQ(sampler.options().workerCount, 4u);
+
+    const int64_t self = getpid();
+    std::vector<int64_t> pids(10, self);
+    std::vector<ProcessStatsData> out(pids.size());
+    sampler.sample(pids.data(), pids.size(), out.data());
+    for (const ProcessStatsData& stats : out) {
+        EXPECT_GT(stats.memoryMB, 0.0);
+    }
+}
+
+// Verifies that every read time falls inside the batch bounds
+TEST(SamplerTest, ReadTimesFallInsideBatchTiming) {
+    Sampler sampler;
+    const int64_t self = getpid();
+    std::vector<int64_t> pids(20, self);
+    std::vector<ProcessStatsData> out(pids.size());
+    std::vector<int64_t> readTimes(pids.size());
+
+    sampler.sample(pids.data(), pids.size(), out.data(), nullptr, readTimes.data());
+
+    const ProcessStats::BatchTiming& timing = sampler.lastBatchTiming();
+    EXPECT_LE(timing.startNs, timing.endNs);
+    for (int64_t readTime : readTimes) {
+        EXPECT_GE(readTime, timing.startNs);
+        EXPECT_LE(readTime, timing.endNs);
+    }
+}
+
+// Verifies that in batch mode every module in a tick shares one window
+TEST(SamplerTest, AlignedBatchSharesOneWindow) {
+    SamplerOptions options;
+    options.alignBatchTimestamps = true;
+    Sampler sampler(options);
+
+    std::vector<int64_t> pids = {getpid(), getppid(), 1};
+    std::vector<ProcessStatsData> out(pids.size());
+    std::vector<int64_t> windows(pids.size());
+
+    sampler.sample(pids.data(), pids.size(), out.data(), windows.data());
+    usleep(20000);
+    sampler.sample(pids.data(), pids.size(), out.data(), windows.data());
+
+    EXPECT_GE(windows[0], 15);
+    EXPECT_EQ(windows[1], windows[0]);
+    EXPECT_EQ(windows[2], windows[0]);
+}
+
+// Verifies that column output carries the same values as row output and
+// skips null columns
+TEST(SamplerTest, ColumnsMatchRowLayout) {
+    // Deterministic counters: pid p has used p seconds per tick
+    struct CountingSource : ProcessStats::SampleSource {
+        int64_t tick = 0;
+        int64_t nowNs() override { return tick * 1000000000; }
+        int64_t wallTimeMs() override { return tick * 1000; }
+        ProcessStats::RawCounters read(int64_t pid) const override {
+            ProcessStats::RawCounters counters;
+            counters.cpuTimeSeconds = pid * tick / 100.0;
+            counters.memoryMB = pid * 2.0;
+            counters.readTimeNs = tick * 1000000000;
+            counters.valid = pid < 100;
+            return counters;
+        }
+    };
+    auto rowSource = std::make_shared<CountingSource>();
+    auto columnSource = std::make_shared<CountingSource>();
+    SamplerOptions options;
+    options.source = rowSource;
+    Sampler rows(options);
+    options.source = columnSource;
+    Sampler columns(options);
+
+    const std::vector<int64_t> pids = {5, -1, 50, 200, 7};
+    std::vector<ProcessStatsData> expected(pids.size());
+    std::vector<int64_t> expectedWindows(pids.size());
+    std::vector<double> cpuPercent(pids.size(), -1.0);
+    std::vector<double> memoryMB(pids.size(), -1.0);
+    std::vector<int64_t> windows(pids.size(), -1);
+    ProcessStats::ProcessStatsColumns out;
+    out.cpuPercent = cpuPercent.data();
+    out.memoryMB = memoryMB.data();
+    out.windowMs = windows.data();
+
+    for (int64_t tick = 1; tick <= 3; ++tick) {
+        rowSource->tick = tick;
+        columnSource->tick = tick;
+        rows.sample(pids.data(), pids.size(), expected.data(), expectedWindows.data());
+        columns.sample(pids.data(), pids.size(), out);
+        for (std::size_t i = 0; i < pids.size(); ++i) {
+            EXPECT_EQ(cpuPercent[i], expected[i].cpuPercent) << "tick " << tick << " index " << i;
+            EXPECT_EQ(memoryMB[i], expected[i].memoryMB) << "tick " << tick << " index " << i;
+            EXPECT_EQ(windows[i], expectedWindows[i]) << "tick " << tick << " index " << i;
+        }
+    }
+    EXPECT_DOUBLE_EQ(cpuPercent[0], 5.0);
+    EXPECT_EQ(windows[0], 1000);
+    EXPECT_EQ(cpuPercent[3], 0.0);
+    EXPECT_EQ(memoryMB[1], 0.0);
+}
+
+// Verifies that PIDs the source reports as gone are retried after a delay
+// that doubles up to the maximum, and that a recovered PID is read again
+TEST(SamplerTest, NegativeCacheBacksOffFailingPids) {
+    using ProcessStats::ModuleStatus;
+    // Time is in whole milliseconds; pid 1 is fine, the others fail as set
+    struct FailingSource : ProcessStats::SampleSource {
+        int64_t nowMs = 0;
+        ModuleStatus failure = ModuleStatus::Exited;
+        bool failing = true;
+        int64_t nowNs() override { return nowMs * 1000000; }
+        int64_t wallTimeMs() override { return nowMs; }
+        ProcessStats::RawCounters read(int64_t pid) const override {
+            ProcessStats::RawCounters counters;
+            counters.readTimeNs = nowMs * 1000000;
+            if (pid != 1 && failing) {
+                counters.status = failure;
+                return counters;
+            }
+            counters.cpuTimeSeconds = nowMs / 1000.0;
+            counters.memoryMB = 1.0;
+            counters.valid = true;
+            return counters;
+        }
+    };
+    auto source = std::make_shared<FailingSource>();
+    SamplerOptions options;
+    options.source = source;
+    options.retryBackoffMinMs = 100;
+    options.retryBackoffMaxMs = 400;
+    Sampler sampler(options);
+
+    const std::vector<int64_t> pids = {1, 2};
+    std::vector<ProcessStatsData> out(pids.size());
+    std::vector<ModuleStatus> status(pids.size());
+    auto tickAt = [&](int64_t ms) {
+        source->nowMs = ms;
+        const uint64_t reads = sampler.readCount();
+        sampler.sample(pids.data(), pids.size(), out.data(), nullptr, nullptr, status.data());
+        return sampler.readCount() - reads;
+    };
+
+    EXPECT_EQ(tickAt(0), 2u);
+    EXPECT_EQ(status[0], ModuleStatus::Ok);
+    EXPECT_EQ(status[1], ModuleStatus::Exited);
+    EXPECT_EQ(sampler.backoffCount(), 1u);
+
+    // Retries come 100, 200, 400 and then every 400 ms
+    EXPECT_EQ(tickAt(50), 1u);
+    EXPECT_EQ(status[1], ModuleStatus::Exited);
+    EXPECT_EQ(out[1].memoryMB, 0.0);
+    EXPECT_EQ(tickAt(100), 2u);
+    EXPECT_EQ(tickAt(299), 1u);
+    EXPECT_EQ(tickAt(300), 2u);
+    EXPECT_EQ(tickAt(699), 1u);
+    EXPECT_EQ(tickAt(700), 2u);
+    EXPECT_EQ(tickAt(1099), 1u);
+    EXPECT_EQ(tickAt(1100), 2u);
+
+    // The status reported while waiting is the one last read
+    source->failure = ModuleStatus::PermissionDenied;
+    EXPECT_EQ(tickAt(1500), 2u);
+    EXPECT_EQ(status[1], ModuleStatus::PermissionDenied);
+    EXPECT_EQ(tickAt(1600), 1u);
+    EXPECT_EQ(status[1], ModuleStatus::PermissionDenied);
+
+    source->failing = false;
+    EXPECT_EQ(tickAt(1900), 2u);
+    EXPECT_EQ(status[1], ModuleStatus::Ok);
+    EXPECT_EQ(sampler.backoffCount(), 0u);
+    EXPECT_EQ(tickAt(1950), 2u);
+    EXPECT_GT(out[1].memoryMB, 0.0);
+
+    // Forgetting a PID, or a zero minimum delay, reads it every time
+    source->failing = true;
+    tickAt(2000);
+    EXPECT_EQ(sampler.backoffCount(), 1u);
+    sampler.forget(2);
+    EXPECT_EQ(tickAt(2001), 2u);
+    sampler.retainOnly(pids.data(), 1);
+    EXPECT_EQ(sampler.backoffCount(), 0u);
+
+    options.retryBackoffMinMs = 0;
+    Sampler uncached(options);
+    for (int i = 0; i < 3; ++i) {
+        uncached.sample(pids.data(), pids.size(), out.data(), nullptr, nullptr, status.data());
+        EXPECT_EQ(status[1], ModuleStatus::PermissionDenied);
+    }
+    EXPECT_EQ(uncached.readCount(), 6u);
+    EXPECT_EQ(uncached.backoffCount(), 0u);
+}
+
+#ifdef __linux__
+// Verifies the status of a child that has exited but is not yet reaped, and
+// once it is
+TEST(SamplerTest, ReportsZombieAndExitedProcesses) {
+    using ProcessStats::ModuleStatus;
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        _exit(0);
+    }
+
+    ProcessStats::RawCounters counters;
+    for (int i = 0; i < 500 && counters.status != ModuleStatus::Zombie; ++i) {
+        usleep(2000);
+        counters = ProcessStats::readRawCounters(child);
+    }
+    EXPECT_FALSE(counters.valid);
+    EXPECT_EQ(counters.status, ModuleStatus::Zombie);
+
+    SamplerOptions options;
+    options.retryBackoffMinMs = 0;
+    Sampler sampler(options);
+    ModuleStatus status = ModuleStatus::Ok;
+    const ProcessStatsData zombie = sampler.sampleProcess(child, &status);
+    EXPECT_EQ(status, ModuleStatus::Zombie);
+    EXPECT_EQ(zombie.memoryMB, 0.0);
+
+    ASSERT_EQ(waitpid(child, nullptr, 0), child);
+    sampler.sampleProcess(child, &status);
+    EXPECT_EQ(status, ModuleStatus::Exited);
+    sampler.sampleProcess(-1, &status);
+    EXPECT_EQ(status, ModuleStatus::Exited);
+    sampler.sampleProcess(getpid(), &status);
+    EXPECT_EQ(status, ModuleStatus::Ok);
+}
+#endif
+
+// Verifies that a sampler counts its own ticks, reads and time spent
+TEST(SamplerTest, CountsOwnOverhead) {
+    Sampler sampler;
+    if (!ProcessStats::kSelfStatsEnabled) {
+        sampler.sampleProcess(getpid());
+        EXPECT_EQ(sampler.selfStats().load().ticks, 0u);
+        return;
+    }
+    const std::vector<int64_t> pids = {getpid(), getpid(), -1};
+    std::vector<ProcessStatsData> out(pids.size());
+    sampler.sample(pids.data(), pids.size(), out.data());
+    sampler.sample(pids.data(), pids.size(), out.data());
+    sampler.sampleProcess(getpid());
+
+    const ProcessStats::SelfStats stats = sampler.selfStats().load();
+    EXPECT_EQ(stats.ticks, 3u);
+    EXPECT_EQ(stats.pidsSampled, 5u);
+#ifdef __linux__
+    // open, read and close of stat and statm per PID
+    EXPECT_EQ(stats.syscalls, 30u);
+    EXPECT_GT(stats.bytesRead, 5u * 20);
+#endif
+    EXPECT_GT(stats.readNs, 0u);
+    EXPECT_GE(stats.maxTickNs, stats.readNs / stats.ticks);
+    EXPECT_EQ(stats.serializeNs, 0u);
+    EXPECT_EQ(stats.allocations, 1u);   // the read buffer, grown once
+
+    sampler.selfStats().reset();
+    EXPECT_EQ(sampler.selfStats().load().ticks, 0u);
+    EXPECT_EQ(sampler.selfStats().load().maxTickNs, 0u);
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include "binary_snapshot.h"
+#include "shm_snapshot_publisher.h"
+#include "shm_snapshot_reader.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using ProcessStats::BinarySnapshotView;
+using ProcessStats::ModuleSample;
+using ProcessStats::ShmSnapshotPublisher;
+using ProcessStats::ShmSnapshotReader;
+using ProcessStats::Snapshot;
+
+namespace {
+    // Every field is derived from the sequence, so a torn read is detectable
+    Snapshot makeSnapshot(uint64_t sequence, std::size_t modules) {
+        Snapshot snapshot;
+        snapshot.sequence = sequence;
+        snapshot.timestampMs = static_cast<int64_t>(sequence) * 10;
+        snapshot.batchStartNs = static_cast<int64_t>(sequence) * 1000;
+        snapshot.batchEndNs = snapshot.batchStartNs + 500;
+        for (std::size_t i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(i);
+            module.pid = static_cast<int64_t>(i + 1);
+            module.stats = {static_cast<double>(sequence), sequence * 2.0, sequence + static_cast<double>(i)};
+            module.windowMs = static_cast<int64_t>(sequence);
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    bool isConsistent(const void* data, std::size_t size, uint64_t* sequence) {
+        BinarySnapshotView view(data, size);
+        if (!view.isValid()) {
+            return false;
+        }
+        const double expected = static_cast<double>(view.sequence());
+        if (view.header().timestamp_ms != static_cast<int64_t>(view.sequence()) * 10) {
+            return false;
+        }
+        for (uint32_t i = 0; i < view.moduleCount(); ++i) {
+            const ps_module_record& record = view.record(i);
+            if (record.cpu_percent != expected || record.cpu_time_seconds != expected * 2.0
+                || record.memory_mb != expected + i || record.window_ms != static_cast<int64_t>(view.sequence())) {
+                return false;
+            }
+        }
+        *sequence = view.sequence();
+        return true;
+    }
+
+    // Child body: read until the final sequence shows up; exit status reports the result
+    // 0 = ok, 1 = torn or invalid snapshot, 2 = sequence went backwards, 3 = could not map
+    int readUntil(std::unique_ptr<ShmSnapshotReader> reader, uint64_t finalSequence) {
+        if (!reader) {
+            return 3;
+        }
+        uint64_t last = 0;
+        while (last < finalSequence) {
+            std::size_t size = 0;
+            const void* data = reader->readLatest(&size);
+            if (!data) {
+                continue;
+            }
+            uint64_t sequence = 0;
+            if (!isConsistent(data, size, &sequence)) {
+                return 1;
+            }
+            if (sequence < last) {
+                return 2;
+            }
+            last = sequence;
+        }
+        return 0;
+    }
+
+    std::string uniqueName() {
+        return "/process_stats_test_" + std::to_string(getpid());
+    }
+}
+
+// =============================================================================
+// Shared Memory Snapshot Tests
+// =============================================================================
+
+// Verifies that a reader in the same process sees the latest published snapshot
+TEST(ShmSnapshotTest, ReaderSeesLatestSnapshot) {
+    auto publisher = ShmSnapshotPublisher::create(uniqueName());
+    ASSERT_NE(publisher, nullptr);
+    auto reader = ShmSnapshotReader::open(uniqueName());
+    ASSERT_NE(reader, nullptr);
+
+    Snapshot out;
+    EXPECT_FALSE(reader->readLatest(out));
+
+    for (uint64_t sequence = 1; sequence <= 10; ++sequence) {
+        ASSERT_TRUE(publisher->publish(makeSnapshot(sequence, 3)));
+    }
+    EXPECT_EQ(reader->publishedCount(), 10u);
+    ASSERT_TRUE(reader->readLatest(out));
+    EXPECT_EQ(out.sequence, 10u);
+    ASSERT_EQ(out.modules.size(), 3u);
+    EXPECT_EQ(out.modules[2].name, "module_2");
+    EXPECT_EQ(out.modules[2].stats.memoryMB, 12.0);
+}
+
+// Verifies that snapshots larger than a slot are dropped, keeping the previous one
+TEST(ShmSnapshotTest, OversizedSnapshotIsDropped) {
+    auto publisher = ShmSnapshotPublisher::create(uniqueName(), 2, 256);
+    ASSERT_NE(publisher, nullptr);
+    ASSERT_TRUE(publisher->publish(makeSnapshot(1, 1)));
+    EXPECT_FALSE(publisher->publish(makeSnapshot(2, 50)));
+    EXPECT_EQ(publisher->droppedCount(), 1u);
+
+    auto reader = ShmSnapshotReader::open(uniqueName());
+    ASSERT_NE(reader, nullptr);
+    Snapshot out;
+    ASSERT_TRUE(reader->readLatest(out));
+    EXPECT_EQ(out.sequence, 1u);
+}
+
+// Verifies that opening a missing segment fails cleanly
+TEST(ShmSnapshotTest, OpenRejectsMissingSegment) {
+    EXPECT_EQ(ShmSnapshotReader::open("/process_stats_test_missing"), nullptr);
+}
+
+// Verifies that several reader processes see only complete, monotonically
+// increasing snapshots while the writer publishes as fast as it can
+TEST(ShmSnapshotTest, MultiProcessReadersNeverSeeTornSnapshots) {
+    constexpr int kReaders = 4;
+    constexpr uint64_t kPublications = 20000;
+
+    const std::string name = uniqueName();
+    auto publisher = ShmSnapshotPublisher::create(name, 4, 16 * 1024);
+    ASSERT_NE(publisher, nullptr);
+    ASSERT_TRUE(publisher->publish(makeSnapshot(1, 40)));
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < kReaders; ++i) {
+        pid_t child = fork();
+        ASSERT_GE(child, 0);
+        if (child == 0) {
+            _exit(readUntil(ShmSnapshotReader::open(name), kPublications));
+        }
+        children.push_back(child);
+    }
+
+    for (uint64_t sequence = 2; sequence <= kPublications; ++sequence) {
+        publisher->publish(makeSnapshot(sequence, 40));
+    }
+
+    for (pid_t child : children) {
+        int status = 0;
+        ASSERT_EQ(waitpid(child, &status, 0), child);
+        ASSERT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+}
+
+#ifdef __linux__
+// Verifies that an anonymous memfd segment can be handed to a child by fd
+TEST(ShmSnapshotTest, AnonymousSegmentIsReadableThroughFd) {
+    auto publisher = ShmSnapshotPublisher::createAnonymous();
+    ASSERT_NE(publisher, nullptr);
+    ASSERT_TRUE(publisher->publish(makeSnapshot(1, 5)));
+
+    const int fd = publisher->fd();
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        _exit(readUntil(ShmSnapshotReader::fromFd(fd), 500));
+    }
+    for (uint64_t sequence = 2; sequence <= 500; ++sequence) {
+        publisher->publish(makeSnapshot(sequence, 5));
+    }
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+#endif
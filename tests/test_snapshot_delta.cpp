@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "snapshot_delta.h"
+#include <string>
+#include <vector>
+
+using ProcessStats::DeltaOptions;
+using ProcessStats::DeltaTracker;
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleSample;
+using ProcessStats::ProcessStatsData;
+using ProcessStats::Snapshot;
+
+namespace {
+    struct Module {
+        const char* name;
+        ProcessStatsData stats;
+    };
+
+    Snapshot makeSnapshot(uint64_t sequence, const std::vector<Module>& modules) {
+        Snapshot snapshot;
+        snapshot.sequence = sequence;
+        for (const Module& module : modules) {
+            ModuleSample sample;
+            sample.name = module.name;
+            sample.stats = module.stats;
+            snapshot.modules.push_back(sample);
+        }
+        return snapshot;
+    }
+
+    std::string deltaJson(const DeltaTracker& tracker, uint64_t since) {
+        JsonWriter writer;
+        tracker.writeJson(writer, since);
+        return writer.buffer();
+    }
+}
+
+// =============================================================================
+// DeltaTracker Tests
+// =============================================================================
+
+// Verifies that a caller without a sequence gets every module
+TEST(DeltaTrackerTest, FirstRequestIsFull) {
+    DeltaTracker tracker;
+    tracker.update(makeSnapshot(7, {{"a", {1.5, 2.0, 3.0}}, {"b", {0.0, 1.0, 4.25}}}));
+    EXPECT_TRUE(tracker.isFull(0));
+    EXPECT_EQ(deltaJson(tracker, 0),
+              "{\"full\":true,\"modules\":["
+              "{\"cpu_percent\":1.5,\"cpu_time_seconds\":2,\"memory_mb\":3,\"name\":\"a\",\"status\":\"ok\"},"
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":1,\"memory_mb\":4.25,\"name\":\"b\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":7,\"since\":0}");
+    EXPECT_TRUE(tracker.isFull(99));
+    EXPECT_FALSE(tracker.isFull(7));
+    EXPECT_EQ(tracker.changedCount(7), 0u);
+}
+
+// Verifies that unchanged modules are left out of a delta
+TEST(DeltaTrackerTest, OmitsUnchangedModules) {
+    DeltaTracker tracker;
+    tracker.update(makeSnapshot(1, {{"a", {0.0, 1.0, 10.0}}, {"b", {0.0, 1.0, 20.0}}, {"c", {0.0, 1.0, 30.0}}}));
+    tracker.update(makeSnapshot(2, {{"a", {0.0, 1.0, 10.0}}, {"b", {5.0, 1.05, 20.0}}, {"c", {0.0, 1.0, 30.0}}}));
+    EXPECT_EQ(deltaJson(tracker, 1),
+              "{\"full\":false,\"modules\":["
+              "{\"cpu_percent\":5,\"cpu_time_seconds\":1.05,\"memory_mb\":20,\"name\":\"b\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":2,\"since\":1}");
+
+    // A caller a snapshot behind sees both changes
+    tracker.update(makeSnapshot(3, {{"a", {0.0, 1.0, 10.5}}, {"b", {5.0, 1.05, 20.0}}, {"c", {0.0, 1.0, 30.0}}}));
+    EXPECT_EQ(tracker.changedCount(2), 1u);
+    EXPECT_EQ(tracker.changedCount(1), 2u);
+}
+
+// Verifies that epsilons compare against the value last sent, so slow drift
+// is still reported
+TEST(DeltaTrackerTest, EpsilonsCompareAgainstReportedValue) {
+    DeltaOptions options;
+    options.cpuPercentEpsilon = 1.0;
+    options.cpuTimeSecondsEpsilon = 1e9;
+    options.memoryMBEpsilon = 1.0;
+    DeltaTracker tracker(options);
+
+    tracker.update(makeSnapshot(1, {{"a", {0.0, 0.0, 100.0}}}));
+    tracker.update(makeSnapshot(2, {{"a", {0.5, 0.0, 100.4}}}));
+    EXPECT_EQ(tracker.changedCount(1), 0u);
+    tracker.update(makeSnapshot(3, {{"a", {0.9, 0.0, 100.8}}}));
+    EXPECT_EQ(tracker.changedCount(2), 0u);
+    tracker.update(makeSnapshot(4, {{"a", {0.9, 0.0, 101.2}}}));
+    EXPECT_EQ(tracker.changedCount(3), 1u);
+    EXPECT_EQ(deltaJson(tracker, 3),
+              "{\"full\":false,\"modules\":["
+              "{\"cpu_percent\":0.9,\"cpu_time_seconds\":0,\"memory_mb\":101.2,\"name\":\"a\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":4,\"since\":3}");
+
+    // Either metric alone is enough
+    tracker.update(makeSnapshot(5, {{"a", {2.0, 0.0, 101.2}}}));
+    EXPECT_EQ(tracker.changedCount(4), 1u);
+}
+
+// Verifies that removals are listed until the module comes back
+TEST(DeltaTrackerTest, ListsRemovedModules) {
+    DeltaTracker tracker;
+    tracker.update(makeSnapshot(1, {{"a", {1.0, 1.0, 1.0}}, {"b", {2.0, 2.0, 2.0}}}));
+    tracker.update(makeSnapshot(2, {{"a", {1.0, 1.0, 1.0}}}));
+    EXPECT_EQ(deltaJson(tracker, 1),
+              "{\"full\":false,\"modules\":[],\"removed\":[\"b\"],\"sequence\":2,\"since\":1}");
+    EXPECT_EQ(tracker.changedCount(0), 1u);
+
+    tracker.update(makeSnapshot(3, {{"a", {1.0, 1.0, 1.0}}}));
+    EXPECT_EQ(deltaJson(tracker, 2),
+              "{\"full\":false,\"modules\":[],\"removed\":[],\"sequence\":3,\"since\":2}");
+
+    // Back with the same values: still sent to callers that saw it removed
+    tracker.update(makeSnapshot(4, {{"a", {1.0, 1.0, 1.0}}, {"b", {2.0, 2.0, 2.0}}}));
+    EXPECT_EQ(deltaJson(tracker, 2),
+              "{\"full\":false,\"modules\":["
+              "{\"cpu_percent\":2,\"cpu_time_seconds\":2,\"memory_mb\":2,\"name\":\"b\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":4,\"since\":2}");
+}
+
+// Verifies periodic full snapshots with exact values, and that deltas only
+// reach back one interval
+TEST(DeltaTrackerTest, ResyncsPeriodically) {
+    DeltaOptions options;
+    options.memoryMBEpsilon = 10.0;
+    options.fullSnapshotInterval = 4;
+    DeltaTracker tracker(options);
+
+    for (uint64_t sequence = 1; sequence <= 3; ++sequence) {
+        tracker.update(makeSnapshot(sequence, {{"a", {0.0, 0.0, 100.0 + sequence}}}));
+        EXPECT_FALSE(tracker.isFull(sequence - (sequence > 1 ? 1 : 0)));
+        EXPECT_EQ(tracker.changedCount(1), 0u);
+    }
+    tracker.update(makeSnapshot(4, {{"a", {0.0, 0.0, 104.0}}}));
+    EXPECT_TRUE(tracker.isFull(3));
+    EXPECT_EQ(deltaJson(tracker, 3),
+              "{\"full\":true,\"modules\":["
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":0,\"memory_mb\":104,\"name\":\"a\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":4,\"since\":3}");
+
+    for (uint64_t sequence = 5; sequence <= 9; ++sequence) {
+        tracker.update(makeSnapshot(sequence, {{"a", {0.0, 0.0, 104.0}}}));
+    }
+    EXPECT_FALSE(tracker.isFull(5));
+    EXPECT_TRUE(tracker.isFull(4));
+
+    // New options start over
+    tracker.setOptions(DeltaOptions());
+    tracker.update(makeSnapshot(10, {{"a", {0.0, 0.0, 104.0}}}));
+    EXPECT_TRUE(tracker.isFull(9));
+    EXPECT_FALSE(tracker.isFull(10));
+}
+
+// Verifies JsonWriter's boolean values and that literals stay strings
+TEST(DeltaTrackerTest, WritesBooleans) {
+    JsonWriter writer;
+    writer.beginArray();
+    writer.value(true);
+    writer.value(false);
+    writer.value("text");
+    writer.endArray();
+    EXPECT_EQ(writer.buffer(), "[true,false,\"text\"]");
+}
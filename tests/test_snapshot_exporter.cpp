@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+#include "binary_snapshot.h"
+#include "snapshot_exporter.h"
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using ProcessStats::ExporterOptions;
+using ProcessStats::ModuleSample;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotExporter;
+using ProcessStats::SnapshotPublisher;
+
+namespace {
+    Snapshot makeSnapshot(uint64_t sequence, std::size_t modules) {
+        Snapshot snapshot;
+        snapshot.sequence = sequence;
+        snapshot.timestampMs = 1700000000000;
+        snapshot.batchStartNs = 1000;
+        snapshot.batchEndNs = 2000;
+        for (std::size_t i = 0; i < modules; ++i) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(i);
+            module.pid = static_cast<int64_t>(100 + i);
+            module.stats = {1.5, 2.0 + sequence, 64.0};
+            module.windowMs = 1000;
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    std::string unixPath() {
+        return "/tmp/process_stats_exporter_" + std::to_string(getpid()) + ".sock";
+    }
+
+    // Read until the server closes, then close fd
+    std::string readToEnd(int fd) {
+        std::string response;
+        char chunk[4096];
+        ssize_t received;
+        while ((received = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            response.append(chunk, static_cast<std::size_t>(received));
+        }
+        close(fd);
+        return response;
+    }
+
+    // Send request and read until the server closes; empty on connect failure
+    std::string roundTrip(int fd, const std::string& request) {
+        if (::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            close(fd);
+            return std::string();
+        }
+        return readToEnd(fd);
+    }
+
+    std::string fetchUnix(const std::string& path, const std::string& target) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return std::string();
+        }
+        return roundTrip(fd, "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    }
+
+    std::string fetchTcp(uint16_t port, const std::string& target) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return std::string();
+        }
+        return roundTrip(fd, "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    }
+
+    std::string body(const std::string& response) {
+        const std::size_t end = response.find("\r\n\r\n");
+        return end == std::string::npos ? std::string() : response.substr(end + 4);
+    }
+
+    bool hasStatus(const std::string& response, const std::string& status) {
+        return response.compare(0, 9 + status.size(), "HTTP/1.1 " + status) == 0;
+    }
+}
+
+// =============================================================================
+// SnapshotExporter Tests
+// =============================================================================
+
+// Verifies that every format is served over the Unix domain socket
+TEST(SnapshotExporterTest, ServesAllFormatsOverUnixSocket) {
+    SnapshotPublisher<Snapshot> publisher;
+    publisher.publish(makeSnapshot(7, 3));
+
+    SnapshotExporter exporter(publisher);
+    ExporterOptions options;
+    options.unixSocketPath = unixPath();
+    ASSERT_TRUE(exporter.start(options)) << std::strerror(errno);
+
+    const std::string metrics = fetchUnix(options.unixSocketPath, "/metrics");
+    ASSERT_TRUE(hasStatus(metrics, "200"));
+    EXPECT_NE(metrics.find("Content-Type: text/plain; version=0.0.4"), std::string::npos);
+    EXPECT_NE(body(metrics).find("process_stats_modules 3\n"), std::string::npos);
+
+    const std::string json = fetchUnix(options.unixSocketPath, "/json");
+    ASSERT_TRUE(hasStatus(json, "200"));
+    EXPECT_EQ(body(json).front(), '{');
+    EXPECT_NE(body(json).find("\"sequence\":7"), std::string::npos);
+
+    const std::string binary = body(fetchUnix(options.unixSocketPath, "/binary"));
+    Snapshot decoded;
+    ASSERT_TRUE(ProcessStats::decodeBinarySnapshot(binary.data(), binary.size(), decoded));
+    EXPECT_EQ(decoded.sequence, 7u);
+    ASSERT_EQ(decoded.modules.size(), 3u);
+    EXPECT_EQ(decoded.modules[1].name, "module_1");
+
+    exporter.stop();
+    EXPECT_NE(access(options.unixSocketPath.c_str(), F_OK), 0);
+}
+
+// Verifies the localhost TCP listener on an ephemeral port
+TEST(SnapshotExporterTest, ServesOverLocalhostTcp) {
+    SnapshotPublisher<Snapshot> publisher;
+    publisher.publish(makeSnapshot(1, 2));
+
+    SnapshotExporter exporter(publisher);
+    ExporterOptions options;
+    options.tcpPort = 0;
+    ASSERT_TRUE(exporter.start(options)) << std::strerror(errno);
+    ASSERT_NE(exporter.tcpPort(), 0);
+
+    const std::string response = fetchTcp(exporter.tcpPort(), "/");
+    ASSERT_TRUE(hasStatus(response, "200"));
+    EXPECT_NE(body(response).find("process_stats_modules 2\n"), std::string::npos);
+}
+
+// Verifies error statuses for unknown paths, other methods and no data yet
+TEST(SnapshotExporterTest, ReportsErrors) {
+    SnapshotPublisher<Snapshot> publisher;
+    SnapshotExporter exporter(publisher);
+    ExporterOptions options;
+    options.unixSocketPath = unixPath();
+    ASSERT_TRUE(exporter.start(options));
+
+    EXPECT_TRUE(hasStatus(fetchUnix(options.unixSocketPath, "/metrics"), "503"));
+    publisher.publish(makeSnapshot(1, 1));
+    EXPECT_TRUE(hasStatus(fetchUnix(options.unixSocketPath, "/metrics"), "200"));
+    EXPECT_TRUE(hasStatus(fetchUnix(options.unixSocketPath, "/nope"), "404"));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.unixSocketPath.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    EXPECT_TRUE(hasStatus(roundTrip(fd, "POST /metrics HTTP/1.1\r\n\r\n"), "405"));
+}
+
+// Verifies that a client that half-closes after its request still gets the
+// response, and that an incomplete request is dropped
+TEST(SnapshotExporterTest, AnswersHalfClosedClients) {
+    SnapshotPublisher<Snapshot> publisher;
+    publisher.publish(makeSnapshot(1, 2));
+    SnapshotExporter exporter(publisher);
+    ExporterOptions options;
+    options.tcpPort = 0;
+    ASSERT_TRUE(exporter.start(options)) << std::strerror(errno);
+
+    auto halfClosed = [&](const std::string& request) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(exporter.tcpPort());
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+            || ::send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            close(fd);
+            return std::string("connect or send failed");
+        }
+        shutdown(fd, SHUT_WR);   // as nc -N does
+        return readToEnd(fd);
+    };
+
+    const std::string response = halfClosed("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    ASSERT_TRUE(hasStatus(response, "200")) << response;
+    EXPECT_NE(body(response).find("process_stats_modules 2\n"), std::string::npos);
+
+    EXPECT_EQ(halfClosed("GET /metrics HTTP/1.1\r\nHost: loc"), "");
+}
+
+// Verifies that concurrent scrapes share one render per snapshot and that a
+// new publication is picked up on the next request
+TEST(SnapshotExporterTest, RendersOncePerPublication) {
+    SnapshotPublisher<Snapshot> publisher;
+    publisher.publish(makeSnapshot(1, 200));
+
+    SnapshotExporter exporter(publisher);
+    ExporterOptions options;
+    options.unixSocketPath = unixPath();
+    ASSERT_TRUE(exporter.start(options));
+
+    constexpr int kClients = 16;
+    constexpr int kRequestsPerClient = 10;
+    std::vector<std::thread> clients;
+    std::vector<int> failures(kClients, 0);
+    for (int c = 0; c < kClients; ++c) {
+        clients.emplace_back([&, c] {
+            for (int r = 0; r < kRequestsPerClient; ++r) {
+                const std::string response = fetchUnix(options.unixSocketPath, "/metrics");
+                if (!hasStatus(response, "200") || body(response).find("process_stats_modules 200\n") == std::string::npos) {
+                    ++failures[c];
+                }
+            }
+        });
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    for (int failed : failures) {
+        EXPECT_EQ(failed, 0);
+    }
+    EXPECT_EQ(exporter.requestCount(), static_cast<uint64_t>(kClients * kRequestsPerClient));
+    EXPECT_EQ(exporter.renderCount(), 1u);
+
+    publisher.publish(makeSnapshot(2, 200));
+    const std::string json = body(fetchUnix(options.unixSocketPath, "/json"));
+    EXPECT_NE(json.find("\"sequence\":2"), std::string::npos);
+    fetchUnix(options.unixSocketPath, "/json");
+    EXPECT_EQ(exporter.renderCount(), 2u);
+}
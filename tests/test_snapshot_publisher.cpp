@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include "snapshot.h"
+#include "snapshot_publisher.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using ProcessStats::ModuleSample;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotPublisher;
+
+namespace {
+    // Fill a snapshot whose every field is derived from value so readers can
+    // detect a torn read
+    void fillSnapshot(Snapshot& snapshot, uint64_t value, size_t moduleCount) {
+        snapshot.sequence = value;
+        snapshot.timestampMs = static_cast<int64_t>(value);
+        snapshot.modules.resize(moduleCount);
+        for (size_t i = 0; i < moduleCount; ++i) {
+            ModuleSample& module = snapshot.modules[i];
+            module.name = "module_" + std::to_string(value);
+            module.pid = static_cast<int64_t>(value);
+            module.stats.cpuPercent = static_cast<double>(value);
+            module.stats.cpuTimeSeconds = static_cast<double>(value);
+            module.stats.memoryMB = static_cast<double>(value);
+        }
+    }
+
+    bool isConsistent(const Snapshot& snapshot) {
+        const uint64_t value = snapshot.sequence;
+        if (snapshot.timestampMs != static_cast<int64_t>(value)) {
+            return false;
+        }
+        const std::string name = "module_" + std::to_string(value);
+        for (const ModuleSample& module : snapshot.modules) {
+            if (module.name != name || module.pid != static_cast<int64_t>(value)
+                || module.stats.cpuPercent != static_cast<double>(value)
+                || module.stats.cpuTimeSeconds != static_cast<double>(value)
+                || module.stats.memoryMB != static_cast<double>(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+// =============================================================================
+// SnapshotPublisher Tests
+// =============================================================================
+
+// Verifies that readers see nothing before the first publication
+TEST(SnapshotPublisherTest, ReadFailsBeforeFirstPublish) {
+    SnapshotPublisher<Snapshot> publisher;
+    Snapshot out;
+
+    EXPECT_FALSE(publisher.read(out));
+    EXPECT_FALSE(publisher.pin());
+    EXPECT_EQ(publisher.sequence(), 0u);
+}
+
+// Verifies that the latest published value is returned
+TEST(SnapshotPublisherTest, ReadReturnsLatestPublishedValue) {
+    SnapshotPublisher<Snapshot> publisher;
+    Snapshot first;
+    fillSnapshot(first, 1, 3);
+    Snapshot second;
+    fillSnapshot(second, 2, 5);
+
+    ASSERT_TRUE(publisher.publish(first));
+    ASSERT_TRUE(publisher.publish(second));
+
+    Snapshot out;
+    uint64_t sequence = 0;
+    ASSERT_TRUE(publisher.read(out, &sequence));
+    EXPECT_EQ(out.sequence, 2u);
+    EXPECT_EQ(out.modules.size(), 5u);
+    EXPECT_EQ(sequence, 2u);
+    EXPECT_EQ(publisher.sequence(), 2u);
+}
+
+// Verifies that a pinned value stays intact while the writer keeps publishing
+TEST(SnapshotPublisherTest, PinnedValueIsNotOverwritten) {
+    SnapshotPublisher<Snapshot> publisher(3);
+    Snapshot snapshot;
+    fillSnapshot(snapshot, 1, 4);
+    ASSERT_TRUE(publisher.publish(snapshot));
+
+    auto guard = publisher.pin();
+    ASSERT_TRUE(guard);
+
+    for (uint64_t value = 2; value < 20; ++value) {
+        fillSnapshot(snapshot, value, 4);
+        EXPECT_TRUE(publisher.publish(snapshot));
+    }
+
+    EXPECT_EQ(guard->sequence, 1u);
+    EXPECT_TRUE(isConsistent(*guard));
+    EXPECT_EQ(publisher.droppedCount(), 0u);
+}
+
+// Verifies that the writer drops a publication instead of waiting when every
+// spare slot is pinned
+TEST(SnapshotPublisherTest, PublishDropsWhenAllSpareSlotsArePinned) {
+    SnapshotPublisher<Snapshot> publisher(2);
+    Snapshot snapshot;
+    fillSnapshot(snapshot, 1, 1);
+    ASSERT_TRUE(publisher.publish(snapshot));
+    auto first = publisher.pin();
+
+    fillSnapshot(snapshot, 2, 1);
+    ASSERT_TRUE(publisher.publish(snapshot));
+    auto second = publisher.pin();
+
+    fillSnapshot(snapshot, 3, 1);
+    EXPECT_FALSE(publisher.publish(snapshot));
+    EXPECT_EQ(publisher.droppedCount(), 1u);
+    EXPECT_EQ(publisher.sequence(), 2u);
+
+    first.release();
+    EXPECT_TRUE(publisher.publish(snapshot));
+    EXPECT_EQ(publisher.sequence(), 3u);
+}
+
+// Verifies that publishWith() reuses slot storage in place
+TEST(SnapshotPublisherTest, PublishWithFillsSlotInPlace) {
+    SnapshotPublisher<Snapshot> publisher(2);
+    for (uint64_t value = 1; value <= 4; ++value) {
+        ASSERT_TRUE(publisher.publishWith([value](Snapshot& target) {
+            fillSnapshot(target, value, 8);
+        }));
+    }
+
+    auto guard = publisher.pin();
+    ASSERT_TRUE(guard);
+    EXPECT_EQ(guard->sequence, 4u);
+    EXPECT_GE(guard->modules.capacity(), 8u);
+}
+
+// Stress test: one writer and many readers; build with
+// -DPROCESS_STATS_ENABLE_TSAN=ON to run it under ThreadSanitizer
+TEST(SnapshotPublisherTest, ConcurrentReadersNeverSeeTornSnapshots) {
+    constexpr int kReaders = 8;
+    constexpr uint64_t kPublications = 5000;
+    SnapshotPublisher<Snapshot> publisher(kReaders + 2);
+
+    std::atomic<bool> done{false};
+    std::atomic<int> tornReads{0};
+    std::atomic<int> regressions{0};
+    std::atomic<uint64_t> totalReads{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; ++r) {
+        readers.emplace_back([&, r]() {
+            Snapshot copy;
+            uint64_t lastSeen = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                bool ok = false;
+                if (r % 2 == 0) {
+                    ok = publisher.read(copy);
+                } else {
+                    auto guard = publisher.pin();
+                    ok = static_cast<bool>(guard);
+                    if (ok) {
+                        copy = *guard;
+                    }
+                }
+                if (!ok) {
+                    continue;
+                }
+                if (!isConsistent(copy)) {
+                    tornReads.fetch_add(1);
+                }
+                if (copy.sequence < lastSeen) {
+                    regressions.fetch_add(1);
+                }
+                lastSeen = copy.sequence;
+                totalReads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    uint64_t published = 0;
+    for (uint64_t value = 1; value <= kPublications; ++value) {
+        if (publisher.publishWith([value](Snapshot& target) {
+                fillSnapshot(target, value, 16);
+            })) {
+            ++published;
+        }
+        if (value % 1000 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    // Make sure readers overlapped with the writer at least once
+    while (totalReads.load(std::memory_order_relaxed) == 0) {
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(tornReads.load(), 0);
+    EXPECT_EQ(regressions.load(), 0);
+    EXPECT_EQ(published, kPublications);
+    EXPECT_EQ(publisher.droppedCount(), 0u);
+    EXPECT_GT(totalReads.load(), 0u);
+}
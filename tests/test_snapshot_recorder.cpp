@@ -0,0 +1,374 @@
+#include <gtest/gtest.h>
+#include "gorilla_codec.h"
+#include "recording_reader.h"
+#include "snapshot_recorder.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using ProcessStats::BitReader;
+using ProcessStats::BitWriter;
+using ProcessStats::ModuleSample;
+using ProcessStats::RecordedSeries;
+using ProcessStats::RecordingReader;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotRecorder;
+using ProcessStats::TimestampDecoder;
+using ProcessStats::TimestampEncoder;
+using ProcessStats::XorDecoder;
+using ProcessStats::XorEncoder;
+
+namespace {
+    std::string recordingPath(const char* name) {
+        std::string path = "/tmp/process_stats_" + std::string(name) + "_" + std::to_string(getpid()) + ".psrc";
+        std::remove(path.c_str());
+        return path;
+    }
+
+    uint64_t bitsOf(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    // Module state for a plausible workload: most modules idle most of the
+    // time, CPU time in clock ticks, memory in pages, a jittery 1 s cadence
+    class Workload {
+    public:
+        explicit Workload(std::size_t modules) : m_cpuTicks(modules, 0), m_pages(modules) {
+            for (std::size_t i = 0; i < modules; ++i) {
+                m_pages[i] = 10000 + 97 * i;
+            }
+        }
+
+        Snapshot next() {
+            Snapshot snapshot;
+            m_timeMs += 1000 + static_cast<int64_t>(m_random() % 7) - 3;
+            snapshot.timestampMs = m_timeMs;
+            for (std::size_t i = 0; i < m_cpuTicks.size(); ++i) {
+                const uint64_t roll = m_random() % 100;
+                uint64_t ticks = 0;
+                if (roll < 20) {
+                    ticks = 1 + m_random() % 3;
+                } else if (roll < 25) {
+                    ticks = 10 + m_random() % 90;
+                }
+                m_cpuTicks[i] += ticks;
+                if (m_random() % 10 == 0) {
+                    m_pages[i] += static_cast<int64_t>(m_random() % 64) - 32;
+                }
+                ModuleSample module;
+                module.name = "module_" + std::to_string(i);
+                module.pid = static_cast<int64_t>(1000 + i);
+                module.stats.cpuTimeSeconds = m_cpuTicks[i] / 100.0;
+                module.stats.cpuPercent = static_cast<double>(ticks);
+                module.stats.memoryMB = m_pages[i] * 4096.0 / (1024.0 * 1024.0);
+                snapshot.modules.push_back(module);
+            }
+            return snapshot;
+        }
+
+    private:
+        std::mt19937_64 m_random{42};
+        int64_t m_timeMs = 1700000000000;
+        std::vector<uint64_t> m_cpuTicks;
+        std::vector<int64_t> m_pages;
+    };
+
+    std::vector<RecordedSeries> readAll(const std::string& path) {
+        std::vector<RecordedSeries> series;
+        auto reader = RecordingReader::open(path);
+        if (!reader) {
+            return series;
+        }
+        for (uint64_t i = 0; i < reader->blockCount(); ++i) {
+            reader->readBlock(i, series);
+        }
+        return series;
+    }
+}
+
+// =============================================================================
+// Gorilla Codec Tests
+// =============================================================================
+
+// Verifies that timestamps round-trip through every delta-of-delta bucket
+TEST(GorillaCodecTest, TimestampsRoundTrip) {
+    const std::vector<int64_t> timestamps = {
+        1700000000000, 1700000001000, 1700000002000, 1700000003003, 1700000003950,
+        1700000005200, 1700000007000, 1700000007001, 1700000107001, 1600000000000,
+        std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min(), 0,
+    };
+    BitWriter out;
+    TimestampEncoder encoder;
+    for (int64_t timestamp : timestamps) {
+        encoder.append(out, timestamp);
+    }
+
+    BitReader in(out.data(), out.bitCount());
+    TimestampDecoder decoder;
+    for (int64_t timestamp : timestamps) {
+        EXPECT_EQ(decoder.next(in), timestamp);
+    }
+    EXPECT_FALSE(in.overrun());
+    EXPECT_EQ(in.position(), out.bitCount());
+}
+
+// Verifies that a steady cadence costs one bit per timestamp
+TEST(GorillaCodecTest, SteadyCadenceCostsOneBit) {
+    BitWriter out;
+    TimestampEncoder encoder;
+    for (int64_t i = 0; i < 1000; ++i) {
+        encoder.append(out, 5000 + i * 1000);
+    }
+    // 64 for the first, 16 for the first interval, then one bit each
+    EXPECT_EQ(out.bitCount(), 64u + 16u + 998u);
+}
+
+// Verifies that doubles round-trip bit for bit, special values included
+TEST(GorillaCodecTest, DoublesRoundTripExactly) {
+    std::vector<double> values = {
+        0.0, -0.0, 1.0, 1.0, 12340.0, 12350.0, 3.14159, -2.5e300, 5e-324,
+        std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(), 1.0,
+    };
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 1000; ++i) {
+        const uint64_t bits = random();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        values.push_back(value);
+        values.push_back(static_cast<double>(random() % 100000));
+    }
+
+    BitWriter out;
+    XorEncoder encoder;
+    for (double value : values) {
+        encoder.append(out, value);
+    }
+    BitReader in(out.data(), out.bitCount());
+    XorDecoder decoder;
+    for (double value : values) {
+        EXPECT_EQ(bitsOf(decoder.next(in)), bitsOf(value));
+    }
+    EXPECT_FALSE(in.overrun());
+}
+
+// Verifies that truncating a writer undoes later writes exactly
+TEST(GorillaCodecTest, TruncateUndoesWrites) {
+    BitWriter out;
+    out.write(0b101, 3);
+    const std::size_t mark = out.bitCount();
+    out.write(0xffffffffu, 32);
+    out.truncate(mark);
+    out.write(0b0110, 4);
+    BitReader in(out.data(), out.bitCount());
+    EXPECT_EQ(in.read(7), 0b1010110u);
+    in.read(1);
+    EXPECT_TRUE(in.overrun());
+}
+
+// =============================================================================
+// SnapshotRecorder Tests
+// =============================================================================
+
+// Verifies that recorded samples read back with the documented precision
+TEST(SnapshotRecorderTest, RoundTripsSamples) {
+    const std::string path = recordingPath("roundtrip");
+    Workload workload(10);
+    std::vector<Snapshot> recorded;
+    {
+        auto recorder = SnapshotRecorder::open(path);
+        ASSERT_NE(recorder, nullptr) << std::strerror(errno);
+        for (int i = 0; i < 100; ++i) {
+            recorded.push_back(workload.next());
+            recorder->record(recorded.back());
+        }
+        EXPECT_EQ(recorder->recordedSamples(), 1000u);
+    }
+
+    const std::vector<RecordedSeries> series = readAll(path);
+    ASSERT_EQ(series.size(), 10u);
+    for (std::size_t m = 0; m < series.size(); ++m) {
+        EXPECT_EQ(series[m].name, "module_" + std::to_string(m));
+        ASSERT_EQ(series[m].samples.size(), 100u);
+        for (std::size_t row = 0; row < 100; ++row) {
+            const ModuleSample& expected = recorded[row].modules[m];
+            const auto& sample = series[m].samples[row];
+            EXPECT_EQ(sample.timestampMs, recorded[row].timestampMs);
+            EXPECT_DOUBLE_EQ(sample.cpuTimeSeconds, expected.stats.cpuTimeSeconds);
+            EXPECT_DOUBLE_EQ(sample.memoryMB, expected.stats.memoryMB);
+            if (row == 0) {
+                EXPECT_EQ(sample.cpuPercent, expected.stats.cpuPercent);
+            } else {
+                const double elapsed = (recorded[row].timestampMs - recorded[row - 1].timestampMs) / 1000.0;
+                const double cpu = expected.stats.cpuTimeSeconds - recorded[row - 1].modules[m].stats.cpuTimeSeconds;
+                EXPECT_NEAR(sample.cpuPercent, cpu / elapsed * 100.0, 1e-9);
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Verifies the size target on a realistic workload: under two bytes per sample
+TEST(SnapshotRecorderTest, CompressesBelowTwoBytesPerSample) {
+    const std::string path = recordingPath("ratio");
+    Workload workload(500);
+    uint64_t samples = 0;
+    uint64_t blocks = 0;
+    {
+        auto recorder = SnapshotRecorder::open(path);
+        ASSERT_NE(recorder, nullptr);
+        for (int i = 0; i < 1200; ++i) {
+            recorder->record(workload.next());
+        }
+        samples = recorder->recordedSamples();
+        // Headers, names and streams of every block
+        const double bytesPerSample = static_cast<double>(recorder->encodedBytes()) / samples;
+        EXPECT_LT(bytesPerSample, 2.0);
+        recorder.reset();
+    }
+    auto reader = RecordingReader::open(path);
+    ASSERT_NE(reader, nullptr);
+    blocks = reader->blockCount();
+    ASSERT_GT(blocks, 1u);
+
+    uint64_t decoded = 0;
+    uint64_t fullBlockSamples = 0;
+    for (uint64_t i = 0; i < blocks; ++i) {
+        ProcessStats::Recording::BlockHeader header;
+        ASSERT_TRUE(reader->blockHeader(i, header));
+        decoded += header.sampleCount;
+        if (i + 1 < blocks) {
+            fullBlockSamples += header.sampleCount;
+        }
+    }
+    EXPECT_EQ(decoded, samples);
+    // Sealed blocks, counted at their full fixed size on disk
+    EXPECT_LT(static_cast<double>((blocks - 1) * reader->blockSize()) / fullBlockSamples, 2.0);
+    std::remove(path.c_str());
+}
+
+// Verifies that block headers form a time index and rows never straddle blocks
+TEST(SnapshotRecorderTest, BlockHeadersIndexTimeRanges) {
+    const std::string path = recordingPath("index");
+    Workload workload(50);
+    int64_t lastTimestamp = 0;
+    {
+        auto recorder = SnapshotRecorder::open(path, 4096);
+        ASSERT_NE(recorder, nullptr);
+        for (int i = 0; i < 300; ++i) {
+            Snapshot snapshot = workload.next();
+            lastTimestamp = snapshot.timestampMs;
+            recorder->record(snapshot);
+        }
+    }
+    auto reader = RecordingReader::open(path);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_GT(reader->blockCount(), 3u);
+
+    int64_t previousMax = 0;
+    uint64_t rows = 0;
+    for (uint64_t i = 0; i < reader->blockCount(); ++i) {
+        ProcessStats::Recording::BlockHeader header;
+        ASSERT_TRUE(reader->blockHeader(i, header));
+        EXPECT_EQ(header.blockNumber, i);
+        EXPECT_LE(header.usedBytes, 4096u);
+        EXPECT_EQ(header.sampleCount, header.rowCount * 50u);
+        EXPECT_GT(header.minTimeMs, previousMax);
+        EXPECT_GE(header.maxTimeMs, header.minTimeMs);
+        previousMax = header.maxTimeMs;
+        rows += header.rowCount;
+    }
+    EXPECT_EQ(rows, 300u);
+    EXPECT_EQ(previousMax, lastTimestamp);
+    std::remove(path.c_str());
+}
+
+// Verifies that modules leaving and returning start new series
+TEST(SnapshotRecorderTest, SplitsSeriesAtGaps) {
+    const std::string path = recordingPath("gaps");
+    {
+        auto recorder = SnapshotRecorder::open(path);
+        ASSERT_NE(recorder, nullptr);
+        for (int i = 0; i < 6; ++i) {
+            Snapshot snapshot;
+            snapshot.timestampMs = 1000 * (i + 1);
+            ModuleSample steady;
+            steady.name = "steady";
+            steady.stats = {0.0, 1.0 * i, 8.0};
+            snapshot.modules.push_back(steady);
+            if (i < 2 || i >= 4) {
+                ModuleSample flaky;
+                flaky.name = "flaky";
+                flaky.stats = {5.0, 2.0 * i, 16.0};
+                snapshot.modules.push_back(flaky);
+                snapshot.modules.push_back(flaky);  // duplicate entries are recorded once
+            }
+            recorder->record(snapshot);
+        }
+    }
+    const std::vector<RecordedSeries> series = readAll(path);
+    ASSERT_EQ(series.size(), 3u);
+    EXPECT_EQ(series[0].name, "steady");
+    EXPECT_EQ(series[0].samples.size(), 6u);
+    EXPECT_EQ(series[1].name, "flaky");
+    ASSERT_EQ(series[1].samples.size(), 2u);
+    EXPECT_EQ(series[2].name, "flaky");
+    ASSERT_EQ(series[2].samples.size(), 2u);
+    EXPECT_EQ(series[2].samples[0].timestampMs, 5000);
+    EXPECT_EQ(series[2].samples[0].cpuPercent, 5.0);
+    std::remove(path.c_str());
+}
+
+// Verifies that reopening a recording appends after the existing blocks
+TEST(SnapshotRecorderTest, ReopenAppends) {
+    const std::string path = recordingPath("append");
+    Workload workload(5);
+    for (int session = 0; session < 3; ++session) {
+        auto recorder = SnapshotRecorder::open(path, 8192);
+        ASSERT_NE(recorder, nullptr);
+        for (int i = 0; i < 10; ++i) {
+            recorder->record(workload.next());
+        }
+        recorder->flush();
+        recorder->record(workload.next());
+    }
+    auto reader = RecordingReader::open(path);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(reader->blockSize(), 8192u);
+    EXPECT_EQ(reader->blockCount(), 6u);
+
+    uint64_t samples = 0;
+    for (const RecordedSeries& series : readAll(path)) {
+        samples += series.samples.size();
+    }
+    EXPECT_EQ(samples, 3u * 11u * 5u);
+    std::remove(path.c_str());
+}
+
+// Verifies that files that are not recordings, or are already being recorded to, are refused
+TEST(SnapshotRecorderTest, RejectsForeignAndBusyFiles) {
+    const std::string path = recordingPath("foreign");
+    FILE* file = std::fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    std::fputs("not a recording\n", file);
+    std::fclose(file);
+    errno = 0;
+    EXPECT_EQ(SnapshotRecorder::open(path), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ(RecordingReader::open(path), nullptr);
+    std::remove(path.c_str());
+
+    auto first = SnapshotRecorder::open(path);
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(SnapshotRecorder::open(path), nullptr);
+    first.reset();
+    std::remove(path.c_str());
+}
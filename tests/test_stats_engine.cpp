@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+#include "json_writer.h"
+#include "module_registry.h"
+#include "stats_engine.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using ProcessStats::JsonWriter;
+using ProcessStats::ModuleRef;
+using ProcessStats::RawCounters;
+using ProcessStats::SamplerOptions;
+using ProcessStats::SampleSource;
+using ProcessStats::Snapshot;
+using ProcessStats::StatsEngine;
+
+namespace {
+    // One second per tick; pid p burns p% CPU and holds p MB, and PIDs of
+    // 100 and above do not exist
+    struct TickSource : SampleSource {
+        int64_t tick = 1;
+        int64_t nowNs() override { return tick * 1000000000; }
+        int64_t wallTimeMs() override { return 1700000000000 + tick * 1000; }
+        RawCounters read(int64_t pid) const override {
+            RawCounters counters;
+            counters.cpuTimeSeconds = pid * tick / 100.0;
+            counters.memoryMB = static_cast<double>(pid);
+            counters.readTimeNs = tick * 1000000000;
+            counters.valid = pid < 100;
+            return counters;
+        }
+    };
+
+    StatsEngine::WarningHandler collectInto(std::vector<std::string>& warnings) {
+        return [&warnings](std::string_view message) { warnings.emplace_back(message); };
+    }
+}
+
+// =============================================================================
+// StatsEngine Tests
+// =============================================================================
+
+// Verifies that the engine samples this process by name without Qt
+TEST(StatsEngineTest, SamplesOwnProcess) {
+    StatsEngine engine;
+    const std::string name = "self";
+    Snapshot snapshot = engine.sampleModules({ModuleRef{name, getpid()}});
+    ASSERT_EQ(snapshot.modules.size(), 1u);
+    EXPECT_EQ(snapshot.modules[0].name, "self");
+    EXPECT_EQ(snapshot.modules[0].pid, getpid());
+    EXPECT_GT(snapshot.modules[0].stats.memoryMB, 0.0);
+    EXPECT_GT(snapshot.timestampMs, 0);
+    EXPECT_EQ(snapshot.sequence, 1u);
+}
+
+// Verifies that invalid PIDs are skipped and reported to the handler
+TEST(StatsEngineTest, WarnsAboutInvalidPids) {
+    std::vector<std::string> warnings;
+    StatsEngine engine(SamplerOptions(), collectInto(warnings));
+    const std::vector<ModuleRef> modules = {{"negative", -1}, {"zero", 0}, {"self", getpid()}};
+    Snapshot snapshot = engine.sampleModules(modules);
+    ASSERT_EQ(snapshot.modules.size(), 1u);
+    EXPECT_EQ(snapshot.modules[0].name, "self");
+    ASSERT_EQ(warnings.size(), 2u);
+    EXPECT_EQ(warnings[0], "Invalid PID for module negative");
+    EXPECT_EQ(warnings[1], "Invalid PID for module zero");
+}
+
+// Verifies that engines keep separate state and publish every snapshot
+TEST(StatsEngineTest, EnginesAreIndependent) {
+    StatsEngine first;
+    StatsEngine second;
+    const std::vector<ModuleRef> modules = {{"self", getpid()}};
+    first.sampleModules(modules);
+    first.sampleModules(modules);
+    second.sampleModules(modules);
+
+    Snapshot latest;
+    uint64_t sequence = 0;
+    ASSERT_TRUE(first.latestSnapshot().read(latest, &sequence));
+    EXPECT_EQ(latest.sequence, 2u);
+    ASSERT_TRUE(second.latestSnapshot().read(latest));
+    EXPECT_EQ(latest.sequence, 1u);
+}
+
+// Verifies deterministic sampling and deltas from a substituted source
+TEST(StatsEngineTest, DeltasFromSampleSource) {
+    auto source = std::make_shared<TickSource>();
+    SamplerOptions options;
+    options.source = source;
+    StatsEngine engine(options);
+    const std::vector<ModuleRef> modules = {{"a", 10}, {"b", 20}};
+
+    JsonWriter writer;
+    engine.writeModuleStatsDelta(modules.data(), modules.size(), 0, writer);
+    EXPECT_EQ(writer.buffer(),
+              "{\"full\":true,\"modules\":["
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":0.1,\"memory_mb\":10,\"name\":\"a\",\"status\":\"ok\"},"
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":0.2,\"memory_mb\":20,\"name\":\"b\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":1,\"since\":0}");
+
+    // Only b is left, with b's CPU percentage now known
+    source->tick = 2;
+    writer.clear();
+    const ModuleRef onlyB = modules[1];
+    engine.writeModuleStatsDelta(&onlyB, 1, 1, writer);
+    EXPECT_EQ(writer.buffer(),
+              "{\"full\":false,\"modules\":["
+              "{\"cpu_percent\":20,\"cpu_time_seconds\":0.4,\"memory_mb\":20,\"name\":\"b\",\"status\":\"ok\"}],"
+              "\"removed\":[\"a\"],\"sequence\":2,\"since\":1}");
+    Snapshot latest;
+    ASSERT_TRUE(engine.latestSnapshot().read(latest));
+    EXPECT_EQ(latest.timestampMs, 1700000002000);
+}
+
+// Verifies that a sink that cannot be set up reports why
+TEST(StatsEngineTest, ReportsSinkFailures) {
+    std::vector<std::string> warnings;
+    StatsEngine engine(SamplerOptions(), collectInto(warnings));
+    EXPECT_FALSE(engine.setRecordingFile("/nonexistent/process_stats/recording.psrc"));
+    ASSERT_EQ(warnings.size(), 1u);
+    EXPECT_EQ(warnings[0].rfind("Failed to open recording /nonexistent/process_stats/recording.psrc: ", 0), 0u)
+        << warnings[0];
+    EXPECT_TRUE(engine.setRecordingFile(""));
+    EXPECT_EQ(warnings.size(), 1u);
+}
+
+// Verifies that the __process_stats__ entry is added only when reporting is on
+TEST(StatsEngineTest, ReportsSelfStatsOnRequest) {
+    auto source = std::make_shared<TickSource>();
+    SamplerOptions options;
+    options.source = source;
+    StatsEngine engine(options);
+    const std::vector<ModuleRef> modules = {{"a", 10}, {"b", 20}};
+
+    Snapshot snapshot = engine.sampleModules(modules);
+    EXPECT_FALSE(snapshot.hasSelfStats);
+    JsonWriter writer;
+    engine.writeModuleStatsDelta(modules.data(), modules.size(), 0, writer);
+    EXPECT_EQ(writer.buffer().find("__process_stats__"), std::string::npos);
+
+    engine.setSelfStatsReporting(true);
+    EXPECT_EQ(engine.selfStatsReporting(), ProcessStats::kSelfStatsEnabled);
+    if (!ProcessStats::kSelfStatsEnabled) {
+        return;
+    }
+    snapshot = engine.sampleModules(modules);
+    ASSERT_TRUE(snapshot.hasSelfStats);
+    EXPECT_EQ(snapshot.modules.size(), 2u);
+    // Counted since the engine was created, the delta's tick included
+    EXPECT_EQ(snapshot.selfStats.ticks, 3u);
+    EXPECT_EQ(snapshot.selfStats.pidsSampled, 6u);
+    EXPECT_GT(snapshot.selfStats.serializeNs, 0u);
+
+    // Once its buffers have grown, a registry tick allocates nothing
+    ProcessStats::ModuleRegistry registry;
+    registry.add("a", 10);
+    registry.add("a module name too long to be stored inline", 20);
+    ProcessStats::RegistrySample sample;
+    engine.sampleModules(registry, sample);
+    const uint64_t allocations = engine.selfStats().allocations;
+    EXPECT_GT(allocations, 0u);
+    for (int i = 0; i < 5; ++i) {
+        engine.sampleModules(registry, sample);
+    }
+    EXPECT_EQ(engine.selfStats().allocations, allocations);
+    EXPECT_TRUE(sample.snapshot.hasSelfStats);
+
+    writer.clear();
+    engine.writeModuleStatsDelta(modules.data(), modules.size(), 0, writer);
+    EXPECT_NE(writer.buffer().find("{\"allocations\":"), std::string::npos) << writer.buffer();
+    EXPECT_NE(writer.buffer().find("\"name\":\"__process_stats__\""), std::string::npos);
+
+    engine.resetSelfStats();
+    EXPECT_EQ(engine.selfStats().ticks, 0u);
+}
+
+// Verifies that coalesced ticks can run while the sampler is reconfigured
+TEST(StatsEngineTest, CoalescedTicksSurviveReconfiguration) {
+    SamplerOptions options;
+    options.source = std::make_shared<TickSource>();
+    StatsEngine engine(options);
+    engine.setCoalescingWindow(1);
+    const std::vector<ModuleRef> modules = {{"a", 10}, {"b", 20}, {"c", 30}};
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i) {
+        callers.emplace_back([&]() {
+            while (!done.load()) {
+                const Snapshot snapshot = engine.sampleModules(modules);
+                EXPECT_EQ(snapshot.modules.size(), 3u);
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        engine.setSamplingThreads(i % 2 ? 4 : 1);
+        engine.setSampleSource(std::make_shared<TickSource>());
+        engine.setAlignedBatchTimestamps(i % 2 == 0);
+        engine.clearHistory();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done.store(true);
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+}
+
+// Verifies that sampling other module sets in between does not disturb deltas
+TEST(StatsEngineTest, DeltasIgnoreOtherSampling) {
+    auto source = std::make_shared<TickSource>();
+    SamplerOptions options;
+    options.source = source;
+    StatsEngine engine(options);
+    engine.setCoalescingWindow(1000000);
+    const std::vector<ModuleRef> modules = {{"a", 10}, {"b", 20}};
+    const std::vector<ModuleRef> others = {{"c", 30}};
+
+    JsonWriter writer;
+    engine.writeModuleStatsDelta(modules.data(), modules.size(), 0, writer);
+    uint64_t since = 1;
+    for (int i = 0; i < 3; ++i) {
+        // Nothing moved: no modules, no removals, however c comes and goes
+        engine.sampleModules(others);
+        writer.clear();
+        engine.writeModuleStatsDelta(modules.data(), modules.size(), since, writer);
+        EXPECT_EQ(writer.buffer(), "{\"full\":false,\"modules\":[],\"removed\":[],\"sequence\":" + std::to_string(since + 1)
+                                       + ",\"since\":" + std::to_string(since) + "}");
+        ++since;
+    }
+}
+
+// Verifies that registry and plain samples keep each other's CPU baselines,
+// and that a module leaving the registry loses its own
+TEST(StatsEngineTest, RegistryAndPlainSamplesKeepBaselines) {
+    auto source = std::make_shared<TickSource>();
+    SamplerOptions options;
+    options.source = source;
+    StatsEngine engine(options);
+    ProcessStats::ModuleRegistry registry;
+    const ProcessStats::ModuleId a = registry.add("a", 10);
+    ProcessStats::RegistrySample sample;
+    const std::vector<ModuleRef> others = {{"b", 20}};
+
+    for (int64_t tick = 1; tick <= 3; ++tick) {
+        source->tick = tick;
+        engine.sampleModules(registry, sample);
+        const Snapshot plain = engine.sampleModules(others);
+        ASSERT_EQ(sample.snapshot.modules.size(), 1u);
+        ASSERT_EQ(plain.modules.size(), 1u);
+        EXPECT_EQ(sample.snapshot.modules[0].windowMs, tick > 1 ? 1000 : 0);
+        EXPECT_DOUBLE_EQ(sample.snapshot.modules[0].stats.cpuPercent, tick > 1 ? 10.0 : 0.0);
+        EXPECT_EQ(plain.modules[0].windowMs, tick > 1 ? 1000 : 0);
+        EXPECT_DOUBLE_EQ(plain.modules[0].stats.cpuPercent, tick > 1 ? 20.0 : 0.0);
+    }
+
+    // Removed and added back: a first reading again
+    registry.remove(a);
+    engine.sampleModules(registry, sample);
+    EXPECT_TRUE(sample.snapshot.modules.empty());
+    registry.add("a", 10);
+    source->tick = 4;
+    engine.sampleModules(registry, sample);
+    ASSERT_EQ(sample.snapshot.modules.size(), 1u);
+    EXPECT_EQ(sample.snapshot.modules[0].windowMs, 0);
+}
+
+// Verifies that the JSON precision applies to deltas and can be reset
+TEST(StatsEngineTest, JsonPrecisionAppliesToDeltas) {
+    SamplerOptions options;
+    options.source = std::make_shared<TickSource>();
+    StatsEngine engine(options);
+    const ModuleRef module = {"a", 33};
+    EXPECT_EQ(engine.jsonPrecision(), JsonWriter::kShortestPrecision);
+
+    engine.setJsonPrecision(1);
+    EXPECT_EQ(engine.jsonPrecision(), 1);
+    JsonWriter writer;
+    engine.writeModuleStatsDelta(&module, 1, 0, writer);
+    EXPECT_EQ(writer.buffer(),
+              "{\"full\":true,\"modules\":["
+              "{\"cpu_percent\":0,\"cpu_time_seconds\":0.3,\"memory_mb\":3e+01,\"name\":\"a\",\"status\":\"ok\"}],"
+              "\"removed\":[],\"sequence\":1,\"since\":0}");
+
+    engine.setJsonPrecision(0);
+    EXPECT_EQ(engine.jsonPrecision(), JsonWriter::kShortestPrecision);
+    writer.clear();
+    engine.writeModuleStatsDelta(&module, 1, 0, writer);
+    EXPECT_NE(writer.buffer().find("\"cpu_time_seconds\":0.33,\"memory_mb\":33,"), std::string::npos)
+        << writer.buffer();
+}
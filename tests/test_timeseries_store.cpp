@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include "snapshot_recorder.h"
+#include "timeseries_store.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+using ProcessStats::AggregatedSample;
+using ProcessStats::ModuleSample;
+using ProcessStats::RecordedSample;
+using ProcessStats::Snapshot;
+using ProcessStats::SnapshotRecorder;
+using ProcessStats::TimeSeriesStore;
+
+namespace {
+    constexpr int64_t kStartMs = 1699999980000;  // on a minute boundary
+
+    std::string storeDirectory(const char* name) {
+        return "/tmp/process_stats_store_" + std::string(name) + "_" + std::to_string(getpid());
+    }
+
+    void removeDirectory(const std::string& directory) {
+        if (DIR* entries = opendir(directory.c_str())) {
+            while (dirent* entry = readdir(entries)) {
+                if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                    std::remove((directory + "/" + entry->d_name).c_str());
+                }
+            }
+            closedir(entries);
+        }
+        rmdir(directory.c_str());
+    }
+
+    // Row r of module m: easy to check after a round trip
+    Snapshot makeRow(int row, int modules) {
+        Snapshot snapshot;
+        snapshot.timestampMs = kStartMs + row * 1000;
+        for (int m = 0; m < modules; ++m) {
+            ModuleSample module;
+            module.name = "module_" + std::to_string(m);
+            module.stats.cpuPercent = m;
+            module.stats.cpuTimeSeconds = (row * m) / 100.0;
+            module.stats.memoryMB = 10.0 + m + (row % 8) / 4.0;
+            snapshot.modules.push_back(module);
+        }
+        return snapshot;
+    }
+
+    // rows rows of modules modules, in small blocks and segments so a test
+    // spans several of each
+    void record(const std::string& directory, int firstRow, int rows, int modules) {
+        auto recorder = SnapshotRecorder::openDirectory(directory, 4, 4096);
+        ASSERT_NE(recorder, nullptr) << std::strerror(errno);
+        for (int row = firstRow; row < firstRow + rows; ++row) {
+            recorder->record(makeRow(row, modules));
+        }
+    }
+}
+
+// =============================================================================
+// TimeSeriesStore Tests
+// =============================================================================
+
+// Verifies that a range query returns exactly the samples in the range
+TEST(TimeSeriesStoreTest, QueryReturnsRange) {
+    const std::string directory = storeDirectory("range");
+    removeDirectory(directory);
+    record(directory, 0, 2000, 20);
+
+    auto store = TimeSeriesStore::open(directory);
+    ASSERT_NE(store, nullptr) << std::strerror(errno);
+    ASSERT_GT(store->segmentCount(), 3u);
+    EXPECT_EQ(store->modules().size(), 20u);
+
+    std::vector<RecordedSample> samples;
+    const int64_t from = kStartMs + 1234 * 1000;
+    const int64_t to = kStartMs + 1414 * 1000;
+    ASSERT_EQ(store->query("module_7", from, to, samples), 180u);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const int row = 1234 + static_cast<int>(i);
+        EXPECT_EQ(samples[i].timestampMs, kStartMs + row * 1000);
+        EXPECT_DOUBLE_EQ(samples[i].cpuTimeSeconds, (row * 7) / 100.0);
+        EXPECT_DOUBLE_EQ(samples[i].memoryMB, 17.0 + (row % 8) / 4.0);
+        EXPECT_NEAR(samples[i].cpuPercent, 7.0, 1e-9);
+    }
+
+    samples.clear();
+    EXPECT_EQ(store->query("module_7", to, from, samples), 0u);
+    EXPECT_EQ(store->query("missing", kStartMs, kStartMs + 5000000, samples), 0u);
+    removeDirectory(directory);
+}
+
+// Verifies that a narrow query decodes only the blocks covering it
+TEST(TimeSeriesStoreTest, QuerySeeksToCoveringBlocks) {
+    const std::string directory = storeDirectory("seek");
+    removeDirectory(directory);
+    record(directory, 0, 2000, 20);
+
+    auto store = TimeSeriesStore::open(directory);
+    ASSERT_NE(store, nullptr);
+    uint64_t blocks = 0;
+    for (std::size_t i = 0; i < store->segmentCount(); ++i) {
+        blocks += store->segment(i).blockCount;
+    }
+    ASSERT_GT(blocks, 20u);
+
+    std::vector<RecordedSample> samples;
+    store->query("module_3", kStartMs + 1000 * 1000, kStartMs + 1010 * 1000, samples);
+    EXPECT_EQ(samples.size(), 10u);
+    EXPECT_LE(store->blocksDecoded(), 2u);
+    removeDirectory(directory);
+}
+
+// Verifies that segments without the module are skipped through their bitmaps
+TEST(TimeSeriesStoreTest, SkipsSegmentsWithoutModule) {
+    const std::string directory = storeDirectory("bitmap");
+    removeDirectory(directory);
+    {
+        auto recorder = SnapshotRecorder::openDirectory(directory, 1, 4096);
+        ASSERT_NE(recorder, nullptr);
+        for (int row = 0; row < 1000; ++row) {
+            // "early" is only present at the start of the recording
+            recorder->record(makeRow(row, row < 50 ? 10 : 5));
+        }
+    }
+    auto store = TimeSeriesStore::open(directory);
+    ASSERT_NE(store, nullptr);
+    ASSERT_GT(store->segmentCount(), 2u);
+    EXPECT_EQ(store->segment(0).moduleCount, 10u);
+    EXPECT_EQ(store->segment(store->segmentCount() - 1).moduleCount, 5u);
+
+    std::vector<RecordedSample> samples;
+    EXPECT_EQ(store->query("module_8", kStartMs, kStartMs + 1000 * 1000, samples), 50u);
+    EXPECT_LE(store->blocksDecoded(), store->segment(0).blockCount + 1);
+    removeDirectory(directory);
+}
+
+// Verifies bucketed aggregates against the raw samples
+TEST(TimeSeriesStoreTest, AggregatesBuckets) {
+    const std::string directory = storeDirectory("aggregate");
+    removeDirectory(directory);
+    record(directory, 0, 600, 4);
+
+    auto store = TimeSeriesStore::open(directory);
+    ASSERT_NE(store, nullptr);
+    std::vector<AggregatedSample> buckets;
+    ASSERT_EQ(store->aggregate("module_2", kStartMs, kStartMs + 600 * 1000, 60 * 1000, buckets), 10u);
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        EXPECT_EQ(buckets[i].startMs % 60000, 0);
+        EXPECT_EQ(buckets[i].count, 60u);
+        // Memory cycles through 12.0, 12.25, ... 13.75 every 8 rows
+        EXPECT_DOUBLE_EQ(buckets[i].memoryMBMax, 13.75);
+        EXPECT_NEAR(buckets[i].cpuPercentMean, 2.0, 1e-9);
+    }
+
+    std::vector<RecordedSample> raw;
+    store->query("module_2", buckets[3].startMs, buckets[3].startMs + 60000, raw);
+    double sum = 0.0;
+    for (const RecordedSample& sample : raw) {
+        sum += sample.memoryMB;
+    }
+    EXPECT_NEAR(buckets[3].memoryMBMean, sum / raw.size(), 1e-9);
+    removeDirectory(directory);
+}
+
+// Verifies that refresh() picks up blocks and segments recorded after open
+TEST(TimeSeriesStoreTest, RefreshSeesNewData) {
+    const std::string directory = storeDirectory("refresh");
+    removeDirectory(directory);
+    record(directory, 0, 300, 10);
+
+    auto store = TimeSeriesStore::open(directory);
+    ASSERT_NE(store, nullptr);
+    std::vector<RecordedSample> samples;
+    EXPECT_EQ(store->query("module_1", kStartMs, kStartMs + 900 * 1000, samples), 300u);
+
+    record(directory, 300, 600, 10);
+    ASSERT_TRUE(store->refresh());
+    samples.clear();
+    EXPECT_EQ(store->query("module_1", kStartMs, kStartMs + 900 * 1000, samples), 900u);
+    for (std::size_t i = 1; i < samples.size(); ++i) {
+        EXPECT_EQ(samples[i].timestampMs - samples[i - 1].timestampMs, 1000);
+    }
+    removeDirectory(directory);
+}
+
+// Verifies that a single recording file can be opened as a store
+TEST(TimeSeriesStoreTest, OpensSingleFile) {
+    const std::string path = storeDirectory("single") + ".psrc";
+    std::remove(path.c_str());
+    {
+        auto recorder = SnapshotRecorder::open(path, 4096);
+        ASSERT_NE(recorder, nullptr);
+        for (int row = 0; row < 100; ++row) {
+            recorder->record(makeRow(row, 3));
+        }
+    }
+    auto store = TimeSeriesStore::open(path);
+    ASSERT_NE(store, nullptr);
+    EXPECT_EQ(store->segmentCount(), 1u);
+    std::vector<RecordedSample> samples;
+    EXPECT_EQ(store->query("module_0", kStartMs, kStartMs + 100 * 1000, samples), 100u);
+    std::remove(path.c_str());
+
+    errno = 0;
+    EXPECT_EQ(TimeSeriesStore::open(path), nullptr);
+    EXPECT_EQ(errno, ENOENT);
+}
+
+// Verifies that blocks are found by time in a long segment, and still found
+// after the wall clock stepped back
+TEST(TimeSeriesStoreTest, FindsBlocksWhenClockStepsBack) {
+    const std::string path = storeDirectory("stepback") + ".psrc";
+    std::remove(path.c_str());
+    {
+        auto recorder = SnapshotRecorder::open(path, 4096);
+        ASSERT_NE(recorder, nullptr);
+        for (int row = 0; row < 2000; ++row) {
+            recorder->record(makeRow(row, 20));
+        }
+    }
+    auto store = TimeSeriesStore::open(path);
+    ASSERT_NE(store, nullptr);
+    ASSERT_GT(store->segment(0).blockCount, 20u);
+    std::vector<RecordedSample> samples;
+    EXPECT_EQ(store->query("module_1", kStartMs + 1500 * 1000, kStartMs + 1510 * 1000, samples), 10u);
+    EXPECT_LE(store->blocksDecoded(), 2u);
+    store.reset();
+
+    // Rows 1000 to 1199 recorded a second time, as after a clock step
+    {
+        auto recorder = SnapshotRecorder::open(path, 4096);
+        ASSERT_NE(recorder, nullptr);
+        for (int row = 1000; row < 1200; ++row) {
+            recorder->record(makeRow(row, 20));
+        }
+    }
+    store = TimeSeriesStore::open(path);
+    ASSERT_NE(store, nullptr);
+    samples.clear();
+    EXPECT_EQ(store->query("module_1", kStartMs + 1100 * 1000, kStartMs + 1110 * 1000, samples), 20u);
+    samples.clear();
+    EXPECT_EQ(store->query("module_1", kStartMs + 1500 * 1000, kStartMs + 1510 * 1000, samples), 10u);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "proc_reader.h"
+#include "typed_sampler.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using ProcessStats::RawCounters;
+using ProcessStats::TypedSampler;
+namespace Metrics = ProcessStats::Metrics;
+
+namespace {
+    // Detects a member only the selected metrics provide
+    template <typename T, typename = void>
+    struct HasMemory : std::false_type {};
+    template <typename T>
+    struct HasMemory<T, std::void_t<decltype(std::declval<T>().memoryMB)>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct HasCpu : std::false_type {};
+    template <typename T>
+    struct HasCpu<T, std::void_t<decltype(std::declval<T>().cpuPercent)>> : std::true_type {};
+
+    void burnCpu(std::chrono::milliseconds duration) {
+        volatile double sink = 0.0;
+        const auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end) {
+            for (int i = 0; i < 10000; ++i) {
+                sink = sink + i * 0.5;
+            }
+        }
+    }
+}
+
+// =============================================================================
+// TypedSampler Tests
+// =============================================================================
+
+// Verifies that readings carry the selected metrics only
+TEST(TypedSamplerTest, ReadingHoldsSelectedMetricsOnly) {
+    using RssReading = TypedSampler<Metrics::Rss>::Reading;
+    using CpuReading = TypedSampler<Metrics::Cpu>::Reading;
+    using AllReading = TypedSampler<Metrics::Cpu | Metrics::Rss>::Reading;
+    static_assert(HasMemory<RssReading>::value && !HasCpu<RssReading>::value, "RSS only");
+    static_assert(HasCpu<CpuReading>::value && !HasMemory<CpuReading>::value, "CPU only");
+    static_assert(HasCpu<AllReading>::value && HasMemory<AllReading>::value, "both");
+    EXPECT_LT(sizeof(RssReading), sizeof(CpuReading));
+    EXPECT_LT(sizeof(CpuReading), sizeof(AllReading));
+    EXPECT_EQ(sizeof(RssReading), 2 * sizeof(double));
+}
+
+// Verifies that an RSS-only sampler reads what the full reader does and
+// keeps no history
+TEST(TypedSamplerTest, RssOnlyMatchesFullRead) {
+    TypedSampler<Metrics::Rss> sampler;
+    const RawCounters full = ProcessStats::readRawCounters(getpid());
+    const auto reading = sampler.sample(getpid());
+    ASSERT_TRUE(reading.valid);
+    EXPECT_GT(reading.memoryMB, 0.0);
+    EXPECT_NEAR(reading.memoryMB, full.memoryMB, 1.0);
+    EXPECT_EQ(sampler.historySize(), 0u);
+
+#ifdef __linux__
+    // The same figure /proc/[pid]/status reports as VmRSS
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    double vmRssKB = 0.0;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            vmRssKB = std::strtod(line.c_str() + 6, nullptr);
+        }
+    }
+    EXPECT_NEAR(sampler.sample(getpid()).memoryMB, vmRssKB / 1024.0, 1.0);
+#endif
+}
+
+// Verifies that CPU percentages start from the second reading, as with Sampler
+TEST(TypedSamplerTest, CpuNeedsBaseline) {
+    TypedSampler<Metrics::Cpu> sampler;
+    const auto first = sampler.sample(getpid());
+    ASSERT_TRUE(first.valid);
+    EXPECT_EQ(first.cpuPercent, 0.0);
+    EXPECT_EQ(first.windowMs, 0);
+    EXPECT_EQ(sampler.historySize(), 1u);
+
+    // Until the CPU time has moved by a clock tick, however loaded the machine
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    double seconds = 0.0;
+    do {
+        burnCpu(std::chrono::milliseconds(100));
+        ASSERT_TRUE(ProcessStats::readCpuTimeSeconds(getpid(), seconds));
+    } while (seconds <= first.cpuTimeSeconds && std::chrono::steady_clock::now() < deadline);
+    const auto second = sampler.sample(getpid());
+    ASSERT_TRUE(second.valid);
+    EXPECT_GT(second.cpuTimeSeconds, first.cpuTimeSeconds);
+    EXPECT_GT(second.cpuPercent, 0.0);
+    EXPECT_GE(second.windowMs, 100);
+
+    sampler.forget(getpid());
+    EXPECT_EQ(sampler.historySize(), 0u);
+}
+
+// Verifies batches and processes that cannot be read
+TEST(TypedSamplerTest, SamplesBatchesAndInvalidPids) {
+    TypedSampler<Metrics::All> sampler;
+    const std::vector<int64_t> pids = {getpid(), 0, -5, 999999999};
+    std::vector<TypedSampler<Metrics::All>::Reading> readings(pids.size());
+    sampler.sample(pids.data(), pids.size(), readings.data());
+    EXPECT_TRUE(readings[0].valid);
+    EXPECT_GT(readings[0].memoryMB, 0.0);
+    for (std::size_t i = 1; i < readings.size(); ++i) {
+        EXPECT_FALSE(readings[i].valid) << "pid " << pids[i];
+        EXPECT_EQ(readings[i].memoryMB, 0.0);
+        EXPECT_EQ(readings[i].cpuTimeSeconds, 0.0);
+    }
+    EXPECT_EQ(sampler.historySize(), 1u);
+    sampler.clearHistory();
+    EXPECT_EQ(sampler.historySize(), 0u);
+}
+
+// Verifies the single-counter readers against the combined one
+TEST(TypedSamplerTest, SingleCounterReadersMatchRawCounters) {
+    // CPU time moves in clock ticks, and a loaded machine may give us less
+    // than one per burn: burn until it shows, within a deadline
+    double seconds = -1.0;
+    double megabytes = -1.0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    do {
+        burnCpu(std::chrono::milliseconds(20));
+        ASSERT_TRUE(ProcessStats::readCpuTimeSeconds(getpid(), seconds));
+    } while (seconds <= 0.0 && std::chrono::steady_clock::now() < deadline);
+    ASSERT_TRUE(ProcessStats::readResidentMB(getpid(), megabytes));
+    const RawCounters full = ProcessStats::readRawCounters(getpid());
+    EXPECT_GT(seconds, 0.0);
+    EXPECT_LE(seconds, full.cpuTimeSeconds);
+    EXPECT_NEAR(megabytes, full.memoryMB, 1.0);
+
+    EXPECT_FALSE(ProcessStats::readCpuTimeSeconds(999999999, seconds));
+    EXPECT_EQ(seconds, 0.0);
+    EXPECT_FALSE(ProcessStats::readResidentMB(0, megabytes));
+}